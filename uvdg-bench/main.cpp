@@ -0,0 +1,371 @@
+// End-to-end ingest benchmark: connects to an rtl-uvd compatible feed (such
+// as uvdg-feedgen), runs every line through RtlUvdParser into a realtime
+// UvdState and reports throughput, drop rate and latency percentiles, and
+// in builds that count them the heap allocations per line after a warm-up.
+// Alert rules can be loaded to measure what evaluating them costs. With
+// --shm it reads the records of a RecordRing (uvdg-feedgen --shm) instead.
+// The feed is asked for binary frames unless --text is given.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "Socket.h"
+#include "AlertEngine.h"
+#include "AllocationCounter.h"
+#include "Clock.h"
+#include "LatencyHistogram.h"
+#include "LatencyTracer.h"
+#include "RecordRing.h"
+#include "RtlUvdFeedReader.h"
+#include "SpanRecorder.h"
+#include "Thread.h"
+#include "RtlUvdParser.h"
+#include "UvdState.h"
+
+#define RULE_LINE_LENGTH 4096
+#define RING_READ_RECORDS 1024
+#define RING_OPEN_SECONDS 30
+
+typedef struct {
+    unsigned long receivedLines;
+    unsigned long acceptedLines;
+    unsigned long sentLines;        // from the feedgen trailer, 0 if unknown
+    unsigned long sentDuplicates;
+} BenchCounters;
+
+static long long localTimeOfDay()
+{
+    // wall clock to the microsecond, combined from a coarse and a monotonic clock
+    static time_t baseTime = 0;
+    static long long baseLocal = 0;
+    if (baseTime == 0)
+    {
+        baseTime = time(NULL);
+        while (time(NULL) == baseTime) {}
+        baseTime = time(NULL);
+        baseLocal = ClockMicroseconds();
+    }
+
+    struct tm date = *localtime(&baseTime);
+    long long base = (date.tm_hour * 3600LL + date.tm_min * 60 + date.tm_sec) * 1000000;
+    return (base + ClockMicroseconds() - baseLocal) % (86400LL * 1000000);
+}
+
+static void countLine(UvdTime lineTime, long long recvLocal, bool isMeasuringEndToEnd, BenchCounters *counters,
+                      LatencyHistogram *socketToState, LatencyHistogram *feedToState)
+{
+    long long doneLocal = ClockMicroseconds();
+    if (lineTime <= 0) return;
+
+    counters->acceptedLines++;
+    socketToState->record(doneLocal - recvLocal);
+
+    if (isMeasuringEndToEnd)
+    {
+        long long lineTimeOfDay = lineTime % UVD_DAY;
+        long long latency = localTimeOfDay() - lineTimeOfDay;
+        if (latency < -43200LL * 1000000) latency += 86400LL * 1000000;
+        feedToState->record(latency);
+    }
+}
+
+static bool openRing(RecordRing *ring, const char *name)
+{
+    // the producer may start after the benchmark
+    long long stopLocal = ClockMicroseconds() + RING_OPEN_SECONDS * 1000000LL;
+    while (!ring->open(name))
+    {
+        if (ClockMicroseconds() >= stopLocal) return false;
+        ThreadSleep(100);
+    }
+    return true;
+}
+
+static bool loadAlertRules(AlertEngine *alerts, const char *path)
+{
+    FILE *file = fopen(path, "r");
+    if (file == NULL) return false;
+
+    // one rule per line, blank and # lines are skipped by addRule
+    char line[RULE_LINE_LENGTH];
+    bool isValid = true;
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        if (!alerts->addRule(line)) isValid = false;
+    }
+    fclose(file);
+    return isValid;
+}
+
+static void printUsage()
+{
+    printf("usage: uvdg-bench [--host H] [--port N] [--text] [--shm NAME] [--seconds N] [--warmup N] [--e2e] [--spans PATH] [--alerts PATH]\n");
+    printf("  --text  don't ask the feed for binary frames\n");
+    printf("  --shm   read the shared-memory ring NAME rather than a TCP feed\n");
+    printf("  --warmup  seconds before allocations are counted as steady state (2)\n");
+    printf("  --e2e   also measure feed-to-state latency from line timestamps;\n");
+    printf("          only meaningful against a local feedgen running on the local clock\n");
+    printf("  --spans record spans while running and dump them as a Chrome trace\n");
+    printf("  --alerts evaluate the alert rules in a file, one per line\n");
+}
+
+int main(int argc, char **argv)
+{
+    const char *host = "127.0.0.1";
+    int port = 31003;
+    int seconds = 0;
+    int warmupSeconds = 2;
+    bool isMeasuringEndToEnd = false;
+    const char *spansPath = NULL;
+    const char *alertsPath = NULL;
+    const char *ringName = NULL;
+    bool isTextOnly = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--host") == 0 && i + 1 < argc) host = argv[++i];
+        else if (strcmp(argv[i], "--port") == 0 && i + 1 < argc) port = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) seconds = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc) warmupSeconds = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--e2e") == 0) isMeasuringEndToEnd = true;
+        else if (strcmp(argv[i], "--spans") == 0 && i + 1 < argc) spansPath = argv[++i];
+        else if (strcmp(argv[i], "--alerts") == 0 && i + 1 < argc) alertsPath = argv[++i];
+        else if (strcmp(argv[i], "--shm") == 0 && i + 1 < argc) ringName = argv[++i];
+        else if (strcmp(argv[i], "--text") == 0) isTextOnly = true;
+        else
+        {
+            printUsage();
+            return 1;
+        }
+    }
+
+    AlertEngine alerts;
+    if (alertsPath != NULL && !loadAlertRules(&alerts, alertsPath))
+    {
+        printf("can't load the alert rules in %s.\n", alertsPath);
+        return 1;
+    }
+
+    if (!SocketStartup()) return 1;
+
+    if (isMeasuringEndToEnd)
+    {
+        // calibrate the wall clock before any line is timed
+        localTimeOfDay();
+    }
+
+    Socket socket = SOCKET_INVALID;
+    RecordRing *ring = NULL;
+    if (ringName != NULL)
+    {
+        ring = new RecordRing();
+        if (!openRing(ring, ringName))
+        {
+            printf("no ring %s.\n", ringName);
+            return 1;
+        }
+    }
+    else
+    {
+        socket = SocketConnect(host, port);
+        if (socket == SOCKET_INVALID)
+        {
+            printf("can't connect to %s:%d.\n", host, port);
+            return 1;
+        }
+
+        if (!isTextOnly)
+        {
+            SocketSend(socket, WIRE_HELLO "\n", (int)strlen(WIRE_HELLO "\n"));
+        }
+    }
+
+    UvdState *state = new UvdState();
+    RtlUvdParser *parser = new RtlUvdParser(state);
+    state->startRealtimeMode();
+    if (alertsPath != NULL) state->setAlertEngine(&alerts);
+
+    SpanRecorder::setEnabled(spansPath != NULL);
+
+    LatencyTracer tracer;
+    parser->setLatencyTracer(&tracer);
+
+    LatencyHistogram socketToState;
+    LatencyHistogram feedToState;
+    BenchCounters counters;
+    memset(&counters, 0, sizeof(counters));
+
+    RtlUvdFeedReader reader;
+    RingRecord *records = (RingRecord *)malloc(RING_READ_RECORDS * sizeof(RingRecord));
+
+    long long startLocal = ClockMicroseconds();
+    long long reportLocal = startLocal;
+    unsigned long reportLines = 0;
+    bool isDone = false;
+
+    bool isWarm = false;
+    unsigned long warmLines = 0;
+    unsigned long long warmAllocations[TraceStageCount];
+
+    while (!isDone)
+    {
+        if (ring != NULL)
+        {
+            int count = ring->read(records, RING_READ_RECORDS);
+            if (count == 0 && ring->isClosed())
+            {
+                // what the producer wrote before it closed the ring
+                count = ring->read(records, RING_READ_RECORDS);
+                if (count == 0) break;
+            }
+            if (count == 0) ring->wait(100);
+
+            long long recvLocal = ClockMicroseconds();
+            tracer.beginBatch();
+
+            TRACE_SPAN("processRecord batch");
+            for (int i = 0; i < count; i++)
+            {
+                counters.receivedLines++;
+
+                UvdTime lineTime = parser->processRecord(&records[i]);
+                countLine(lineTime, recvLocal, isMeasuringEndToEnd, &counters, &socketToState, &feedToState);
+            }
+        }
+        else
+        {
+            int space;
+            char *buffer = reader.space(&space);
+            int received = SocketRecv(socket, buffer, space);
+            if (received <= 0) break;
+
+            long long recvLocal = ClockMicroseconds();
+            tracer.beginBatch();
+
+            TRACE_SPAN("processLine batch");
+            reader.append(received);
+
+            // lines as QTcpSocket::readLine splits them in MainWindow::tcpHaveBytes,
+            // or frames after the feed took the hello
+            char *line;
+            const RingRecord *record;
+            FeedItem item;
+            while ((item = reader.next(&line, &record)) != FeedItemNone)
+            {
+                if (item == FeedItemLine && line[0] == '#')
+                {
+                    sscanf(line, "# feedgen: %lu lines, %lu duplicates", &counters.sentLines, &counters.sentDuplicates);
+                    isDone = true;
+                    continue;
+                }
+
+                counters.receivedLines++;
+
+                UvdTime lineTime = item == FeedItemRecord ? parser->processRecord(record) : parser->processLine(line);
+                countLine(lineTime, recvLocal, isMeasuringEndToEnd, &counters, &socketToState, &feedToState);
+            }
+        }
+
+        long long nowLocal = ClockMicroseconds();
+        if (nowLocal >= reportLocal + 1000000)
+        {
+            printf("%.0f lines/s, %lu received, %lu accepted, socket-to-state p50 %lld us p99 %lld us.\n",
+                   (counters.receivedLines - reportLines) * 1000000.0 / (nowLocal - reportLocal),
+                   counters.receivedLines, counters.acceptedLines,
+                   socketToState.percentile(50.0), socketToState.percentile(99.0));
+            reportLocal = nowLocal;
+            reportLines = counters.receivedLines;
+        }
+
+        if (!isWarm && nowLocal - startLocal >= warmupSeconds * 1000000LL)
+        {
+            isWarm = true;
+            warmLines = counters.acceptedLines;
+            for (int i = 0; i < TraceStageCount; i++) warmAllocations[i] = tracer.allocations((TraceStage)i);
+        }
+
+        if (seconds > 0 && nowLocal - startLocal >= seconds * 1000000LL) break;
+    }
+
+    double elapsed = (ClockMicroseconds() - startLocal) / 1000000.0;
+
+    printf("\n");
+    printf("lines received:    %lu in %.1f s, %.0f lines/s sustained\n", counters.receivedLines, elapsed, counters.receivedLines / elapsed);
+    printf("lines accepted:    %lu\n", counters.acceptedLines);
+    if (ring == NULL)
+    {
+        printf("feed:              %s, %.1f bytes per line\n", reader.isBinary() ? "binary frames" : "text lines",
+               counters.receivedLines > 0 ? reader.byteCount() / (double)counters.receivedLines : 0.0);
+    }
+
+    if (ring != NULL)
+    {
+        unsigned long long written = ring->writtenCount();
+        unsigned long long dropped = ring->droppedCount();
+        printf("records written:   %llu, %llu more dropped by a full ring\n", written, dropped);
+        printf("drop rate:         %.4f%% in the ring, repeated records are not known\n",
+               written + dropped > 0 ? dropped * 100.0 / (written + dropped) : 0.0);
+    }
+    else if (counters.sentLines > 0)
+    {
+        unsigned long expected = counters.sentLines - counters.sentDuplicates;
+        long dropped = (long)expected - (long)counters.acceptedLines;
+        printf("lines sent:        %lu, %lu of them duplicates\n", counters.sentLines, counters.sentDuplicates);
+        printf("drop rate:         %.4f%% (%ld unique lines not accepted)\n", expected > 0 ? dropped * 100.0 / expected : 0.0, dropped);
+    }
+    else
+    {
+        printf("drop rate:         unknown, the feed did not report what it sent\n");
+    }
+
+    printf("socket-to-state:   p50 %lld us, p99 %lld us, max %lld us\n",
+           socketToState.percentile(50.0), socketToState.percentile(99.0), socketToState.max());
+
+    for (int i = TraceStageParse; i <= TraceStageInsert; i++)
+    {
+        LatencyHistogram *histogram = tracer.histogram((TraceStage)i);
+        printf("recv-to-%-6s     p50 %lld us, p99 %lld us, max %lld us\n", LatencyTracer::stageName((TraceStage)i),
+               histogram->percentile(50.0), histogram->percentile(99.0), histogram->max());
+    }
+
+    if (!AllocationCounter::isCounting())
+    {
+        printf("allocations:       not counted, build with make COUNT_ALLOCATIONS=1\n");
+    }
+    else
+    {
+        for (int i = TraceStageParse; i <= TraceStageInsert; i++)
+        {
+            unsigned long long allocations = tracer.allocations((TraceStage)i);
+            printf("allocs-in-%-6s   %llu in all", LatencyTracer::stageName((TraceStage)i), allocations);
+            if (isWarm)
+            {
+                printf(", %llu in %lu lines after the %d s warm-up", allocations - warmAllocations[i], counters.acceptedLines - warmLines, warmupSeconds);
+            }
+            printf("\n");
+        }
+    }
+
+    if (alertsPath != NULL)
+    {
+        printf("alerts:            %lu matches of %lu rules\n", alerts.matchCount(), (unsigned long)alerts.ruleCount());
+    }
+
+    if (isMeasuringEndToEnd)
+    {
+        printf("feed-to-state:     p50 %lld us, p99 %lld us, max %lld us\n",
+               feedToState.percentile(50.0), feedToState.percentile(99.0), feedToState.max());
+    }
+
+    if (spansPath != NULL)
+    {
+        printf("spans %s %s\n", SpanRecorder::dump(spansPath) ? "dumped to" : "can't be written to", spansPath);
+    }
+
+    if (ring != NULL) delete ring;
+    else SocketClose(socket);
+    free(records);
+
+    return 0;
+}
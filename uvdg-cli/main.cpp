@@ -0,0 +1,332 @@
+// Headless batch analyzer: parses rtl-uvd logs in parallel and prints the
+// per tail number aircraft statistics report, and exports merged archives
+// as timeline images.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "AircraftStatistics.h"
+#include "Clock.h"
+#include "Log.h"
+#include "Mutex.h"
+#include "RtlUvdArchive.h"
+#include "RtlUvdParser.h"
+#include "RtlUvdRangeLoader.h"
+#include "Thread.h"
+#include "UvdImageExporter.h"
+#include "UvdState.h"
+
+#define MAX_JOBS 64
+#define EXPORT_DEFAULT_HEIGHT 600
+
+typedef struct {
+    std::vector<const char *> paths;
+    size_t nextPath;
+    bool hidesTailNumbers;
+
+    const char *exportPath;
+    const char *exportFrom;
+    const char *exportTo;
+    double exportSlice;
+    int exportHeight;
+
+    AircraftStatistics statistics;
+    unsigned long failedFiles;
+
+    Mutex lock;
+} BatchContext;
+
+static void processFile(BatchContext *context, const char *path)
+{
+    long long startLocal = ClockMicroseconds();
+
+    UvdState *state = new UvdState();
+    state->setHidesTailNumbers(context->hidesTailNumbers);
+
+    int yyyy, mm, dd;
+    if (RtlUvdParser::dateFromLogFileName(path, &yyyy, &mm, &dd))
+    {
+        state->setStartDate(yyyy, mm, dd);
+    }
+    RtlUvdParser *parser = new RtlUvdParser(state);
+
+    bool isParsed = parser->parseLogFile(path);
+
+    AircraftStatistics *statistics = state->statistics();
+    double seconds = (ClockMicroseconds() - startLocal) / 1000000.0;
+
+    // results are streamed as files complete, the merged report comes last
+    MutexLock(&context->lock);
+    if (isParsed)
+    {
+        context->statistics.merge(statistics);
+        printf("%s: %lu points, %lu occurrences, %lu aircrafts, %.2f s.\n", path,
+               (unsigned long)state->points()->size(), (unsigned long)state->occurrences()->size(),
+               (unsigned long)statistics->aircraftCount(), seconds);
+    }
+    else
+    {
+        context->failedFiles++;
+        printf("%s: can't open.\n", path);
+    }
+    fflush(stdout);
+    MutexUnlock(&context->lock);
+
+    delete parser;
+    delete state;
+}
+
+static void workerThread(void *parameter)
+{
+    BatchContext *context = (BatchContext *)parameter;
+
+    while (true)
+    {
+        MutexLock(&context->lock);
+        const char *path = NULL;
+        if (context->nextPath < context->paths.size())
+        {
+            path = context->paths[context->nextPath++];
+        }
+        MutexUnlock(&context->lock);
+
+        if (path == NULL) break;
+
+        processFile(context, path);
+    }
+}
+
+static bool parseExportTime(UvdState *state, const char *text, UvdTime *time)
+{
+    // YYYY-MM-DD[THH:MM], relative to the start date of the archive
+    int yyyy, mm, dd, hours = 0, minutes = 0;
+    int count = sscanf(text, "%d-%d-%dT%d:%d", &yyyy, &mm, &dd, &hours, &minutes);
+    if (count != 3 && count != 5) return false;
+
+    int startYyyy, startMm, startDd;
+    if (!state->getStartDate(&startYyyy, &startMm, &startDd)) return false;
+
+    int day = UvdState::dayNumber(yyyy, mm, dd) - UvdState::dayNumber(startYyyy, startMm, startDd);
+    *time = day * UVD_DAY + (hours * 60 + minutes) * 60 * UVD_SECOND;
+    return true;
+}
+
+static int exportRange(BatchContext *context, UvdState *state)
+{
+    UvdTime timeSlice = (UvdTime)(context->exportSlice * UVD_SECOND);
+    if (timeSlice < 1) timeSlice = 1;
+
+    // all of it by default, the last point included
+    UvdTime leftTime, rightTime;
+    state->lock();
+    bool hasBounds = state->getTimeBounds(&leftTime, &rightTime);
+    state->unlock();
+    if (!hasBounds)
+    {
+        printf("nothing to export.\n");
+        return 2;
+    }
+    rightTime += timeSlice;
+
+    if ((context->exportFrom != NULL && !parseExportTime(state, context->exportFrom, &leftTime)) ||
+        (context->exportTo != NULL && !parseExportTime(state, context->exportTo, &rightTime)))
+    {
+        printf("bad export range.\n");
+        return 1;
+    }
+
+    UvdImageExporter *exporter = new UvdImageExporter(state);
+
+    long long startLocal = ClockMicroseconds();
+    bool isExported = exporter->exportPng(context->exportPath, leftTime, rightTime, timeSlice, context->exportHeight);
+    double seconds = (ClockMicroseconds() - startLocal) / 1000000.0;
+
+    int result = 0;
+    if (isExported)
+    {
+        printf("\nexported %dx%d pixels to %s in %.2f s.\n", exporter->width(), exporter->height(), context->exportPath, seconds);
+    }
+    else
+    {
+        printf("\ncan't export to %s.\n", context->exportPath);
+        result = 2;
+    }
+
+    delete exporter;
+
+    return result;
+}
+
+static RtlUvdArchive *createArchive(BatchContext *context, UvdState *state)
+{
+    RtlUvdArchive *archive = new RtlUvdArchive(state);
+
+    std::vector<const char *>::iterator iter;
+    for (iter = context->paths.begin(); iter != context->paths.end(); ++iter)
+    {
+        if (archive->addFile(*iter)) continue;
+        if (archive->addDirectory(*iter, ARCHIVE_DAY_ANY, ARCHIVE_DAY_ANY) > 0) continue;
+
+        printf("%s: no daily logs.\n", *iter);
+    }
+
+    return archive;
+}
+
+// the exporter pulls its windows through a range loader, so an export
+// holds a few hours of the archive at a time however long it is
+static int exportImage(BatchContext *context)
+{
+    UvdState *state = new UvdState();
+    state->setHidesTailNumbers(context->hidesTailNumbers);
+    RtlUvdArchive *archive = createArchive(context, state);
+    RtlUvdRangeLoader *rangeLoader = new RtlUvdRangeLoader(state, archive);
+    delete archive;
+
+    int result = 0;
+    if (rangeLoader->open())
+    {
+        result = exportRange(context, state);
+    }
+    else
+    {
+        printf("nothing to export.\n");
+        result = 2;
+    }
+
+    delete rangeLoader;
+    delete state;
+
+    return result;
+}
+
+static int loadArchive(BatchContext *context, int jobs)
+{
+    UvdState *state = new UvdState();
+    state->setHidesTailNumbers(context->hidesTailNumbers);
+    RtlUvdArchive *archive = createArchive(context, state);
+
+    long long startLocal = ClockMicroseconds();
+    bool isLoaded = archive->load(jobs);
+    double seconds = (ClockMicroseconds() - startLocal) / 1000000.0;
+
+    int result = 0;
+    if (isLoaded)
+    {
+        for (size_t i = 0; i < archive->fileCount(); i++)
+        {
+            ArchiveFile *file = archive->file(i);
+            if (!file->isParsed) printf("%s: can't open.\n", file->path);
+        }
+
+        printf("%lu file(s) merged in %.2f s with %d job(s): %lu points, %lu occurrences.\n\n",
+               (unsigned long)archive->fileCount(), seconds, jobs,
+               (unsigned long)state->points()->size(), (unsigned long)state->occurrences()->size());
+
+        state->statistics()->print(stdout, context->hidesTailNumbers);
+    }
+    else
+    {
+        printf("nothing loaded.\n");
+        result = 2;
+    }
+
+    delete archive;
+    delete state;
+
+    // after the report, with the merged archive freed
+    if (result == 0 && context->exportPath != NULL) result = exportImage(context);
+
+    return result;
+}
+
+static void printUsage()
+{
+    printf("usage: uvdg-cli [--jobs N] [--archive] [--hide-tail-numbers] [--verbose]\n");
+    printf("                [--export PNG [--from TIME] [--to TIME] [--slice SECONDS] [--height N]] LOG...\n");
+    printf("  --jobs N              files parsed in parallel (number of processors)\n");
+    printf("  --archive             merge daily logs (or directories of them) into one\n");
+    printf("                        timeline, stitching flights across midnight\n");
+    printf("  --hide-tail-numbers   mask tail numbers in the report\n");
+    printf("  --verbose             print parser diagnostics\n");
+    printf("  --export PNG          write the timeline of the daily logs as an image, loading\n");
+    printf("                        a few hours of them at a time\n");
+    printf("  --from, --to TIME     range to export, YYYY-MM-DD[THH:MM] (all of it)\n");
+    printf("  --slice SECONDS       time per pixel column (1)\n");
+    printf("  --height N            rows for the altitudes (%d)\n", EXPORT_DEFAULT_HEIGHT);
+}
+
+int main(int argc, char **argv)
+{
+    BatchContext context;
+    context.nextPath = 0;
+    context.hidesTailNumbers = false;
+    context.failedFiles = 0;
+    context.exportPath = NULL;
+    context.exportFrom = NULL;
+    context.exportTo = NULL;
+    context.exportSlice = 1.0;
+    context.exportHeight = EXPORT_DEFAULT_HEIGHT;
+
+    int jobs = ThreadProcessorCount();
+    bool isArchive = false;
+    bool isVerbose = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) jobs = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--hide-tail-numbers") == 0) context.hidesTailNumbers = true;
+        else if (strcmp(argv[i], "--archive") == 0) isArchive = true;
+        else if (strcmp(argv[i], "--verbose") == 0) isVerbose = true;
+        else if (strcmp(argv[i], "--export") == 0 && i + 1 < argc) context.exportPath = argv[++i];
+        else if (strcmp(argv[i], "--from") == 0 && i + 1 < argc) context.exportFrom = argv[++i];
+        else if (strcmp(argv[i], "--to") == 0 && i + 1 < argc) context.exportTo = argv[++i];
+        else if (strcmp(argv[i], "--slice") == 0 && i + 1 < argc) context.exportSlice = atof(argv[++i]);
+        else if (strcmp(argv[i], "--height") == 0 && i + 1 < argc) context.exportHeight = atoi(argv[++i]);
+        else if (strncmp(argv[i], "--", 2) == 0)
+        {
+            printUsage();
+            return 1;
+        }
+        else context.paths.push_back(argv[i]);
+    }
+
+    if (context.paths.size() == 0)
+    {
+        printUsage();
+        return 1;
+    }
+
+    if (jobs < 1) jobs = 1;
+    if (jobs > MAX_JOBS) jobs = MAX_JOBS;
+
+    UvdLogSetEnabled(isVerbose);
+
+    if (isArchive) return loadArchive(&context, jobs);
+    if (context.exportPath != NULL) return exportImage(&context);
+
+    if ((size_t)jobs > context.paths.size()) jobs = (int)context.paths.size();
+    MutexCreate(&context.lock);
+
+    long long startLocal = ClockMicroseconds();
+
+    Thread threads[MAX_JOBS];
+    for (int i = 0; i < jobs; i++)
+    {
+        ThreadCreate(&threads[i], workerThread, &context);
+    }
+    for (int i = 0; i < jobs; i++)
+    {
+        ThreadJoin(&threads[i]);
+    }
+
+    double seconds = (ClockMicroseconds() - startLocal) / 1000000.0;
+    printf("%lu file(s) in %.2f s with %d job(s).\n\n", (unsigned long)(context.paths.size() - context.failedFiles), seconds, jobs);
+
+    context.statistics.print(stdout, context.hidesTailNumbers);
+
+    MutexDestroy(&context.lock);
+
+    return context.failedFiles > 0 ? 2 : 0;
+}
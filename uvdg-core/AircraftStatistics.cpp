@@ -0,0 +1,249 @@
+#include "AircraftStatistics.h"
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+static bool compareAirtime(const AircraftSummary &a, const AircraftSummary &b)
+{
+    return a.totalDuration > b.totalDuration;
+}
+
+static bool compareLastSeen(const AircraftSummary &a, const AircraftSummary &b)
+{
+    return a.lastSeen > b.lastSeen;
+}
+
+AircraftStatistics::AircraftStatistics()
+{
+    m_rowIndex = (int *)malloc(TAIL_NUMBER_COUNT * sizeof(int));
+    memset(m_rowIndex, 0xFF, TAIL_NUMBER_COUNT * sizeof(int));
+
+    m_baseDay = 0;
+    m_lastTime = 0;
+}
+
+AircraftStatistics::~AircraftStatistics()
+{
+    free(m_rowIndex);
+}
+
+void AircraftStatistics::clear()
+{
+    memset(m_rowIndex, 0xFF, TAIL_NUMBER_COUNT * sizeof(int));
+    m_rows.clear();
+    m_lastTime = 0;
+}
+
+// the points are kept, for a merge that adds the occurrences again
+void AircraftStatistics::clearOccurrences()
+{
+    std::vector<AircraftSummary>::iterator iter;
+    for (iter = m_rows.begin(); iter != m_rows.end(); ++iter)
+    {
+        (*iter).occurrences = 0;
+        (*iter).totalDuration = 0.0;
+        (*iter).maxDuration = 0.0;
+        (*iter).firstSeen = -1;
+        (*iter).lastSeen = 0;
+        (*iter).firstDay = -1;
+        (*iter).lastDay = -1;
+        (*iter).days = 0;
+    }
+    m_lastTime = 0;
+}
+
+AircraftSummary *AircraftStatistics::row(int tailNumber)
+{
+    if (tailNumber < 0 || tailNumber >= TAIL_NUMBER_COUNT) return NULL;
+
+    int index = m_rowIndex[tailNumber];
+    if (index < 0)
+    {
+        AircraftSummary summary;
+        memset(&summary, 0, sizeof(AircraftSummary));
+        summary.tailNumber = tailNumber;
+        summary.firstSeen = -1;
+        summary.firstDay = -1;
+        summary.lastDay = -1;
+
+        index = (int)m_rows.size();
+        m_rows.push_back(summary);
+        m_rowIndex[tailNumber] = index;
+    }
+
+    return &m_rows[index];
+}
+
+AircraftSummary *AircraftStatistics::summary(int tailNumber)
+{
+    if (tailNumber < 0 || tailNumber >= TAIL_NUMBER_COUNT) return NULL;
+
+    int index = m_rowIndex[tailNumber];
+    return index >= 0 ? &m_rows[index] : NULL;
+}
+
+void AircraftStatistics::lineSeen(int tailNumber, UvdTime time)
+{
+    AircraftSummary *summary = row(tailNumber);
+    if (summary == NULL) return;
+
+    if (summary->firstSeen < 0 || time < summary->firstSeen) summary->firstSeen = time;
+    if (time > summary->lastSeen) summary->lastSeen = time;
+    if (time > m_lastTime) m_lastTime = time;
+}
+
+void AircraftStatistics::addOccurrence(int tailNumber, UvdTime firstTime, UvdTime lastTime)
+{
+    AircraftSummary *summary = row(tailNumber);
+    if (summary == NULL) return;
+
+    double duration = UvdTimeSeconds(lastTime - firstTime);
+    summary->occurrences++;
+    summary->totalDuration += duration;
+    if (duration > summary->maxDuration) summary->maxDuration = duration;
+
+    if (summary->firstSeen < 0 || firstTime < summary->firstSeen) summary->firstSeen = firstTime;
+    if (lastTime > summary->lastSeen) summary->lastSeen = lastTime;
+    if (lastTime > m_lastTime) m_lastTime = lastTime;
+
+    // occurrences of one aircraft are finalized in time order, so only days
+    // after the last counted one can be new
+    int firstDay = dayForTime(firstTime);
+    int lastDay = dayForTime(lastTime);
+    if (summary->lastDay < 0)
+    {
+        summary->firstDay = firstDay;
+    }
+    else if (firstDay <= summary->lastDay)
+    {
+        firstDay = summary->lastDay + 1;
+    }
+    if (lastDay >= firstDay)
+    {
+        summary->days += lastDay - firstDay + 1;
+        summary->lastDay = lastDay;
+    }
+}
+
+void AircraftStatistics::addPoint(int tailNumber, int altitude)
+{
+    AircraftSummary *summary = row(tailNumber);
+    if (summary == NULL) return;
+
+    if (summary->points == 0 || altitude < summary->minAltitude) summary->minAltitude = altitude;
+    if (summary->points == 0 || altitude > summary->maxAltitude) summary->maxAltitude = altitude;
+    summary->points++;
+}
+
+void AircraftStatistics::merge(AircraftStatistics *other)
+{
+    UvdTime timeShift = (other->m_baseDay - m_baseDay) * UVD_DAY;
+
+    std::vector<AircraftSummary>::iterator iter;
+    for (iter = other->m_rows.begin(); iter != other->m_rows.end(); ++iter)
+    {
+        AircraftSummary *source = &(*iter);
+        AircraftSummary *summary = row(source->tailNumber);
+
+        if (source->firstSeen >= 0)
+        {
+            UvdTime firstSeen = source->firstSeen + timeShift;
+            UvdTime lastSeen = source->lastSeen + timeShift;
+            if (summary->firstSeen < 0 || firstSeen < summary->firstSeen) summary->firstSeen = firstSeen;
+            if (lastSeen > summary->lastSeen) summary->lastSeen = lastSeen;
+            if (lastSeen > m_lastTime) m_lastTime = lastSeen;
+        }
+
+        summary->occurrences += source->occurrences;
+        summary->totalDuration += source->totalDuration;
+        if (source->maxDuration > summary->maxDuration) summary->maxDuration = source->maxDuration;
+
+        // exact for reports over disjoint periods (daily logs), otherwise
+        // the shared range is assumed to be seen in both
+        if (source->days > 0)
+        {
+            if (summary->days == 0)
+            {
+                summary->firstDay = source->firstDay;
+                summary->lastDay = source->lastDay;
+                summary->days = source->days;
+            }
+            else
+            {
+                int overlap = std::min(summary->lastDay, source->lastDay) - std::max(summary->firstDay, source->firstDay) + 1;
+                int days = summary->days + source->days - std::max(overlap, 0);
+                summary->days = std::max(days, std::max(summary->days, source->days));
+                summary->firstDay = std::min(summary->firstDay, source->firstDay);
+                summary->lastDay = std::max(summary->lastDay, source->lastDay);
+            }
+        }
+
+        mergeSummaryPoints(summary, source);
+    }
+}
+
+void AircraftStatistics::mergePoints(AircraftStatistics *other)
+{
+    std::vector<AircraftSummary>::iterator iter;
+    for (iter = other->m_rows.begin(); iter != other->m_rows.end(); ++iter)
+    {
+        AircraftSummary *source = &(*iter);
+        if (source->points == 0) continue;
+
+        mergeSummaryPoints(row(source->tailNumber), source);
+    }
+}
+
+void AircraftStatistics::mergeSummaryPoints(AircraftSummary *summary, AircraftSummary *source)
+{
+    if (source->points == 0) return;
+
+    if (summary->points == 0 || source->minAltitude < summary->minAltitude) summary->minAltitude = source->minAltitude;
+    if (summary->points == 0 || source->maxAltitude > summary->maxAltitude) summary->maxAltitude = source->maxAltitude;
+    summary->points += source->points;
+}
+
+void AircraftStatistics::topByAirtime(size_t count, std::vector<AircraftSummary> *result)
+{
+    *result = m_rows;
+    if (count > result->size()) count = result->size();
+
+    std::partial_sort(result->begin(), result->begin() + count, result->end(), compareAirtime);
+    result->resize(count);
+}
+
+void AircraftStatistics::seenSince(UvdTime time, std::vector<AircraftSummary> *result)
+{
+    result->clear();
+
+    std::vector<AircraftSummary>::iterator iter;
+    for (iter = m_rows.begin(); iter != m_rows.end(); ++iter)
+    {
+        if ((*iter).lastSeen >= time) result->push_back(*iter);
+    }
+
+    std::sort(result->begin(), result->end(), compareLastSeen);
+}
+
+void AircraftStatistics::print(FILE *file, bool hidesTailNumbers)
+{
+    fprintf(file, "Unique aircrafts: %lu.\n", (unsigned long)m_rows.size());
+
+    for (int tailNumber = 0; tailNumber < TAIL_NUMBER_COUNT; tailNumber++)
+    {
+        if (m_rowIndex[tailNumber] < 0) continue;
+
+        AircraftSummary *summary = &m_rows[m_rowIndex[tailNumber]];
+        char tailNumberString[6];
+        if (hidesTailNumbers) strcpy(tailNumberString, "*****");
+        else sprintf(tailNumberString, "%05d", tailNumber);
+
+        fprintf(file, "%s: %lu occurrences, duration %.0lf mins (max %.0lf) over %d day(s)",
+                tailNumberString, summary->occurrences, summary->totalDuration / 60.0, summary->maxDuration / 60.0, summary->days);
+        if (summary->points > 0)
+        {
+            fprintf(file, ", %lu points at %d-%dm", summary->points, summary->minAltitude, summary->maxAltitude);
+        }
+        fprintf(file, ".\n");
+    }
+}
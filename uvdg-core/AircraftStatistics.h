@@ -0,0 +1,69 @@
+#ifndef __AIRCRAFTSTATISTICS_H__
+#define __AIRCRAFTSTATISTICS_H__
+
+#include <stdio.h>
+#include <vector>
+#include "UvdTime.h"
+
+#define TAIL_NUMBER_COUNT 100000
+
+typedef struct {
+    int tailNumber;
+    unsigned long occurrences;
+    double totalDuration;   // seconds
+    double maxDuration;
+    UvdTime firstSeen;
+    UvdTime lastSeen;
+    int firstDay, lastDay;
+    int days;
+    unsigned long points;
+    int minAltitude, maxAltitude;
+} AircraftSummary;
+
+// Per tail number aggregates, updated in O(1) as UvdState finalizes
+// occurrences: a direct index over all 5-digit tail numbers points into a
+// dense row table, so queries only walk aircrafts actually seen.
+// Times are on the state clock (seconds since the start date midnight),
+// days are absolute day numbers, so reports of several logs can be merged.
+class AircraftStatistics
+{
+    friend class UvdSnapshot;
+
+    int *m_rowIndex;
+    std::vector<AircraftSummary> m_rows;
+
+    int m_baseDay;
+    UvdTime m_lastTime;
+
+    AircraftStatistics(const AircraftStatistics &);
+    AircraftStatistics &operator=(const AircraftStatistics &);
+
+    AircraftSummary *row(int tailNumber);
+    void mergeSummaryPoints(AircraftSummary *summary, AircraftSummary *source);
+    int dayForTime(UvdTime time) { return m_baseDay + (int)(time / UVD_DAY); }
+
+public:
+    AircraftStatistics();
+    ~AircraftStatistics();
+
+    void setBaseDay(int day) { m_baseDay = day; }
+    void clear();
+    void clearOccurrences();
+
+    void lineSeen(int tailNumber, UvdTime time);
+    void addOccurrence(int tailNumber, UvdTime firstTime, UvdTime lastTime);
+    void addPoint(int tailNumber, int altitude);
+    void merge(AircraftStatistics *other);
+    void mergePoints(AircraftStatistics *other);
+
+    size_t aircraftCount() { return m_rows.size(); }
+    UvdTime lastTime() { return m_lastTime; }
+    AircraftSummary *summary(int tailNumber);
+
+    void topByAirtime(size_t count, std::vector<AircraftSummary> *result);
+    void seenSince(UvdTime time, std::vector<AircraftSummary> *result);
+
+    void print(FILE *file, bool hidesTailNumbers);
+};
+
+#endif
@@ -0,0 +1,437 @@
+#include "AlertEngine.h"
+#include "Log.h"
+#include <algorithm>
+#include <stdlib.h>
+#include <string.h>
+
+#define ALERT_TOKEN_LENGTH 32
+#define WATCHLIST_EMPTY_SLOT -1
+
+static const char *eventNames[AlertEventCount] = { "k1", "k2", "new", "gone" };
+static const char *fieldNames[AlertFieldCount] = { "tail", "alt", "fuel", "amp", "conf", "dur" };
+static const char *opNames[AlertOpIn] = { "<", "<=", ">", ">=", "=", "!=" };
+
+// fields each event sets, the others read as 0
+static const bool eventFields[AlertEventCount][AlertFieldCount] = {
+    { true, false, false, true, true, false },
+    { true, true, true, true, true, false },
+    { true, false, false, false, false, false },
+    { true, false, false, false, false, true },
+};
+
+static bool isOperatorChar(char c)
+{
+    return c == '<' || c == '>' || c == '=' || c == '!';
+}
+
+// a word, a number or an operator; commas separate like spaces
+static const char *nextToken(const char *cursor, char *token)
+{
+    while (*cursor == ' ' || *cursor == '\t' || *cursor == ',' || *cursor == '\r' || *cursor == '\n') cursor++;
+
+    size_t length = 0;
+    bool isOperator = isOperatorChar(*cursor);
+    while (*cursor != 0 && *cursor != ' ' && *cursor != '\t' && *cursor != ',' && *cursor != '\r' && *cursor != '\n'
+           && isOperatorChar(*cursor) == isOperator)
+    {
+        if (length < ALERT_TOKEN_LENGTH - 1) token[length++] = *cursor;
+        cursor++;
+    }
+    token[length] = 0;
+    return cursor;
+}
+
+static int findName(const char *token, const char **names, int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        if (strcmp(token, names[i]) == 0) return i;
+    }
+    return -1;
+}
+
+static bool parseNumber(const char *token, int *value)
+{
+    char *end;
+    long number = strtol(token, &end, 10);
+    if (end == token || *end != 0) return false;
+
+    *value = (int)number;
+    return true;
+}
+
+static unsigned int watchlistHash(int tailNumber)
+{
+    unsigned int hash = (unsigned int)tailNumber * 2654435761u;
+    return hash ^ (hash >> 16);
+}
+
+AlertEngine::AlertEngine()
+{
+    m_function = NULL;
+    m_context = NULL;
+    m_matches = 0;
+
+    for (int i = 0; i < AlertEventCount; i++)
+    {
+        m_eventRuleCounts[i] = 0;
+        m_tailIndexes[i].tailCount = 0;
+    }
+}
+
+bool AlertEngine::addRule(const char *text)
+{
+    char token[ALERT_TOKEN_LENGTH];
+    const char *cursor = nextToken(text, token);
+    if (token[0] == 0 || token[0] == '#') return true;
+
+    AlertRule rule;
+    rule.actions = 0;
+    rule.lastMatchTime = -1;
+    strncpy(rule.text, text, ALERT_TEXT_LENGTH - 1);
+    rule.text[ALERT_TEXT_LENGTH - 1] = 0;
+    size_t length = strlen(rule.text);
+    while (length > 0 && (rule.text[length - 1] == '\n' || rule.text[length - 1] == '\r' || rule.text[length - 1] == ' ')) rule.text[--length] = 0;
+
+    while (strcmp(token, "beep") == 0 || strcmp(token, "notify") == 0)
+    {
+        rule.actions |= token[0] == 'b' ? ALERT_ACTION_BEEP : ALERT_ACTION_NOTIFY;
+        cursor = nextToken(cursor, token);
+    }
+    if (rule.actions == 0) rule.actions = ALERT_ACTION_NOTIFY;
+
+    int event = findName(token, eventNames, AlertEventCount);
+    if (event < 0)
+    {
+        UvdLog("alert rule \"%s\": unknown event \"%s\".\n", text, token);
+        return false;
+    }
+    rule.event = (AlertEvent)event;
+
+    // the lists of "in" tests are kept aside until the rule parses
+    std::vector<AlertInstruction> instructions;
+    std::vector<std::vector<int> > lists;
+    const char *error = NULL;
+    cursor = nextToken(cursor, token);
+    while (token[0] != 0 && error == NULL)
+    {
+        AlertInstruction instruction;
+
+        int field = findName(token, fieldNames, AlertFieldCount);
+        if (field < 0 || !eventFields[event][field])
+        {
+            error = "unknown field";
+            break;
+        }
+        instruction.field = (unsigned char)field;
+
+        cursor = nextToken(cursor, token);
+        bool isNegated = strcmp(token, "not") == 0;
+        if (isNegated) cursor = nextToken(cursor, token);
+
+        if (strcmp(token, "in") == 0)
+        {
+            std::vector<int> list;
+            int value;
+            cursor = nextToken(cursor, token);
+            while (parseNumber(token, &value))
+            {
+                list.push_back(value);
+                cursor = nextToken(cursor, token);
+            }
+            if (list.empty())
+            {
+                error = "empty list";
+                break;
+            }
+
+            instruction.op = (unsigned char)(isNegated ? AlertOpNotIn : AlertOpIn);
+            instruction.value = (int)lists.size();
+            lists.push_back(list);
+        }
+        else
+        {
+            int op = findName(token, opNames, AlertOpIn);
+            if (op < 0 || isNegated)
+            {
+                error = "unknown operator";
+                break;
+            }
+            instruction.op = (unsigned char)op;
+
+            cursor = nextToken(cursor, token);
+            if (!parseNumber(token, &instruction.value))
+            {
+                error = "number expected";
+                break;
+            }
+            cursor = nextToken(cursor, token);
+        }
+        instructions.push_back(instruction);
+
+        if (strcmp(token, "and") == 0)
+        {
+            cursor = nextToken(cursor, token);
+            if (token[0] == 0) error = "condition expected";
+        }
+        else if (token[0] != 0)
+        {
+            error = "\"and\" expected";
+        }
+    }
+
+    if (error != NULL)
+    {
+        UvdLog("alert rule \"%s\": %s at \"%s\".\n", text, error, token);
+        return false;
+    }
+
+    // the first test of the tail number for a value or a list picks the
+    // rule out of the index, the other tests run as the rule's program
+    std::vector<int> indexedTailNumbers;
+    std::vector<AlertInstruction> tests;
+    for (size_t i = 0; i < instructions.size(); i++)
+    {
+        AlertInstruction instruction = instructions[i];
+        bool isIndexable = instruction.field == AlertFieldTail && (instruction.op == AlertOpEqual || instruction.op == AlertOpIn);
+        if (isIndexable && indexedTailNumbers.empty())
+        {
+            if (instruction.op == AlertOpEqual) indexedTailNumbers.push_back(instruction.value);
+            else indexedTailNumbers = lists[instruction.value];
+            continue;
+        }
+
+        if (instruction.op == AlertOpIn || instruction.op == AlertOpNotIn)
+        {
+            instruction.value = addWatchlist(&lists[instruction.value]);
+        }
+        tests.push_back(instruction);
+    }
+
+    AlertInstruction match;
+    match.field = 0;
+    match.op = AlertOpMatch;
+    match.value = (int)m_rules.size();
+    tests.push_back(match);
+
+    std::vector<AlertInstruction> &program = indexedTailNumbers.empty() ? m_programs[event] : m_indexedPrograms[event];
+    int start = (int)program.size();
+    int next = (int)(program.size() + tests.size());
+    for (size_t i = 0; i < tests.size(); i++)
+    {
+        tests[i].next = next;
+        program.push_back(tests[i]);
+    }
+
+    // a tail number listed twice would run the rule twice
+    std::sort(indexedTailNumbers.begin(), indexedTailNumbers.end());
+    indexedTailNumbers.erase(std::unique(indexedTailNumbers.begin(), indexedTailNumbers.end()), indexedTailNumbers.end());
+    for (size_t i = 0; i < indexedTailNumbers.size(); i++)
+    {
+        indexTail(&m_tailIndexes[event], indexedTailNumbers[i], start);
+    }
+
+    m_rules.push_back(rule);
+    m_eventRuleCounts[event]++;
+    return true;
+}
+
+void AlertEngine::clear()
+{
+    m_rules.clear();
+    for (int i = 0; i < AlertEventCount; i++)
+    {
+        m_eventRuleCounts[i] = 0;
+        m_programs[i].clear();
+        m_indexedPrograms[i].clear();
+        m_tailIndexes[i].heads.clear();
+        m_tailIndexes[i].entries.clear();
+        m_tailIndexes[i].tailCount = 0;
+    }
+    m_watchlists.clear();
+    m_watchlistSlots.clear();
+    m_matches = 0;
+}
+
+int AlertEngine::addWatchlist(std::vector<int> *tailNumbers)
+{
+    // at most half full, so a lookup probes a slot or two
+    int slotCount = 8;
+    while (slotCount < 2 * (int)tailNumbers->size()) slotCount *= 2;
+
+    Watchlist watchlist;
+    watchlist.offset = (int)m_watchlistSlots.size();
+    watchlist.mask = slotCount - 1;
+    m_watchlistSlots.resize(m_watchlistSlots.size() + slotCount, WATCHLIST_EMPTY_SLOT);
+
+    int *slots = &m_watchlistSlots[watchlist.offset];
+    for (size_t i = 0; i < tailNumbers->size(); i++)
+    {
+        int tailNumber = (*tailNumbers)[i];
+        unsigned int slot = watchlistHash(tailNumber) & watchlist.mask;
+        while (slots[slot] != WATCHLIST_EMPTY_SLOT && slots[slot] != tailNumber)
+        {
+            slot = (slot + 1) & watchlist.mask;
+        }
+        slots[slot] = tailNumber;
+    }
+
+    m_watchlists.push_back(watchlist);
+    return (int)m_watchlists.size() - 1;
+}
+
+bool AlertEngine::isInWatchlist(int watchlist, int tailNumber)
+{
+    const Watchlist &list = m_watchlists[watchlist];
+    const int *slots = &m_watchlistSlots[list.offset];
+
+    unsigned int slot = watchlistHash(tailNumber) & list.mask;
+    while (slots[slot] != WATCHLIST_EMPTY_SLOT)
+    {
+        if (slots[slot] == tailNumber) return true;
+        slot = (slot + 1) & list.mask;
+    }
+    return false;
+}
+
+static int findTailSlot(AlertTailIndex *index, int tailNumber)
+{
+    unsigned int mask = (unsigned int)index->heads.size() - 1;
+    unsigned int slot = watchlistHash(tailNumber) & mask;
+    while (index->heads[slot] != WATCHLIST_EMPTY_SLOT && index->entries[index->heads[slot]].tailNumber != tailNumber)
+    {
+        slot = (slot + 1) & mask;
+    }
+    return (int)slot;
+}
+
+void AlertEngine::indexTail(AlertTailIndex *index, int tailNumber, int start)
+{
+    // grown (and rehashed) to stay at most half full
+    if (2 * (index->tailCount + 1) > (int)index->heads.size())
+    {
+        size_t slotCount = index->heads.empty() ? 64 : 2 * index->heads.size();
+        index->heads.assign(slotCount, WATCHLIST_EMPTY_SLOT);
+        for (size_t i = 0; i < index->entries.size(); i++)
+        {
+            // entries of one tail number are chained from its newest
+            int slot = findTailSlot(index, index->entries[i].tailNumber);
+            index->heads[slot] = (int)i;
+        }
+    }
+
+    AlertTailEntry entry;
+    entry.tailNumber = tailNumber;
+    entry.start = start;
+    entry.nextEntry = -1;
+
+    int slot = findTailSlot(index, tailNumber);
+    if (index->heads[slot] != WATCHLIST_EMPTY_SLOT)
+    {
+        entry.nextEntry = index->heads[slot];
+    }
+    else
+    {
+        index->tailCount++;
+    }
+    index->heads[slot] = (int)index->entries.size();
+    index->entries.push_back(entry);
+}
+
+void AlertEngine::dispatch(AlertEvent event, UvdTime time, int *fields)
+{
+    const std::vector<AlertInstruction> &program = m_programs[event];
+    if (!program.empty()) evaluate(event, program, 0, program.size(), time, fields);
+
+    AlertTailIndex *index = &m_tailIndexes[event];
+    if (index->tailCount == 0) return;
+
+    const std::vector<AlertInstruction> &indexedProgram = m_indexedPrograms[event];
+    int entry = index->heads[findTailSlot(index, fields[AlertFieldTail])];
+    while (entry != WATCHLIST_EMPTY_SLOT)
+    {
+        const AlertTailEntry &tailEntry = index->entries[entry];
+        evaluate(event, indexedProgram, tailEntry.start, indexedProgram[tailEntry.start].next, time, fields);
+        entry = tailEntry.nextEntry;
+    }
+}
+
+void AlertEngine::evaluate(AlertEvent event, const std::vector<AlertInstruction> &program, size_t index, size_t endIndex, UvdTime time, int *fields)
+{
+    while (index < endIndex)
+    {
+        const AlertInstruction &instruction = program[index];
+        int value = fields[instruction.field];
+
+        bool passes;
+        switch (instruction.op)
+        {
+        case AlertOpLess: passes = value < instruction.value; break;
+        case AlertOpLessEqual: passes = value <= instruction.value; break;
+        case AlertOpGreater: passes = value > instruction.value; break;
+        case AlertOpGreaterEqual: passes = value >= instruction.value; break;
+        case AlertOpEqual: passes = value == instruction.value; break;
+        case AlertOpNotEqual: passes = value != instruction.value; break;
+        case AlertOpIn: passes = isInWatchlist(instruction.value, value); break;
+        case AlertOpNotIn: passes = !isInWatchlist(instruction.value, value); break;
+        default:
+            {
+                // transitions are rare, lines are held off
+                AlertRule &rule = m_rules[instruction.value];
+                bool isHeldOff = event <= AlertEventK2 && rule.lastMatchTime >= 0 && time < rule.lastMatchTime + ALERT_HOLDOFF;
+                if (!isHeldOff)
+                {
+                    rule.lastMatchTime = time;
+                    m_matches++;
+
+                    if (m_function != NULL)
+                    {
+                        AlertMatch match;
+                        match.text = rule.text;
+                        match.event = event;
+                        match.actions = rule.actions;
+                        match.time = time;
+                        memcpy(match.fields, fields, sizeof(match.fields));
+                        m_function(m_context, &match);
+                    }
+                }
+                passes = true;
+            }
+        }
+
+        index = passes ? index + 1 : instruction.next;
+    }
+}
+
+void AlertEngine::k1Seen(const K1 &k1)
+{
+    if (m_eventRuleCounts[AlertEventK1] == 0) return;
+
+    int fields[AlertFieldCount] = { k1.tailNumber, 0, 0, k1.ri.amplitude, k1.ri.confidence, 0 };
+    dispatch(AlertEventK1, k1.ri.time, fields);
+}
+
+void AlertEngine::k2Seen(const K2 &k2)
+{
+    if (m_eventRuleCounts[AlertEventK2] == 0) return;
+
+    int fields[AlertFieldCount] = { k2.tailNumber, k2.alt, k2.fuel, k2.ri.amplitude, k2.ri.confidence, 0 };
+    dispatch(AlertEventK2, k2.ri.time, fields);
+}
+
+void AlertEngine::occurrenceStarted(int tailNumber, UvdTime time)
+{
+    if (m_eventRuleCounts[AlertEventNew] == 0) return;
+
+    int fields[AlertFieldCount] = { tailNumber, 0, 0, 0, 0, 0 };
+    dispatch(AlertEventNew, time, fields);
+}
+
+void AlertEngine::occurrenceEnded(const OccurrenceRecord &record, UvdTime time)
+{
+    if (m_eventRuleCounts[AlertEventGone] == 0) return;
+
+    int duration = (int)((record.lastTime - record.firstTime) / UVD_SECOND);
+    int fields[AlertFieldCount] = { record.tailNumber, 0, 0, 0, 0, duration };
+    dispatch(AlertEventGone, time, fields);
+}
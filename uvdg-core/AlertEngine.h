@@ -0,0 +1,135 @@
+#ifndef __ALERTENGINE_H__
+#define __ALERTENGINE_H__
+
+#include <vector>
+#include "UvdRecords.h"
+
+#define ALERT_HOLDOFF (5 * UVD_SECOND)
+#define ALERT_TEXT_LENGTH 128
+#define ALERT_ACTION_NOTIFY 1
+#define ALERT_ACTION_BEEP 2
+
+typedef enum {
+    AlertEventK1 = 0,           // every K1 line
+    AlertEventK2,               // every K2 line (point)
+    AlertEventNew,              // an aircraft appears (an occurrence starts)
+    AlertEventGone,             // a track vanishes (an occurrence ends)
+    AlertEventCount
+} AlertEvent;
+
+typedef enum {
+    AlertFieldTail = 0,
+    AlertFieldAltitude,
+    AlertFieldFuel,
+    AlertFieldAmplitude,
+    AlertFieldConfidence,
+    AlertFieldDuration,         // seconds, of a vanished track
+    AlertFieldCount
+} AlertField;
+
+typedef enum {
+    AlertOpLess = 0,
+    AlertOpLessEqual,
+    AlertOpGreater,
+    AlertOpGreaterEqual,
+    AlertOpEqual,
+    AlertOpNotEqual,
+    AlertOpIn,                  // value is a watchlist
+    AlertOpNotIn,
+    AlertOpMatch                // value is the rule, ends its instructions
+} AlertOp;
+
+typedef struct {
+    unsigned char field;
+    unsigned char op;
+    int value;
+    int next;                   // the next rule's first instruction
+} AlertInstruction;
+
+typedef struct {
+    AlertEvent event;
+    int actions;                // ALERT_ACTION_*
+    UvdTime lastMatchTime;      // -1 = never
+    char text[ALERT_TEXT_LENGTH];
+} AlertRule;
+
+typedef struct {
+    int offset;                 // into m_watchlistSlots
+    int mask;                   // slot count - 1
+} Watchlist;
+
+typedef struct {
+    int tailNumber;
+    int start;                  // of the rule's other tests in m_indexedPrograms
+    int nextEntry;              // of the same tail number, -1 = last
+} AlertTailEntry;
+
+// rules that test "tail =" or "tail in", by those tail numbers
+typedef struct {
+    std::vector<int> heads;     // first entry of a tail number, -1 = empty
+    std::vector<AlertTailEntry> entries;
+    int tailCount;
+} AlertTailIndex;
+
+typedef struct {
+    const char *text;           // of the rule
+    AlertEvent event;
+    int actions;
+    UvdTime time;
+    int fields[AlertFieldCount];
+} AlertMatch;
+
+// called on the ingest thread, without the state lock
+typedef void (*AlertFunction)(void *context, const AlertMatch *match);
+
+// User-defined conditions evaluated against every line and occurrence
+// transition UvdState ingests, one rule per text line:
+//
+//   [beep] [notify] EVENT [FIELD OP NUMBER | FIELD [not] in NUMBER... [and ...]]
+//
+// with EVENT one of k1, k2, new, gone, FIELD one of tail, alt, fuel, amp,
+// conf, dur and OP one of < <= > >= = !=. Rules are compiled into one flat
+// predicate program per event, where a failed test jumps to the next rule,
+// and "in" lists into open addressing hash sets. A rule that tests the tail
+// number for a value or a list is instead reached through a hash index of
+// those tail numbers, so a line only runs the rules about its aircraft and
+// thousands of watchlist rules cost microseconds per line. A rule on k1 or
+// k2 lines matches at most once per ALERT_HOLDOFF of feed time.
+class AlertEngine
+{
+    std::vector<AlertRule> m_rules;
+    int m_eventRuleCounts[AlertEventCount];
+    std::vector<AlertInstruction> m_programs[AlertEventCount];
+    std::vector<AlertInstruction> m_indexedPrograms[AlertEventCount];
+    AlertTailIndex m_tailIndexes[AlertEventCount];
+    std::vector<Watchlist> m_watchlists;
+    std::vector<int> m_watchlistSlots;
+
+    AlertFunction m_function;
+    void *m_context;
+    unsigned long m_matches;
+
+    int addWatchlist(std::vector<int> *tailNumbers);
+    bool isInWatchlist(int watchlist, int tailNumber);
+    void indexTail(AlertTailIndex *index, int tailNumber, int start);
+    void dispatch(AlertEvent event, UvdTime time, int *fields);
+    void evaluate(AlertEvent event, const std::vector<AlertInstruction> &program, size_t index, size_t endIndex, UvdTime time, int *fields);
+
+public:
+    AlertEngine();
+
+    // false (and logged) if the text doesn't parse
+    bool addRule(const char *text);
+    void clear();
+    void setAlertFunction(AlertFunction function, void *context) { m_function = function; m_context = context; }
+
+    void k1Seen(const K1 &k1);
+    void k2Seen(const K2 &k2);
+    void occurrenceStarted(int tailNumber, UvdTime time);
+    void occurrenceEnded(const OccurrenceRecord &record, UvdTime time);
+
+    size_t ruleCount() { return m_rules.size(); }
+    unsigned long matchCount() { return m_matches; }
+};
+
+#endif
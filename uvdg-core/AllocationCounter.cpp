@@ -0,0 +1,53 @@
+#include "AllocationCounter.h"
+#include "SpanRecorder.h"
+#include <stdlib.h>
+#include <new>
+
+static THREAD_LOCAL unsigned long long allocationCount = 0;
+
+#ifdef UVDG_COUNT_ALLOCATIONS
+
+void *operator new(size_t size)
+{
+    allocationCount++;
+    void *memory = malloc(size > 0 ? size : 1);
+    if (memory == NULL) throw std::bad_alloc();
+    return memory;
+}
+
+void *operator new[](size_t size)
+{
+    allocationCount++;
+    void *memory = malloc(size > 0 ? size : 1);
+    if (memory == NULL) throw std::bad_alloc();
+    return memory;
+}
+
+void operator delete(void *memory) throw()
+{
+    free(memory);
+}
+
+void operator delete[](void *memory) throw()
+{
+    free(memory);
+}
+
+bool AllocationCounter::isCounting()
+{
+    return true;
+}
+
+#else
+
+bool AllocationCounter::isCounting()
+{
+    return false;
+}
+
+#endif
+
+unsigned long long AllocationCounter::count()
+{
+    return allocationCount;
+}
@@ -0,0 +1,15 @@
+#ifndef __ALLOCATIONCOUNTER_H__
+#define __ALLOCATIONCOUNTER_H__
+
+// Heap allocations made through operator new by the calling thread. Only
+// counted in builds with UVDG_COUNT_ALLOCATIONS (Debug, or make
+// COUNT_ALLOCATIONS=1), which replace the global operator new; otherwise
+// the count stays 0.
+class AllocationCounter
+{
+public:
+    static bool isCounting();
+    static unsigned long long count();
+};
+
+#endif
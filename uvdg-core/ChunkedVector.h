@@ -0,0 +1,236 @@
+#ifndef __CHUNKEDVECTOR_H__
+#define __CHUNKEDVECTOR_H__
+
+#include <string.h>
+#include <stddef.h>
+#include <iterator>
+#include <vector>
+
+#define CHUNK_SHIFT 16
+#define CHUNK_LENGTH (1 << CHUNK_SHIFT)
+#define CHUNK_MASK (CHUNK_LENGTH - 1)
+#define CHUNK_SPARE_COUNT 4
+#define CHUNK_TABLE_RESERVE 256
+
+// Random access storage for plain records, in chunks of CHUNK_LENGTH.
+// Growing never moves what is stored (std::vector copies everything when
+// it outgrows its capacity, with the lock held), and up to
+// CHUNK_SPARE_COUNT chunks a shrink frees are kept for the next growth,
+// so a container that is appended to and trimmed in turns stops
+// allocating. Records are moved with memcpy, T must be a plain struct.
+template <class T>
+class ChunkedVector
+{
+    std::vector<T *> m_chunks;      // allocated chunks, used ones first
+    size_t m_size;
+
+    ChunkedVector(const ChunkedVector &);
+    ChunkedVector &operator=(const ChunkedVector &);
+
+    void addChunk()
+    {
+        m_chunks.push_back(new T[CHUNK_LENGTH]);
+    }
+
+    void trimChunks()
+    {
+        size_t usedChunks = (m_size + CHUNK_MASK) >> CHUNK_SHIFT;
+        while (m_chunks.size() > usedChunks + CHUNK_SPARE_COUNT)
+        {
+            delete[] m_chunks.back();
+            m_chunks.pop_back();
+        }
+    }
+
+    void moveRecords(size_t toIndex, size_t fromIndex, size_t count)
+    {
+        // overlapping ranges within the container, in the safe direction
+        if (toIndex < fromIndex)
+        {
+            size_t done = 0;
+            while (done < count)
+            {
+                size_t piece = count - done;
+                if (piece > contiguousCount(toIndex + done)) piece = contiguousCount(toIndex + done);
+                if (piece > contiguousCount(fromIndex + done)) piece = contiguousCount(fromIndex + done);
+                memmove(&at(toIndex + done), &at(fromIndex + done), piece * sizeof(T));
+                done += piece;
+            }
+        }
+        else if (toIndex > fromIndex)
+        {
+            size_t left = count;
+            while (left > 0)
+            {
+                // pieces ending at the last records, contiguous backwards
+                size_t piece = left;
+                size_t toOffset = (toIndex + left - 1) & CHUNK_MASK;
+                size_t fromOffset = (fromIndex + left - 1) & CHUNK_MASK;
+                if (piece > toOffset + 1) piece = toOffset + 1;
+                if (piece > fromOffset + 1) piece = fromOffset + 1;
+                memmove(&at(toIndex + left - piece), &at(fromIndex + left - piece), piece * sizeof(T));
+                left -= piece;
+            }
+        }
+    }
+
+public:
+    class iterator
+    {
+        ChunkedVector *m_vector;
+        size_t m_index;
+
+    public:
+        typedef std::random_access_iterator_tag iterator_category;
+        typedef T value_type;
+        typedef ptrdiff_t difference_type;
+        typedef T *pointer;
+        typedef T &reference;
+
+        iterator() : m_vector(NULL), m_index(0) {}
+        iterator(ChunkedVector *vector, size_t index) : m_vector(vector), m_index(index) {}
+
+        T &operator*() const { return m_vector->at(m_index); }
+        T *operator->() const { return &m_vector->at(m_index); }
+        T &operator[](ptrdiff_t n) const { return m_vector->at(m_index + n); }
+
+        iterator &operator++() { m_index++; return *this; }
+        iterator operator++(int) { iterator old = *this; m_index++; return old; }
+        iterator &operator--() { m_index--; return *this; }
+        iterator operator--(int) { iterator old = *this; m_index--; return old; }
+        iterator &operator+=(ptrdiff_t n) { m_index += n; return *this; }
+        iterator &operator-=(ptrdiff_t n) { m_index -= n; return *this; }
+        iterator operator+(ptrdiff_t n) const { return iterator(m_vector, m_index + n); }
+        iterator operator-(ptrdiff_t n) const { return iterator(m_vector, m_index - n); }
+        ptrdiff_t operator-(const iterator &other) const { return (ptrdiff_t)m_index - (ptrdiff_t)other.m_index; }
+
+        bool operator==(const iterator &other) const { return m_index == other.m_index; }
+        bool operator!=(const iterator &other) const { return m_index != other.m_index; }
+        bool operator<(const iterator &other) const { return m_index < other.m_index; }
+        bool operator>(const iterator &other) const { return m_index > other.m_index; }
+        bool operator<=(const iterator &other) const { return m_index <= other.m_index; }
+        bool operator>=(const iterator &other) const { return m_index >= other.m_index; }
+    };
+
+    ChunkedVector()
+    {
+        m_size = 0;
+        m_chunks.reserve(CHUNK_TABLE_RESERVE);
+    }
+
+    ~ChunkedVector()
+    {
+        release();
+    }
+
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+
+    T &at(size_t index) { return m_chunks[index >> CHUNK_SHIFT][index & CHUNK_MASK]; }
+    T &operator[](size_t index) { return m_chunks[index >> CHUNK_SHIFT][index & CHUNK_MASK]; }
+    T &back() { return at(m_size - 1); }
+
+    iterator begin() { return iterator(this, 0); }
+    iterator end() { return iterator(this, m_size); }
+
+    // records from index to the end of its chunk, or of the container
+    size_t contiguousCount(size_t index) const
+    {
+        size_t count = CHUNK_LENGTH - (index & CHUNK_MASK);
+        return index + count <= m_size ? count : m_size - index;
+    }
+
+    void push_back(const T &record)
+    {
+        if (m_size == m_chunks.size() << CHUNK_SHIFT) addChunk();
+        at(m_size++) = record;
+    }
+
+    void append(const T *records, size_t count)
+    {
+        size_t index = m_size;
+        resize(m_size + count);
+        while (count > 0)
+        {
+            size_t piece = contiguousCount(index);
+            if (piece > count) piece = count;
+            memcpy(&at(index), records, piece * sizeof(T));
+            index += piece;
+            records += piece;
+            count -= piece;
+        }
+    }
+
+    void append(ChunkedVector *source, size_t startIndex, size_t endIndex)
+    {
+        while (startIndex < endIndex)
+        {
+            size_t piece = source->contiguousCount(startIndex);
+            if (piece > endIndex - startIndex) piece = endIndex - startIndex;
+            append(&source->at(startIndex), piece);
+            startIndex += piece;
+        }
+    }
+
+    // opens a gap at index and copies the source into it
+    void insert(size_t index, ChunkedVector *source)
+    {
+        size_t count = source->size();
+        if (count == 0) return;
+
+        size_t tailCount = m_size - index;
+        resize(m_size + count);
+        moveRecords(index + count, index, tailCount);
+
+        size_t done = 0;
+        while (done < count)
+        {
+            size_t piece = count - done;
+            if (piece > contiguousCount(index + done)) piece = contiguousCount(index + done);
+            if (piece > source->contiguousCount(done)) piece = source->contiguousCount(done);
+            memcpy(&at(index + done), &source->at(done), piece * sizeof(T));
+            done += piece;
+        }
+    }
+
+    void erase(size_t startIndex, size_t endIndex)
+    {
+        if (startIndex >= endIndex) return;
+
+        moveRecords(startIndex, endIndex, m_size - endIndex);
+        resize(m_size - (endIndex - startIndex));
+    }
+
+    // new records are not initialized
+    void resize(size_t count)
+    {
+        while (count > m_chunks.size() << CHUNK_SHIFT) addChunk();
+        bool isShrinking = count < m_size;
+        m_size = count;
+        if (isShrinking) trimChunks();
+    }
+
+    // until the next shrink, which keeps CHUNK_SPARE_COUNT of them
+    void reserve(size_t count)
+    {
+        while (count > m_chunks.size() << CHUNK_SHIFT) addChunk();
+    }
+
+    void clear()
+    {
+        resize(0);
+    }
+
+    // frees every chunk, spares included
+    void release()
+    {
+        for (size_t i = 0; i < m_chunks.size(); i++)
+        {
+            delete[] m_chunks[i];
+        }
+        m_chunks.clear();
+        m_size = 0;
+    }
+};
+
+#endif
@@ -0,0 +1,31 @@
+#include "Clock.h"
+
+#ifdef _MSC_VER
+
+#include <Windows.h>
+
+long long ClockMicroseconds()
+{
+    static LARGE_INTEGER frequency;
+    if (frequency.QuadPart == 0)
+    {
+        QueryPerformanceFrequency(&frequency);
+    }
+
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+
+    return (long long)(counter.QuadPart / frequency.QuadPart) * 1000000
+        + (long long)(counter.QuadPart % frequency.QuadPart) * 1000000 / frequency.QuadPart;
+}
+
+#else
+
+#include <chrono>
+
+long long ClockMicroseconds()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+#endif
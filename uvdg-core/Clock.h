@@ -0,0 +1,7 @@
+#ifndef __CLOCK_H__
+#define __CLOCK_H__
+
+// monotonic clock, for measuring intervals only
+long long ClockMicroseconds();
+
+#endif
@@ -0,0 +1,92 @@
+#include "LatencyHistogram.h"
+#include <string.h>
+
+LatencyHistogram::LatencyHistogram()
+{
+    reset();
+}
+
+void LatencyHistogram::reset()
+{
+    memset(m_counts, 0, sizeof(m_counts));
+    m_count = 0;
+    m_min = 0;
+    m_max = 0;
+    m_sum = 0.0;
+}
+
+int LatencyHistogram::indexForValue(long long value)
+{
+    if (value < 0) value = 0;
+    if (value < 64) return (int)value;
+
+    int msb = 0;
+    while ((value >> (msb + 1)) != 0) msb++;
+
+    int shift = msb - LATENCY_HISTOGRAM_SUB_BUCKET_BITS;
+    int subBucket = (int)(value >> shift) - 32;
+    int index = 64 + (shift - 1) * 32 + subBucket;
+
+    return index < LATENCY_HISTOGRAM_BUCKETS ? index : LATENCY_HISTOGRAM_BUCKETS - 1;
+}
+
+long long LatencyHistogram::valueForIndex(int index)
+{
+    if (index < 64) return index;
+
+    int shift = (index - 64) / 32 + 1;
+    int subBucket = (index - 64) % 32;
+
+    // middle of the bucket
+    return ((long long)(subBucket + 32) << shift) + ((1LL << shift) >> 1);
+}
+
+void LatencyHistogram::record(long long microseconds)
+{
+    if (microseconds < 0) microseconds = 0;
+
+    m_counts[indexForValue(microseconds)]++;
+
+    if (m_count == 0 || microseconds < m_min) m_min = microseconds;
+    if (microseconds > m_max) m_max = microseconds;
+    m_count++;
+    m_sum += microseconds;
+}
+
+void LatencyHistogram::merge(LatencyHistogram *other)
+{
+    if (other->m_count == 0) return;
+
+    for (int i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++)
+    {
+        m_counts[i] += other->m_counts[i];
+    }
+
+    if (m_count == 0 || other->m_min < m_min) m_min = other->m_min;
+    if (other->m_max > m_max) m_max = other->m_max;
+    m_count += other->m_count;
+    m_sum += other->m_sum;
+}
+
+long long LatencyHistogram::percentile(double percent)
+{
+    if (m_count == 0) return 0;
+
+    unsigned long long target = (unsigned long long)(m_count * percent / 100.0);
+    if (target >= m_count) target = m_count - 1;
+
+    unsigned long long seen = 0;
+    for (int i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++)
+    {
+        seen += m_counts[i];
+        if (seen > target)
+        {
+            long long value = valueForIndex(i);
+            if (value > m_max) value = m_max;
+            if (value < m_min) value = m_min;
+            return value;
+        }
+    }
+
+    return m_max;
+}
@@ -0,0 +1,35 @@
+#ifndef __LATENCYHISTOGRAM_H__
+#define __LATENCYHISTOGRAM_H__
+
+// HDR-style histogram of microsecond latencies: exact below 64 us, then
+// 32 sub-buckets per power of two, i.e. about 3% relative precision up to
+// several days
+#define LATENCY_HISTOGRAM_SUB_BUCKET_BITS 5
+#define LATENCY_HISTOGRAM_BUCKETS (64 + 40 * 32)
+
+class LatencyHistogram
+{
+    unsigned long long m_counts[LATENCY_HISTOGRAM_BUCKETS];
+    unsigned long long m_count;
+    long long m_min;
+    long long m_max;
+    double m_sum;
+
+    static int indexForValue(long long value);
+    static long long valueForIndex(int index);
+
+public:
+    LatencyHistogram();
+
+    void record(long long microseconds);
+    void merge(LatencyHistogram *other);
+    void reset();
+
+    unsigned long long count() { return m_count; }
+    long long min() { return m_count > 0 ? m_min : 0; }
+    long long max() { return m_max; }
+    double mean() { return m_count > 0 ? m_sum / m_count : 0.0; }
+    long long percentile(double percent);
+};
+
+#endif
@@ -0,0 +1,116 @@
+#include "LatencyTracer.h"
+#include "AllocationCounter.h"
+#include "Clock.h"
+#include <stdio.h>
+#include <time.h>
+
+LatencyTracer::LatencyTracer()
+{
+    m_batchTime = -1;
+    m_unrenderedTime = -1;
+    m_unpaintedTime = -1;
+
+    for (int i = 0; i < TraceStageCount; i++)
+    {
+        m_allocations[i] = 0;
+    }
+    m_allocationMark = 0;
+}
+
+void LatencyTracer::beginBatch()
+{
+    m_batchTime = ClockMicroseconds();
+}
+
+void LatencyTracer::lineStarted()
+{
+    m_allocationMark = AllocationCounter::count();
+}
+
+void LatencyTracer::lineReached(TraceStage stage)
+{
+    // allocations since the previous stage of the line
+    unsigned long long allocations = AllocationCounter::count();
+    m_allocations[stage] += allocations - m_allocationMark;
+    m_allocationMark = allocations;
+
+    if (m_batchTime < 0) return;
+
+    m_histograms[stage].record(ClockMicroseconds() - m_batchTime);
+}
+
+void LatencyTracer::batchAccepted()
+{
+    // the oldest change not on screen yet is what the user waits for
+    if (m_unrenderedTime < 0)
+    {
+        m_unrenderedTime = m_batchTime;
+    }
+}
+
+void LatencyTracer::bitmapGenerated()
+{
+    if (m_unrenderedTime < 0) return;
+
+    m_histograms[TraceStageBitmap].record(ClockMicroseconds() - m_unrenderedTime);
+
+    if (m_unpaintedTime < 0)
+    {
+        m_unpaintedTime = m_unrenderedTime;
+    }
+    m_unrenderedTime = -1;
+}
+
+void LatencyTracer::paintFinished()
+{
+    if (m_unpaintedTime < 0) return;
+
+    m_histograms[TraceStagePaint].record(ClockMicroseconds() - m_unpaintedTime);
+    m_unpaintedTime = -1;
+}
+
+const char *LatencyTracer::stageName(TraceStage stage)
+{
+    switch (stage)
+    {
+        case TraceStageRead: return "read";
+        case TraceStageParse: return "parse";
+        case TraceStageInsert: return "insert";
+        case TraceStageBitmap: return "bitmap";
+        case TraceStagePaint: return "paint";
+        default: return "?";
+    }
+}
+
+bool LatencyTracer::dump(const char *path)
+{
+    FILE *file = fopen(path, "a");
+    if (file == NULL) return false;
+
+    time_t now = time(NULL);
+    fprintf(file, "latency since socket receive, us, %s", ctime(&now));
+    fprintf(file, "%-8s %12s %10s %10s %10s %10s %10s %10s %12s %12s\n", "stage", "count", "min", "p50", "p90", "p99", "p99.9", "max", "mean", "allocations");
+
+    for (int i = 0; i < TraceStageCount; i++)
+    {
+        LatencyHistogram *histogram = &m_histograms[i];
+        fprintf(file, "%-8s %12llu %10lld %10lld %10lld %10lld %10lld %10lld %12.1f %12llu\n",
+                stageName((TraceStage)i), histogram->count(), histogram->min(),
+                histogram->percentile(50.0), histogram->percentile(90.0), histogram->percentile(99.0),
+                histogram->percentile(99.9), histogram->max(), histogram->mean(), m_allocations[i]);
+    }
+
+    fprintf(file, "\n");
+    fclose(file);
+
+    return true;
+}
+
+void LatencyTracer::reset()
+{
+    for (int i = 0; i < TraceStageCount; i++)
+    {
+        m_histograms[i].reset();
+        m_allocations[i] = 0;
+    }
+}
@@ -0,0 +1,46 @@
+#ifndef __LATENCYTRACER_H__
+#define __LATENCYTRACER_H__
+
+#include "LatencyHistogram.h"
+
+typedef enum {
+    TraceStageRead,     // line read from the socket
+    TraceStageParse,    // line parsed by RtlUvdParser
+    TraceStageInsert,   // record inserted into UvdState
+    TraceStageBitmap,   // bitmap regenerated with the batch in it
+    TraceStagePaint,    // paintEvent finished drawing that bitmap
+    TraceStageCount
+} TraceStage;
+
+// Latency of each ingest stage, measured from the moment a batch of bytes
+// was picked up from the socket, and the heap allocations each stage made
+// for a line (see AllocationCounter). Everything runs on the main thread.
+class LatencyTracer
+{
+    LatencyHistogram m_histograms[TraceStageCount];
+    unsigned long long m_allocations[TraceStageCount];
+    unsigned long long m_allocationMark;
+
+    long long m_batchTime;
+    long long m_unrenderedTime;
+    long long m_unpaintedTime;
+
+public:
+    LatencyTracer();
+
+    void beginBatch();
+    void lineStarted();
+    void lineReached(TraceStage stage);
+    void batchAccepted();
+    void bitmapGenerated();
+    void paintFinished();
+
+    LatencyHistogram *histogram(TraceStage stage) { return &m_histograms[stage]; }
+    unsigned long long allocations(TraceStage stage) { return m_allocations[stage]; }
+    static const char *stageName(TraceStage stage);
+
+    bool dump(const char *path);
+    void reset();
+};
+
+#endif
@@ -0,0 +1,20 @@
+#include "Log.h"
+#include <stdio.h>
+#include <stdarg.h>
+
+static bool s_isEnabled = true;
+
+void UvdLog(const char *format, ...)
+{
+    if (!s_isEnabled) return;
+
+    va_list args;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+void UvdLogSetEnabled(bool flag)
+{
+    s_isEnabled = flag;
+}
@@ -0,0 +1,9 @@
+#ifndef __LOG_H__
+#define __LOG_H__
+
+// diagnostics of the core classes; the batch tools switch them off so they
+// don't mix with their reports
+void UvdLog(const char *format, ...);
+void UvdLogSetEnabled(bool flag);
+
+#endif
@@ -0,0 +1,337 @@
+#include "LogDecompressor.h"
+#include "RtlUvdIndex.h"
+#include "SpanRecorder.h"
+#include "Log.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef UVDG_GZIP
+#include <zlib.h>
+#endif
+#ifdef UVDG_ZSTD
+#include <zstd.h>
+#endif
+
+LogDecompressor::LogDecompressor()
+{
+    m_file = NULL;
+    m_compression = LogCompressionNone;
+    m_fileSize = 0;
+    m_inputOffset = 0;
+    m_isRunning = false;
+
+    for (int i = 0; i < DECOMPRESS_QUEUE_BLOCKS; i++)
+    {
+        m_blocks[i] = (char *)malloc(DECOMPRESS_BLOCK_SIZE);
+        m_blockSizes[i] = 0;
+    }
+
+    MutexCreate(&m_lock);
+    EventCreate(&m_filledEvent);
+    EventCreate(&m_freedEvent);
+}
+
+LogDecompressor::~LogDecompressor()
+{
+    close();
+
+    for (int i = 0; i < DECOMPRESS_QUEUE_BLOCKS; i++)
+    {
+        free(m_blocks[i]);
+    }
+
+    MutexDestroy(&m_lock);
+    EventDestroy(&m_filledEvent);
+    EventDestroy(&m_freedEvent);
+}
+
+LogCompression LogDecompressor::detect(const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) return LogCompressionNone;
+
+    unsigned char magic[4];
+    size_t length = fread(magic, 1, sizeof(magic), file);
+    fclose(file);
+
+    if (length >= 2 && magic[0] == 0x1f && magic[1] == 0x8b) return LogCompressionGzip;
+    if (length >= 4 && magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f && magic[3] == 0xfd) return LogCompressionZstd;
+    return LogCompressionNone;
+}
+
+bool LogDecompressor::isSupported(LogCompression compression)
+{
+#ifdef UVDG_GZIP
+    if (compression == LogCompressionGzip) return true;
+#endif
+#ifdef UVDG_ZSTD
+    if (compression == LogCompressionZstd) return true;
+#endif
+    return compression == LogCompressionNone;
+}
+
+bool LogDecompressor::open(const char *path)
+{
+    close();
+
+    m_compression = detect(path);
+    if (m_compression == LogCompressionNone) return false;
+    if (!isSupported(m_compression))
+    {
+        UvdLog("%s: built without %s support.\n", path, m_compression == LogCompressionGzip ? "gzip" : "zstd");
+        return false;
+    }
+
+    m_file = fopen(path, "rb");
+    if (m_file == NULL) return false;
+
+    fseek(m_file, 0, SEEK_END);
+    m_fileSize = FileTell(m_file);
+    FileSeek(m_file, 0);
+    m_inputOffset = 0;
+
+    m_readBlock = 0;
+    m_filledCount = 0;
+    m_isHeld = false;
+    m_isFinished = false;
+    m_isFailed = false;
+    m_isStopping = false;
+
+    ThreadCreate(&m_thread, decompressThread, this);
+    m_isRunning = true;
+    return true;
+}
+
+void LogDecompressor::close()
+{
+    if (m_isRunning)
+    {
+        MutexLock(&m_lock);
+        m_isStopping = true;
+        MutexUnlock(&m_lock);
+        EventSignal(&m_freedEvent);
+
+        ThreadJoin(&m_thread);
+        m_isRunning = false;
+    }
+
+    if (m_file != NULL)
+    {
+        fclose(m_file);
+        m_file = NULL;
+    }
+}
+
+void LogDecompressor::decompressThread(void *context)
+{
+    LogDecompressor *decompressor = (LogDecompressor *)context;
+    TRACE_SPAN("LogDecompressor");
+
+    char *input = (char *)malloc(DECOMPRESS_INPUT_SIZE);
+    bool isValid = false;
+#ifdef UVDG_GZIP
+    if (decompressor->m_compression == LogCompressionGzip) isValid = decompressor->inflateGzip(input);
+#endif
+#ifdef UVDG_ZSTD
+    if (decompressor->m_compression == LogCompressionZstd) isValid = decompressor->inflateZstd(input);
+#endif
+    free(input);
+
+    MutexLock(&decompressor->m_lock);
+    decompressor->m_isFailed = !isValid && !decompressor->m_isStopping;
+    decompressor->m_isFinished = true;
+    MutexUnlock(&decompressor->m_lock);
+    EventSignal(&decompressor->m_filledEvent);
+}
+
+// on the thread: the block to fill next, NULL when stopping
+char *LogDecompressor::freeBlock()
+{
+    MutexLock(&m_lock);
+    while (m_filledCount == DECOMPRESS_QUEUE_BLOCKS && !m_isStopping)
+    {
+        MutexUnlock(&m_lock);
+        EventWait(&m_freedEvent, 100);
+        MutexLock(&m_lock);
+    }
+
+    char *block = m_isStopping ? NULL : m_blocks[(m_readBlock + m_filledCount) % DECOMPRESS_QUEUE_BLOCKS];
+    MutexUnlock(&m_lock);
+    return block;
+}
+
+void LogDecompressor::fillBlock(size_t size)
+{
+    if (size == 0) return;
+
+    MutexLock(&m_lock);
+    m_blockSizes[(m_readBlock + m_filledCount) % DECOMPRESS_QUEUE_BLOCKS] = size;
+    m_filledCount++;
+    MutexUnlock(&m_lock);
+    EventSignal(&m_filledEvent);
+}
+
+#ifdef UVDG_GZIP
+
+bool LogDecompressor::inflateGzip(char *input)
+{
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    if (inflateInit2(&stream, 15 + 16) != Z_OK) return false;
+
+    bool isValid = true;
+    bool isEnded = false;
+    bool isMemberEnded = false;
+    while (!isEnded)
+    {
+        char *block = freeBlock();
+        if (block == NULL) break;
+
+        stream.next_out = (Bytef *)block;
+        stream.avail_out = DECOMPRESS_BLOCK_SIZE;
+
+        while (stream.avail_out > 0)
+        {
+            if (stream.avail_in == 0)
+            {
+                size_t length = fread(input, 1, DECOMPRESS_INPUT_SIZE, m_file);
+                if (length == 0)
+                {
+                    // a member cut short is an error, the last one complete is the end
+                    isValid = isMemberEnded;
+                    isEnded = true;
+                    break;
+                }
+                m_inputOffset += length;
+                stream.next_in = (Bytef *)input;
+                stream.avail_in = (uInt)length;
+            }
+
+            int result = inflate(&stream, Z_NO_FLUSH);
+            isMemberEnded = result == Z_STREAM_END;
+            if (result == Z_STREAM_END)
+            {
+                // the next member of a log appended to, if any
+                inflateReset(&stream);
+            }
+            else if (result != Z_OK && result != Z_BUF_ERROR)
+            {
+                UvdLog("gzip: %s.\n", stream.msg != NULL ? stream.msg : "corrupt data");
+                isValid = false;
+                isEnded = true;
+                break;
+            }
+        }
+
+        fillBlock(DECOMPRESS_BLOCK_SIZE - stream.avail_out);
+    }
+
+    inflateEnd(&stream);
+    return isValid;
+}
+
+#endif
+
+#ifdef UVDG_ZSTD
+
+bool LogDecompressor::inflateZstd(char *input)
+{
+    ZSTD_DCtx *context = ZSTD_createDCtx();
+    if (context == NULL) return false;
+
+    ZSTD_inBuffer in;
+    in.src = input;
+    in.size = 0;
+    in.pos = 0;
+
+    // frames follow each other in a log appended to, 0 between them
+    size_t remaining = 0;
+    bool isValid = true;
+    bool isEnded = false;
+    while (!isEnded)
+    {
+        char *block = freeBlock();
+        if (block == NULL) break;
+
+        ZSTD_outBuffer out;
+        out.dst = block;
+        out.size = DECOMPRESS_BLOCK_SIZE;
+        out.pos = 0;
+
+        while (out.pos < out.size)
+        {
+            if (in.pos == in.size)
+            {
+                size_t length = fread(input, 1, DECOMPRESS_INPUT_SIZE, m_file);
+                if (length == 0)
+                {
+                    isValid = remaining == 0;
+                    isEnded = true;
+                    break;
+                }
+                m_inputOffset += length;
+                in.size = length;
+                in.pos = 0;
+            }
+
+            remaining = ZSTD_decompressStream(context, &out, &in);
+            if (ZSTD_isError(remaining))
+            {
+                UvdLog("zstd: %s.\n", ZSTD_getErrorName(remaining));
+                isValid = false;
+                isEnded = true;
+                break;
+            }
+        }
+
+        fillBlock(out.pos);
+    }
+
+    ZSTD_freeDCtx(context);
+    return isValid;
+}
+
+#endif
+
+char *LogDecompressor::nextBlock(size_t *size)
+{
+    MutexLock(&m_lock);
+    if (m_isHeld)
+    {
+        m_readBlock = (m_readBlock + 1) % DECOMPRESS_QUEUE_BLOCKS;
+        m_filledCount--;
+        m_isHeld = false;
+        EventSignal(&m_freedEvent);
+    }
+
+    while (m_filledCount == 0 && !m_isFinished)
+    {
+        MutexUnlock(&m_lock);
+        EventWait(&m_filledEvent, 100);
+        MutexLock(&m_lock);
+    }
+
+    char *block = NULL;
+    if (m_filledCount > 0)
+    {
+        block = m_blocks[m_readBlock];
+        *size = m_blockSizes[m_readBlock];
+        m_isHeld = true;
+    }
+    MutexUnlock(&m_lock);
+
+    return block;
+}
+
+bool LogDecompressor::isValid()
+{
+    MutexLock(&m_lock);
+    bool isValid = !m_isFailed;
+    MutexUnlock(&m_lock);
+    return isValid;
+}
+
+double LogDecompressor::progress()
+{
+    return m_fileSize > 0 ? m_inputOffset / (double)m_fileSize : 1.0;
+}
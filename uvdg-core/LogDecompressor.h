@@ -0,0 +1,75 @@
+#ifndef __LOGDECOMPRESSOR_H__
+#define __LOGDECOMPRESSOR_H__
+
+#include <stdio.h>
+#include "Mutex.h"
+#include "Thread.h"
+
+#define DECOMPRESS_INPUT_SIZE (256 * 1024)
+#define DECOMPRESS_BLOCK_SIZE (1024 * 1024)
+#define DECOMPRESS_QUEUE_BLOCKS 4
+
+typedef enum {
+    LogCompressionNone,
+    LogCompressionGzip,     // built with UVDG_GZIP (zlib)
+    LogCompressionZstd      // built with UVDG_ZSTD (libzstd)
+} LogCompression;
+
+// Streams a compressed daily log as blocks of its text. A thread reads and
+// inflates the file into a queue of DECOMPRESS_QUEUE_BLOCKS blocks while the
+// caller parses the ones before, so a day is parsed about as fast as it
+// inflates, and never goes through a decompressed copy on disk. Rotated
+// logs appended to as several gzip members or zstd frames read as one.
+class LogDecompressor
+{
+    FILE *m_file;
+    LogCompression m_compression;
+    long long m_fileSize;
+    volatile long long m_inputOffset;
+
+    // filled blocks from m_readBlock on, the first one held by the caller
+    // between nextBlock calls
+    char *m_blocks[DECOMPRESS_QUEUE_BLOCKS];
+    size_t m_blockSizes[DECOMPRESS_QUEUE_BLOCKS];
+    int m_readBlock;
+    int m_filledCount;
+    bool m_isHeld;
+    bool m_isFinished;
+    bool m_isFailed;
+    bool m_isStopping;
+
+    Mutex m_lock;
+    Event m_filledEvent;
+    Event m_freedEvent;
+    Thread m_thread;
+    bool m_isRunning;
+
+    static void decompressThread(void *context);
+
+    char *freeBlock();
+    void fillBlock(size_t size);
+    bool inflateGzip(char *input);
+    bool inflateZstd(char *input);
+
+public:
+    LogDecompressor();
+    ~LogDecompressor();
+
+    // by the magic at the start of the file
+    static LogCompression detect(const char *path);
+    static bool isSupported(LogCompression compression);
+
+    bool open(const char *path);
+    void close();
+
+    // the next block of text, NULL after the last one; the caller may
+    // write to it until the next call
+    char *nextBlock(size_t *size);
+
+    // false if the file ended in corrupt or truncated data
+    bool isValid();
+    // of the compressed file read so far
+    double progress();
+};
+
+#endif
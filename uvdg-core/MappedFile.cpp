@@ -0,0 +1,93 @@
+#include "MappedFile.h"
+#include <stdlib.h>
+
+#ifdef _MSC_VER
+
+bool MappedFileOpen(MappedFile *file, const char *path)
+{
+    file->data = NULL;
+    file->size = 0;
+    file->mapping = NULL;
+
+    file->file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file->file == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file->file, &size) || size.QuadPart == 0)
+    {
+        // an empty file can't be mapped
+        CloseHandle(file->file);
+        return false;
+    }
+    file->size = size.QuadPart;
+
+    file->mapping = CreateFileMappingA(file->file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (file->mapping != NULL)
+    {
+        file->data = (const unsigned char *)MapViewOfFile(file->mapping, FILE_MAP_READ, 0, 0, 0);
+    }
+
+    if (file->data == NULL)
+    {
+        MappedFileClose(file);
+        return false;
+    }
+
+    return true;
+}
+
+void MappedFileClose(MappedFile *file)
+{
+    if (file->data != NULL) UnmapViewOfFile(file->data);
+    if (file->mapping != NULL) CloseHandle(file->mapping);
+    CloseHandle(file->file);
+
+    file->data = NULL;
+    file->size = 0;
+}
+
+#else
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+bool MappedFileOpen(MappedFile *file, const char *path)
+{
+    file->data = NULL;
+    file->size = 0;
+
+    file->fd = open(path, O_RDONLY);
+    if (file->fd < 0) return false;
+
+    struct stat status;
+    if (fstat(file->fd, &status) != 0 || status.st_size == 0)
+    {
+        // an empty file can't be mapped
+        close(file->fd);
+        return false;
+    }
+    file->size = status.st_size;
+
+    void *data = mmap(NULL, (size_t)file->size, PROT_READ, MAP_PRIVATE, file->fd, 0);
+    if (data == MAP_FAILED)
+    {
+        close(file->fd);
+        return false;
+    }
+
+    file->data = (const unsigned char *)data;
+    return true;
+}
+
+void MappedFileClose(MappedFile *file)
+{
+    if (file->data != NULL) munmap((void *)file->data, (size_t)file->size);
+    close(file->fd);
+
+    file->data = NULL;
+    file->size = 0;
+}
+
+#endif
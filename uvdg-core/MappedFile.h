@@ -0,0 +1,23 @@
+#ifndef __MAPPEDFILE_H__
+#define __MAPPEDFILE_H__
+
+#ifdef _MSC_VER
+#include <Windows.h>
+#endif
+
+// read-only view of a whole file
+typedef struct {
+    const unsigned char *data;
+    long long size;
+#ifdef _MSC_VER
+    HANDLE file;
+    HANDLE mapping;
+#else
+    int fd;
+#endif
+} MappedFile;
+
+bool MappedFileOpen(MappedFile *file, const char *path);
+void MappedFileClose(MappedFile *file);
+
+#endif
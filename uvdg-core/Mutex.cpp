@@ -5,23 +5,24 @@
 
 void MutexCreate(Mutex *mutex)
 {
-    *mutex = CreateMutex(NULL, FALSE, NULL);
+    InitializeCriticalSection(mutex);
 }
 
 void MutexDestroy(Mutex *mutex)
 {
-    CloseHandle(*mutex);
+    DeleteCriticalSection(mutex);
 }
 
 void MutexLock(Mutex *mutex)
 {
-    // not needed as all QTcpSocket stuff performs on main thread
-    // WaitForSingleObject(*mutex, INFINITE);
+    // QTcpSocket stuff still performs on main thread, but the recorder's
+    // writer thread shares buffers with it
+    EnterCriticalSection(mutex);
 }
 
 void MutexUnlock(Mutex *mutex)
 {
-    // ReleaseMutex(*mutex);
+    LeaveCriticalSection(mutex);
 }
 
 #else
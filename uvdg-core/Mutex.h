@@ -5,7 +5,7 @@
 #ifdef _MSC_VER
 
 #include <Windows.h>
-typedef HANDLE Mutex;
+typedef CRITICAL_SECTION Mutex;
 
 #else
 
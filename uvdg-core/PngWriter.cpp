@@ -0,0 +1,324 @@
+#include "PngWriter.h"
+#include "Log.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define PNG_HISTORY 3
+#define ADLER_MODULO 65521
+#define ADLER_RUN 5552
+
+static const unsigned char pngSignature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+
+static const int lengthBases[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const int lengthExtraBits[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+
+static unsigned long crcTable[256];
+static unsigned short literalCodes[288];    // bit reversed, ready for putBits
+static unsigned char literalLengths[288];
+static bool areTablesReady = false;
+
+static unsigned int reverseBits(unsigned int code, int length)
+{
+    // Huffman codes go from their most significant bit
+    unsigned int reversed = 0;
+    for (int i = 0; i < length; i++)
+    {
+        reversed = (reversed << 1) | ((code >> i) & 1);
+    }
+    return reversed;
+}
+
+static void makeTables()
+{
+    for (int i = 0; i < 256; i++)
+    {
+        unsigned long crc = (unsigned long)i;
+        for (int k = 0; k < 8; k++)
+        {
+            crc = (crc & 1) ? 0xedb88320UL ^ (crc >> 1) : crc >> 1;
+        }
+        crcTable[i] = crc;
+    }
+
+    // the fixed literal/length code of deflate
+    for (int value = 0; value < 288; value++)
+    {
+        unsigned int code;
+        int length;
+        if (value < 144) { code = 0x30 + value; length = 8; }
+        else if (value < 256) { code = 0x190 + value - 144; length = 9; }
+        else if (value < 280) { code = value - 256; length = 7; }
+        else { code = 0xc0 + value - 280; length = 8; }
+
+        literalCodes[value] = (unsigned short)reverseBits(code, length);
+        literalLengths[value] = (unsigned char)length;
+    }
+    areTablesReady = true;
+}
+
+static unsigned long updateCrc(unsigned long crc, const unsigned char *data, size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        crc = crcTable[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+static void putBigEndian(unsigned char *data, unsigned long value)
+{
+    data[0] = (unsigned char)(value >> 24);
+    data[1] = (unsigned char)(value >> 16);
+    data[2] = (unsigned char)(value >> 8);
+    data[3] = (unsigned char)value;
+}
+
+PngWriter::PngWriter()
+{
+    m_file = NULL;
+    m_buffer = NULL;
+    m_isOpen = false;
+    m_row = NULL;
+    m_chunk = NULL;
+}
+
+PngWriter::~PngWriter()
+{
+    if (m_isOpen) close();
+}
+
+bool PngWriter::open(const char *path, int width, int height)
+{
+    m_file = fopen(path, "wb");
+    if (m_file == NULL)
+    {
+        UvdLog("can't create %s.\n", path);
+        return false;
+    }
+
+    m_buffer = NULL;
+    return start(width, height);
+}
+
+bool PngWriter::open(std::vector<unsigned char> *buffer, int width, int height)
+{
+    m_file = NULL;
+    m_buffer = buffer;
+    return start(width, height);
+}
+
+bool PngWriter::start(int width, int height)
+{
+    if (!areTablesReady) makeTables();
+
+    m_isOpen = true;
+    m_width = width;
+    m_height = height;
+    m_writtenRows = 0;
+    m_row = (unsigned char *)calloc(PNG_HISTORY + 1 + (size_t)width * 3, 1);
+    m_chunk = (unsigned char *)malloc(PNG_CHUNK_SIZE);
+    m_chunkSize = 0;
+    m_bits = 0;
+    m_bitCount = 0;
+    m_adler1 = 1;
+    m_adler2 = 0;
+    m_isFailed = false;
+
+    write(pngSignature, sizeof(pngSignature));
+
+    // 8-bit RGB, deflate, no filtering beyond the per row type, no interlace
+    unsigned char header[13];
+    putBigEndian(header, (unsigned long)width);
+    putBigEndian(header + 4, (unsigned long)height);
+    header[8] = 8;
+    header[9] = 2;
+    header[10] = 0;
+    header[11] = 0;
+    header[12] = 0;
+    writeChunk("IHDR", header, sizeof(header));
+
+    // zlib header (deflate, 32K window, fastest), then a fixed Huffman block
+    m_chunk[m_chunkSize++] = 0x78;
+    m_chunk[m_chunkSize++] = 0x01;
+    putBits(0, 1);
+    putBits(1, 2);
+
+    return true;
+}
+
+void PngWriter::write(const void *data, size_t size)
+{
+    if (m_buffer != NULL)
+    {
+        const unsigned char *bytes = (const unsigned char *)data;
+        m_buffer->insert(m_buffer->end(), bytes, bytes + size);
+    }
+    else if (fwrite(data, 1, size, m_file) != size)
+    {
+        m_isFailed = true;
+    }
+}
+
+void PngWriter::writeChunk(const char *type, const unsigned char *data, size_t size)
+{
+    unsigned char header[8];
+    putBigEndian(header, (unsigned long)size);
+    memcpy(header + 4, type, 4);
+
+    unsigned long crc = updateCrc(0xffffffffUL, header + 4, 4);
+    crc = updateCrc(crc, data, size) ^ 0xffffffffUL;
+    unsigned char trailer[4];
+    putBigEndian(trailer, crc);
+
+    write(header, 8);
+    if (size > 0) write(data, size);
+    write(trailer, 4);
+}
+
+void PngWriter::putBits(unsigned int bits, int count)
+{
+    // deflate packs values from the least significant bit
+    m_bits |= (unsigned long long)bits << m_bitCount;
+    m_bitCount += count;
+    while (m_bitCount >= 8)
+    {
+        m_chunk[m_chunkSize++] = (unsigned char)m_bits;
+        m_bits >>= 8;
+        m_bitCount -= 8;
+
+        if (m_chunkSize == PNG_CHUNK_SIZE)
+        {
+            writeChunk("IDAT", m_chunk, m_chunkSize);
+            m_chunkSize = 0;
+        }
+    }
+}
+
+void PngWriter::putLiteral(int value)
+{
+    putBits(literalCodes[value], literalLengths[value]);
+}
+
+void PngWriter::putMatch(int length, int distance)
+{
+    int code = 0;
+    while (code < 28 && lengthBases[code + 1] <= length) code++;
+    putLiteral(257 + code);
+    if (lengthExtraBits[code] > 0) putBits(length - lengthBases[code], lengthExtraBits[code]);
+
+    // distances 1 to 4 are codes 0 to 3 without extra bits
+    putBits(reverseBits(distance - 1, 5), 5);
+}
+
+void PngWriter::flushBits()
+{
+    if (m_bitCount > 0) putBits(0, 8 - m_bitCount);
+}
+
+void PngWriter::updateAdler(const unsigned char *data, size_t size)
+{
+    while (size > 0)
+    {
+        size_t run = size < ADLER_RUN ? size : ADLER_RUN;
+        for (size_t i = 0; i < run; i++)
+        {
+            m_adler1 += data[i];
+            m_adler2 += m_adler1;
+        }
+        m_adler1 %= ADLER_MODULO;
+        m_adler2 %= ADLER_MODULO;
+        data += run;
+        size -= run;
+    }
+}
+
+void PngWriter::writeRow(const unsigned char *pixels)
+{
+    if (!m_isOpen || m_writtenRows == m_height) return;
+
+    // the row follows the last bytes of the previous one, which matches
+    // may refer to
+    size_t rowSize = 1 + (size_t)m_width * 3;
+    unsigned char *row = m_row + PNG_HISTORY;
+    if (m_writtenRows > 0) memcpy(m_row, row + rowSize - PNG_HISTORY, PNG_HISTORY);
+    row[0] = 0;
+    memcpy(row + 1, pixels, rowSize - 1);
+    updateAdler(row, rowSize);
+
+    size_t index = 0;
+    size_t historyCount = m_writtenRows > 0 ? PNG_HISTORY : 0;
+    while (index < rowSize)
+    {
+        // the longer of a run of the previous pixel or of the previous byte
+        int bestLength = 0;
+        int bestDistance = 0;
+        for (int distance = 3; distance >= 1; distance -= 2)
+        {
+            if (index + historyCount < (size_t)distance) continue;
+
+            size_t limit = rowSize - index;
+            if (limit > PNG_MAX_MATCH) limit = PNG_MAX_MATCH;
+            size_t length = 0;
+            while (length < limit && row[index + length] == row[index + length - distance]) length++;
+
+            if ((int)length > bestLength)
+            {
+                bestLength = (int)length;
+                bestDistance = distance;
+            }
+        }
+
+        if (bestLength >= 3)
+        {
+            putMatch(bestLength, bestDistance);
+            index += bestLength;
+        }
+        else
+        {
+            putLiteral(row[index]);
+            index++;
+        }
+    }
+
+    m_writtenRows++;
+}
+
+bool PngWriter::close()
+{
+    if (!m_isOpen) return false;
+
+    // rows that were never written are black
+    if (m_writtenRows < m_height)
+    {
+        unsigned char *black = (unsigned char *)calloc((size_t)m_width * 3, 1);
+        while (m_writtenRows < m_height) writeRow(black);
+        free(black);
+    }
+
+    // end of the block, then an empty final one
+    putLiteral(256);
+    putBits(1, 1);
+    putBits(1, 2);
+    putLiteral(256);
+    flushBits();
+
+    unsigned char adler[4];
+    putBigEndian(adler, (m_adler2 << 16) | m_adler1);
+    for (int i = 0; i < 4; i++)
+    {
+        putBits(adler[i], 8);
+    }
+    writeChunk("IDAT", m_chunk, m_chunkSize);
+    writeChunk("IEND", NULL, 0);
+
+    if (m_file != NULL && fclose(m_file) != 0) m_isFailed = true;
+    m_file = NULL;
+    m_buffer = NULL;
+    m_isOpen = false;
+    free(m_row);
+    free(m_chunk);
+    m_row = NULL;
+    m_chunk = NULL;
+
+    return !m_isFailed;
+}
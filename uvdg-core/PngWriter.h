@@ -0,0 +1,55 @@
+#ifndef __PNGWRITER_H__
+#define __PNGWRITER_H__
+
+#include <stdio.h>
+#include <vector>
+
+#define PNG_CHUNK_SIZE (256 * 1024)
+#define PNG_MAX_MATCH 258
+
+// Streaming encoder of 8-bit RGB PNG files, a row at a time, so an image
+// never has to be held whole. The deflate stream is a single block of
+// fixed Huffman codes whose only matches repeat the previous pixel or
+// byte: plotted timelines are mostly runs of one color, which this packs
+// to a few bits per 258 bytes. zlib is only linked where the Makefile
+// builds gzip support (UVDG_GZIP), the Visual Studio projects go without.
+class PngWriter
+{
+    FILE *m_file;
+    std::vector<unsigned char> *m_buffer;   // instead of a file
+    bool m_isOpen;
+    int m_width;
+    int m_height;
+    int m_writtenRows;
+
+    unsigned char *m_row;           // 3 bytes of history, the filter byte, the pixels
+    unsigned char *m_chunk;         // IDAT data being filled
+    size_t m_chunkSize;
+    unsigned long long m_bits;
+    int m_bitCount;
+    unsigned long m_adler1, m_adler2;
+    bool m_isFailed;
+
+    bool start(int width, int height);
+    void write(const void *data, size_t size);
+    void writeChunk(const char *type, const unsigned char *data, size_t size);
+    void putBits(unsigned int bits, int count);
+    void putLiteral(int value);
+    void putMatch(int length, int distance);
+    void flushBits();
+    void updateAdler(const unsigned char *data, size_t size);
+
+public:
+    PngWriter();
+    ~PngWriter();
+
+    bool open(const char *path, int width, int height);
+    // the file goes to the end of buffer
+    bool open(std::vector<unsigned char> *buffer, int width, int height);
+    // width pixels of R, G, B bytes, top row first
+    void writeRow(const unsigned char *pixels);
+    // false if anything failed to be written
+    bool close();
+};
+
+#endif
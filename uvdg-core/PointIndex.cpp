@@ -0,0 +1,293 @@
+#include "PointIndex.h"
+#include <algorithm>
+
+PointIndex::PointIndex()
+{
+    m_pointCount = 0;
+    m_trackedCount = 0;
+    m_freeTrackBlock = -1;
+    m_lastTailNumber = 0;
+    m_lastTrack = 0;
+    m_trackLists.reserve(TRACK_LIST_RESERVE);
+}
+
+static bool trackListIsBefore(const TrackList &list, int tailNumber)
+{
+    return list.tailNumber < tailNumber;
+}
+
+static void startBlock(PointBlock *block, const K2 &point)
+{
+    short amplitude = point.ri.amplitude > SHRT_MAX ? SHRT_MAX : (short)point.ri.amplitude;
+
+    block->minAltitude = point.alt;
+    block->maxAltitude = point.alt;
+    block->minFuel = (short)point.fuel;
+    block->maxFuel = (short)point.fuel;
+    block->minAmplitude = amplitude;
+    block->maxAmplitude = amplitude;
+    block->hasConfidence4 = point.ri.confidence == 4;
+    block->isAllConfidence4 = block->hasConfidence4;
+}
+
+static void widenBlock(PointBlock *block, const K2 &point)
+{
+    short amplitude = point.ri.amplitude > SHRT_MAX ? SHRT_MAX : (short)point.ri.amplitude;
+
+    if (point.alt < block->minAltitude) block->minAltitude = point.alt;
+    if (point.alt > block->maxAltitude) block->maxAltitude = point.alt;
+    if (point.fuel < block->minFuel) block->minFuel = (short)point.fuel;
+    if (point.fuel > block->maxFuel) block->maxFuel = (short)point.fuel;
+    if (amplitude < block->minAmplitude) block->minAmplitude = amplitude;
+    if (amplitude > block->maxAmplitude) block->maxAmplitude = amplitude;
+    if (point.ri.confidence == 4) block->hasConfidence4 = true;
+    else block->isAllConfidence4 = false;
+}
+
+int PointIndex::takeTrackBlock(int previous)
+{
+    int block = m_freeTrackBlock;
+    if (block >= 0)
+    {
+        m_freeTrackBlock = m_trackLinks[block].next;
+    }
+    else
+    {
+        block = (int)m_trackLinks.size();
+        m_trackLinks.resize(block + 1);
+        m_trackIndexes.resize((size_t)(block + 1) * TRACK_BLOCK_LENGTH);
+    }
+
+    m_trackLinks[block].previous = previous;
+    m_trackLinks[block].next = -1;
+    if (previous >= 0) m_trackLinks[previous].next = block;
+    return block;
+}
+
+void PointIndex::addTrackPoint(int tailNumber, size_t index)
+{
+    if (tailNumber != m_lastTailNumber)
+    {
+        std::vector<TrackList>::iterator list = std::lower_bound(m_trackLists.begin(), m_trackLists.end(), tailNumber, trackListIsBefore);
+        if (list == m_trackLists.end() || list->tailNumber != tailNumber)
+        {
+            TrackList newList;
+            newList.tailNumber = tailNumber;
+            newList.firstBlock = takeTrackBlock(-1);
+            newList.lastBlock = newList.firstBlock;
+            newList.lastCount = 0;
+            list = m_trackLists.insert(list, newList);
+        }
+        m_lastTailNumber = tailNumber;
+        m_lastTrack = list - m_trackLists.begin();
+    }
+
+    TrackList *list = &m_trackLists[m_lastTrack];
+    if (list->lastCount == TRACK_BLOCK_LENGTH)
+    {
+        list->lastBlock = takeTrackBlock(list->lastBlock);
+        list->lastCount = 0;
+    }
+    m_trackIndexes[(size_t)list->lastBlock * TRACK_BLOCK_LENGTH + list->lastCount] = (unsigned int)index;
+    list->lastCount++;
+}
+
+void PointIndex::add(const K2 &point)
+{
+    if ((m_pointCount & POINT_BLOCK_MASK) == 0)
+    {
+        PointBlock block;
+        startBlock(&block, point);
+        m_blocks.push_back(block);
+    }
+    else
+    {
+        widenBlock(&m_blocks.back(), point);
+    }
+
+    if (m_trackedCount == m_pointCount)
+    {
+        if (point.tailNumber != 0) addTrackPoint(point.tailNumber, m_pointCount);
+        m_trackedCount++;
+    }
+    m_pointCount++;
+}
+
+void PointIndex::rebuild(ChunkedVector<K2> *points, size_t fromIndex)
+{
+    if (fromIndex > m_pointCount) fromIndex = m_pointCount;
+
+    // the block holding fromIndex is summarized again from its start
+    size_t blockCount = fromIndex >> POINT_BLOCK_SHIFT;
+    m_blocks.resize(blockCount);
+    m_pointCount = blockCount << POINT_BLOCK_SHIFT;
+
+    // a block never straddles two chunks of the points
+    size_t pointCount = points->size();
+    while (m_pointCount < pointCount)
+    {
+        size_t count = pointCount - m_pointCount;
+        if (count > POINT_BLOCK_LENGTH) count = POINT_BLOCK_LENGTH;
+        const K2 *records = &(*points)[m_pointCount];
+
+        PointBlock block;
+        startBlock(&block, records[0]);
+        for (size_t i = 1; i < count; i++)
+        {
+            widenBlock(&block, records[i]);
+        }
+        m_blocks.push_back(block);
+        m_pointCount += count;
+    }
+
+    // track lists are caught up when a track is asked for; they keep their
+    // capacity, the next points are mostly theirs
+    if (fromIndex >= m_trackedCount) return;
+    m_trackedCount = fromIndex;
+    m_lastTailNumber = 0;
+
+    // cut from the back, what is cut goes to the free blocks
+    size_t writeIndex = 0;
+    for (size_t i = 0; i < m_trackLists.size(); i++)
+    {
+        TrackList list = m_trackLists[i];
+        while (true)
+        {
+            unsigned int *indexes = &m_trackIndexes[(size_t)list.lastBlock * TRACK_BLOCK_LENGTH];
+            list.lastCount = (int)(std::lower_bound(indexes, indexes + list.lastCount, (unsigned int)fromIndex) - indexes);
+            if (list.lastCount > 0 || list.lastBlock == list.firstBlock) break;
+
+            int previous = m_trackLinks[list.lastBlock].previous;
+            m_trackLinks[list.lastBlock].next = m_freeTrackBlock;
+            m_freeTrackBlock = list.lastBlock;
+            list.lastBlock = previous;
+            list.lastCount = TRACK_BLOCK_LENGTH;
+        }
+
+        if (list.lastCount == 0)
+        {
+            m_trackLinks[list.firstBlock].next = m_freeTrackBlock;
+            m_freeTrackBlock = list.firstBlock;
+            continue;
+        }
+        m_trackLinks[list.lastBlock].next = -1;
+        m_trackLists[writeIndex++] = list;
+    }
+    m_trackLists.resize(writeIndex);
+}
+
+void PointIndex::clear()
+{
+    m_blocks.clear();
+    m_trackLists.clear();
+    m_trackIndexes.clear();
+    m_trackLinks.clear();
+    m_freeTrackBlock = -1;
+    m_pointCount = 0;
+    m_trackedCount = 0;
+    m_lastTailNumber = 0;
+}
+
+size_t PointIndex::nextCandidate(size_t index, size_t endIndex, PointFilter *filter)
+{
+    size_t block = index >> POINT_BLOCK_SHIFT;
+    while (index < endIndex)
+    {
+        // points not indexed yet are candidates
+        if (block >= m_blocks.size() || blockPasses(m_blocks[block], filter)) return index;
+        block++;
+        index = block << POINT_BLOCK_SHIFT;
+    }
+    return endIndex;
+}
+
+void PointIndex::catchUpTracks(ChunkedVector<K2> *points)
+{
+    while (m_trackedCount < m_pointCount)
+    {
+        int pointTailNumber = (*points)[m_trackedCount].tailNumber;
+        if (pointTailNumber != 0) addTrackPoint(pointTailNumber, m_trackedCount);
+        m_trackedCount++;
+    }
+}
+
+size_t PointIndex::firstTrackPoint(int tailNumber, size_t index, size_t endIndex, ChunkedVector<K2> *points, TrackCursor *cursor)
+{
+    catchUpTracks(points);
+
+    std::vector<TrackList>::iterator list = std::lower_bound(m_trackLists.begin(), m_trackLists.end(), tailNumber, trackListIsBefore);
+    if (list == m_trackLists.end() || list->tailNumber != tailNumber) return endIndex;
+
+    cursor->lastBlock = list->lastBlock;
+    cursor->lastCount = list->lastCount;
+
+    // the blocks ending before index are skipped whole
+    int block = list->firstBlock;
+    while (block != list->lastBlock && m_trackIndexes[(size_t)block * TRACK_BLOCK_LENGTH + TRACK_BLOCK_LENGTH - 1] < index)
+    {
+        block = m_trackLinks[block].next;
+    }
+
+    unsigned int *indexes = &m_trackIndexes[(size_t)block * TRACK_BLOCK_LENGTH];
+    int count = block == list->lastBlock ? list->lastCount : TRACK_BLOCK_LENGTH;
+    cursor->block = block;
+    cursor->offset = (int)(std::lower_bound(indexes, indexes + count, (unsigned int)index) - indexes);
+    if (cursor->offset == count) return endIndex;
+
+    return indexes[cursor->offset] < endIndex ? indexes[cursor->offset] : endIndex;
+}
+
+size_t PointIndex::nextTrackPoint(TrackCursor *cursor, size_t endIndex)
+{
+    cursor->offset++;
+    if (cursor->block == cursor->lastBlock)
+    {
+        if (cursor->offset >= cursor->lastCount) return endIndex;
+    }
+    else if (cursor->offset == TRACK_BLOCK_LENGTH)
+    {
+        cursor->block = m_trackLinks[cursor->block].next;
+        cursor->offset = 0;
+        if (cursor->block == cursor->lastBlock && cursor->lastCount == 0) return endIndex;
+    }
+
+    size_t index = m_trackIndexes[(size_t)cursor->block * TRACK_BLOCK_LENGTH + cursor->offset];
+    return index < endIndex ? index : endIndex;
+}
+
+bool PointIndex::blockPassesWhole(size_t index, PointFilter *filter)
+{
+    size_t block = index >> POINT_BLOCK_SHIFT;
+    return block < m_blocks.size() && (block + 1) << POINT_BLOCK_SHIFT <= m_pointCount &&
+        blockPassesWhole(m_blocks[block], filter);
+}
+
+void PointIndex::defaultFilter(PointFilter *filter)
+{
+    filter->isConfidence4Only = false;
+    filter->minAmplitude = INT_MIN;
+    filter->minAltitude = INT_MIN;
+    filter->maxAltitude = INT_MAX;
+    filter->minFuel = INT_MIN;
+    filter->maxFuel = INT_MAX;
+    filter->tailNumber = 0;
+}
+
+bool PointIndex::blockPasses(const PointBlock &block, PointFilter *filter)
+{
+    if (filter->isConfidence4Only && !block.hasConfidence4) return false;
+    if (block.maxAmplitude < filter->minAmplitude) return false;
+    if (block.maxAltitude < filter->minAltitude || block.minAltitude > filter->maxAltitude) return false;
+    if (block.maxFuel < filter->minFuel || block.minFuel > filter->maxFuel) return false;
+    return true;
+}
+
+bool PointIndex::blockPassesWhole(const PointBlock &block, PointFilter *filter)
+{
+    if (filter->isConfidence4Only && !block.isAllConfidence4) return false;
+    if (block.minAmplitude < filter->minAmplitude) return false;
+    if (block.minAltitude < filter->minAltitude || block.maxAltitude > filter->maxAltitude) return false;
+    if (block.minFuel < filter->minFuel || block.maxFuel > filter->maxFuel) return false;
+    if (filter->tailNumber != 0) return false;
+    return true;
+}
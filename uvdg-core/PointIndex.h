@@ -0,0 +1,114 @@
+#ifndef __POINTINDEX_H__
+#define __POINTINDEX_H__
+
+#include <limits.h>
+#include <stddef.h>
+#include <vector>
+#include "ChunkedVector.h"
+#include "UvdRecords.h"
+
+#define POINT_BLOCK_SHIFT 6
+#define POINT_BLOCK_LENGTH (1 << POINT_BLOCK_SHIFT)
+#define POINT_BLOCK_MASK (POINT_BLOCK_LENGTH - 1)
+#define TRACK_BLOCK_LENGTH 32               // divides CHUNK_LENGTH, a block never straddles chunks
+#define TRACK_LIST_RESERVE 1024
+
+// which points are drawn, bounds are inclusive, INT_MIN/INT_MAX = no bound
+typedef struct {
+    bool isConfidence4Only;
+    int minAmplitude;
+    int minAltitude, maxAltitude;
+    int minFuel, maxFuel;
+    int tailNumber;             // one associated track, 0 = any
+} PointFilter;
+
+// what the points of one block span
+typedef struct {
+    int minAltitude, maxAltitude;
+    short minFuel, maxFuel;
+    short minAmplitude, maxAmplitude;
+    bool hasConfidence4;
+    bool isAllConfidence4;
+} PointBlock;
+
+// the blocks of the point indexes of one associated track, in time order;
+// all but the last are full
+typedef struct {
+    int tailNumber;
+    int firstBlock, lastBlock;
+    int lastCount;
+} TrackList;
+
+typedef struct {
+    int previous, next;         // -1 = none
+} TrackBlockLink;
+
+// a walk over the points of one track, see firstTrackPoint
+typedef struct {
+    int block;
+    int offset;
+    int lastBlock, lastCount;
+} TrackCursor;
+
+// Summaries of the points of a state, POINT_BLOCK_LENGTH consecutive points
+// per block, and the indexes of the points of every associated track. The
+// points stay in one time ordered store (retention, snapshots and merges
+// rely on it), a renderer asks the index for the next block that may hold
+// a point passing its filter and skips the others, or walks the points of
+// the one track it shows, so a selective filter costs about the points it
+// lets through. The track lists take blocks of TRACK_BLOCK_LENGTH indexes
+// from one pool, and a rebuild puts the blocks it cuts off on a free list,
+// so appending a point to a track doesn't allocate once the pool is warm.
+class PointIndex
+{
+    ChunkedVector<PointBlock> m_blocks;
+    std::vector<TrackList> m_trackLists;    // by tail number
+    ChunkedVector<unsigned int> m_trackIndexes;     // TRACK_BLOCK_LENGTH per block
+    ChunkedVector<TrackBlockLink> m_trackLinks;
+    int m_freeTrackBlock;           // linked by next
+    size_t m_pointCount;
+    size_t m_trackedCount;          // points the track lists hold
+
+    // replies come in bursts, consecutive points are often of one track
+    int m_lastTailNumber;
+    size_t m_lastTrack;             // in m_trackLists
+
+    int takeTrackBlock(int previous);
+    void addTrackPoint(int tailNumber, size_t index);
+    void catchUpTracks(ChunkedVector<K2> *points);
+
+public:
+    PointIndex();
+
+    // called with the state locked, for every point appended
+    void add(const K2 &point);
+    // after the points from fromIndex on were replaced, moved or dropped
+    void rebuild(ChunkedVector<K2> *points, size_t fromIndex);
+    void clear();
+
+    // first index in [index, endIndex) in a block that may pass the filter
+    size_t nextCandidate(size_t index, size_t endIndex, PointFilter *filter);
+    // every point of the block holding index passes, none needs testing
+    bool blockPassesWhole(size_t index, PointFilter *filter);
+    // the first point of a track in [index, endIndex), endIndex = none;
+    // the cursor then walks the next ones in time order
+    size_t firstTrackPoint(int tailNumber, size_t index, size_t endIndex, ChunkedVector<K2> *points, TrackCursor *cursor);
+    size_t nextTrackPoint(TrackCursor *cursor, size_t endIndex);
+    // end of the block holding index
+    static size_t blockEnd(size_t index) { return (index | POINT_BLOCK_MASK) + 1; }
+
+    static void defaultFilter(PointFilter *filter);
+    static bool blockPasses(const PointBlock &block, PointFilter *filter);
+    static bool blockPassesWhole(const PointBlock &block, PointFilter *filter);
+    static bool pointPasses(const K2 &point, PointFilter *filter)
+    {
+        if (filter->isConfidence4Only && point.ri.confidence != 4) return false;
+        if (point.ri.amplitude < filter->minAmplitude) return false;
+        if (point.alt < filter->minAltitude || point.alt > filter->maxAltitude) return false;
+        if (point.fuel < filter->minFuel || point.fuel > filter->maxFuel) return false;
+        if (filter->tailNumber != 0 && point.tailNumber != filter->tailNumber) return false;
+        return true;
+    }
+};
+
+#endif
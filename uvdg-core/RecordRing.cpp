@@ -0,0 +1,399 @@
+#include "RecordRing.h"
+#include "Log.h"
+#include <stdio.h>
+#include <string.h>
+
+static_assert(sizeof(RingRecord) == 32, "RingRecord is 32 bytes in the shared format");
+static_assert(sizeof(RingHeader) == RECORD_RING_HEADER_SIZE, "RingHeader is the shared header");
+
+#ifdef _MSC_VER
+
+#include <intrin.h>
+
+// aligned loads and stores are atomic on x86 and x64, the compiler is kept
+// from moving other accesses across them
+static unsigned long long RingLoad(volatile unsigned long long *value)
+{
+    unsigned long long result = *value;
+    _ReadWriteBarrier();
+    return result;
+}
+
+static void RingStore(volatile unsigned long long *value, unsigned long long newValue)
+{
+    _ReadWriteBarrier();
+    *value = newValue;
+}
+
+static void RingFence()
+{
+    MemoryBarrier();
+}
+
+#else
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+static unsigned long long RingLoad(volatile unsigned long long *value)
+{
+    return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+}
+
+static void RingStore(volatile unsigned long long *value, unsigned long long newValue)
+{
+    __atomic_store_n(value, newValue, __ATOMIC_RELEASE);
+}
+
+static void RingFence()
+{
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+#endif
+
+RecordRing::RecordRing()
+{
+    m_name[0] = '\x00';
+    m_header = NULL;
+    m_records = NULL;
+    m_size = 0;
+    m_isProducer = false;
+    m_mask = 0;
+    m_index = 0;
+    m_readIndex = 0;
+
+#ifdef _MSC_VER
+    m_mapping = NULL;
+    m_wakeEvent = NULL;
+#endif
+}
+
+RecordRing::~RecordRing()
+{
+    close();
+}
+
+bool RecordRing::create(const char *name, unsigned int capacity)
+{
+    if (capacity == 0 || (capacity & (capacity - 1)) != 0)
+    {
+        UvdLog("ring capacity %u is not a power of two.\n", capacity);
+        return false;
+    }
+
+    sprintf(m_name, "%.200s", name);
+    m_size = RECORD_RING_HEADER_SIZE + (size_t)capacity * sizeof(RingRecord);
+    m_isProducer = true;
+    if (!map(true)) return false;
+
+    m_header->version = RECORD_RING_VERSION;
+    m_header->recordSize = sizeof(RingRecord);
+    m_header->capacity = capacity;
+    RingFence();
+    m_header->magic = RECORD_RING_MAGIC;
+
+    m_mask = capacity - 1;
+    m_index = 0;
+    m_readIndex = 0;
+    return true;
+}
+
+bool RecordRing::open(const char *name)
+{
+    sprintf(m_name, "%.200s", name);
+    m_size = 0;
+    m_isProducer = false;
+    if (!map(false)) return false;
+
+    // the view of a Windows mapping is rounded up to whole pages, the ring
+    // only has to fit in it; the capacity is a power of two as create()
+    // makes it, or the mask would let reads past the records
+    RingFence();
+    unsigned int capacity = m_header->capacity;
+    if (m_header->magic != RECORD_RING_MAGIC || m_header->version != RECORD_RING_VERSION ||
+        m_header->recordSize != sizeof(RingRecord) ||
+        capacity == 0 || (capacity & (capacity - 1)) != 0 ||
+        m_size < RECORD_RING_HEADER_SIZE + (size_t)capacity * sizeof(RingRecord))
+    {
+        UvdLog("ring %s: not a version %d ring.\n", m_name, RECORD_RING_VERSION);
+        close();
+        return false;
+    }
+
+    m_mask = capacity - 1;
+    m_index = RingLoad(&m_header->readIndex);
+    return true;
+}
+
+#ifdef _MSC_VER
+
+bool RecordRing::map(bool isCreating)
+{
+    char path[RECORD_RING_NAME_SIZE + 32];
+    sprintf(path, "Local\\uvdg-%s", m_name);
+
+    if (isCreating)
+    {
+        m_mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+                                       (DWORD)((unsigned long long)m_size >> 32), (DWORD)m_size, path);
+    }
+    else
+    {
+        m_mapping = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, path);
+    }
+    if (m_mapping == NULL) return false;
+    if (isCreating && GetLastError() == ERROR_ALREADY_EXISTS)
+    {
+        // a consumer still has the previous one open
+        UvdLog("ring %s is still in use.\n", path);
+        close();
+        return false;
+    }
+
+    void *data = MapViewOfFile(m_mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+    if (data == NULL)
+    {
+        close();
+        return false;
+    }
+
+    if (!isCreating)
+    {
+        MEMORY_BASIC_INFORMATION info;
+        VirtualQuery(data, &info, sizeof(info));
+        m_size = info.RegionSize;
+    }
+
+    m_header = (RingHeader *)data;
+    m_records = (RingRecord *)((char *)data + RECORD_RING_HEADER_SIZE);
+
+    sprintf(path, "Local\\uvdg-%s-wake", m_name);
+    m_wakeEvent = CreateEventA(NULL, FALSE, FALSE, path);
+    if (m_wakeEvent == NULL)
+    {
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+void RecordRing::close()
+{
+    if (m_header != NULL) UnmapViewOfFile(m_header);
+    if (m_mapping != NULL) CloseHandle(m_mapping);
+    if (m_wakeEvent != NULL) CloseHandle(m_wakeEvent);
+
+    m_header = NULL;
+    m_records = NULL;
+    m_mapping = NULL;
+    m_wakeEvent = NULL;
+}
+
+void RecordRing::wake()
+{
+    SetEvent(m_wakeEvent);
+}
+
+bool RecordRing::wait(int timeoutMilliseconds)
+{
+    if (m_header == NULL) return false;
+    if (RingLoad(&m_header->writeIndex) != m_index || m_header->isClosed) return true;
+
+    m_header->isWaiting = 1;
+    RingFence();
+
+    bool isReady = RingLoad(&m_header->writeIndex) != m_index || m_header->isClosed;
+    if (!isReady)
+    {
+        isReady = WaitForSingleObject(m_wakeEvent, timeoutMilliseconds) == WAIT_OBJECT_0;
+    }
+
+    m_header->isWaiting = 0;
+    return isReady;
+}
+
+#else
+
+bool RecordRing::map(bool isCreating)
+{
+    char path[RECORD_RING_NAME_SIZE + 32];
+    sprintf(path, "/uvdg-%s", m_name);
+
+    int fd;
+    if (isCreating)
+    {
+        // a consumer still mapping a stale segment keeps it until it reopens
+        shm_unlink(path);
+        fd = shm_open(path, O_RDWR | O_CREAT | O_EXCL, 0600);
+        if (fd >= 0 && ftruncate(fd, (off_t)m_size) != 0)
+        {
+            ::close(fd);
+            shm_unlink(path);
+            fd = -1;
+        }
+    }
+    else
+    {
+        fd = shm_open(path, O_RDWR, 0);
+        struct stat status;
+        if (fd >= 0 && (fstat(fd, &status) != 0 || status.st_size < RECORD_RING_HEADER_SIZE))
+        {
+            ::close(fd);
+            fd = -1;
+        }
+        if (fd >= 0) m_size = (size_t)status.st_size;
+    }
+
+    if (fd < 0)
+    {
+        UvdLog("ring %s: %s.\n", path, strerror(errno));
+        return false;
+    }
+
+    void *data = mmap(NULL, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED)
+    {
+        if (isCreating) shm_unlink(path);
+        return false;
+    }
+
+    m_header = (RingHeader *)data;
+    m_records = (RingRecord *)((char *)data + RECORD_RING_HEADER_SIZE);
+    return true;
+}
+
+void RecordRing::close()
+{
+    if (m_header == NULL) return;
+
+    munmap(m_header, m_size);
+    m_header = NULL;
+    m_records = NULL;
+
+    if (m_isProducer)
+    {
+        // the consumer keeps its mapping, a new one can't open it any more
+        char path[RECORD_RING_NAME_SIZE + 32];
+        sprintf(path, "/uvdg-%s", m_name);
+        shm_unlink(path);
+    }
+}
+
+void RecordRing::wake()
+{
+    __atomic_add_fetch(&m_header->wakeCount, 1, __ATOMIC_SEQ_CST);
+    syscall(SYS_futex, &m_header->wakeCount, FUTEX_WAKE, 1, NULL, NULL, 0);
+}
+
+bool RecordRing::wait(int timeoutMilliseconds)
+{
+    if (m_header == NULL) return false;
+    if (RingLoad(&m_header->writeIndex) != m_index || m_header->isClosed) return true;
+
+    // the producer either sees isWaiting after it published, or published
+    // before the check below; a wake between the check and the futex call
+    // changes wakeCount, and the futex returns at once
+    unsigned int wakeCount = m_header->wakeCount;
+    m_header->isWaiting = 1;
+    RingFence();
+
+    bool isReady = RingLoad(&m_header->writeIndex) != m_index || m_header->isClosed;
+    if (!isReady)
+    {
+        struct timespec timeout;
+        timeout.tv_sec = timeoutMilliseconds / 1000;
+        timeout.tv_nsec = (timeoutMilliseconds % 1000) * 1000000L;
+        syscall(SYS_futex, &m_header->wakeCount, FUTEX_WAIT, wakeCount, &timeout, NULL, 0);
+
+        isReady = RingLoad(&m_header->writeIndex) != m_index || m_header->isClosed;
+    }
+
+    m_header->isWaiting = 0;
+    return isReady;
+}
+
+#endif
+
+bool RecordRing::write(const RingRecord *record)
+{
+    if (m_index - m_readIndex > m_mask)
+    {
+        // the consumer's index is only fetched when the ring looks full
+        m_readIndex = RingLoad(&m_header->readIndex);
+        if (m_index - m_readIndex > m_mask)
+        {
+            m_header->droppedCount++;
+            return false;
+        }
+    }
+
+    m_records[m_index & m_mask] = *record;
+    m_index++;
+    return true;
+}
+
+void RecordRing::publish()
+{
+    if (RingLoad(&m_header->writeIndex) == m_index) return;
+
+    RingStore(&m_header->writeIndex, m_index);
+    RingFence();
+
+    if (m_header->isWaiting)
+    {
+        m_header->isWaiting = 0;
+        wake();
+    }
+}
+
+void RecordRing::finish()
+{
+    // the records go before the flag, a consumer seeing it has them all
+    RingStore(&m_header->writeIndex, m_index);
+    RingFence();
+    m_header->isClosed = 1;
+    RingFence();
+    wake();
+}
+
+int RecordRing::read(RingRecord *records, int maxCount)
+{
+    unsigned long long writeIndex = RingLoad(&m_header->writeIndex);
+    int count = 0;
+    while (m_index != writeIndex && count < maxCount)
+    {
+        records[count++] = m_records[m_index & m_mask];
+        m_index++;
+    }
+
+    if (count > 0) RingStore(&m_header->readIndex, m_index);
+    return count;
+}
+
+bool RecordRing::isClosed()
+{
+    if (m_header == NULL) return true;
+
+    bool isClosed = m_header->isClosed != 0;
+    RingFence();
+    return isClosed;
+}
+
+unsigned long long RecordRing::writtenCount()
+{
+    return RingLoad(&m_header->writeIndex);
+}
+
+unsigned long long RecordRing::droppedCount()
+{
+    return m_header->droppedCount;
+}
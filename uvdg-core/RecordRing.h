@@ -0,0 +1,120 @@
+#ifndef __RECORDRING_H__
+#define __RECORDRING_H__
+
+#include <stddef.h>
+
+#ifdef _MSC_VER
+#include <Windows.h>
+#endif
+
+#define RECORD_RING_MAGIC 0x52445655        // "UVDR"
+#define RECORD_RING_VERSION 1
+#define RECORD_RING_HEADER_SIZE 256
+#define RECORD_RING_CAPACITY 65536          // records, a power of two
+#define RECORD_RING_NAME_SIZE 256
+
+#define RING_RECORD_K1 1
+#define RING_RECORD_K2 2
+
+// A decoded K1/K2 line, 32 bytes, little-endian. processRecord takes it as
+// processLine takes the line, so the time of day crosses midnight the same
+// way and repeated times are dropped the same way.
+typedef struct {
+    unsigned int type;          // RING_RECORD_K1, RING_RECORD_K2
+    int confidence;             // stars of the line, 0..4
+    long long timeOfDay;        // microseconds since the decoder's midnight
+    int amplitude;
+    int value;                  // K1 tail number, K2 altitude in meters
+    int fuel;                   // K2 fuel in percent
+    unsigned int reserved;      // 0
+} RingRecord;
+
+// Offsets are part of the format; the indexes a side writes are on a cache
+// line of their own.
+typedef struct {
+    // 0: set up by the producer, magic last
+    volatile unsigned int magic;
+    unsigned int version;
+    unsigned int recordSize;    // sizeof(RingRecord)
+    unsigned int capacity;
+    volatile unsigned int isClosed;
+    unsigned int reserved1[11];
+
+    // 64: written by the producer
+    volatile unsigned long long writeIndex;
+    volatile unsigned long long droppedCount;
+    volatile unsigned int wakeCount;
+    unsigned int reserved2[11];
+
+    // 128: written by the consumer
+    volatile unsigned long long readIndex;
+    volatile unsigned int isWaiting;
+    unsigned int reserved3[13];
+
+    unsigned int reserved4[16];
+} RingHeader;
+
+// Shared-memory ring of records from a decoder on the same host, so they
+// reach UvdState without a syscall per record and without text parsing.
+//
+// The segment is shm_open("/uvdg-NAME") on Linux and the file mapping
+// "Local\uvdg-NAME" on Windows: RingHeader, then capacity records from
+// offset RECORD_RING_HEADER_SIZE, record i at i % capacity. One producer
+// creates it, fills records from writeIndex on and then stores writeIndex
+// past them; one consumer opens it, reads records up to writeIndex and then
+// stores readIndex past them. Both indexes only grow, so the ring is full at
+// writeIndex - readIndex == capacity, and then the producer counts a record
+// in droppedCount rather than wait for the consumer.
+//
+// A consumer with nothing to read sets isWaiting and sleeps on wakeCount, a
+// futex on Linux, the event "Local\uvdg-NAME-wake" on Windows. The producer
+// only makes the syscall to wake it when it finds isWaiting set, so a busy
+// ring costs none.
+class RecordRing
+{
+    char m_name[RECORD_RING_NAME_SIZE];
+    RingHeader *m_header;
+    RingRecord *m_records;
+    size_t m_size;
+    bool m_isProducer;
+
+    unsigned int m_mask;
+    unsigned long long m_index;         // the producer's next write, the consumer's next read
+    unsigned long long m_readIndex;     // of the consumer, as last seen by the producer
+
+#ifdef _MSC_VER
+    HANDLE m_mapping;
+    HANDLE m_wakeEvent;
+#endif
+
+    bool map(bool isCreating);
+    void wake();
+
+public:
+    RecordRing();
+    ~RecordRing();
+
+    // producer: a new segment, replacing a stale one of the same name
+    bool create(const char *name, unsigned int capacity);
+    // consumer: the segment of a running producer, read from where the
+    // previous consumer left off
+    bool open(const char *name);
+    void close();
+
+    // the producer writes records and makes them visible in batches
+    bool write(const RingRecord *record);
+    void publish();
+    // publishes, and tells the consumer nothing more is coming
+    void finish();
+
+    // the consumer takes up to maxCount records, 0 when the ring is empty
+    int read(RingRecord *records, int maxCount);
+    // false after timeoutMilliseconds without records
+    bool wait(int timeoutMilliseconds);
+
+    bool isClosed();
+    unsigned long long writtenCount();
+    unsigned long long droppedCount();
+};
+
+#endif
@@ -0,0 +1,267 @@
+#include "RtlUvdArchive.h"
+#include "RtlUvdIndex.h"
+#include "RtlUvdParser.h"
+#include "SpanRecorder.h"
+#include "Log.h"
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+#ifdef _MSC_VER
+#include <Windows.h>
+#else
+#include <dirent.h>
+#endif
+
+#define MAX_ARCHIVE_JOBS 64
+
+static bool compareFiles(const ArchiveFile &a, const ArchiveFile &b)
+{
+    if (a.day != b.day) return a.day < b.day;
+    return strcmp(a.path, b.path) < 0;
+}
+
+RtlUvdArchive::RtlUvdArchive(UvdState *state)
+{
+    m_state = state;
+    m_nextFile = 0;
+    m_parsedFiles = 0;
+    m_runningWorkers = 0;
+
+    MutexCreate(&m_lock);
+    EventCreate(&m_parsedEvent);
+}
+
+RtlUvdArchive::~RtlUvdArchive()
+{
+    EventDestroy(&m_parsedEvent);
+    MutexDestroy(&m_lock);
+}
+
+static bool fileForPath(const char *path, ArchiveFile *file)
+{
+    size_t length = strlen(path);
+    if (length >= sizeof(file->path)) return false;
+
+    // sidecar seek indexes share the log's name
+    size_t suffixLength = strlen(INDEX_FILE_SUFFIX);
+    if (length > suffixLength && strcmp(path + length - suffixLength, INDEX_FILE_SUFFIX) == 0) return false;
+
+    if (!RtlUvdParser::dateFromLogFileName(path, &file->yyyy, &file->mm, &file->dd)) return false;
+
+    strcpy(file->path, path);
+    file->day = UvdState::dayNumber(file->yyyy, file->mm, file->dd);
+    file->part = NULL;
+    file->isParsed = false;
+    file->isFinished = false;
+
+    return true;
+}
+
+bool RtlUvdArchive::addFile(const char *path)
+{
+    ArchiveFile file;
+    if (!fileForPath(path, &file)) return false;
+
+    m_files.push_back(file);
+    return true;
+}
+
+int RtlUvdArchive::addDirectory(const char *path, int fromDay, int toDay)
+{
+    std::vector<ArchiveFile> found;
+    char filePath[1024];
+    ArchiveFile file;
+
+#ifdef _MSC_VER
+    char pattern[1024];
+    _snprintf(pattern, sizeof(pattern), "%s\\rtl-uvd-log-*", path);
+    pattern[sizeof(pattern) - 1] = '\x00';
+
+    WIN32_FIND_DATAA findData;
+    HANDLE find = FindFirstFileA(pattern, &findData);
+    if (find == INVALID_HANDLE_VALUE) return 0;
+
+    do
+    {
+        if (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) continue;
+
+        _snprintf(filePath, sizeof(filePath), "%s\\%s", path, findData.cFileName);
+        filePath[sizeof(filePath) - 1] = '\x00';
+        if (fileForPath(filePath, &file)) found.push_back(file);
+    } while (FindNextFileA(find, &findData));
+
+    FindClose(find);
+#else
+    DIR *directory = opendir(path);
+    if (directory == NULL) return 0;
+
+    struct dirent *entry;
+    while ((entry = readdir(directory)) != NULL)
+    {
+        if (strncmp(entry->d_name, "rtl-uvd-log-", 12) != 0) continue;
+
+        snprintf(filePath, sizeof(filePath), "%s/%s", path, entry->d_name);
+        if (fileForPath(filePath, &file)) found.push_back(file);
+    }
+
+    closedir(directory);
+#endif
+
+    int added = 0;
+    std::vector<ArchiveFile>::iterator iter;
+    for (iter = found.begin(); iter != found.end(); ++iter)
+    {
+        if (fromDay != ARCHIVE_DAY_ANY && (*iter).day < fromDay) continue;
+        if (toDay != ARCHIVE_DAY_ANY && (*iter).day > toDay) continue;
+
+        m_files.push_back(*iter);
+        added++;
+    }
+
+    return added;
+}
+
+void RtlUvdArchive::workerThread(void *context)
+{
+    RtlUvdArchive *archive = (RtlUvdArchive *)context;
+
+    while (!archive->m_state->isLoadCancelled())
+    {
+        MutexLock(&archive->m_lock);
+        ArchiveFile *file = NULL;
+        if (archive->m_nextFile < archive->m_files.size())
+        {
+            file = &archive->m_files[archive->m_nextFile++];
+        }
+        MutexUnlock(&archive->m_lock);
+
+        if (file == NULL) break;
+
+        archive->parseFile(file, &archive->m_files[0]);
+
+        MutexLock(&archive->m_lock);
+        file->isFinished = true;
+        archive->m_parsedFiles++;
+        if (archive->m_state->isLoading())
+        {
+            archive->m_state->setLoadProgress(archive->m_parsedFiles / (double)archive->m_files.size());
+        }
+        MutexUnlock(&archive->m_lock);
+        EventSignal(&archive->m_parsedEvent);
+    }
+
+    MutexLock(&archive->m_lock);
+    archive->m_runningWorkers--;
+    MutexUnlock(&archive->m_lock);
+    EventSignal(&archive->m_parsedEvent);
+}
+
+void RtlUvdArchive::parseFile(ArchiveFile *file, ArchiveFile *firstFile)
+{
+    // parts share the archive's clock: midnight of the first day is 0
+    file->part = new UvdState();
+    file->part->setHidesTailNumbers(false);
+    file->part->setStartDate(firstFile->yyyy, firstFile->mm, firstFile->dd);
+
+    RtlUvdParser *parser = new RtlUvdParser(file->part);
+    parser->setBaseTime((file->day - firstFile->day) * UVD_DAY);
+    file->isParsed = parser->parseLogFile(file->path);
+    delete parser;
+
+    if (!file->isParsed) UvdLog("can't open %s.\n", file->path);
+}
+
+void RtlUvdArchive::sortFiles()
+{
+    std::sort(m_files.begin(), m_files.end(), compareFiles);
+}
+
+bool RtlUvdArchive::load(int jobs)
+{
+    TRACE_SPAN("archive load");
+
+    if (m_files.size() == 0) return false;
+
+    sortFiles();
+
+    ArchiveFile *firstFile = &m_files[0];
+    m_state->setStartDate(firstFile->yyyy, firstFile->mm, firstFile->dd);
+
+    if (jobs < 1) jobs = 1;
+    if (jobs > MAX_ARCHIVE_JOBS) jobs = MAX_ARCHIVE_JOBS;
+    if ((size_t)jobs > m_files.size()) jobs = (int)m_files.size();
+
+    // a day is parsed by one worker, so the load takes about as long as
+    // the largest day plus the merge
+    m_nextFile = 0;
+    m_parsedFiles = 0;
+    m_runningWorkers = jobs;
+    Thread threads[MAX_ARCHIVE_JOBS];
+    for (int i = 0; i < jobs; i++)
+    {
+        ThreadCreate(&threads[i], workerThread, this);
+    }
+
+    // the files of a day may interleave and go in together; the merge of
+    // a day overlapping the one before takes the overlap out again
+    size_t mergedFiles = 0;
+    size_t partCount = 0;
+    while (mergedFiles < m_files.size())
+    {
+        MutexLock(&m_lock);
+        size_t readyFiles = mergedFiles;
+        while (readyFiles < m_files.size() && m_files[readyFiles].isFinished) readyFiles++;
+        bool isStopped = m_runningWorkers == 0;
+        MutexUnlock(&m_lock);
+
+        if (readyFiles < m_files.size())
+        {
+            while (readyFiles > mergedFiles && m_files[readyFiles - 1].day == m_files[readyFiles].day) readyFiles--;
+        }
+
+        if (readyFiles > mergedFiles)
+        {
+            partCount += mergeFiles(mergedFiles, readyFiles);
+            mergedFiles = readyFiles;
+            continue;
+        }
+
+        // cancelled, whatever is merged stays
+        if (isStopped) break;
+        EventWait(&m_parsedEvent, ARCHIVE_MERGE_WAIT_MS);
+    }
+
+    for (int i = 0; i < jobs; i++)
+    {
+        ThreadJoin(&threads[i]);
+    }
+
+    std::vector<ArchiveFile>::iterator iter;
+    for (iter = m_files.begin(); iter != m_files.end(); ++iter)
+    {
+        delete (*iter).part;
+        (*iter).part = NULL;
+    }
+
+    return partCount > 0;
+}
+
+size_t RtlUvdArchive::mergeFiles(size_t firstFile, size_t endFile)
+{
+    std::vector<UvdState *> parts;
+    for (size_t i = firstFile; i < endFile; i++)
+    {
+        if (m_files[i].isParsed) parts.push_back(m_files[i].part);
+    }
+
+    if (parts.size() > 0) m_state->mergeStates(&parts, true);
+
+    for (size_t i = firstFile; i < endFile; i++)
+    {
+        delete m_files[i].part;
+        m_files[i].part = NULL;
+    }
+
+    return parts.size();
+}
@@ -0,0 +1,56 @@
+#ifndef __RTLUVDARCHIVE_H__
+#define __RTLUVDARCHIVE_H__
+
+#include <vector>
+#include "Mutex.h"
+#include "Thread.h"
+#include "UvdState.h"
+
+#define ARCHIVE_DAY_ANY -1
+#define ARCHIVE_MERGE_WAIT_MS 100
+
+typedef struct {
+    char path[1024];
+    int yyyy, mm, dd;
+    int day;                // UvdState::dayNumber of the file name date
+    UvdState *part;
+    bool isParsed;
+    bool isFinished;        // parsed or failed, by a worker
+} ArchiveFile;
+
+// Loads a set of daily rtl-uvd-log-YYYY-MM-DD files into one UvdState.
+// Every file is parsed by a worker into its own state, with the day offset
+// taken from the file name, then the parts are merged by UvdState::mergeStates.
+// Days are merged as soon as they and every day before them are parsed, so
+// a view of the state opens on the first days while later ones still load.
+class RtlUvdArchive
+{
+    UvdState *m_state;
+    std::vector<ArchiveFile> m_files;
+
+    size_t m_nextFile;
+    size_t m_parsedFiles;
+    int m_runningWorkers;
+    Mutex m_lock;
+    Event m_parsedEvent;
+
+    static void workerThread(void *context);
+    void parseFile(ArchiveFile *file, ArchiveFile *firstFile);
+    size_t mergeFiles(size_t firstFile, size_t endFile);
+
+public:
+    RtlUvdArchive(UvdState *state);
+    ~RtlUvdArchive();
+
+    bool addFile(const char *path);
+    int addDirectory(const char *path, int fromDay, int toDay);
+
+    void sortFiles();
+
+    size_t fileCount() { return m_files.size(); }
+    ArchiveFile *file(size_t index) { return &m_files[index]; }
+
+    bool load(int jobs);
+};
+
+#endif
@@ -0,0 +1,86 @@
+#include "RtlUvdFeedReader.h"
+#include <stdlib.h>
+#include <string.h>
+
+RtlUvdFeedReader::RtlUvdFeedReader()
+{
+    m_buffer = (char *)malloc(FEED_READER_BUFFER_SIZE);
+    reset();
+}
+
+RtlUvdFeedReader::~RtlUvdFeedReader()
+{
+    free(m_buffer);
+}
+
+void RtlUvdFeedReader::reset()
+{
+    m_used = 0;
+    m_position = 0;
+    m_isBinary = false;
+    m_wire.reset();
+    m_byteCount = 0;
+}
+
+char *RtlUvdFeedReader::space(int *length)
+{
+    memmove(m_buffer, m_buffer + m_position, m_used - m_position);
+    m_used -= m_position;
+    m_position = 0;
+
+    // a line longer than the buffer is dropped
+    if (m_used == FEED_READER_BUFFER_SIZE) m_used = 0;
+
+    *length = FEED_READER_BUFFER_SIZE - m_used;
+    return m_buffer + m_used;
+}
+
+void RtlUvdFeedReader::append(int length)
+{
+    m_used += length;
+    m_byteCount += length;
+}
+
+FeedItem RtlUvdFeedReader::next(char **line, const RingRecord **record)
+{
+    while (m_position < m_used)
+    {
+        if (!m_isBinary)
+        {
+            char *start = m_buffer + m_position;
+            char *end = (char *)memchr(start, '\n', m_used - m_position);
+            if (end == NULL) return FeedItemNone;
+
+            *end = '\x00';
+            m_position = (int)(end - m_buffer) + 1;
+
+            if (RtlUvdWire::isHello(start))
+            {
+                // the feed's answer, frames from the next byte on
+                m_isBinary = true;
+                m_wire.reset();
+                continue;
+            }
+
+            *line = start;
+            return FeedItemLine;
+        }
+
+        int length = m_wire.decode((const unsigned char *)m_buffer + m_position, m_used - m_position, &m_frame);
+        if (length == 0) return FeedItemNone;
+        m_position += length;
+
+        if (m_frame.kind == WIRE_FRAME_K1 || m_frame.kind == WIRE_FRAME_K2)
+        {
+            *record = &m_frame.record;
+            return FeedItemRecord;
+        }
+        if (m_frame.kind == WIRE_FRAME_COMMENT)
+        {
+            *line = m_frame.text;
+            return FeedItemLine;
+        }
+    }
+
+    return FeedItemNone;
+}
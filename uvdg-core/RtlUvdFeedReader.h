@@ -0,0 +1,46 @@
+#ifndef __RTLUVDFEEDREADER_H__
+#define __RTLUVDFEEDREADER_H__
+
+#include "RtlUvdWire.h"
+
+#define FEED_READER_BUFFER_SIZE (256 * 1024)
+
+typedef enum {
+    FeedItemNone,       // more bytes are needed
+    FeedItemLine,       // a text line, or the text of a comment frame
+    FeedItemRecord      // a K1/K2 frame
+} FeedItem;
+
+// Splits what a feed connection received into lines, or into wire frames
+// once the feed has answered the hello, for the clients of a feed. A line
+// or record stays valid until the next space().
+class RtlUvdFeedReader
+{
+    char *m_buffer;
+    int m_used;
+    int m_position;
+
+    bool m_isBinary;
+    RtlUvdWire m_wire;
+    WireFrame m_frame;
+
+    unsigned long long m_byteCount;
+
+public:
+    RtlUvdFeedReader();
+    ~RtlUvdFeedReader();
+
+    // for a new connection, text until the hello comes back
+    void reset();
+
+    // where to receive into, and how much fits
+    char *space(int *length);
+    void append(int length);
+
+    FeedItem next(char **line, const RingRecord **record);
+
+    bool isBinary() { return m_isBinary; }
+    unsigned long long byteCount() { return m_byteCount; }
+};
+
+#endif
@@ -0,0 +1,190 @@
+#include "RtlUvdIndex.h"
+#include "RtlUvdParser.h"
+#include "SpanRecorder.h"
+#include "Log.h"
+#include <string.h>
+
+#define INDEX_MAGIC "UVDGIDX2"
+
+typedef struct {
+    char magic[8];
+    long long logSize;
+    UvdTime lastTime;
+    UvdTime lastLineTime;
+    int day;
+    int entryCount;
+} IndexHeader;
+
+RtlUvdIndex::RtlUvdIndex()
+{
+    m_logSize = 0;
+    m_lastTime = -1;
+    m_lastLineTime = 0;
+    m_day = 0;
+}
+
+bool RtlUvdIndex::open(const char *logPath)
+{
+    TRACE_SPAN("RtlUvdIndex::open");
+
+    char indexPath[1024];
+    if (strlen(logPath) + strlen(INDEX_FILE_SUFFIX) >= sizeof(indexPath)) return false;
+    sprintf(indexPath, "%s" INDEX_FILE_SUFFIX, logPath);
+
+    bool isRead = read(indexPath);
+    long long indexedSize = m_logSize;
+
+    if (!scan(logPath)) return false;
+
+    // a read-only archive still works, the index is just rebuilt next time
+    if (!isRead || m_logSize != indexedSize)
+    {
+        if (!write(indexPath)) UvdLog("can't write %s.\n", indexPath);
+    }
+
+    return true;
+}
+
+bool RtlUvdIndex::read(const char *indexPath)
+{
+    FILE *file = fopen(indexPath, "rb");
+    if (file == NULL) return false;
+
+    IndexHeader header;
+    bool isValid = fread(&header, sizeof(IndexHeader), 1, file) == 1
+        && memcmp(header.magic, INDEX_MAGIC, 8) == 0
+        && header.entryCount >= 0;
+
+    if (isValid)
+    {
+        m_entries.resize(header.entryCount);
+        if (header.entryCount > 0)
+        {
+            isValid = fread(&m_entries[0], sizeof(IndexEntry), header.entryCount, file) == (size_t)header.entryCount;
+        }
+    }
+
+    fclose(file);
+
+    if (!isValid)
+    {
+        m_entries.clear();
+        return false;
+    }
+
+    m_logSize = header.logSize;
+    m_lastTime = header.lastTime;
+    m_lastLineTime = header.lastLineTime;
+    m_day = header.day;
+
+    return true;
+}
+
+bool RtlUvdIndex::write(const char *indexPath)
+{
+    FILE *file = fopen(indexPath, "wb");
+    if (file == NULL) return false;
+
+    IndexHeader header;
+    memset(&header, 0, sizeof(IndexHeader));
+    memcpy(header.magic, INDEX_MAGIC, 8);
+    header.logSize = m_logSize;
+    header.lastTime = m_lastTime;
+    header.lastLineTime = m_lastLineTime;
+    header.day = m_day;
+    header.entryCount = (int)m_entries.size();
+
+    bool isWritten = fwrite(&header, sizeof(IndexHeader), 1, file) == 1;
+    if (isWritten && m_entries.size() > 0)
+    {
+        isWritten = fwrite(&m_entries[0], sizeof(IndexEntry), m_entries.size(), file) == m_entries.size();
+    }
+
+    if (fclose(file) != 0) isWritten = false;
+    if (!isWritten) remove(indexPath);
+
+    return isWritten;
+}
+
+bool RtlUvdIndex::scan(const char *logPath)
+{
+    FILE *file = fopen(logPath, "rb");
+    if (file == NULL) return false;
+    setvbuf(file, NULL, _IOFBF, 256 * 1024);
+
+    // a shrunk log was replaced, index it from scratch
+    fseek(file, 0, SEEK_END);
+    if (FileTell(file) < m_logSize)
+    {
+        m_entries.clear();
+        m_logSize = 0;
+        m_lastTime = -1;
+        m_lastLineTime = 0;
+        m_day = 0;
+    }
+    FileSeek(file, m_logSize);
+
+    long long offset = m_logSize;
+    long long lastBucket = m_entries.size() > 0 ? m_entries.back().time / INDEX_BUCKET : -1;
+
+    char line[256];
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        size_t length = strlen(line);
+
+        // the recorder may be in the middle of a line
+        if (line[length - 1] != '\n' && feof(file)) break;
+
+        UvdTime time = RtlUvdParser::lineTime(line);
+        if (time >= 0)
+        {
+            // same day crossing rule as RtlUvdParser::processLine
+            if (time < m_lastLineTime) m_day++;
+            m_lastLineTime = time;
+
+            UvdTime fixedTime = time + m_day * UVD_DAY;
+            long long bucket = fixedTime / INDEX_BUCKET;
+            if (bucket != lastBucket)
+            {
+                IndexEntry entry;
+                entry.time = fixedTime;
+                entry.offset = offset;
+                m_entries.push_back(entry);
+                lastBucket = bucket;
+            }
+
+            m_lastTime = fixedTime;
+        }
+
+        offset += length;
+        m_logSize = offset;
+    }
+
+    fclose(file);
+
+    return true;
+}
+
+void RtlUvdIndex::rangeForTimes(UvdTime startTime, UvdTime endTime, long long *startOffset, long long *endOffset)
+{
+    UvdTime startBucketTime = (startTime / INDEX_BUCKET) * INDEX_BUCKET;
+    UvdTime endBucketTime = (endTime / INDEX_BUCKET) * INDEX_BUCKET;
+
+    size_t low = 0, high = m_entries.size();
+    while (low < high)
+    {
+        size_t middle = (low + high) / 2;
+        if (m_entries[middle].time < startBucketTime) low = middle + 1;
+        else high = middle;
+    }
+    *startOffset = low < m_entries.size() ? m_entries[low].offset : m_logSize;
+
+    high = m_entries.size();
+    while (low < high)
+    {
+        size_t middle = (low + high) / 2;
+        if (m_entries[middle].time < endBucketTime) low = middle + 1;
+        else high = middle;
+    }
+    *endOffset = low < m_entries.size() ? m_entries[low].offset : m_logSize;
+}
@@ -0,0 +1,55 @@
+#ifndef __RTLUVDINDEX_H__
+#define __RTLUVDINDEX_H__
+
+#include <stdio.h>
+#include <vector>
+#include "UvdTime.h"
+
+#ifdef _MSC_VER
+#define FileSeek(file, offset) _fseeki64(file, offset, SEEK_SET)
+#define FileTell(file) _ftelli64(file)
+#else
+#define FileSeek(file, offset) fseeko(file, offset, SEEK_SET)
+#define FileTell(file) ftello(file)
+#endif
+
+#define INDEX_BUCKET (60 * UVD_SECOND)
+#define INDEX_FILE_SUFFIX ".idx"
+
+typedef struct {
+    UvdTime time;           // first line of the bucket, on the log's clock
+    long long offset;       // byte offset of that line
+} IndexEntry;
+
+// Sparse seek index of a raw log: one entry per minute that has lines.
+// Kept next to the log as <log>.idx and extended when the log has grown,
+// so a recording can be indexed while it is written.
+class RtlUvdIndex
+{
+    std::vector<IndexEntry> m_entries;
+    long long m_logSize;    // indexed bytes, up to the last complete line
+    UvdTime m_lastTime;
+    UvdTime m_lastLineTime;  // time of day of the last line, for day crossings
+    int m_day;
+
+    bool read(const char *indexPath);
+    bool write(const char *indexPath);
+    bool scan(const char *logPath);
+
+public:
+    RtlUvdIndex();
+
+    bool open(const char *logPath);
+
+    size_t entryCount() { return m_entries.size(); }
+    const IndexEntry *entry(size_t i) { return &m_entries[i]; }
+    UvdTime firstTime() { return m_entries.size() > 0 ? m_entries[0].time : -1; }
+    UvdTime lastTime() { return m_lastTime; }
+    long long logSize() { return m_logSize; }
+
+    // byte range of the lines with startTime <= time < endTime; exact for
+    // bucket aligned times, otherwise widened to whole buckets
+    void rangeForTimes(UvdTime startTime, UvdTime endTime, long long *startOffset, long long *endOffset);
+};
+
+#endif
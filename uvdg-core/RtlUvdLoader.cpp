@@ -0,0 +1,94 @@
+#include "RtlUvdLoader.h"
+#include "LogDecompressor.h"
+#include "RtlUvdIndex.h"
+#include "SpanRecorder.h"
+#include <stdio.h>
+#include <string.h>
+
+RtlUvdLoader::RtlUvdLoader(UvdState *state, RtlUvdParser *parser, const char *path)
+{
+    m_state = state;
+    m_parser = parser;
+    m_archive = NULL;
+    strncpy(m_path, path, sizeof(m_path) - 1);
+    m_path[sizeof(m_path) - 1] = '\x00';
+    m_jobs = 1;
+
+    m_isStarted = false;
+    m_isFinished = false;
+    m_isLoaded = false;
+}
+
+RtlUvdLoader::RtlUvdLoader(UvdState *state, RtlUvdArchive *archive, int jobs)
+{
+    m_state = state;
+    m_parser = NULL;
+    m_archive = archive;
+    m_path[0] = '\x00';
+    m_jobs = jobs;
+
+    m_isStarted = false;
+    m_isFinished = false;
+    m_isLoaded = false;
+}
+
+RtlUvdLoader::~RtlUvdLoader()
+{
+    if (m_isStarted)
+    {
+        cancel();
+        ThreadJoin(&m_thread);
+    }
+
+    if (m_archive != NULL) delete m_archive;
+}
+
+void RtlUvdLoader::start()
+{
+    m_state->startLoading();
+
+    m_isStarted = true;
+    ThreadCreate(&m_thread, loaderThread, this);
+}
+
+void RtlUvdLoader::cancel()
+{
+    if (!m_isFinished) m_state->cancelLoading();
+}
+
+void RtlUvdLoader::loaderThread(void *context)
+{
+    RtlUvdLoader *loader = (RtlUvdLoader *)context;
+    loader->load();
+}
+
+void RtlUvdLoader::load()
+{
+    TRACE_SPAN("RtlUvdLoader::load");
+
+    if (m_archive != NULL)
+    {
+        m_isLoaded = m_archive->load(m_jobs);
+    }
+    else
+    {
+        long long size = -1;
+        FILE *file = fopen(m_path, "rb");
+        if (file != NULL)
+        {
+            fseek(file, 0, SEEK_END);
+            size = FileTell(file);
+            fclose(file);
+        }
+
+        if (size >= 0)
+        {
+            // a compressed log streams through parseLogFile, its progress in compressed bytes
+            if (LogDecompressor::detect(m_path) != LogCompressionNone) m_isLoaded = m_parser->parseLogFile(m_path);
+            else m_isLoaded = m_parser->parseLogRange(m_path, 0, size);
+        }
+    }
+
+    m_state->finishLoading();
+    m_isFinished = true;
+}
@@ -0,0 +1,43 @@
+#ifndef __RTLUVDLOADER_H__
+#define __RTLUVDLOADER_H__
+
+#include "RtlUvdArchive.h"
+#include "Thread.h"
+#include "RtlUvdParser.h"
+#include "UvdState.h"
+
+// Loads a log file or an archive on a worker thread. Points are published
+// into the state as they are parsed (archives once merged), so the view can
+// open at once and follow UvdState::loadProgress.
+//
+// A single log is parsed by the caller's parser, so a feed it then goes on
+// with continues the log's day count and duplicate detection.
+class RtlUvdLoader
+{
+    UvdState *m_state;
+    RtlUvdParser *m_parser;
+    RtlUvdArchive *m_archive;
+    char m_path[1024];
+    int m_jobs;
+
+    Thread m_thread;
+    bool m_isStarted;
+    volatile bool m_isFinished;
+    bool m_isLoaded;
+
+    static void loaderThread(void *context);
+    void load();
+
+public:
+    RtlUvdLoader(UvdState *state, RtlUvdParser *parser, const char *path);
+    RtlUvdLoader(UvdState *state, RtlUvdArchive *archive, int jobs);
+    ~RtlUvdLoader();
+
+    void start();
+    void cancel();
+
+    bool isFinished() { return m_isFinished; }
+    bool isLoaded() { return m_isLoaded; }
+};
+
+#endif
@@ -0,0 +1,332 @@
+
+#include "RtlUvdParser.h"
+#include "RtlUvdIndex.h"
+#include "LogDecompressor.h"
+#include "SpanRecorder.h"
+#include "Log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <iostream>
+#include <fstream>
+
+#define PROGRESS_LINES 16384
+
+
+RtlUvdParser::RtlUvdParser(UvdState *state)
+{
+    m_state = state;
+    
+    m_lastTime = 0;
+    m_day = 0;
+    m_baseTime = 0;
+
+    m_tracer = NULL;
+
+    m_duplicateDetectorBuffer = (UvdTime *)calloc(1, DUPLICATE_DETECTOR_BUFFER_SIZE * sizeof(UvdTime));
+    m_duplicateDetectorBufferIndex = 0;
+}
+
+RtlUvdParser::~RtlUvdParser()
+{
+    free(m_duplicateDetectorBuffer);
+}
+
+UvdTime RtlUvdParser::processLine(char *line)
+{
+    // K1 14:57:41.207.405 [ 1776] {087} **** :01234
+    // K2 14:57:41.212.757 [ 5352] {088} **** FL  770m [F025]+  F:40%
+    
+    if (line[0] != 'K') return -1;
+    if (line[1] < '1' && line[1] > '4') return -1;
+
+    if (m_tracer != NULL) m_tracer->lineStarted();
+    
+    RingRecord record;
+    record.type = line[1] - '0';
+
+    int seconds = atoi(line + 3) * 3600 + atoi(line + 6) * 60 + atoi(line + 9);
+    int msec = atoi(line + 12);
+    int usec = atoi(line + 16);
+    record.timeOfDay = seconds * UVD_SECOND + msec * 1000 + usec;
+
+    record.amplitude = 0;
+    sscanf(line + 30, "%02X", &record.amplitude);
+    
+    record.confidence = (line[34] == '*') + (line[35] == '*') + (line[36] == '*') + (line[37] == '*');
+    
+    record.value = 0;
+    record.fuel = 0;
+    if (record.type == RING_RECORD_K1)
+    {
+        record.value = atoi(line + 40);
+    }
+    else if (record.type == RING_RECORD_K2)
+    {
+        record.value = atoi(line + 42);
+        record.fuel = atoi(line + 59);
+    }
+
+    return dispatchRecord(&record);
+}
+
+UvdTime RtlUvdParser::processRecord(const RingRecord *record)
+{
+    if (m_tracer != NULL) m_tracer->lineStarted();
+
+    return dispatchRecord(record);
+}
+
+UvdTime RtlUvdParser::dispatchRecord(const RingRecord *record)
+{
+    UvdTime time = record->timeOfDay;
+    
+    for (int i = 0; i < DUPLICATE_DETECTOR_BUFFER_SIZE; i++)
+    {
+        if (time == m_duplicateDetectorBuffer[i])
+        {
+//            printf("duplicated line, ignoring: %s\n", line);
+            return -1;
+        }
+    }
+    
+    m_duplicateDetectorBuffer[m_duplicateDetectorBufferIndex] = time;
+    m_duplicateDetectorBufferIndex++;
+    if (m_duplicateDetectorBufferIndex == DUPLICATE_DETECTOR_BUFFER_SIZE) m_duplicateDetectorBufferIndex = 0;
+    
+    RecvInfo ri;
+    int seconds = (int)(time / UVD_SECOND);
+    ri.hh = seconds / 3600;
+    ri.mm = (seconds / 60) % 60;
+    ri.ss = seconds % 60;
+    ri.usec = (int)(time % UVD_SECOND);
+
+    if (time < m_lastTime)
+    {
+        // crossed 00:00:00
+        m_day++;
+        UvdLog("day cross %d (%02d:%02d:%02d (%lld) < %lld).\n", m_day, ri.hh, ri.mm, ri.ss, time, m_lastTime);
+    }
+    UvdTime fixedTime = m_baseTime + time + m_day * UVD_DAY;
+    ri.time = fixedTime;
+    
+    m_lastTime = time;
+    
+    ri.amplitude = record->amplitude;
+    ri.confidence = record->confidence;
+    
+    if (record->type == RING_RECORD_K1)
+    {
+        K1 k1;
+        k1.ri = ri;
+        k1.tailNumber = record->value;
+        
+        if (k1.tailNumber == 0)
+        {
+//            printf("bad tail number: %s.\n", line + 40);
+        }
+        else
+        {
+            if (m_tracer != NULL) m_tracer->lineReached(TraceStageParse);
+            m_state->processK1(k1);
+            if (m_tracer != NULL) m_tracer->lineReached(TraceStageInsert);
+        }
+    }
+    else if (record->type == RING_RECORD_K2)
+    {
+        K2 k2;
+        k2.ri = ri;
+        k2.alt = record->value;
+        k2.fuel = record->fuel;
+        k2.tailNumber = 0;
+
+        if (m_tracer != NULL) m_tracer->lineReached(TraceStageParse);
+        m_state->processK2(k2);
+        if (m_tracer != NULL) m_tracer->lineReached(TraceStageInsert);
+    }
+    else
+    {
+        return -1;
+    }
+    
+    return fixedTime;
+}
+
+bool RtlUvdParser::parseLogFile(const char *path)
+{
+    TRACE_SPAN("parseLogFile");
+
+    if (LogDecompressor::detect(path) != LogCompressionNone) return parseCompressedLog(path);
+
+    std::ifstream istream;
+    istream.open(path);
+    if (!istream.is_open()) return false;
+
+    char line[256];
+    while (istream.getline(line, 256))
+    {
+        processLine(line);
+    }
+
+    istream.close();
+    
+    // finalize
+    
+    m_state->finalizeLogFile();
+    
+//    printf("Confidence 3: K1 lines: %lu, K2 lines: %lu.\n", m_recvStats.k1Conf3Lines, m_recvStats.k2Conf3Lines);
+//    printf("Confidence 4: K1 lines: %lu, K2 lines: %lu.\n", m_recvStats.k1Conf4Lines, m_recvStats.k2Conf4Lines);
+//    printf("Days: %d.\n", m_day + 1);
+
+    return true;
+}
+
+bool RtlUvdParser::parseCompressedLog(const char *path)
+{
+    LogDecompressor decompressor;
+    if (!decompressor.open(path)) return false;
+
+    // lines are parsed in place in the blocks, a line split between two
+    // blocks is put together in this one
+    char line[256];
+    size_t lineLength = 0;
+    unsigned long lineCount = 0;
+
+    char *block;
+    size_t size;
+    while ((block = decompressor.nextBlock(&size)) != NULL)
+    {
+        char *start = block;
+        char *end = block + size;
+        while (start < end)
+        {
+            char *lineEnd = (char *)memchr(start, '\n', end - start);
+            size_t length = (lineEnd != NULL ? lineEnd : end) - start;
+
+            char *text = start;
+            if (lineLength > 0 || lineEnd == NULL)
+            {
+                if (lineLength + length >= sizeof(line)) length = sizeof(line) - 1 - lineLength;
+                memcpy(line + lineLength, start, length);
+                lineLength += length;
+                line[lineLength] = '\x00';
+                text = line;
+                length = lineLength;
+            }
+            if (lineEnd == NULL) break;
+
+            text[length] = '\x00';
+            if (length > 0 && text[length - 1] == '\r') text[length - 1] = '\x00';
+            processLine(text);
+
+            lineLength = 0;
+            start = lineEnd + 1;
+
+            // of the compressed bytes, the decompressed size isn't known
+            if (++lineCount % PROGRESS_LINES == 0 && m_state->isLoading())
+            {
+                if (m_state->isLoadCancelled()) break;
+                m_state->setLoadProgress(decompressor.progress());
+            }
+        }
+
+        if (m_state->isLoadCancelled()) break;
+    }
+
+    if (lineLength > 0) processLine(line);
+
+    bool isValid = decompressor.isValid();
+    if (!isValid) UvdLog("%s is truncated or corrupt, parsed up to there.\n", path);
+
+    decompressor.close();
+
+    m_state->finalizeLogFile();
+
+    return true;
+}
+
+bool RtlUvdParser::parseLogRange(const char *path, long long startOffset, long long endOffset)
+{
+    TRACE_SPAN("parseLogRange");
+
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) return false;
+
+    if (FileSeek(file, startOffset) != 0)
+    {
+        fclose(file);
+        return false;
+    }
+
+    long long offset = startOffset;
+    unsigned long lineCount = 0;
+    char line[256];
+    while (offset < endOffset && fgets(line, sizeof(line), file) != NULL)
+    {
+        size_t length = strlen(line);
+        offset += length;
+
+        while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r')) line[--length] = '\x00';
+        processLine(line);
+
+        if (++lineCount % PROGRESS_LINES == 0 && m_state->isLoading())
+        {
+            if (m_state->isLoadCancelled()) break;
+            m_state->setLoadProgress((offset - startOffset) / (double)(endOffset - startOffset));
+        }
+    }
+
+    fclose(file);
+
+    m_state->finalizeLogFile();
+
+    return true;
+}
+
+bool RtlUvdParser::dateFromLogFileName(const char *path, int *yyyy, int *mm, int *dd)
+{
+    const char *fileName = strrchr(path, '/');
+    const char *backslash = strrchr(path, '\\');
+    if (backslash != NULL && (fileName == NULL || backslash > fileName)) fileName = backslash;
+    fileName = (fileName != NULL) ? fileName + 1 : path;
+
+    return sscanf(fileName, "rtl-uvd-log-%04d-%02d-%02d", yyyy, mm, dd) == 3;
+}
+
+UvdTime RtlUvdParser::lineTime(const char *line)
+{
+    // time of day of a K line as processLine reads it, -1 for other lines
+    if (line[0] != 'K') return -1;
+
+    int seconds = atoi(line + 3) * 3600 + atoi(line + 6) * 60 + atoi(line + 9);
+    int usec = atoi(line + 12) * 1000 + atoi(line + 16);
+    return seconds * UVD_SECOND + usec;
+}
+
+int RtlUvdParser::formatRecord(const RingRecord *record, char *line)
+{
+    // K1 14:57:41.207.405 [    0] {087} **** :01234
+    // K2 14:57:41.212.757 [    0] {088} **** FL  770m [F000]+  F:40%
+
+    int seconds = (int)(record->timeOfDay / UVD_SECOND);
+    int usec = (int)(record->timeOfDay % UVD_SECOND);
+
+    char confidence[5];
+    for (int i = 0; i < 4; i++) confidence[i] = i < record->confidence ? '*' : '.';
+    confidence[4] = '\x00';
+
+    int length = sprintf(line, "K%u %02d:%02d:%02d.%03d.%03d [    0] {%03X} %s ", record->type,
+                         seconds / 3600, (seconds / 60) % 60, seconds % 60, usec / 1000, usec % 1000,
+                         record->amplitude & 0xfff, confidence);
+
+    if (record->type == RING_RECORD_K1)
+    {
+        length += sprintf(line + length, ":%05d", record->value);
+    }
+    else
+    {
+        length += sprintf(line + length, "FL %4dm [F000]+  F:%d%%", record->value, record->fuel);
+    }
+
+    return length;
+}
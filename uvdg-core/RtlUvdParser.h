@@ -0,0 +1,50 @@
+
+#ifndef __RTLUVDPARSER_H__
+#define __RTLUVDPARSER_H__
+
+#include "UvdState.h"
+#include "LatencyTracer.h"
+#include "RecordRing.h"
+
+#define DUPLICATE_DETECTOR_BUFFER_SIZE 1000
+
+class RtlUvdParser
+{
+    friend class UvdSnapshot;
+
+    UvdState *m_state;
+    
+    UvdTime *m_duplicateDetectorBuffer;
+    int m_duplicateDetectorBufferIndex;
+    
+    UvdTime m_lastTime;
+    int m_day;
+    UvdTime m_baseTime;
+
+    LatencyTracer *m_tracer;
+
+    UvdTime dispatchRecord(const RingRecord *record);
+    bool parseCompressedLog(const char *path);
+    
+public:
+    RtlUvdParser(UvdState *state);
+    ~RtlUvdParser();
+    
+    UvdTime processLine(char *line);
+    // a line a decoder parsed already, as from a RecordRing
+    UvdTime processRecord(const RingRecord *record);
+    // plain, or gzip/zstd compressed as LogDecompressor reads them
+    bool parseLogFile(const char *path);
+    bool parseLogRange(const char *path, long long startOffset, long long endOffset);
+
+    void setLatencyTracer(LatencyTracer *tracer) { m_tracer = tracer; }
+    // offset of this log's midnight on the state clock, for archives of daily logs
+    void setBaseTime(UvdTime time) { m_baseTime = time; }
+
+    static bool dateFromLogFileName(const char *path, int *yyyy, int *mm, int *dd);
+    static UvdTime lineTime(const char *line);
+    // the line processLine reads as record, for keeping records in daily logs
+    static int formatRecord(const RingRecord *record, char *line);
+};
+
+#endif
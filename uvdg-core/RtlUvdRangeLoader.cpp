@@ -0,0 +1,231 @@
+#include "RtlUvdRangeLoader.h"
+#include "LogDecompressor.h"
+#include "RtlUvdParser.h"
+#include "SpanRecorder.h"
+#include "Log.h"
+#include <string.h>
+
+RtlUvdRangeLoader::RtlUvdRangeLoader(UvdState *state, RtlUvdArchive *archive)
+{
+    m_state = state;
+    m_firstTime = -1;
+    m_lastTime = -1;
+
+    archive->sortFiles();
+    if (archive->fileCount() == 0) return;
+
+    ArchiveFile *firstFile = archive->file(0);
+    m_state->setStartDate(firstFile->yyyy, firstFile->mm, firstFile->dd);
+
+    for (size_t i = 0; i < archive->fileCount(); i++)
+    {
+        ArchiveFile *file = archive->file(i);
+
+        RangeLogFile logFile;
+        strcpy(logFile.path, file->path);
+        logFile.baseTime = (file->day - firstFile->day) * UVD_DAY;
+        logFile.index = NULL;
+        m_files.push_back(logFile);
+    }
+}
+
+RtlUvdRangeLoader::~RtlUvdRangeLoader()
+{
+    m_state->setRangeFunction(NULL, NULL);
+
+    std::map<int, std::vector<UvdState *> >::iterator iter;
+    for (iter = m_chunks.begin(); iter != m_chunks.end(); ++iter)
+    {
+        releaseChunk(&iter->second);
+    }
+
+    std::vector<RangeLogFile>::iterator fileIter;
+    for (fileIter = m_files.begin(); fileIter != m_files.end(); ++fileIter)
+    {
+        delete (*fileIter).index;
+    }
+}
+
+bool RtlUvdRangeLoader::open()
+{
+    std::vector<RangeLogFile>::iterator iter;
+    for (iter = m_files.begin(); iter != m_files.end(); ++iter)
+    {
+        RangeLogFile *file = &(*iter);
+        file->index = new RtlUvdIndex();
+        if (LogDecompressor::detect(file->path) != LogCompressionNone)
+        {
+            // offsets into it can't be seeked to
+            UvdLog("%s is compressed, it can't be loaded by range.\n", file->path);
+            continue;
+        }
+        if (!file->index->open(file->path) || file->index->entryCount() == 0)
+        {
+            UvdLog("can't index %s.\n", file->path);
+            continue;
+        }
+
+        UvdTime firstTime = file->baseTime + file->index->firstTime();
+        UvdTime lastTime = file->baseTime + file->index->lastTime();
+        if (m_firstTime < 0 || firstTime < m_firstTime) m_firstTime = firstTime;
+        if (lastTime > m_lastTime) m_lastTime = lastTime;
+    }
+
+    if (m_lastTime < 0) return false;
+
+    // the scroller spans the whole archive, not just the loaded chunks
+    m_state->setTimeBounds(m_firstTime, m_lastTime);
+    m_state->setRangeFunction(rangeFunction, this);
+    fillOverview();
+
+    return true;
+}
+
+// the minimap shows the whole archive, not the chunks loaded: lines per
+// index entry, estimated from its bytes, without altitudes
+void RtlUvdRangeLoader::fillOverview()
+{
+    m_state->lock();
+    m_state->setOverviewFixed(true);
+
+    UvdOverview *overview = m_state->overview();
+    overview->clear();
+
+    std::vector<RangeLogFile>::iterator iter;
+    for (iter = m_files.begin(); iter != m_files.end(); ++iter)
+    {
+        RtlUvdIndex *index = (*iter).index;
+        if (index == NULL) continue;
+
+        for (size_t i = 0; i < index->entryCount(); i++)
+        {
+            const IndexEntry *entry = index->entry(i);
+            long long endOffset = i + 1 < index->entryCount() ? index->entry(i + 1)->offset : index->logSize();
+            long long lineCount = (endOffset - entry->offset) / RANGE_LINE_BYTES;
+            if (lineCount < 1) lineCount = 1;
+
+            overview->addCount((*iter).baseTime + entry->time, OVERVIEW_BAND_UNKNOWN, (unsigned int)lineCount);
+        }
+    }
+
+    m_state->unlock();
+}
+
+void RtlUvdRangeLoader::rangeFunction(void *context, UvdTime leftTime, UvdTime rightTime)
+{
+    ((RtlUvdRangeLoader *)context)->ensureRange(leftTime, rightTime);
+}
+
+void RtlUvdRangeLoader::ensureRange(UvdTime leftTime, UvdTime rightTime)
+{
+    if (m_lastTime < 0) return;
+
+    // a view width of prefetch on each side
+    UvdTime margin = rightTime - leftTime;
+
+    int firstChunk = (int)((leftTime - margin) / RANGE_CHUNK);
+    int lastChunk = (int)((rightTime + margin) / RANGE_CHUNK);
+    int minChunk = (int)(m_firstTime / RANGE_CHUNK);
+    int maxChunk = (int)(m_lastTime / RANGE_CHUNK);
+    if (firstChunk < minChunk) firstChunk = minChunk;
+    if (lastChunk > maxChunk) lastChunk = maxChunk;
+    if (lastChunk < firstChunk) lastChunk = firstChunk;
+
+    if (lastChunk - firstChunk + 1 > RANGE_MAX_CHUNKS)
+    {
+        int centerChunk = (int)((leftTime + rightTime) / 2 / RANGE_CHUNK);
+        firstChunk = centerChunk - RANGE_MAX_CHUNKS / 2;
+        lastChunk = firstChunk + RANGE_MAX_CHUNKS - 1;
+    }
+
+    bool isChanged = false;
+
+    std::map<int, std::vector<UvdState *> >::iterator iter = m_chunks.begin();
+    while (iter != m_chunks.end())
+    {
+        if (iter->first < firstChunk || iter->first > lastChunk)
+        {
+            releaseChunk(&iter->second);
+            m_chunks.erase(iter++);
+            isChanged = true;
+        }
+        else
+        {
+            ++iter;
+        }
+    }
+
+    for (int chunk = firstChunk; chunk <= lastChunk; chunk++)
+    {
+        if (m_chunks.count(chunk) == 0)
+        {
+            loadChunk(chunk);
+            isChanged = true;
+        }
+    }
+
+    if (!isChanged) return;
+
+    TRACE_SPAN("range rebuild");
+
+    std::vector<UvdState *> parts;
+    for (iter = m_chunks.begin(); iter != m_chunks.end(); ++iter)
+    {
+        parts.insert(parts.end(), iter->second.begin(), iter->second.end());
+    }
+
+    m_state->clearData();
+    m_state->mergeStates(&parts, false);
+}
+
+void RtlUvdRangeLoader::loadChunk(int chunk)
+{
+    TRACE_SPAN("loadChunk");
+
+    std::vector<UvdState *> &parts = m_chunks[chunk];
+
+    UvdTime startTime = chunk * RANGE_CHUNK;
+    UvdTime endTime = startTime + RANGE_CHUNK;
+
+    int yyyy, mm, dd;
+    m_state->getStartDate(&yyyy, &mm, &dd);
+
+    std::vector<RangeLogFile>::iterator iter;
+    for (iter = m_files.begin(); iter != m_files.end(); ++iter)
+    {
+        RangeLogFile *file = &(*iter);
+        if (file->index == NULL || file->index->entryCount() == 0) continue;
+
+        UvdTime fileStartTime = startTime - file->baseTime;
+        UvdTime fileEndTime = endTime - file->baseTime;
+        if (fileEndTime <= file->index->firstTime() || fileStartTime > file->index->lastTime()) continue;
+
+        long long startOffset, endOffset;
+        file->index->rangeForTimes(fileStartTime, fileEndTime, &startOffset, &endOffset);
+        if (startOffset >= endOffset) continue;
+
+        // the parser counts day crossings from the start of the range
+        int day = fileStartTime > 0 ? (int)(fileStartTime / UVD_DAY) : 0;
+
+        UvdState *part = new UvdState();
+        part->setHidesTailNumbers(false);
+        part->setStartDate(yyyy, mm, dd);
+
+        RtlUvdParser *parser = new RtlUvdParser(part);
+        parser->setBaseTime(file->baseTime + day * UVD_DAY);
+        parser->parseLogRange(file->path, startOffset, endOffset);
+        delete parser;
+
+        parts.push_back(part);
+    }
+}
+
+void RtlUvdRangeLoader::releaseChunk(std::vector<UvdState *> *parts)
+{
+    std::vector<UvdState *>::iterator iter;
+    for (iter = parts->begin(); iter != parts->end(); ++iter)
+    {
+        delete *iter;
+    }
+    parts->clear();
+}
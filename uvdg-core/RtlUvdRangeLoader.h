@@ -0,0 +1,48 @@
+#ifndef __RTLUVDRANGELOADER_H__
+#define __RTLUVDRANGELOADER_H__
+
+#include <map>
+#include <vector>
+#include "RtlUvdArchive.h"
+#include "RtlUvdIndex.h"
+#include "UvdState.h"
+
+#define RANGE_CHUNK UVD_HOUR
+#define RANGE_MAX_CHUNKS 72
+#define RANGE_LINE_BYTES 58     // of an average line, for the lines of an index entry
+
+typedef struct {
+    char path[1024];
+    UvdTime baseTime;       // midnight of the file's day on the state clock
+    RtlUvdIndex *index;
+} RangeLogFile;
+
+// Keeps only the viewed part of an archive in the state. Logs are indexed
+// once (RtlUvdIndex), then chunks overlapping the drawn range plus a view
+// width on each side are parsed from their byte ranges and chunks outside
+// are dropped. At most RANGE_MAX_CHUNKS are held, so memory doesn't grow
+// with the archive; a wider view shows the chunks around its center.
+class RtlUvdRangeLoader
+{
+    UvdState *m_state;
+    std::vector<RangeLogFile> m_files;
+    std::map<int, std::vector<UvdState *> > m_chunks;
+
+    UvdTime m_firstTime, m_lastTime;
+
+    static void rangeFunction(void *context, UvdTime leftTime, UvdTime rightTime);
+    void loadChunk(int chunk);
+    void releaseChunk(std::vector<UvdState *> *parts);
+    void fillOverview();
+
+public:
+    RtlUvdRangeLoader(UvdState *state, RtlUvdArchive *archive);
+    ~RtlUvdRangeLoader();
+
+    bool open();
+    void ensureRange(UvdTime leftTime, UvdTime rightTime);
+
+    size_t loadedChunkCount() { return m_chunks.size(); }
+};
+
+#endif
@@ -0,0 +1,233 @@
+#include "RtlUvdRecorder.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _MSC_VER
+#include <io.h>
+#define fsync _commit
+#define fileno _fileno
+#else
+#include <unistd.h>
+#endif
+
+#define RECORDER_FILE_BUFFER_SIZE (256 * 1024)
+#define RECORDER_BATCH_SIZE (64 * 1024)
+#define RECORDER_MAX_PENDING_SIZE (16 * 1024 * 1024)
+#define RECORDER_FLUSH_INTERVAL_MS 1000
+
+RtlUvdRecorder::RtlUvdRecorder(const char *directory, RecorderSyncPolicy syncPolicy, int syncInterval)
+{
+    strncpy(m_directory, directory, sizeof(m_directory) - 1);
+    m_directory[sizeof(m_directory) - 1] = '\x00';
+
+    m_syncPolicy = syncPolicy;
+    m_syncInterval = syncInterval;
+
+    m_pendingKey = 0;
+    m_droppedLines = 0;
+
+    m_file = NULL;
+    m_fileKey = 0;
+    m_fileBuffer = (char *)malloc(RECORDER_FILE_BUFFER_SIZE);
+    m_lastSyncTime = time(NULL);
+
+    m_isStopping = false;
+
+    m_pendingBytes.reserve(RECORDER_BATCH_SIZE * 2);
+    m_writeBytes.reserve(RECORDER_BATCH_SIZE * 2);
+
+    MutexCreate(&m_lock);
+    EventCreate(&m_wakeup);
+    ThreadCreate(&m_thread, writerThread, this);
+}
+
+RtlUvdRecorder::~RtlUvdRecorder()
+{
+    MutexLock(&m_lock);
+    m_isStopping = true;
+    MutexUnlock(&m_lock);
+
+    EventSignal(&m_wakeup);
+    ThreadJoin(&m_thread);
+
+    closeFile();
+
+    EventDestroy(&m_wakeup);
+    MutexDestroy(&m_lock);
+
+    free(m_fileBuffer);
+
+    if (m_droppedLines > 0)
+    {
+        printf("recorder dropped %lu lines.\n", m_droppedLines);
+    }
+}
+
+unsigned long RtlUvdRecorder::droppedLines()
+{
+    MutexLock(&m_lock);
+    unsigned long droppedLines = m_droppedLines;
+    MutexUnlock(&m_lock);
+
+    return droppedLines;
+}
+
+void RtlUvdRecorder::appendLine(const char *line)
+{
+    // K1 14:57:41.207.405 [ 1776] {087} **** :01234
+
+    size_t length = strlen(line);
+    while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r')) length--;
+    if (length < 12) return;
+
+    int lineSeconds = atoi(line + 3) * 3600 + atoi(line + 6) * 60 + atoi(line + 9);
+
+    // the file is picked by the line's own time of day, the local clock only
+    // supplies the date, so a line from 23:59:59 received after midnight
+    // still goes to yesterday's file
+
+    time_t now = time(NULL);
+    struct tm date = *localtime(&now);
+    int nowSeconds = date.tm_hour * 3600 + date.tm_min * 60 + date.tm_sec;
+    if (lineSeconds - nowSeconds > 12 * 3600)
+    {
+        date.tm_mday -= 1;
+    }
+    else if (nowSeconds - lineSeconds > 12 * 3600)
+    {
+        date.tm_mday += 1;
+    }
+    date.tm_hour = 12;
+    mktime(&date);
+
+    int key = (date.tm_year + 1900) * 10000 + (date.tm_mon + 1) * 100 + date.tm_mday;
+
+    MutexLock(&m_lock);
+
+    if (m_pendingBytes.size() + length + 1 > RECORDER_MAX_PENDING_SIZE)
+    {
+        // disk is stalled, never stall ingest because of it
+        m_droppedLines++;
+        MutexUnlock(&m_lock);
+        return;
+    }
+
+    if (key != m_pendingKey || m_pendingRuns.size() == 0)
+    {
+        RecorderRun run;
+        run.offset = m_pendingBytes.size();
+        run.yyyy = key / 10000;
+        run.mm = (key / 100) % 100;
+        run.dd = key % 100;
+        m_pendingRuns.push_back(run);
+        m_pendingKey = key;
+    }
+
+    m_pendingBytes.insert(m_pendingBytes.end(), line, line + length);
+    m_pendingBytes.push_back('\n');
+
+    bool isBatchFull = m_pendingBytes.size() >= RECORDER_BATCH_SIZE;
+
+    MutexUnlock(&m_lock);
+
+    if (isBatchFull)
+    {
+        EventSignal(&m_wakeup);
+    }
+}
+
+void RtlUvdRecorder::writerThread(void *context)
+{
+    ((RtlUvdRecorder *)context)->writerLoop();
+}
+
+void RtlUvdRecorder::writerLoop()
+{
+    while (true)
+    {
+        EventWait(&m_wakeup, RECORDER_FLUSH_INTERVAL_MS);
+
+        MutexLock(&m_lock);
+        m_writeBytes.swap(m_pendingBytes);
+        m_writeRuns.swap(m_pendingRuns);
+        m_pendingBytes.clear();
+        m_pendingRuns.clear();
+        bool isStopping = m_isStopping;
+        MutexUnlock(&m_lock);
+
+        writeBatch();
+
+        if (isStopping) break;
+    }
+}
+
+void RtlUvdRecorder::writeBatch()
+{
+    if (m_writeRuns.size() == 0) return;
+
+    for (size_t i = 0; i < m_writeRuns.size(); i++)
+    {
+        RecorderRun run = m_writeRuns[i];
+        size_t end = (i + 1 < m_writeRuns.size()) ? m_writeRuns[i + 1].offset : m_writeBytes.size();
+
+        if (!openFile(run.yyyy, run.mm, run.dd)) continue;
+
+        fwrite(&m_writeBytes[run.offset], 1, end - run.offset, m_file);
+    }
+
+    if (m_file == NULL) return;
+
+    fflush(m_file);
+
+    time_t now = time(NULL);
+    if (m_syncPolicy == RecorderSyncEveryBatch
+        || (m_syncPolicy == RecorderSyncInterval && m_lastSyncTime + m_syncInterval <= now))
+    {
+        syncFile();
+        m_lastSyncTime = now;
+    }
+}
+
+bool RtlUvdRecorder::openFile(int yyyy, int mm, int dd)
+{
+    int key = yyyy * 10000 + mm * 100 + dd;
+    if (m_file != NULL && key == m_fileKey) return true;
+
+    // rotating, make the finished day durable before switching
+    if (m_file != NULL && m_syncPolicy != RecorderSyncNever)
+    {
+        fflush(m_file);
+        syncFile();
+    }
+    closeFile();
+
+    char path[1100];
+    sprintf(path, "%s/rtl-uvd-log-%04d-%02d-%02d", m_directory, yyyy, mm, dd);
+
+    m_file = fopen(path, "ab");
+    if (m_file == NULL)
+    {
+        printf("recorder can't open %s.\n", path);
+        return false;
+    }
+
+    setvbuf(m_file, m_fileBuffer, _IOFBF, RECORDER_FILE_BUFFER_SIZE);
+    m_fileKey = key;
+
+    printf("recording to %s.\n", path);
+    return true;
+}
+
+void RtlUvdRecorder::closeFile()
+{
+    if (m_file == NULL) return;
+
+    fclose(m_file);
+    m_file = NULL;
+    m_fileKey = 0;
+}
+
+void RtlUvdRecorder::syncFile()
+{
+    fsync(fileno(m_file));
+}
@@ -0,0 +1,67 @@
+#ifndef __RTLUVDRECORDER_H__
+#define __RTLUVDRECORDER_H__
+
+#include <stdio.h>
+#include <time.h>
+#include <vector>
+#include "Mutex.h"
+#include "Thread.h"
+
+typedef enum {
+    RecorderSyncNever,      // leave it to the OS
+    RecorderSyncInterval,   // fsync at most once per sync interval
+    RecorderSyncEveryBatch  // fsync after every written batch
+} RecorderSyncPolicy;
+
+typedef struct {
+    size_t offset;          // first byte of the run in the batch buffer
+    int yyyy, mm, dd;       // log file the run belongs to
+} RecorderRun;
+
+// Appends accepted raw lines to rtl-uvd-log-YYYY-MM-DD files, so that a
+// recording can be loaded back with RtlUvdParser::parseLogFile. The caller
+// only copies the line into a memory buffer, a writer thread does the disk I/O.
+class RtlUvdRecorder
+{
+    char m_directory[1024];
+
+    RecorderSyncPolicy m_syncPolicy;
+    int m_syncInterval;
+
+    // filled by appendLine, swapped out by the writer thread
+    std::vector<char> m_pendingBytes;
+    std::vector<RecorderRun> m_pendingRuns;
+    int m_pendingKey;
+    unsigned long m_droppedLines;
+
+    // owned by the writer thread
+    std::vector<char> m_writeBytes;
+    std::vector<RecorderRun> m_writeRuns;
+    FILE *m_file;
+    int m_fileKey;
+    char *m_fileBuffer;
+    time_t m_lastSyncTime;
+
+    bool m_isStopping;
+
+    Mutex m_lock;
+    Event m_wakeup;
+    Thread m_thread;
+
+    static void writerThread(void *context);
+    void writerLoop();
+    void writeBatch();
+    bool openFile(int yyyy, int mm, int dd);
+    void closeFile();
+    void syncFile();
+
+public:
+    RtlUvdRecorder(const char *directory, RecorderSyncPolicy syncPolicy, int syncInterval);
+    ~RtlUvdRecorder();
+
+    void appendLine(const char *line);
+
+    unsigned long droppedLines();
+};
+
+#endif
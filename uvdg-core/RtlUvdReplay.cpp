@@ -0,0 +1,147 @@
+#include "RtlUvdReplay.h"
+#include "RtlUvdParser.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+RtlUvdReplay::RtlUvdReplay(const char *path, double speed)
+{
+    m_decompressor = NULL;
+    m_blockStart = NULL;
+    m_blockEnd = NULL;
+
+    bool isOpen;
+    if (LogDecompressor::detect(path) != LogCompressionNone)
+    {
+        m_decompressor = new LogDecompressor();
+        isOpen = m_decompressor->open(path);
+    }
+    else
+    {
+        m_stream.open(path);
+        isOpen = m_stream.is_open();
+    }
+
+    m_hasLine = false;
+    m_lineTime = 0;
+
+    m_firstTime = -1;
+    m_prevTime = 0;
+    m_day = 0;
+
+    m_speed = speed;
+    m_linesRead = 0;
+    m_isFinished = !isOpen;
+
+    if (m_isFinished)
+    {
+        printf("can't open %s for replay.\n", path);
+    }
+}
+
+RtlUvdReplay::~RtlUvdReplay()
+{
+    m_stream.close();
+    delete m_decompressor;
+}
+
+bool RtlUvdReplay::readCompressedLine()
+{
+    // a line split between two blocks is put together in m_line
+    size_t lineLength = 0;
+    while (true)
+    {
+        if (m_blockStart == m_blockEnd)
+        {
+            size_t size;
+            char *block = m_decompressor->nextBlock(&size);
+            if (block == NULL)
+            {
+                m_line[lineLength] = '\x00';
+                return lineLength > 0;
+            }
+            m_blockStart = block;
+            m_blockEnd = block + size;
+        }
+
+        char *lineEnd = (char *)memchr(m_blockStart, '\n', m_blockEnd - m_blockStart);
+        size_t length = (lineEnd != NULL ? lineEnd : m_blockEnd) - m_blockStart;
+        if (lineLength + length >= sizeof(m_line)) length = sizeof(m_line) - 1 - lineLength;
+        memcpy(m_line + lineLength, m_blockStart, length);
+        lineLength += length;
+
+        if (lineEnd == NULL)
+        {
+            m_blockStart = m_blockEnd;
+            continue;
+        }
+
+        m_blockStart = lineEnd + 1;
+        break;
+    }
+
+    if (lineLength > 0 && m_line[lineLength - 1] == '\r') lineLength--;
+    m_line[lineLength] = '\x00';
+    return true;
+}
+
+bool RtlUvdReplay::readLine()
+{
+    bool isRead = m_decompressor != NULL ? readCompressedLine() : (bool)m_stream.getline(m_line, 256);
+    if (!isRead)
+    {
+        m_isFinished = true;
+        return false;
+    }
+
+    m_linesRead++;
+
+    // K1 14:57:41.207.405 [ 1776] {087} **** :01234
+
+    if (m_line[0] != 'K' || strlen(m_line) < 19)
+    {
+        // not ours to judge, the parser will drop it; keep the current pace
+        return true;
+    }
+
+    UvdTime time = RtlUvdParser::lineTime(m_line);
+
+    // same day crossing rule as the parser, but tolerant to the small
+    // reorderings the parser drops as duplicates
+    if (time + UVD_HOUR < m_prevTime)
+    {
+        m_day++;
+    }
+    m_prevTime = time;
+
+    time += m_day * UVD_DAY;
+
+    if (m_firstTime < 0)
+    {
+        m_firstTime = time;
+    }
+
+    if (time - m_firstTime > m_lineTime)
+    {
+        m_lineTime = time - m_firstTime;
+    }
+
+    return true;
+}
+
+char *RtlUvdReplay::nextDueLine(double elapsedTime)
+{
+    if (!m_hasLine)
+    {
+        if (m_isFinished || !readLine()) return NULL;
+        m_hasLine = true;
+    }
+
+    if (m_speed > 0.0 && m_lineTime > UvdTimeFromSeconds(elapsedTime * m_speed))
+    {
+        return NULL;
+    }
+
+    m_hasLine = false;
+    return m_line;
+}
@@ -0,0 +1,45 @@
+#ifndef __RTLUVDREPLAY_H__
+#define __RTLUVDREPLAY_H__
+
+#include <fstream>
+#include "LogDecompressor.h"
+#include "UvdTime.h"
+
+// Reads a recorded rtl-uvd log and hands its lines out paced by their own
+// timestamps, so they can be fed through the realtime ingest path.
+// Speed 0 means as fast as possible. Compressed logs stream through
+// LogDecompressor, as the parser reads them.
+class RtlUvdReplay
+{
+    std::ifstream m_stream;
+    LogDecompressor *m_decompressor;
+    char *m_blockStart;             // of the decompressed block, not read yet
+    char *m_blockEnd;
+
+    char m_line[256];
+    bool m_hasLine;
+    UvdTime m_lineTime;
+
+    UvdTime m_firstTime;
+    UvdTime m_prevTime;
+    int m_day;
+
+    double m_speed;
+    unsigned long m_linesRead;
+    bool m_isFinished;
+
+    bool readLine();
+    bool readCompressedLine();
+
+public:
+    RtlUvdReplay(const char *path, double speed);
+    ~RtlUvdReplay();
+
+    char *nextDueLine(double elapsedTime);
+
+    double speed() { return m_speed; }
+    unsigned long linesRead() { return m_linesRead; }
+    bool isFinished() { return m_isFinished; }
+};
+
+#endif
@@ -0,0 +1,139 @@
+#include "RtlUvdWire.h"
+#include <string.h>
+
+static int clampField(int value, int maxValue)
+{
+    if (value < 0) return 0;
+    return value > maxValue ? maxValue : value;
+}
+
+RtlUvdWire::RtlUvdWire()
+{
+    m_time = -1;
+}
+
+int RtlUvdWire::encode(const RingRecord *record, unsigned char *data)
+{
+    int length = 0;
+    UvdTime time = record->timeOfDay;
+
+    if (m_time < 0 || time < m_time || time - m_time >= WIRE_MAX_DELTA)
+    {
+        data[length++] = 9;
+        data[length++] = WIRE_FRAME_TIME;
+        for (int i = 0; i < 8; i++) data[length++] = (unsigned char)((unsigned long long)time >> (i * 8));
+        m_time = time;
+    }
+
+    int start = length;
+    data[length++] = 0;
+    data[length++] = (unsigned char)(record->type | (clampField(record->confidence, 15) << 4));
+    data[length++] = (unsigned char)clampField(record->amplitude, 255);
+
+    if (record->type == RING_RECORD_K1)
+    {
+        unsigned int tailNumber = (unsigned int)record->value;
+        for (int i = 0; i < 4; i++) data[length++] = (unsigned char)(tailNumber >> (i * 8));
+    }
+    else
+    {
+        int alt = clampField(record->value, 65535);
+        data[length++] = (unsigned char)alt;
+        data[length++] = (unsigned char)(alt >> 8);
+        data[length++] = (unsigned char)clampField(record->fuel, 255);
+    }
+
+    unsigned long long delta = (unsigned long long)(time - m_time);
+    do
+    {
+        unsigned char byte = delta & 0x7f;
+        delta >>= 7;
+        data[length++] = delta != 0 ? (byte | 0x80) : byte;
+    } while (delta != 0);
+
+    data[start] = (unsigned char)(length - start - 1);
+    m_time = time;
+    return length;
+}
+
+int RtlUvdWire::encodeComment(const char *text, unsigned char *data)
+{
+    int textLength = (int)strlen(text);
+    if (textLength > WIRE_MAX_FRAME_SIZE - 2) textLength = WIRE_MAX_FRAME_SIZE - 2;
+
+    data[0] = (unsigned char)(textLength + 1);
+    data[1] = WIRE_FRAME_COMMENT;
+    memcpy(data + 2, text, textLength);
+    return textLength + 2;
+}
+
+int RtlUvdWire::decode(const unsigned char *data, int length, WireFrame *frame)
+{
+    if (length < 1 || length < 1 + data[0]) return 0;
+
+    int frameLength = data[0];
+    const unsigned char *p = data + 1;
+    const unsigned char *end = p + frameLength;
+
+    frame->kind = frameLength > 0 ? (p[0] & 0x0f) : -1;
+
+    if (frame->kind == WIRE_FRAME_TIME && frameLength >= 9)
+    {
+        unsigned long long time = 0;
+        for (int i = 0; i < 8; i++) time |= (unsigned long long)p[1 + i] << (i * 8);
+        m_time = (UvdTime)time;
+    }
+    else if ((frame->kind == WIRE_FRAME_K1 && frameLength >= 7) || (frame->kind == WIRE_FRAME_K2 && frameLength >= 6))
+    {
+        RingRecord *record = &frame->record;
+        record->type = frame->kind;
+        record->confidence = p[0] >> 4;
+        record->amplitude = p[1];
+        record->reserved = 0;
+        p += 2;
+
+        if (frame->kind == WIRE_FRAME_K1)
+        {
+            record->value = (int)(p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int)p[3] << 24));
+            record->fuel = 0;
+            p += 4;
+        }
+        else
+        {
+            record->value = p[0] | (p[1] << 8);
+            record->fuel = p[2];
+            p += 3;
+        }
+
+        unsigned long long delta = 0;
+        for (int shift = 0; p < end; shift += 7)
+        {
+            delta |= (unsigned long long)(*p & 0x7f) << shift;
+            if ((*p++ & 0x80) == 0) break;
+        }
+
+        m_time += (UvdTime)delta;
+        record->timeOfDay = m_time;
+    }
+    else if (frame->kind == WIRE_FRAME_COMMENT)
+    {
+        memcpy(frame->text, p + 1, frameLength - 1);
+        frame->text[frameLength - 1] = '\x00';
+    }
+    else
+    {
+        // a kind of a later version, skipped
+        frame->kind = -1;
+    }
+
+    return 1 + frameLength;
+}
+
+bool RtlUvdWire::isHello(const char *line)
+{
+    // with or without the line end QTcpSocket::readLine keeps
+    size_t length = strlen(WIRE_HELLO);
+    if (strncmp(line, WIRE_HELLO, length) != 0) return false;
+
+    return line[length] == '\x00' || line[length] == '\n' || line[length] == '\r';
+}
@@ -0,0 +1,61 @@
+#ifndef __RTLUVDWIRE_H__
+#define __RTLUVDWIRE_H__
+
+#include "RecordRing.h"
+#include "UvdTime.h"
+
+#define WIRE_HELLO "# uvdg-wire 1"
+#define WIRE_MAX_FRAME_SIZE 256
+#define WIRE_MAX_RECORD_BYTES 32        // encode() of a record, time frame included
+#define WIRE_MAX_DELTA (1LL << 28)      // 4 bytes of varint
+
+#define WIRE_FRAME_TIME 0
+#define WIRE_FRAME_K1 1
+#define WIRE_FRAME_K2 2
+#define WIRE_FRAME_COMMENT 3
+
+// Binary framing of an rtl-uvd feed, about 8 bytes a line instead of 60.
+//
+// A client that understands it sends the line WIRE_HELLO after connecting.
+// A feed that understands it answers with the same line and sends frames
+// from the byte after it; any other feed ignores the hello and keeps sending
+// text lines, which the client goes on reading as before.
+//
+// A frame is one byte n, then n bytes, the first of them the kind in the
+// low four bits (the line's confidence in the high four for K1/K2), so a
+// client skips the kinds it doesn't know:
+//   TIME      i64 time of day in microseconds                  n = 9
+//   K1        u8 amplitude, u32 tail number, varint delta       n = 7..10
+//   K2        u8 amplitude, u16 altitude in meters, u8 fuel,
+//             varint delta                                      n = 6..9
+//   COMMENT   text of a # line, without the newline
+// Integers are little-endian. The time of a K1/K2 frame is the time of the
+// previous frame plus delta (LEB128, at most 4 bytes); a TIME frame comes
+// first and wherever the time goes back or jumps too far.
+typedef struct {
+    int kind;
+    RingRecord record;                  // K1, K2
+    char text[WIRE_MAX_FRAME_SIZE];     // COMMENT
+} WireFrame;
+
+class RtlUvdWire
+{
+    UvdTime m_time;     // of the previous frame, -1 before the first
+
+public:
+    RtlUvdWire();
+
+    // for a new connection, both ends
+    void reset() { m_time = -1; }
+
+    // the frames of record, WIRE_MAX_RECORD_BYTES at most
+    int encode(const RingRecord *record, unsigned char *data);
+    int encodeComment(const char *text, unsigned char *data);
+
+    // bytes of the frame at data, 0 if it isn't all there yet
+    int decode(const unsigned char *data, int length, WireFrame *frame);
+
+    static bool isHello(const char *line);
+};
+
+#endif
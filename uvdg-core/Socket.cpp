@@ -0,0 +1,153 @@
+#ifdef _MSC_VER
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+typedef int socklen_t;
+#else
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <signal.h>
+#define closesocket close
+#endif
+
+#include "Socket.h"
+#include <stdio.h>
+#include <string.h>
+
+bool SocketStartup()
+{
+#ifdef _MSC_VER
+    WSADATA data;
+    return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+#else
+    // a peer going away must be an error code, not a signal
+    signal(SIGPIPE, SIG_IGN);
+    return true;
+#endif
+}
+
+Socket SocketListen(int port)
+{
+    Socket listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (listener == SOCKET_INVALID) return SOCKET_INVALID;
+
+    int reuse = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, (const char *)&reuse, sizeof(reuse));
+
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons((unsigned short)port);
+
+    if (bind(listener, (struct sockaddr *)&address, sizeof(address)) != 0
+        || listen(listener, 16) != 0)
+    {
+        printf("can't listen on port %d.\n", port);
+        closesocket(listener);
+        return SOCKET_INVALID;
+    }
+
+    return listener;
+}
+
+Socket SocketAccept(Socket listener)
+{
+    Socket socket = accept(listener, NULL, NULL);
+    if (socket == SOCKET_INVALID) return SOCKET_INVALID;
+
+    int noDelay = 1;
+    setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, (const char *)&noDelay, sizeof(noDelay));
+
+    return socket;
+}
+
+Socket SocketConnect(const char *host, int port)
+{
+    char portString[16];
+    sprintf(portString, "%d", port);
+
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+
+    struct addrinfo *info = NULL;
+    if (getaddrinfo(host, portString, &hints, &info) != 0 || info == NULL)
+    {
+        printf("can't resolve %s.\n", host);
+        return SOCKET_INVALID;
+    }
+
+    Socket connection = socket(info->ai_family, info->ai_socktype, info->ai_protocol);
+    if (connection != SOCKET_INVALID && connect(connection, info->ai_addr, (socklen_t)info->ai_addrlen) != 0)
+    {
+        closesocket(connection);
+        connection = SOCKET_INVALID;
+    }
+
+    freeaddrinfo(info);
+
+    if (connection != SOCKET_INVALID)
+    {
+        int noDelay = 1;
+        setsockopt(connection, IPPROTO_TCP, TCP_NODELAY, (const char *)&noDelay, sizeof(noDelay));
+    }
+
+    return connection;
+}
+
+int SocketSend(Socket socket, const char *data, int length)
+{
+    int sent = 0;
+    while (sent < length)
+    {
+        int result = send(socket, data + sent, length - sent, 0);
+        if (result <= 0) return -1;
+        sent += result;
+    }
+
+    return sent;
+}
+
+int SocketRecv(Socket socket, char *buffer, int length)
+{
+    return recv(socket, buffer, length, 0);
+}
+
+void SocketSetTimeout(Socket socket, int milliseconds)
+{
+#ifdef _MSC_VER
+    DWORD timeout = milliseconds;
+#else
+    struct timeval timeout;
+    timeout.tv_sec = milliseconds / 1000;
+    timeout.tv_usec = (milliseconds % 1000) * 1000;
+#endif
+    setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, (const char *)&timeout, sizeof(timeout));
+}
+
+bool SocketIsReadable(Socket socket, int milliseconds)
+{
+    fd_set sockets;
+    FD_ZERO(&sockets);
+    FD_SET(socket, &sockets);
+
+    struct timeval timeout;
+    timeout.tv_sec = milliseconds / 1000;
+    timeout.tv_usec = (milliseconds % 1000) * 1000;
+
+    // the first argument is ignored by winsock
+    return select((int)socket + 1, &sockets, NULL, NULL, &timeout) > 0;
+}
+
+void SocketClose(Socket socket)
+{
+    closesocket(socket);
+}
@@ -0,0 +1,31 @@
+#ifndef __SOCKET_H__
+#define __SOCKET_H__
+
+#ifdef _MSC_VER
+
+#include <BaseTsd.h>
+typedef UINT_PTR Socket;
+
+#else
+
+typedef int Socket;
+
+#endif
+
+#define SOCKET_INVALID ((Socket)-1)
+
+// blocking TCP sockets for the console tools; the GUI uses QTcpSocket
+
+bool SocketStartup();
+Socket SocketListen(int port);
+Socket SocketAccept(Socket listener);
+Socket SocketConnect(const char *host, int port);
+int SocketSend(Socket socket, const char *data, int length);
+int SocketRecv(Socket socket, char *buffer, int length);
+// SocketRecv fails after milliseconds without data
+void SocketSetTimeout(Socket socket, int milliseconds);
+// whether SocketRecv would return at once, waiting up to milliseconds
+bool SocketIsReadable(Socket socket, int milliseconds);
+void SocketClose(Socket socket);
+
+#endif
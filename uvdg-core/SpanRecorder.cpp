@@ -0,0 +1,107 @@
+#include "SpanRecorder.h"
+#include "Mutex.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+volatile bool SpanRecorder::isEnabled = false;
+
+static THREAD_LOCAL SpanBuffer *s_threadBuffer = NULL;
+
+static SpanBuffer *s_buffers = NULL;
+static SpanBuffer *s_freeBuffers = NULL;    // of exited threads, spans kept until reused
+static int s_threadCount = 0;
+static Mutex s_buffersLock;
+
+static struct SpanRecorderSetup {
+    SpanRecorderSetup() { MutexCreate(&s_buffersLock); }
+} s_setup;
+
+static SpanBuffer *registerThreadBuffer()
+{
+    MutexLock(&s_buffersLock);
+    SpanBuffer *buffer = s_freeBuffers;
+    if (buffer != NULL)
+    {
+        s_freeBuffers = buffer->nextFree;
+        buffer->count = 0;
+    }
+    else
+    {
+        buffer = (SpanBuffer *)calloc(1, sizeof(SpanBuffer));
+        buffer->next = s_buffers;
+        s_buffers = buffer;
+    }
+    buffer->threadId = ++s_threadCount;
+    MutexUnlock(&s_buffersLock);
+
+    return buffer;
+}
+
+void SpanRecorder::releaseThreadBuffer()
+{
+    SpanBuffer *buffer = s_threadBuffer;
+    if (buffer == NULL) return;
+    s_threadBuffer = NULL;
+
+    MutexLock(&s_buffersLock);
+    buffer->nextFree = s_freeBuffers;
+    s_freeBuffers = buffer;
+    MutexUnlock(&s_buffersLock);
+}
+
+void SpanRecorder::record(const char *name, long long start, long long end)
+{
+    SpanBuffer *buffer = s_threadBuffer;
+    if (buffer == NULL)
+    {
+        buffer = registerThreadBuffer();
+        s_threadBuffer = buffer;
+    }
+
+    Span *span = &buffer->spans[buffer->count % SPAN_BUFFER_CAPACITY];
+    span->name = name;
+    span->start = start;
+    span->duration = end - start;
+    buffer->count++;
+}
+
+bool SpanRecorder::dump(const char *path)
+{
+    FILE *file = fopen(path, "w");
+    if (file == NULL) return false;
+
+    // spans still being written while dumping may come out torn; stop
+    // recording for the copy, it only takes a moment
+    bool wasEnabled = isEnabled;
+    isEnabled = false;
+
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+    bool isFirst = true;
+
+    MutexLock(&s_buffersLock);
+    for (SpanBuffer *buffer = s_buffers; buffer != NULL; buffer = buffer->next)
+    {
+        fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"thread %d\"}}",
+                isFirst ? "" : ",\n", buffer->threadId, buffer->threadId);
+        isFirst = false;
+
+        unsigned long count = buffer->count;
+        unsigned long first = count > SPAN_BUFFER_CAPACITY ? count - SPAN_BUFFER_CAPACITY : 0;
+        for (unsigned long i = first; i < count; i++)
+        {
+            Span *span = &buffer->spans[i % SPAN_BUFFER_CAPACITY];
+            fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%lld,\"dur\":%lld}",
+                    span->name, buffer->threadId, span->start, span->duration);
+        }
+    }
+    MutexUnlock(&s_buffersLock);
+
+    fprintf(file, "\n]}\n");
+    fclose(file);
+
+    isEnabled = wasEnabled;
+
+    return true;
+}
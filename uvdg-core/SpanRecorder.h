@@ -0,0 +1,67 @@
+#ifndef __SPANRECORDER_H__
+#define __SPANRECORDER_H__
+
+#include "Clock.h"
+
+#ifdef _MSC_VER
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL __thread
+#endif
+
+#define SPAN_BUFFER_CAPACITY 65536
+
+typedef struct {
+    const char *name;   // must be a string literal
+    long long start;
+    long long duration;
+} Span;
+
+typedef struct SpanBuffer {
+    Span spans[SPAN_BUFFER_CAPACITY];
+    unsigned long count;    // total ever recorded, index is count % capacity
+    int threadId;
+    struct SpanBuffer *next;
+    struct SpanBuffer *nextFree;
+} SpanBuffer;
+
+// Records named time spans into per-thread ring buffers and dumps them in
+// Chrome trace event format (chrome://tracing, ui.perfetto.dev).
+// Use TRACE_SPAN("name") at the top of a scope. When recording is off a
+// span costs one load and a branch. The buffer of a thread that exits
+// (through ThreadCreate) is handed to the next thread that records, so
+// short lived workers don't add a buffer each.
+class SpanRecorder
+{
+public:
+    static volatile bool isEnabled;
+
+    static void setEnabled(bool flag) { isEnabled = flag; }
+    static void record(const char *name, long long start, long long end);
+    static void releaseThreadBuffer();
+    static bool dump(const char *path);
+};
+
+class SpanScope
+{
+    const char *m_name;
+    long long m_start;
+
+public:
+    SpanScope(const char *name)
+    {
+        m_name = name;
+        m_start = SpanRecorder::isEnabled ? ClockMicroseconds() : -1;
+    }
+
+    ~SpanScope()
+    {
+        if (m_start >= 0) SpanRecorder::record(m_name, m_start, ClockMicroseconds());
+    }
+};
+
+#define TRACE_SPAN_JOIN2(a, b) a##b
+#define TRACE_SPAN_JOIN(a, b) TRACE_SPAN_JOIN2(a, b)
+#define TRACE_SPAN(name) SpanScope TRACE_SPAN_JOIN(spanScope, __LINE__)(name)
+
+#endif
@@ -0,0 +1,144 @@
+#include "Thread.h"
+#include "SpanRecorder.h"
+#include <stdlib.h>
+
+#ifdef _MSC_VER
+
+typedef struct {
+    ThreadFunction function;
+    void *context;
+} ThreadStart;
+
+static DWORD WINAPI ThreadEntry(LPVOID parameter)
+{
+    ThreadStart start = *(ThreadStart *)parameter;
+    free(parameter);
+
+    start.function(start.context);
+    SpanRecorder::releaseThreadBuffer();
+    return 0;
+}
+
+void ThreadCreate(Thread *thread, ThreadFunction function, void *context)
+{
+    ThreadStart *start = (ThreadStart *)malloc(sizeof(ThreadStart));
+    start->function = function;
+    start->context = context;
+
+    *thread = CreateThread(NULL, 0, ThreadEntry, start, 0, NULL);
+}
+
+void ThreadJoin(Thread *thread)
+{
+    WaitForSingleObject(*thread, INFINITE);
+    CloseHandle(*thread);
+    *thread = NULL;
+}
+
+void ThreadSleep(int milliseconds)
+{
+    Sleep(milliseconds);
+}
+
+int ThreadProcessorCount()
+{
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+}
+
+void EventCreate(Event *event)
+{
+    *event = CreateEvent(NULL, FALSE, FALSE, NULL);
+}
+
+void EventDestroy(Event *event)
+{
+    CloseHandle(*event);
+}
+
+void EventSignal(Event *event)
+{
+    SetEvent(*event);
+}
+
+bool EventWait(Event *event, int timeoutMilliseconds)
+{
+    return WaitForSingleObject(*event, timeoutMilliseconds < 0 ? INFINITE : timeoutMilliseconds) == WAIT_OBJECT_0;
+}
+
+#else
+
+#include <chrono>
+
+static void ThreadEntry(ThreadFunction function, void *context)
+{
+    function(context);
+    SpanRecorder::releaseThreadBuffer();
+}
+
+void ThreadCreate(Thread *thread, ThreadFunction function, void *context)
+{
+    *thread = new std::thread(ThreadEntry, function, context);
+}
+
+void ThreadJoin(Thread *thread)
+{
+    (*thread)->join();
+    delete *thread;
+    *thread = NULL;
+}
+
+void ThreadSleep(int milliseconds)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(milliseconds));
+}
+
+int ThreadProcessorCount()
+{
+    int count = (int)std::thread::hardware_concurrency();
+    return count > 0 ? count : 1;
+}
+
+void EventCreate(Event *event)
+{
+    event->mutex = new std::mutex();
+    event->condition = new std::condition_variable();
+    event->isSignaled = false;
+}
+
+void EventDestroy(Event *event)
+{
+    delete event->condition;
+    delete event->mutex;
+}
+
+void EventSignal(Event *event)
+{
+    std::lock_guard<std::mutex> guard(*event->mutex);
+    event->isSignaled = true;
+    event->condition->notify_one();
+}
+
+bool EventWait(Event *event, int timeoutMilliseconds)
+{
+    std::unique_lock<std::mutex> guard(*event->mutex);
+    if (timeoutMilliseconds < 0)
+    {
+        while (!event->isSignaled) event->condition->wait(guard);
+    }
+    else
+    {
+        std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMilliseconds);
+        while (!event->isSignaled)
+        {
+            if (event->condition->wait_until(guard, deadline) == std::cv_status::timeout) break;
+        }
+    }
+
+    bool wasSignaled = event->isSignaled;
+    event->isSignaled = false;
+    return wasSignaled;
+}
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef __THREAD_H__
+#define __THREAD_H__
+
+#ifdef _MSC_VER
+
+#include <Windows.h>
+typedef HANDLE Thread;
+typedef HANDLE Event;
+
+#else
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+typedef std::thread *Thread;
+
+typedef struct {
+    std::mutex *mutex;
+    std::condition_variable *condition;
+    bool isSignaled;
+} Event;
+
+#endif
+
+typedef void (*ThreadFunction)(void *context);
+
+void ThreadCreate(Thread *thread, ThreadFunction function, void *context);
+void ThreadJoin(Thread *thread);
+void ThreadSleep(int milliseconds);
+int ThreadProcessorCount();
+
+// auto-reset event: one waiter is released per signal
+void EventCreate(Event *event);
+void EventDestroy(Event *event);
+void EventSignal(Event *event);
+bool EventWait(Event *event, int timeoutMilliseconds);
+
+#endif
@@ -0,0 +1,321 @@
+#include "TileCache.h"
+#include "PngWriter.h"
+#include "SpanRecorder.h"
+#include <algorithm>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+bool TileKeyLess::operator()(const TileKey &a, const TileKey &b) const
+{
+    // by zoom and time first, so the tiles over a time range are adjacent
+    if (a.zoom != b.zoom) return a.zoom < b.zoom;
+    if (a.leftTime != b.leftTime) return a.leftTime < b.leftTime;
+    if (a.highlightTailNumber != b.highlightTailNumber) return a.highlightTailNumber < b.highlightTailNumber;
+
+    const PointFilter &f = a.filter;
+    const PointFilter &g = b.filter;
+    if (f.isConfidence4Only != g.isConfidence4Only) return f.isConfidence4Only < g.isConfidence4Only;
+    if (f.minAmplitude != g.minAmplitude) return f.minAmplitude < g.minAmplitude;
+    if (f.minAltitude != g.minAltitude) return f.minAltitude < g.minAltitude;
+    if (f.maxAltitude != g.maxAltitude) return f.maxAltitude < g.maxAltitude;
+    if (f.minFuel != g.minFuel) return f.minFuel < g.minFuel;
+    if (f.maxFuel != g.maxFuel) return f.maxFuel < g.maxFuel;
+    return f.tailNumber < g.tailNumber;
+}
+
+TileRenderer::TileRenderer(UvdState *state, int height)
+{
+    m_generator = new UvdBitmapGenerator(state);
+    m_height = height;
+    m_bitmap = (unsigned char *)malloc((size_t)TILE_WIDTH * height * 4);
+    m_row = (unsigned char *)malloc(TILE_WIDTH * 3);
+    m_generator->setBitmap(m_bitmap, TILE_WIDTH, height);
+}
+
+TileRenderer::~TileRenderer()
+{
+    delete m_generator;
+    free(m_bitmap);
+    free(m_row);
+}
+
+void TileRenderer::render(const TileKey *key, std::vector<unsigned char> *png)
+{
+    TRACE_SPAN("TileRenderer::render");
+
+    PointFilter filter = key->filter;
+    m_generator->setFilter(&filter);
+    m_generator->setHighlightTailNumber(key->highlightTailNumber);
+
+    UvdTime timeSlice = TILE_BASE_SLICE << key->zoom;
+    m_generator->update(key->leftTime, key->leftTime + TILE_WIDTH * timeSlice, UVD_TIME_MIN, UVD_TIME_MAX, timeSlice);
+
+    PngWriter writer;
+    writer.open(png, TILE_WIDTH, m_height);
+    for (int j = 0; j < m_height; j++)
+    {
+        const unsigned char *pixel = m_bitmap + (size_t)j * TILE_WIDTH * 4;
+        for (int i = 0; i < TILE_WIDTH; i++, pixel += 4)
+        {
+#ifndef BITMAP_BGR
+            m_row[i * 3] = pixel[0];
+            m_row[i * 3 + 1] = pixel[1];
+            m_row[i * 3 + 2] = pixel[2];
+#else
+            m_row[i * 3] = pixel[2];
+            m_row[i * 3 + 1] = pixel[1];
+            m_row[i * 3 + 2] = pixel[0];
+#endif
+        }
+        writer.writeRow(m_row);
+    }
+    writer.close();
+}
+
+TileCache::TileCache(UvdState *state, size_t maxBytes)
+{
+    m_state = state;
+    m_maxBytes = maxBytes;
+    m_bytes = 0;
+    m_useCount = 0;
+    m_changeCount = 0;
+    m_historyCount = 0;
+    m_hits = 0;
+    m_misses = 0;
+
+    // tags of a restarted server don't repeat the previous one's
+    m_nextTag = (unsigned long long)time(NULL) << 20;
+
+    MutexCreate(&m_lock);
+    MutexCreate(&m_rangeLock);
+
+    m_state->lock();
+    m_state->setChangeFunction(changeFunction, this);
+    m_state->unlock();
+}
+
+TileCache::~TileCache()
+{
+    m_state->lock();
+    m_state->setChangeFunction(NULL, NULL);
+    m_state->unlock();
+
+    std::map<TileKey, TileEntry *, TileKeyLess>::iterator iter;
+    for (iter = m_tiles.begin(); iter != m_tiles.end(); ++iter)
+    {
+        delete iter->second;
+    }
+
+    MutexDestroy(&m_lock);
+    MutexDestroy(&m_rangeLock);
+}
+
+void TileCache::changeFunction(void *context, UvdTime firstTime, UvdTime lastTime)
+{
+    TileCache *cache = (TileCache *)context;
+
+    // appends land next to the previous ones and extend their range, other
+    // changes take a range of their own or widen the nearest one
+    int nearest = 0;
+    UvdTime nearestGap = UVD_TIME_MAX;
+    for (int i = 0; i < cache->m_changeCount; i++)
+    {
+        TileChange *change = &cache->m_changes[i];
+        UvdTime gap = 0;
+        if (firstTime > change->lastTime) gap = firstTime - change->lastTime;
+        else if (lastTime < change->firstTime) gap = change->firstTime - lastTime;
+
+        if (gap <= TILE_CHANGE_SLACK)
+        {
+            nearest = i;
+            nearestGap = 0;
+            break;
+        }
+        if (gap < nearestGap)
+        {
+            nearest = i;
+            nearestGap = gap;
+        }
+    }
+
+    if (nearestGap > 0 && cache->m_changeCount < TILE_CHANGE_RANGES)
+    {
+        TileChange *change = &cache->m_changes[cache->m_changeCount++];
+        change->firstTime = firstTime;
+        change->lastTime = lastTime;
+        return;
+    }
+
+    TileChange *change = &cache->m_changes[nearest];
+    if (firstTime < change->firstTime) change->firstTime = firstTime;
+    if (lastTime > change->lastTime) change->lastTime = lastTime;
+}
+
+// with m_lock locked
+void TileCache::refresh()
+{
+    TileChange changes[TILE_CHANGE_RANGES];
+
+    m_state->lock();
+    int changeCount = m_changeCount;
+    memcpy(changes, m_changes, changeCount * sizeof(TileChange));
+    m_changeCount = 0;
+    m_state->unlock();
+
+    for (int i = 0; i < changeCount; i++)
+    {
+        invalidate(changes[i].firstTime, changes[i].lastTime);
+        m_history[m_historyCount % TILE_CHANGE_HISTORY] = changes[i];
+        m_historyCount++;
+    }
+}
+
+// with m_lock locked
+void TileCache::invalidate(UvdTime firstTime, UvdTime lastTime)
+{
+    for (int zoom = 0; zoom <= TILE_MAX_ZOOM; zoom++)
+    {
+        // the tiles that end after firstTime and start before lastTime
+        UvdTime width = tileTimeWidth(zoom);
+        TileKey key;
+        memset(&key, 0, sizeof(key));
+        key.zoom = zoom;
+        key.leftTime = firstTime > UVD_TIME_MIN + width ? firstTime - width + 1 : UVD_TIME_MIN;
+        key.highlightTailNumber = INT_MIN;
+
+        std::map<TileKey, TileEntry *, TileKeyLess>::iterator iter = m_tiles.lower_bound(key);
+        while (iter != m_tiles.end() && iter->first.zoom == zoom && iter->first.leftTime <= lastTime)
+        {
+            m_bytes -= iter->second->png.size();
+            delete iter->second;
+            m_tiles.erase(iter++);
+        }
+    }
+}
+
+// with m_lock locked
+bool TileCache::isChangedSince(unsigned long historyCount, UvdTime firstTime, UvdTime lastTime)
+{
+    if (m_historyCount - historyCount > TILE_CHANGE_HISTORY) return true;
+
+    for (unsigned long i = historyCount; i < m_historyCount; i++)
+    {
+        TileChange *change = &m_history[i % TILE_CHANGE_HISTORY];
+        if (change->firstTime <= lastTime && change->lastTime >= firstTime) return true;
+    }
+    return false;
+}
+
+// with m_lock locked
+void TileCache::evict()
+{
+    // the least recently used quarter goes
+    std::vector<unsigned long long> uses;
+    uses.reserve(m_tiles.size());
+    std::map<TileKey, TileEntry *, TileKeyLess>::iterator iter;
+    for (iter = m_tiles.begin(); iter != m_tiles.end(); ++iter)
+    {
+        uses.push_back(iter->second->lastUsed);
+    }
+    if (uses.size() == 0) return;
+
+    size_t cut = uses.size() / 4 + 1;
+    std::nth_element(uses.begin(), uses.begin() + (cut - 1), uses.end());
+    unsigned long long lastEvicted = uses[cut - 1];
+
+    iter = m_tiles.begin();
+    while (iter != m_tiles.end())
+    {
+        if (iter->second->lastUsed <= lastEvicted)
+        {
+            m_bytes -= iter->second->png.size();
+            delete iter->second;
+            m_tiles.erase(iter++);
+        }
+        else
+        {
+            ++iter;
+        }
+    }
+}
+
+bool TileCache::getTile(const TileKey *key, TileRenderer *renderer, unsigned long long knownTag,
+                        std::vector<unsigned char> *png, unsigned long long *tag)
+{
+    MutexLock(&m_lock);
+    refresh();
+
+    std::map<TileKey, TileEntry *, TileKeyLess>::iterator iter = m_tiles.find(*key);
+    if (iter != m_tiles.end())
+    {
+        TileEntry *entry = iter->second;
+        entry->lastUsed = ++m_useCount;
+        m_hits++;
+
+        bool isChanged = entry->tag != knownTag;
+        if (isChanged)
+        {
+            png->assign(entry->png.begin(), entry->png.end());
+            *tag = entry->tag;
+        }
+        MutexUnlock(&m_lock);
+        return isChanged;
+    }
+
+    m_misses++;
+    unsigned long historyCount = m_historyCount;
+    MutexUnlock(&m_lock);
+
+    // drawn unlocked, threads render different tiles in parallel
+    UvdTime leftTime = key->leftTime;
+    UvdTime rightTime = leftTime + tileTimeWidth(key->zoom);
+
+    MutexLock(&m_rangeLock);
+    m_state->ensureRange(leftTime, rightTime);
+    MutexUnlock(&m_rangeLock);
+
+    png->clear();
+    renderer->render(key, png);
+
+    MutexLock(&m_lock);
+    refresh();
+    *tag = m_nextTag++;
+
+    // a point that came while it was drawn may be missing from it, such a
+    // tile is only served
+    if (!isChangedSince(historyCount, leftTime, rightTime - 1))
+    {
+        TileEntry *entry = new TileEntry();
+        entry->png = *png;
+        entry->tag = *tag;
+        entry->lastUsed = ++m_useCount;
+
+        iter = m_tiles.find(*key);
+        if (iter != m_tiles.end())
+        {
+            m_bytes -= iter->second->png.size();
+            delete iter->second;
+            iter->second = entry;
+        }
+        else
+        {
+            m_tiles.insert(std::make_pair(*key, entry));
+        }
+        m_bytes += entry->png.size();
+
+        if (m_bytes > m_maxBytes) evict();
+    }
+    MutexUnlock(&m_lock);
+
+    return true;
+}
+
+void TileCache::getCounts(unsigned long *tileCount, unsigned long *hits, unsigned long *misses)
+{
+    MutexLock(&m_lock);
+    *tileCount = (unsigned long)m_tiles.size();
+    *hits = m_hits;
+    *misses = m_misses;
+    MutexUnlock(&m_lock);
+}
@@ -0,0 +1,108 @@
+#ifndef __TILECACHE_H__
+#define __TILECACHE_H__
+
+#include <map>
+#include <vector>
+#include "Mutex.h"
+#include "PointIndex.h"
+#include "UvdBitmapGenerator.h"
+#include "UvdState.h"
+
+#define TILE_WIDTH 256
+#define TILE_BASE_SLICE (UVD_SECOND / 16)       // time per column at zoom 0
+#define TILE_MAX_ZOOM 20
+#define TILE_CACHE_BYTES (64 * 1024 * 1024)
+#define TILE_CHANGE_RANGES 8
+#define TILE_CHANGE_HISTORY 64
+#define TILE_CHANGE_SLACK (TILE_WIDTH * TILE_BASE_SLICE)
+
+// a tile is TILE_WIDTH columns of TILE_BASE_SLICE << zoom each, from
+// leftTime, a multiple of its time width
+typedef struct {
+    int zoom;
+    UvdTime leftTime;
+    PointFilter filter;
+    int highlightTailNumber;
+} TileKey;
+
+struct TileKeyLess
+{
+    bool operator()(const TileKey &a, const TileKey &b) const;
+};
+
+typedef struct {
+    std::vector<unsigned char> png;
+    unsigned long long tag;     // new for every rendering, the HTTP ETag
+    unsigned long long lastUsed;
+} TileEntry;
+
+typedef struct {
+    UvdTime firstTime;
+    UvdTime lastTime;
+} TileChange;
+
+// Draws tiles for one thread at a time, a cache serves several of them.
+class TileRenderer
+{
+    UvdBitmapGenerator *m_generator;
+    unsigned char *m_bitmap;
+    unsigned char *m_row;
+    int m_height;
+
+public:
+    TileRenderer(UvdState *state, int height);
+    ~TileRenderer();
+
+    void render(const TileKey *key, std::vector<unsigned char> *png);
+};
+
+// Rendered tiles of a live state as PNG, shared by the threads serving
+// them. The state reports the time ranges its points were added to or
+// rewritten in, and only the tiles over them are dropped: a tile of the
+// past stays cached, and keeps its tag for revalidation, until a point
+// lands in it. Least recently used tiles go past maxBytes.
+class TileCache
+{
+    UvdState *m_state;
+    size_t m_maxBytes;
+
+    std::map<TileKey, TileEntry *, TileKeyLess> m_tiles;
+    size_t m_bytes;
+    unsigned long long m_nextTag;
+    unsigned long long m_useCount;
+
+    // filled on the ingest thread, with the state locked
+    TileChange m_changes[TILE_CHANGE_RANGES];
+    int m_changeCount;
+
+    // the ranges taken from it, numbered, for tiles rendered meanwhile
+    TileChange m_history[TILE_CHANGE_HISTORY];
+    unsigned long m_historyCount;
+
+    unsigned long m_hits, m_misses;
+
+    Mutex m_lock;
+    Mutex m_rangeLock;
+
+    static void changeFunction(void *context, UvdTime firstTime, UvdTime lastTime);
+
+    void refresh();
+    void invalidate(UvdTime firstTime, UvdTime lastTime);
+    bool isChangedSince(unsigned long historyCount, UvdTime firstTime, UvdTime lastTime);
+    void evict();
+
+public:
+    TileCache(UvdState *state, size_t maxBytes);
+    ~TileCache();
+
+    static UvdTime tileTimeWidth(int zoom) { return (UvdTime)TILE_WIDTH * (TILE_BASE_SLICE << zoom); }
+
+    // false if knownTag is still the tag of the tile, otherwise its PNG
+    // and tag, rendered with renderer unless cached
+    bool getTile(const TileKey *key, TileRenderer *renderer, unsigned long long knownTag,
+                 std::vector<unsigned char> *png, unsigned long long *tag);
+
+    void getCounts(unsigned long *tileCount, unsigned long *hits, unsigned long *misses);
+};
+
+#endif
@@ -0,0 +1,459 @@
+#include "TileServer.h"
+#include "Log.h"
+#include "SpanRecorder.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _MSC_VER
+#define strncasecmp _strnicmp
+#else
+#include <strings.h>
+#endif
+
+static const char viewerPage[] =
+    "<!DOCTYPE html>\n"
+    "<html><head><meta charset=\"utf-8\"><title>UVDG</title>\n"
+    "<style>\n"
+    "body { background: #000; color: #c0c0c0; font: 12px monospace; margin: 0; }\n"
+    "#tiles { white-space: nowrap; overflow-x: auto; line-height: 0; }\n"
+    "</style></head>\n"
+    "<body><div id=\"tiles\"></div><div id=\"info\"></div>\n"
+    "<script>\n"
+    "// the latest tiles, revalidated every few seconds; + and - zoom, the\n"
+    "// page query (conf4=1, minalt=..., tail=...) is the filter of the tiles\n"
+    "var zoom = 4, maxZoom = 0;\n"
+    "function load(img, url) {\n"
+    "  fetch(url, { cache: 'no-cache' }).then(function (r) {\n"
+    "    var tag = r.headers.get('ETag');\n"
+    "    if (img.getAttribute('data-url') == url && img.getAttribute('data-tag') == tag) return;\n"
+    "    img.setAttribute('data-url', url);\n"
+    "    img.setAttribute('data-tag', tag);\n"
+    "    return r.blob().then(function (blob) {\n"
+    "      if (img.src) URL.revokeObjectURL(img.src);\n"
+    "      img.src = URL.createObjectURL(blob);\n"
+    "    });\n"
+    "  });\n"
+    "}\n"
+    "function update() {\n"
+    "  fetch('/status', { cache: 'no-store' }).then(function (r) { return r.json(); }).then(function (s) {\n"
+    "    var div = document.getElementById('tiles');\n"
+    "    var slice = s.baseSlice * Math.pow(2, zoom);\n"
+    "    var count = Math.ceil(window.innerWidth / s.tileWidth) + 1;\n"
+    "    var last = s.lastTime === null ? 0 : Math.floor(s.lastTime / (slice * s.tileWidth));\n"
+    "    maxZoom = s.maxZoom;\n"
+    "    while (div.children.length < count) div.appendChild(document.createElement('img'));\n"
+    "    while (div.children.length > count) div.removeChild(div.lastChild);\n"
+    "    for (var i = 0; i < count; i++) {\n"
+    "      load(div.children[i], '/tile/' + zoom + '/' + (last - count + 1 + i) + '.png' + location.search);\n"
+    "    }\n"
+    "    div.scrollLeft = div.scrollWidth;\n"
+    "    document.getElementById('info').textContent = slice / 1e6 + ' s/px, ' + s.points + ' points';\n"
+    "  });\n"
+    "}\n"
+    "document.onkeydown = function (e) {\n"
+    "  if (e.key == '+' && zoom > 0) zoom--;\n"
+    "  else if (e.key == '-' && zoom < maxZoom) zoom++;\n"
+    "  else return;\n"
+    "  update();\n"
+    "};\n"
+    "update();\n"
+    "setInterval(update, 5000);\n"
+    "</script></body></html>\n";
+
+static void appendText(std::vector<char> *body, const char *text)
+{
+    body->insert(body->end(), text, text + strlen(text));
+}
+
+// the value of a header of the request, NULL if it has none
+static const char *headerValue(const char *request, const char *name)
+{
+    size_t length = strlen(name);
+    const char *line = strstr(request, "\r\n");
+    while (line != NULL)
+    {
+        line += 2;
+        if (strncasecmp(line, name, length) == 0 && line[length] == ':')
+        {
+            const char *value = line + length + 1;
+            while (*value == ' ') value++;
+            return value;
+        }
+        line = strstr(line, "\r\n");
+    }
+    return NULL;
+}
+
+static bool queryNumber(const char *query, const char *name, long long *value)
+{
+    size_t length = strlen(name);
+    const char *parameter = query;
+    while (*parameter != 0)
+    {
+        if (strncmp(parameter, name, length) == 0 && parameter[length] == '=')
+        {
+            *value = atoll(parameter + length + 1);
+            return true;
+        }
+
+        parameter = strchr(parameter, '&');
+        if (parameter == NULL) break;
+        parameter++;
+    }
+    return false;
+}
+
+static void queryInt(const char *query, const char *name, int *value)
+{
+    long long number;
+    if (queryNumber(query, name, &number)) *value = (int)number;
+}
+
+TileServer::TileServer(UvdState *state, TileCache *cache, int tileHeight)
+{
+    m_state = state;
+    m_cache = cache;
+    m_tileHeight = tileHeight;
+    m_port = 0;
+    m_listener = SOCKET_INVALID;
+    m_isStopping = false;
+    m_requestCount = 0;
+
+    MutexCreate(&m_lock);
+}
+
+TileServer::~TileServer()
+{
+    if (m_listener != SOCKET_INVALID) stop();
+
+    MutexDestroy(&m_lock);
+}
+
+bool TileServer::start(int port, int threadCount)
+{
+    if (!SocketStartup()) return false;
+
+    m_listener = SocketListen(port);
+    if (m_listener == SOCKET_INVALID) return false;
+
+    m_port = port;
+    m_isStopping = false;
+
+    // every worker accepts on the listener and serves what it got
+    m_threads.resize(threadCount);
+    for (int i = 0; i < threadCount; i++)
+    {
+        ThreadCreate(&m_threads[i], workerThread, this);
+    }
+
+    UvdLog("tile server: listening on port %d with %d threads.\n", port, threadCount);
+    return true;
+}
+
+void TileServer::stop()
+{
+    m_isStopping = true;
+
+    // a connection wakes each worker blocked in accept, the others finish
+    // their request or time out
+    for (size_t i = 0; i < m_threads.size(); i++)
+    {
+        Socket socket = SocketConnect("127.0.0.1", m_port);
+        if (socket != SOCKET_INVALID) SocketClose(socket);
+    }
+    for (size_t i = 0; i < m_threads.size(); i++)
+    {
+        ThreadJoin(&m_threads[i]);
+    }
+    m_threads.clear();
+
+    SocketClose(m_listener);
+    m_listener = SOCKET_INVALID;
+}
+
+unsigned long TileServer::requestCount()
+{
+    MutexLock(&m_lock);
+    unsigned long count = m_requestCount;
+    MutexUnlock(&m_lock);
+    return count;
+}
+
+void TileServer::workerThread(void *context)
+{
+    TileServer *server = (TileServer *)context;
+    TileRenderer renderer(server->m_state, server->m_tileHeight);
+
+    while (true)
+    {
+        Socket socket = SocketAccept(server->m_listener);
+        if (server->m_isStopping)
+        {
+            if (socket != SOCKET_INVALID) SocketClose(socket);
+            break;
+        }
+        if (socket == SOCKET_INVALID) continue;
+
+        server->serveConnection(socket, &renderer);
+    }
+}
+
+void TileServer::serveConnection(Socket socket, TileRenderer *renderer)
+{
+    SocketSetTimeout(socket, HTTP_TIMEOUT_MS);
+
+    char request[HTTP_REQUEST_SIZE + 1];
+    int used = 0;
+    bool keepsAlive = true;
+
+    while (keepsAlive && !m_isStopping)
+    {
+        // requests are just their header, pipelined ones stay in the buffer
+        char *headerEnd = NULL;
+        while (true)
+        {
+            request[used] = 0;
+            headerEnd = strstr(request, "\r\n\r\n");
+            if (headerEnd != NULL) break;
+
+            if (used == HTTP_REQUEST_SIZE)
+            {
+                sendResponse(socket, "431 Request Header Fields Too Large", "text/plain", "Connection: close\r\n", NULL, 0, false);
+                SocketClose(socket);
+                return;
+            }
+
+            int received = SocketRecv(socket, request + used, HTTP_REQUEST_SIZE - used);
+            if (received <= 0)
+            {
+                SocketClose(socket);
+                return;
+            }
+            used += received;
+        }
+
+        headerEnd[2] = 0;
+        int requestSize = (int)(headerEnd + 4 - request);
+
+        keepsAlive = respond(socket, request, renderer);
+
+        memmove(request, request + requestSize, used - requestSize);
+        used -= requestSize;
+    }
+
+    SocketClose(socket);
+}
+
+// false if the connection is to be closed
+bool TileServer::respond(Socket socket, char *request, TileRenderer *renderer)
+{
+    TRACE_SPAN("TileServer::respond");
+
+    MutexLock(&m_lock);
+    m_requestCount++;
+    MutexUnlock(&m_lock);
+
+    char method[8], target[2048], version[16];
+    if (sscanf(request, "%7s %2047s %15s", method, target, version) != 3)
+    {
+        sendResponse(socket, "400 Bad Request", "text/plain", "Connection: close\r\n", NULL, 0, false);
+        return false;
+    }
+
+    // 1.1 keeps the connection unless told otherwise, 1.0 closes it unless asked
+    bool keepsAlive = strcmp(version, "HTTP/1.1") == 0;
+    const char *connection = headerValue(request, "Connection");
+    if (connection != NULL)
+    {
+        if (strncasecmp(connection, "close", 5) == 0) keepsAlive = false;
+        else if (strncasecmp(connection, "keep-alive", 10) == 0) keepsAlive = true;
+    }
+    const char *closeHeader = keepsAlive ? "" : "Connection: close\r\n";
+
+    bool isHead = strcmp(method, "HEAD") == 0;
+    if (!isHead && strcmp(method, "GET") != 0)
+    {
+        sendResponse(socket, "405 Method Not Allowed", "text/plain", "Allow: GET, HEAD\r\nConnection: close\r\n", NULL, 0, false);
+        return false;
+    }
+
+    const char *path = target;
+    const char *query = "";
+    char *questionMark = strchr(target, '?');
+    if (questionMark != NULL)
+    {
+        *questionMark = 0;
+        query = questionMark + 1;
+    }
+
+    bool isSent;
+    if (strncmp(path, "/tile/", 6) == 0)
+    {
+        TileKey key;
+        if (!parseTileKey(path, query, &key))
+        {
+            return sendResponse(socket, "404 Not Found", "text/plain", closeHeader, NULL, 0, isHead) && keepsAlive;
+        }
+
+        // tags are sent as "hex", weak ones compare the same
+        unsigned long long knownTag = 0;
+        const char *match = headerValue(request, "If-None-Match");
+        if (match != NULL)
+        {
+            if (strncmp(match, "W/", 2) == 0) match += 2;
+            if (*match == '"') knownTag = strtoull(match + 1, NULL, 16);
+        }
+
+        std::vector<unsigned char> png;
+        unsigned long long tag = knownTag;
+        bool isChanged = m_cache->getTile(&key, renderer, knownTag, &png, &tag);
+
+        char headers[256];
+        sprintf(headers, "ETag: \"%llx\"\r\nCache-Control: no-cache\r\n%s", tag, closeHeader);
+        if (!isChanged)
+        {
+            isSent = sendResponse(socket, "304 Not Modified", NULL, headers, NULL, 0, true);
+        }
+        else
+        {
+            isSent = sendResponse(socket, "200 OK", "image/png", headers, png.size() > 0 ? &png[0] : NULL, png.size(), isHead);
+        }
+    }
+    else if (strcmp(path, "/status") == 0)
+    {
+        std::vector<char> body;
+        statusJson(&body);
+        isSent = sendResponse(socket, "200 OK", "application/json", closeHeader, &body[0], body.size(), isHead);
+    }
+    else if (strcmp(path, "/occurrences") == 0)
+    {
+        long long firstTime = UVD_TIME_MIN;
+        long long lastTime = UVD_TIME_MAX;
+        queryNumber(query, "from", &firstTime);
+        queryNumber(query, "to", &lastTime);
+
+        std::vector<char> body;
+        occurrencesJson(firstTime, lastTime, &body);
+        isSent = sendResponse(socket, "200 OK", "application/json", closeHeader, &body[0], body.size(), isHead);
+    }
+    else if (strcmp(path, "/") == 0 || strcmp(path, "/index.html") == 0)
+    {
+        isSent = sendResponse(socket, "200 OK", "text/html; charset=utf-8", closeHeader, viewerPage, sizeof(viewerPage) - 1, isHead);
+    }
+    else
+    {
+        isSent = sendResponse(socket, "404 Not Found", "text/plain", closeHeader, NULL, 0, isHead);
+    }
+
+    return isSent && keepsAlive;
+}
+
+bool TileServer::sendResponse(Socket socket, const char *status, const char *contentType, const char *headers,
+                              const void *body, size_t bodySize, bool isHead)
+{
+    // one send for the header and the body, tiles are small
+    char header[1024];
+    int headerSize;
+    if (contentType == NULL)
+    {
+        headerSize = sprintf(header, "HTTP/1.1 %s\r\n%s\r\n", status, headers);
+    }
+    else
+    {
+        headerSize = sprintf(header, "HTTP/1.1 %s\r\nContent-Type: %s\r\nContent-Length: %lu\r\n%s\r\n",
+                             status, contentType, (unsigned long)bodySize, headers);
+    }
+
+    if (isHead || bodySize == 0)
+    {
+        return SocketSend(socket, header, headerSize) == headerSize;
+    }
+
+    std::vector<char> response(headerSize + bodySize);
+    memcpy(&response[0], header, headerSize);
+    memcpy(&response[headerSize], body, bodySize);
+    return SocketSend(socket, &response[0], (int)response.size()) == (int)response.size();
+}
+
+bool TileServer::parseTileKey(const char *path, const char *query, TileKey *key)
+{
+    int zoom;
+    long long x;
+    char suffix[8];
+    if (sscanf(path, "/tile/%d/%lld%7s", &zoom, &x, suffix) != 3 || strcmp(suffix, ".png") != 0) return false;
+    if (zoom < 0 || zoom > TILE_MAX_ZOOM) return false;
+
+    UvdTime width = TileCache::tileTimeWidth(zoom);
+    if (x > UVD_TIME_MAX / width - 1 || x < UVD_TIME_MIN / width) return false;
+
+    memset(key, 0, sizeof(TileKey));
+    key->zoom = zoom;
+    key->leftTime = x * width;
+
+    PointIndex::defaultFilter(&key->filter);
+    int isConfidence4Only = 0;
+    queryInt(query, "conf4", &isConfidence4Only);
+    key->filter.isConfidence4Only = isConfidence4Only != 0;
+    queryInt(query, "minamp", &key->filter.minAmplitude);
+    queryInt(query, "minalt", &key->filter.minAltitude);
+    queryInt(query, "maxalt", &key->filter.maxAltitude);
+    queryInt(query, "minfuel", &key->filter.minFuel);
+    queryInt(query, "maxfuel", &key->filter.maxFuel);
+    queryInt(query, "tail", &key->filter.tailNumber);
+    queryInt(query, "highlight", &key->highlightTailNumber);
+
+    return true;
+}
+
+void TileServer::statusJson(std::vector<char> *body)
+{
+    UvdTime firstTime, lastTime;
+    m_state->lock();
+    bool hasBounds = m_state->getTimeBounds(&firstTime, &lastTime);
+    unsigned long pointCount = (unsigned long)m_state->points()->size();
+    m_state->unlock();
+
+    unsigned long tileCount, hits, misses;
+    m_cache->getCounts(&tileCount, &hits, &misses);
+
+    char bounds[64];
+    if (hasBounds) sprintf(bounds, "%lld,\"lastTime\":%lld", firstTime, lastTime);
+    else strcpy(bounds, "null,\"lastTime\":null");
+
+    char startDate[16];
+    int yyyy, mm, dd;
+    if (m_state->getStartDate(&yyyy, &mm, &dd)) sprintf(startDate, "\"%04d-%02d-%02d\"", yyyy, mm, dd);
+    else strcpy(startDate, "null");
+
+    char text[512];
+    sprintf(text, "{\"firstTime\":%s,\"startDate\":%s,\"points\":%lu,"
+            "\"tileWidth\":%d,\"tileHeight\":%d,\"baseSlice\":%lld,\"maxZoom\":%d,"
+            "\"cachedTiles\":%lu,\"hits\":%lu,\"misses\":%lu,\"requests\":%lu}\n",
+            bounds, startDate, pointCount, TILE_WIDTH, m_tileHeight, (long long)TILE_BASE_SLICE, TILE_MAX_ZOOM,
+            tileCount, hits, misses, requestCount());
+    appendText(body, text);
+}
+
+void TileServer::occurrencesJson(UvdTime firstTime, UvdTime lastTime, std::vector<char> *body)
+{
+    std::vector<OccurrenceRecord> records;
+    m_state->lock();
+    std::vector<OccurrenceRecord> *occurrences = m_state->occurrences();
+    for (size_t i = 0; i < occurrences->size(); i++)
+    {
+        const OccurrenceRecord &record = (*occurrences)[i];
+        if (record.lastTime >= firstTime && record.firstTime <= lastTime) records.push_back(record);
+    }
+    m_state->unlock();
+
+    appendText(body, "[");
+    for (size_t i = 0; i < records.size(); i++)
+    {
+        char text[128];
+        sprintf(text, "%s{\"tail\":%d,\"firstTime\":%lld,\"lastTime\":%lld}", i > 0 ? ",\n" : "\n",
+                records[i].tailNumber, records[i].firstTime, records[i].lastTime);
+        appendText(body, text);
+    }
+    appendText(body, "\n]\n");
+}
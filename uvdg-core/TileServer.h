@@ -0,0 +1,58 @@
+#ifndef __TILESERVER_H__
+#define __TILESERVER_H__
+
+#include <vector>
+#include "Mutex.h"
+#include "Socket.h"
+#include "Thread.h"
+#include "TileCache.h"
+#include "UvdState.h"
+
+#define HTTP_REQUEST_SIZE 8192
+#define HTTP_TIMEOUT_MS 10000
+#define TILE_SERVER_THREADS 16
+
+// Embedded HTTP/1.1 server of a state for browsers, on blocking sockets, a
+// connection per worker thread and keep-alive:
+//   /                          a page scrolling the latest tiles
+//   /status                    JSON of the time bounds and the tile layout
+//   /tile/ZOOM/X.png?FILTER    the tile from X * tile time width, PNG with
+//                              an ETag, 304 to a matching If-None-Match
+//   /occurrences?from=T&to=T   JSON of the occurrences overlapping T..T
+// Times are on the state clock, in microseconds. FILTER is any of conf4=1,
+// minamp, minalt, maxalt, minfuel, maxfuel, tail and highlight.
+class TileServer
+{
+    UvdState *m_state;
+    TileCache *m_cache;
+    int m_tileHeight;
+
+    int m_port;
+    Socket m_listener;
+    std::vector<Thread> m_threads;
+    volatile bool m_isStopping;
+
+    unsigned long m_requestCount;
+    Mutex m_lock;
+
+    static void workerThread(void *context);
+
+    void serveConnection(Socket socket, TileRenderer *renderer);
+    bool respond(Socket socket, char *request, TileRenderer *renderer);
+    bool sendResponse(Socket socket, const char *status, const char *contentType, const char *headers,
+                      const void *body, size_t bodySize, bool isHead);
+    void statusJson(std::vector<char> *body);
+    void occurrencesJson(UvdTime firstTime, UvdTime lastTime, std::vector<char> *body);
+    bool parseTileKey(const char *path, const char *query, TileKey *key);
+
+public:
+    TileServer(UvdState *state, TileCache *cache, int tileHeight);
+    ~TileServer();
+
+    bool start(int port, int threadCount);
+    void stop();
+
+    unsigned long requestCount();
+};
+
+#endif
@@ -0,0 +1,133 @@
+#include "TrackAssociator.h"
+#include <algorithm>
+#include <stdlib.h>
+
+static bool trackIsBefore(const Track &track, int tailNumber)
+{
+    return track.tailNumber < tailNumber;
+}
+
+TrackAssociator::TrackAssociator()
+{
+    m_tracks.reserve(TRACK_RESERVE);
+    m_nextExpiryTime = -1;
+}
+
+void TrackAssociator::k1Seen(const K1 &k1)
+{
+    std::vector<Track>::iterator track = std::lower_bound(m_tracks.begin(), m_tracks.end(), k1.tailNumber, trackIsBefore);
+    if (track == m_tracks.end() || track->tailNumber != k1.tailNumber)
+    {
+        Track newTrack;
+        newTrack.tailNumber = k1.tailNumber;
+        newTrack.k1Time = k1.ri.time;
+        newTrack.amplitude = k1.ri.amplitude;
+        newTrack.alt = 0;
+        newTrack.altTime = -1;
+        newTrack.confirmations = 0;
+        m_tracks.insert(track, newTrack);
+
+        if (m_nextExpiryTime < 0) m_nextExpiryTime = k1.ri.time + TRACK_LIFETIME;
+    }
+    else
+    {
+        track->k1Time = k1.ri.time;
+        track->amplitude = (3 * track->amplitude + k1.ri.amplitude + 2) / 4;
+    }
+}
+
+int TrackAssociator::associate(const K2 &k2)
+{
+    Track *best = NULL;
+    double bestScore = 0.0;
+    double secondScore = 0.0;
+    bool isBestContinuous = false;
+    bool isBestInBurst = false;
+
+    for (size_t i = 0; i < m_tracks.size(); i++)
+    {
+        Track *track = &m_tracks[i];
+
+        UvdTime k1Age = k2.ri.time - track->k1Time;
+        if (k1Age < 0) k1Age = -k1Age;
+        if (k1Age > ASSOCIATION_WINDOW) continue;
+
+        int amplitudeDifference = abs(k2.ri.amplitude - track->amplitude);
+        if (amplitudeDifference > ASSOCIATION_AMPLITUDE_TOLERANCE) continue;
+
+        // each term is 0 for a perfect fit and 1 at the limit, a reply
+        // in the burst of the track's last K1 has no timing cost
+        double score = (double)amplitudeDifference / ASSOCIATION_AMPLITUDE_TOLERANCE;
+        if (k1Age > ASSOCIATION_BURST) score += 0.5 + 0.5 * k1Age / ASSOCIATION_WINDOW;
+
+        bool isContinuous = false;
+        if (track->altTime >= 0 && k2.ri.time - track->altTime < ASSOCIATION_ALTITUDE_MEMORY)
+        {
+            double allowed = ASSOCIATION_ALTITUDE_SLACK + ASSOCIATION_CLIMB_RATE * UvdTimeSeconds(k2.ri.time - track->altTime);
+            int altDifference = abs(k2.alt - track->alt);
+            isContinuous = altDifference <= allowed;
+            if (!isContinuous && track->confirmations >= ASSOCIATION_CONFIRMATIONS) continue;
+            score += isContinuous ? altDifference / allowed : 1.0;
+        }
+        else
+        {
+            // nothing to confirm it, as good as the worst continuous fit
+            score += 1.0;
+        }
+
+        // outside a burst only a confirmed altitude tells aircraft apart
+        bool isInBurst = k1Age <= ASSOCIATION_BURST;
+        if (!isInBurst && !(isContinuous && track->confirmations >= ASSOCIATION_CONFIRMATIONS)) continue;
+
+        if (best == NULL || score < bestScore)
+        {
+            secondScore = best != NULL ? bestScore : score + ASSOCIATION_MARGIN;
+            best = track;
+            bestScore = score;
+            isBestContinuous = isContinuous;
+            isBestInBurst = isInBurst;
+        }
+        else if (score < secondScore)
+        {
+            secondScore = score;
+        }
+    }
+
+    if (best == NULL || secondScore - bestScore < ASSOCIATION_MARGIN) return 0;
+
+    // the track learns only from clear associations, so one that was
+    // barely right doesn't lead the next ones astray
+    if (isBestInBurst || secondScore - bestScore >= 2 * ASSOCIATION_MARGIN)
+    {
+        // an altitude that broke a tentative one starts over
+        best->confirmations = isBestContinuous ? best->confirmations + 1 : 1;
+        best->alt = k2.alt;
+        best->altTime = k2.ri.time;
+        best->amplitude = (3 * best->amplitude + k2.ri.amplitude + 2) / 4;
+    }
+    return best->tailNumber;
+}
+
+void TrackAssociator::expire(UvdTime currentTime)
+{
+    if (m_nextExpiryTime < 0 || currentTime < m_nextExpiryTime) return;
+
+    // rare, in place so the table keeps its capacity
+    size_t writeIndex = 0;
+    m_nextExpiryTime = -1;
+    for (size_t i = 0; i < m_tracks.size(); i++)
+    {
+        UvdTime expiryTime = m_tracks[i].k1Time + TRACK_LIFETIME;
+        if (expiryTime < currentTime) continue;
+
+        m_tracks[writeIndex++] = m_tracks[i];
+        if (m_nextExpiryTime < 0 || expiryTime < m_nextExpiryTime) m_nextExpiryTime = expiryTime;
+    }
+    m_tracks.resize(writeIndex);
+}
+
+void TrackAssociator::clear()
+{
+    m_tracks.clear();
+    m_nextExpiryTime = -1;
+}
@@ -0,0 +1,52 @@
+#ifndef __TRACKASSOCIATOR_H__
+#define __TRACKASSOCIATOR_H__
+
+#include <vector>
+#include "UvdRecords.h"
+
+#define TRACK_RESERVE 256
+#define TRACK_LIFETIME (100 * UVD_SECOND)
+#define ASSOCIATION_WINDOW (20 * UVD_SECOND)
+#define ASSOCIATION_BURST (UVD_SECOND / 10)
+#define ASSOCIATION_AMPLITUDE_TOLERANCE 16
+#define ASSOCIATION_CLIMB_RATE 25.0
+#define ASSOCIATION_ALTITUDE_SLACK 50.0
+#define ASSOCIATION_ALTITUDE_MEMORY (60 * UVD_SECOND)
+#define ASSOCIATION_CONFIRMATIONS 3
+#define ASSOCIATION_MARGIN 0.5
+
+typedef struct {
+    int tailNumber;
+    UvdTime k1Time;             // last K1 reply
+    int amplitude;              // smoothed level of its replies
+    int alt;                    // last associated altitude
+    UvdTime altTime;            // -1 = none associated yet
+    int confirmations;          // consecutive continuous altitudes
+} Track;
+
+// Streaming association of K2 replies (altitude and fuel, no identity)
+// with the aircraft whose K1 replies (tail number) were heard recently.
+// A K2 reply goes to the track it fits best by timing (an interrogation
+// burst gets K1 and K2 replies of an aircraft within milliseconds),
+// amplitude (the replies of one transponder arrive at about the same
+// level) and altitude continuity (no faster than ASSOCIATION_CLIMB_RATE
+// m/s once ASSOCIATION_CONFIRMATIONS altitudes agreed), and to none when
+// no track fits or two fit about as well. Runs on the ingest thread.
+class TrackAssociator
+{
+    friend class UvdSnapshot;
+
+    std::vector<Track> m_tracks;        // by tail number
+    UvdTime m_nextExpiryTime;
+
+public:
+    TrackAssociator();
+
+    void k1Seen(const K1 &k1);
+    // the tail number of the point's track, 0 = none
+    int associate(const K2 &k2);
+    void expire(UvdTime currentTime);
+    void clear();
+};
+
+#endif
@@ -0,0 +1,367 @@
+
+#include "UvdBitmapGenerator.h"
+#include "SpanRecorder.h"
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+static bool pointIsBefore(const K2 &point, UvdTime time)
+{
+    return point.ri.time < time;
+}
+
+// rounds towards minus infinity, the view may start before the state clock
+static long long floorDivide(UvdTime time, UvdTime period)
+{
+    return time >= 0 ? time / period : -((-time + period - 1) / period);
+}
+
+UvdBitmapGenerator::UvdBitmapGenerator(UvdState *state)
+{
+    m_state = state;
+    m_bitmap = NULL;
+    m_stripFirstRow = 0;
+    m_stripRowCount = 0;
+    
+    PointIndex::defaultFilter(&m_filter);
+    m_highlightTailNumber = 0;
+    m_boldThreshold = 100;
+    
+    m_isIndexingPoints = false;
+    m_cellColumns = 0;
+    m_cellRows = 0;
+    m_leftTime = 0;
+    m_timeSlice = UVD_SECOND;
+    
+    MutexCreate(&m_lock);
+}
+
+UvdBitmapGenerator::~UvdBitmapGenerator()
+{
+}
+
+void UvdBitmapGenerator::setBitmap(unsigned char *bitmap, int width, int height)
+{
+    m_bitmap = bitmap;
+    m_bitmapWidth = width;
+    m_bitmapHeight = height;
+    m_stripFirstRow = 0;
+    m_stripRowCount = height;
+}
+
+void UvdBitmapGenerator::update(UvdTime leftTime, UvdTime rightTime, UvdTime firstTime, UvdTime lastTime, UvdTime timeSlice)
+{
+    TRACE_SPAN("UvdBitmapGenerator::update");
+
+    if (m_bitmap == NULL) return;
+    
+    memset(m_bitmap, 0, (size_t)m_bitmapWidth * m_stripRowCount * 4);
+    
+    m_leftTime = leftTime;
+    m_timeSlice = timeSlice;
+    m_cellColumns = 0;
+    m_cellRows = 0;
+    m_columns.clear();
+    if (m_isIndexingPoints && m_stripRowCount == m_bitmapHeight)
+    {
+        m_cellColumns = (m_bitmapWidth + HOVER_CELL_SIZE - 1) / HOVER_CELL_SIZE;
+        m_cellRows = (m_bitmapHeight + HOVER_CELL_SIZE - 1) / HOVER_CELL_SIZE;
+        m_cells.assign((size_t)m_cellColumns * m_cellRows * HOVER_CELL_SIZE * HOVER_CELL_SIZE, UINT_MAX);
+        
+        ColumnStats empty = { 0, INT_MAX, INT_MIN };
+        m_columns.assign(m_bitmapWidth, empty);
+    }
+    
+    bool havePointsInViewport = true;
+    if (lastTime <= leftTime || firstTime >= rightTime)
+    {
+//        printf("no points in viewport.\n");
+        havePointsInViewport = false;
+    }
+    
+    UvdTime timeOffset = leftTime;
+    UvdTime endTime = timeOffset + m_bitmapWidth * timeSlice;
+    
+    for (int i = 0; i < m_bitmapWidth; i++)
+    {
+        // computed per column, not accumulated, so boundaries don't drift
+        UvdTime prevTime = timeOffset + i * timeSlice;
+        UvdTime time = prevTime + timeSlice;
+        
+        if (floorDivide(prevTime, UVD_DAY) != floorDivide(time, UVD_DAY))
+        {
+            for (int j = m_stripFirstRow; j < m_stripFirstRow + m_stripRowCount; j++)
+            {
+                putPixel(i, j, 0x7f, 0x7f, 0x7f);
+            }
+        }
+        else if (floorDivide(prevTime, UVD_HOUR) != floorDivide(time, UVD_HOUR))
+        {
+            for (int j = m_stripFirstRow; j < m_stripFirstRow + m_stripRowCount; j++)
+            {
+                if (j % 3 != 0) continue;
+                putPixel(i, j, 0x7f, 0x7f, 0x7f);
+            }
+        }
+    }
+    
+    if (!havePointsInViewport) return;
+    
+    m_state->lock();
+    ChunkedVector<K2> *points = m_state->points();
+    
+    // visible points are a range of the time ordered store, blocks of it
+    // that can't pass the filter are skipped without touching their points
+    size_t startIndex = std::lower_bound(points->begin(), points->end(), timeOffset, pointIsBefore) - points->begin();
+    size_t endIndex = std::lower_bound(points->begin() + startIndex, points->end(), endTime, pointIsBefore) - points->begin();
+    
+    PointFilter filter = m_filter;
+    if (m_stripRowCount < m_bitmapHeight)
+    {
+        // a strip only shows an altitude band (a row wider for the bold
+        // pixel above a point and the rounding), other blocks are skipped
+        float rowAltitude = MAX_ALTITUDE / (m_bitmapHeight - 1);
+        int minAltitude = (int)(MAX_ALTITUDE - (m_stripFirstRow + m_stripRowCount + 1) * rowAltitude) - 1;
+        int maxAltitude = (int)(MAX_ALTITUDE - (m_stripFirstRow - 1) * rowAltitude) + 1;
+        if (m_stripFirstRow == 0) maxAltitude = INT_MAX;
+        if (m_stripFirstRow + m_stripRowCount == m_bitmapHeight) minAltitude = INT_MIN;
+        
+        if (minAltitude > filter.minAltitude) filter.minAltitude = minAltitude;
+        if (maxAltitude < filter.maxAltitude) filter.maxAltitude = maxAltitude;
+    }
+    
+    if (m_highlightTailNumber == 0)
+    {
+        drawPoints(startIndex, endIndex, &filter, timeOffset, timeSlice, false, true);
+    }
+    else
+    {
+        // everything dimmed, then the highlighted track over it (its
+        // points were counted in the columns with the others)
+        PointFilter trackFilter = filter;
+        trackFilter.tailNumber = m_highlightTailNumber;
+        drawPoints(startIndex, endIndex, &filter, timeOffset, timeSlice, true, true);
+        drawPoints(startIndex, endIndex, &trackFilter, timeOffset, timeSlice, false, false);
+    }
+    
+    m_state->unlock();
+}
+
+// with the state locked
+void UvdBitmapGenerator::drawPoints(size_t startIndex, size_t endIndex, PointFilter *filter, UvdTime timeOffset, UvdTime timeSlice, bool isDimmed, bool isCounted)
+{
+    ChunkedVector<K2> *points = m_state->points();
+    PointIndex *pointIndex = m_state->pointIndex();
+    
+    int i = 0;
+    UvdTime columnEndTime = timeOffset;
+    
+    if (filter->tailNumber != 0)
+    {
+        // a single track is drawn from its own list
+        TrackCursor cursor;
+        size_t index = pointIndex->firstTrackPoint(filter->tailNumber, startIndex, endIndex, points, &cursor);
+        for (; index < endIndex; index = pointIndex->nextTrackPoint(&cursor, endIndex))
+        {
+            K2 point = (*points)[index];
+            if (!PointIndex::pointPasses(point, filter)) continue;
+            
+            if (point.ri.time >= columnEndTime)
+            {
+                i = (int)((point.ri.time - timeOffset) / timeSlice);
+                columnEndTime = timeOffset + (i + 1) * timeSlice;
+            }
+            
+            drawPoint(point, i, isDimmed);
+            if (m_cellColumns > 0) indexPoint(point, index, i, isCounted);
+        }
+        return;
+    }
+    
+    size_t index = pointIndex->nextCandidate(startIndex, endIndex, filter);
+    while (index < endIndex)
+    {
+        size_t blockEnd = PointIndex::blockEnd(index);
+        if (blockEnd > endIndex) blockEnd = endIndex;
+        
+        bool testsPoints = !pointIndex->blockPassesWhole(index, filter);
+        for (; index < blockEnd; index++)
+        {
+            K2 point = (*points)[index];
+            if (testsPoints && !PointIndex::pointPasses(point, filter)) continue;
+            
+            if (point.ri.time >= columnEndTime)
+            {
+                i = (int)((point.ri.time - timeOffset) / timeSlice);
+                columnEndTime = timeOffset + (i + 1) * timeSlice;
+            }
+            
+            drawPoint(point, i, isDimmed);
+            if (m_cellColumns > 0) indexPoint(point, index, i, isCounted);
+        }
+        
+        index = pointIndex->nextCandidate(index, endIndex, filter);
+    }
+}
+
+void UvdBitmapGenerator::drawPoint(const K2 &point, int i, bool isDimmed)
+{
+    float normAlt = point.alt / MAX_ALTITUDE;
+    float y = (1.0 - normAlt) * (m_bitmapHeight - 1);
+    
+    unsigned char colorR, colorG, colorB;
+    if (point.fuel == 0)
+    {
+        colorR = 0x7f;
+        colorG = 0x7f;
+        colorB = 0xff;
+    }
+    else
+    {
+        colorR = 0xff;
+        colorG = 255 * (point.fuel / 100.0f);
+        colorB = 255 * (point.fuel / 100.0f);
+    }
+    
+    if (isDimmed)
+    {
+        colorR /= 3;
+        colorG /= 3;
+        colorB /= 3;
+    }
+    
+    putPixel(i, y, colorR, colorG, colorB);
+    if (point.ri.amplitude > m_boldThreshold)
+    {
+        putPixel(i, y - 1, colorR, colorG, colorB);
+    }
+}
+
+// the pixel drawPoint puts point at, false if it is outside the bitmap
+bool UvdBitmapGenerator::pixelForPoint(const K2 &point, int *x, int *y)
+{
+    float normAlt = point.alt / MAX_ALTITUDE;
+    *x = (int)((point.ri.time - m_leftTime) / m_timeSlice);
+    *y = (int)((1.0 - normAlt) * (m_bitmapHeight - 1));
+    
+    return *x >= 0 && *x < m_bitmapWidth && *y >= 0 && *y < m_bitmapHeight;
+}
+
+void UvdBitmapGenerator::indexPoint(const K2 &point, size_t index, int i, bool isCounted)
+{
+    if (i < 0 || i >= m_bitmapWidth) return;
+    
+    if (isCounted)
+    {
+        ColumnStats *column = &m_columns[i];
+        column->count++;
+        if (point.alt < column->minAltitude) column->minAltitude = point.alt;
+        if (point.alt > column->maxAltitude) column->maxAltitude = point.alt;
+    }
+    
+    int x, y;
+    if (!pixelForPoint(point, &x, &y)) return;
+    
+    // the last drawn is the one on top; points at other pixels of the cell
+    // keep their slots, any of them may be the nearest to the cursor
+    m_cells[cellSlot(x, y)] = (unsigned int)index;
+}
+
+// the slot of pixel x, y, the pixels of a cell are kept together so a
+// lookup reads one run per cell
+size_t UvdBitmapGenerator::cellSlot(int x, int y)
+{
+    size_t cell = (size_t)(y / HOVER_CELL_SIZE) * m_cellColumns + x / HOVER_CELL_SIZE;
+    return cell * HOVER_CELL_SIZE * HOVER_CELL_SIZE + (y % HOVER_CELL_SIZE) * HOVER_CELL_SIZE + x % HOVER_CELL_SIZE;
+}
+
+bool UvdBitmapGenerator::nearestPoint(int x, int y, K2 *point, int *pointX, int *pointY)
+{
+    if (m_cellColumns == 0) return false;
+    
+    int cellX = x / HOVER_CELL_SIZE;
+    int cellY = y / HOVER_CELL_SIZE;
+    int cellRadius = (HOVER_RADIUS + HOVER_CELL_SIZE - 1) / HOVER_CELL_SIZE;
+    int bestDistance = HOVER_RADIUS * HOVER_RADIUS + 1;
+    
+    m_state->lock();
+    ChunkedVector<K2> *points = m_state->points();
+    
+    for (int row = cellY - cellRadius; row <= cellY + cellRadius; row++)
+    {
+        if (row < 0 || row >= m_cellRows) continue;
+        
+        for (int column = cellX - cellRadius; column <= cellX + cellRadius; column++)
+        {
+            if (column < 0 || column >= m_cellColumns) continue;
+            
+            size_t firstSlot = cellSlot(column * HOVER_CELL_SIZE, row * HOVER_CELL_SIZE);
+            for (int slot = 0; slot < HOVER_CELL_SIZE * HOVER_CELL_SIZE; slot++)
+            {
+                unsigned int index = m_cells[firstSlot + slot];
+                if (index == UINT_MAX || index >= points->size()) continue;
+                
+                // points rewritten since the update (a merge, retention) have
+                // moved, the slot no longer holds them
+                K2 candidate = (*points)[index];
+                int candidateX, candidateY;
+                if (!pixelForPoint(candidate, &candidateX, &candidateY)) continue;
+                if (cellSlot(candidateX, candidateY) != firstSlot + slot) continue;
+                
+                int distance = (candidateX - x) * (candidateX - x) + (candidateY - y) * (candidateY - y);
+                if (distance < bestDistance)
+                {
+                    bestDistance = distance;
+                    *point = candidate;
+                    *pointX = candidateX;
+                    *pointY = candidateY;
+                }
+            }
+        }
+    }
+    
+    m_state->unlock();
+    
+    return bestDistance <= HOVER_RADIUS * HOVER_RADIUS;
+}
+
+bool UvdBitmapGenerator::getColumnStats(int x, ColumnStats *stats)
+{
+    if (x < 0 || x >= (int)m_columns.size()) return false;
+    
+    *stats = m_columns[x];
+    return stats->count > 0;
+}
+
+void UvdBitmapGenerator::putPixel(int x, int y, unsigned char r, unsigned char g, unsigned char b)
+{
+    if (x < 0 || x >= m_bitmapWidth) return;
+    if (y < 0 || y >= m_bitmapHeight) return;
+    
+    y -= m_stripFirstRow;
+    if (y < 0 || y >= m_stripRowCount) return;
+    
+    size_t pixelIndex = ((size_t)x + (size_t)y * m_bitmapWidth) * 4;
+    
+#ifndef BITMAP_BGR
+    m_bitmap[pixelIndex] = r;
+    m_bitmap[pixelIndex + 1] = g;
+    m_bitmap[pixelIndex + 2] = b;
+#else
+    m_bitmap[pixelIndex] = b;
+    m_bitmap[pixelIndex + 1] = g;
+    m_bitmap[pixelIndex + 2] = r;
+#endif
+    m_bitmap[pixelIndex + 3] = 0xff;
+}
+
+void UvdBitmapGenerator::lock()
+{
+    MutexLock(&m_lock);
+}
+
+void UvdBitmapGenerator::unlock()
+{
+    MutexUnlock(&m_lock);
+}
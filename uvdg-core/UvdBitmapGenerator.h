@@ -0,0 +1,97 @@
+
+#ifndef __UVDBITMAPGENERATOR_H__
+#define __UVDBITMAPGENERATOR_H__
+
+#include <vector>
+#include "UvdState.h"
+#include "Mutex.h"
+
+#define MAX_ALTITUDE 11000.0f
+#define HOVER_CELL_SIZE 4           // pixels per side of a cell of the point grid
+#define HOVER_RADIUS 8              // pixels from the cursor a point is found at
+
+// the points plotted in one column of the last update
+typedef struct {
+    int count;
+    int minAltitude, maxAltitude;
+} ColumnStats;
+
+#ifdef _MSC_VER
+#define BITMAP_BGR
+#endif
+
+class UvdBitmapGenerator
+{
+    UvdState *m_state;
+    
+    unsigned char *m_bitmap;
+    int m_bitmapWidth;
+    int m_bitmapHeight;
+    int m_stripFirstRow;            // the bitmap holds only these rows
+    int m_stripRowCount;
+    
+    PointFilter m_filter;
+    int m_highlightTailNumber;
+    int m_boldThreshold;
+    
+    // what the last update plotted, for hover inspection: a grid of cells of
+    // HOVER_CELL_SIZE pixels, each a run of HOVER_CELL_SIZE^2 slots holding
+    // the index of the last point drawn at every pixel of the cell, and
+    // stats per column
+    bool m_isIndexingPoints;
+    std::vector<unsigned int> m_cells;
+    int m_cellColumns, m_cellRows;
+    std::vector<ColumnStats> m_columns;
+    UvdTime m_leftTime, m_timeSlice;
+    
+    Mutex m_lock;
+    
+    void drawPoints(size_t startIndex, size_t endIndex, PointFilter *filter, UvdTime timeOffset, UvdTime timeSlice, bool isDimmed, bool isCounted);
+    void drawPoint(const K2 &point, int i, bool isDimmed);
+    void indexPoint(const K2 &point, size_t index, int i, bool isCounted);
+    bool pixelForPoint(const K2 &point, int *x, int *y);
+    size_t cellSlot(int x, int y);
+    void putPixel(int x, int y, unsigned char r, unsigned char g, unsigned char b);
+    
+public:
+    UvdBitmapGenerator(UvdState *state);
+    ~UvdBitmapGenerator();
+    
+    // column i shows the points with
+    // leftTime + i * timeSlice <= time < leftTime + (i + 1) * timeSlice
+    void update(UvdTime leftTime, UvdTime rightTime, UvdTime firstTime, UvdTime lastTime, UvdTime timeSlice);
+    
+    void setBitmap(unsigned char *bitmap, int width, int height);
+    unsigned char *bitmap() { return m_bitmap; }
+    
+    // rows firstRow.. of a height tall image, the bitmap holds rowCount
+    // rows (setBitmap resets it to the whole image)
+    void setStrip(int firstRow, int rowCount) { m_stripFirstRow = firstRow; m_stripRowCount = rowCount; }
+    
+    // only points passing the filter are drawn
+    void setFilter(PointFilter *filter) { m_filter = *filter; }
+    void getFilter(PointFilter *filter) { *filter = m_filter; }
+    void setConfidence4Only(bool flag) { m_filter.isConfidence4Only = flag; }
+    bool isConfidence4Only() { return m_filter.isConfidence4Only; }
+    
+    // the points of other tracks are dimmed, 0 = none
+    void setHighlightTailNumber(int tailNumber) { m_highlightTailNumber = tailNumber; }
+    int highlightTailNumber() { return m_highlightTailNumber; }
+    
+    void setBoldThreshold(int threshold) { m_boldThreshold = threshold; }
+    int boldThreshold() { return m_boldThreshold; }
+    
+    // for a view that inspects the points under the mouse, off by default;
+    // strips aren't indexed
+    void setIndexesPoints(bool flag) { m_isIndexingPoints = flag; }
+    // the plotted point nearest to pixel x, y within HOVER_RADIUS, looked up
+    // in the slots of a square of cells around it whatever the points drawn;
+    // of the points sharing a pixel the one on top is shown
+    bool nearestPoint(int x, int y, K2 *point, int *pointX, int *pointY);
+    bool getColumnStats(int x, ColumnStats *stats);
+    
+    void lock();
+    void unlock();
+};
+
+#endif
@@ -0,0 +1,419 @@
+#include "UvdImageExporter.h"
+#include "RtlUvdIndex.h"
+#include "SpanRecorder.h"
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define GLYPH_WIDTH 5
+#define GLYPH_HEIGHT 7
+#define GLYPH_ADVANCE 6
+
+// 5x7 glyphs of what labels use, a row per byte from the top, bit 4 leftmost
+static const char glyphChars[] = "0123456789:-+";
+static const unsigned char glyphRows[][GLYPH_HEIGHT] = {
+    { 0x0e, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0e },
+    { 0x04, 0x0c, 0x04, 0x04, 0x04, 0x04, 0x0e },
+    { 0x0e, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1f },
+    { 0x1f, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0e },
+    { 0x02, 0x06, 0x0a, 0x12, 0x1f, 0x02, 0x02 },
+    { 0x1f, 0x10, 0x1e, 0x01, 0x01, 0x11, 0x0e },
+    { 0x06, 0x08, 0x10, 0x1e, 0x11, 0x11, 0x0e },
+    { 0x1f, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08 },
+    { 0x0e, 0x11, 0x11, 0x0e, 0x11, 0x11, 0x0e },
+    { 0x0e, 0x11, 0x11, 0x0f, 0x01, 0x02, 0x0c },
+    { 0x00, 0x0c, 0x0c, 0x00, 0x0c, 0x0c, 0x00 },
+    { 0x00, 0x00, 0x00, 0x1f, 0x00, 0x00, 0x00 },
+    { 0x00, 0x04, 0x04, 0x1f, 0x04, 0x04, 0x00 },
+};
+
+// label intervals, the first that leaves EXPORT_LABEL_SPACING between them
+static const UvdTime labelIntervals[] = {
+    60 * UVD_SECOND, 5 * 60 * UVD_SECOND, 15 * 60 * UVD_SECOND, 30 * 60 * UVD_SECOND,
+    UVD_HOUR, 3 * UVD_HOUR, 6 * UVD_HOUR, 12 * UVD_HOUR, UVD_DAY
+};
+
+static bool compareFirstTime(const OccurrenceRecord &a, const OccurrenceRecord &b)
+{
+    return a.firstTime < b.firstTime;
+}
+
+UvdImageExporter::UvdImageExporter(UvdState *state)
+{
+    m_state = state;
+    m_generator = new UvdBitmapGenerator(state);
+    m_strip = NULL;
+    m_row = NULL;
+    m_width = 0;
+    m_height = 0;
+}
+
+UvdImageExporter::~UvdImageExporter()
+{
+    delete m_generator;
+}
+
+bool UvdImageExporter::exportPng(const char *path, UvdTime leftTime, UvdTime rightTime, UvdTime timeSlice, int pointsHeight)
+{
+    TRACE_SPAN("UvdImageExporter::exportPng");
+
+    if (timeSlice <= 0 || rightTime <= leftTime || pointsHeight < 2) return false;
+
+    m_leftTime = leftTime;
+    m_timeSlice = timeSlice;
+    m_width = (int)((rightTime - leftTime + timeSlice - 1) / timeSlice);
+    m_pointsHeight = pointsHeight;
+    m_height = EXPORT_AXIS_HEIGHT + pointsHeight + EXPORT_LANES_HEIGHT;
+
+    m_state->lock();
+    if (!m_state->getTimeBounds(&m_firstTime, &m_lastTime))
+    {
+        m_firstTime = -1;
+        m_lastTime = -1;
+    }
+    m_state->unlock();
+
+    m_occurrences.clear();
+    m_lastOccurrences.clear();
+    m_lanes.clear();
+
+    int windowColumns = m_width;
+    if (EXPORT_WINDOW_DURATION / timeSlice < windowColumns) windowColumns = (int)std::max(EXPORT_WINDOW_DURATION / timeSlice, (UvdTime)1);
+
+    size_t rowBytes = (size_t)windowColumns * 4;
+    m_stripRows = (int)(EXPORT_STRIP_BYTES / rowBytes);
+    if (m_stripRows < 1) m_stripRows = 1;
+    if (m_stripRows > m_height) m_stripRows = m_height;
+
+    // windows land in the spool file, a single one goes straight to the image
+    char spoolPath[1040];
+    FILE *spool = NULL;
+    if (windowColumns < m_width)
+    {
+        sprintf(spoolPath, "%s.part", path);
+        spool = fopen(spoolPath, "w+b");
+        if (spool == NULL) return false;
+    }
+
+    PngWriter writer;
+    if (!writer.open(path, m_width, m_height))
+    {
+        if (spool != NULL)
+        {
+            fclose(spool);
+            remove(spoolPath);
+        }
+        return false;
+    }
+
+    m_strip = (unsigned char *)malloc(rowBytes * m_stripRows);
+    m_row = (unsigned char *)malloc((size_t)m_width * 3);
+    bool isOk = true;
+
+    // a spooled image gets the rows above the lanes first, the lanes once
+    // every window's occurrences are known
+    int lanesFirstRow = spool != NULL ? m_height - EXPORT_LANES_HEIGHT : m_height;
+    for (m_windowFirstX = 0; m_windowFirstX < m_width && isOk; m_windowFirstX += windowColumns)
+    {
+        m_windowWidth = std::min(windowColumns, m_width - m_windowFirstX);
+        UvdTime windowLeftTime = leftTime + m_windowFirstX * timeSlice;
+        UvdTime windowRightTime = windowLeftTime + m_windowWidth * timeSlice;
+
+        // a range loaded state parses the window and drops what is behind it
+        m_state->ensureRange(windowLeftTime, windowRightTime);
+        collectOccurrences(windowLeftTime, windowRightTime);
+        if (spool == NULL) assignLanes();
+
+        isOk = renderWindow(0, lanesFirstRow, spool, &writer);
+    }
+
+    if (spool != NULL)
+    {
+        assignLanes();
+        for (m_windowFirstX = 0; m_windowFirstX < m_width && isOk; m_windowFirstX += windowColumns)
+        {
+            m_windowWidth = std::min(windowColumns, m_width - m_windowFirstX);
+            isOk = renderWindow(lanesFirstRow, m_height, spool, &writer);
+        }
+
+        for (int y = 0; y < m_height && isOk; y++)
+        {
+            if (FileSeek(spool, (long long)y * m_width * 3) != 0 || fread(m_row, 3, m_width, spool) != (size_t)m_width)
+            {
+                isOk = false;
+                break;
+            }
+            writer.writeRow(m_row);
+        }
+
+        fclose(spool);
+        remove(spoolPath);
+    }
+
+    free(m_strip);
+    m_strip = NULL;
+    free(m_row);
+    m_row = NULL;
+    m_occurrences.clear();
+    m_lastOccurrences.clear();
+    m_lanes.clear();
+
+    if (!writer.close()) return false;
+    return isOk;
+}
+
+// rows [firstRow, endRow) of the current window, to the spool or the image
+bool UvdImageExporter::renderWindow(int firstRow, int endRow, FILE *spool, PngWriter *writer)
+{
+    UvdTime windowLeftTime = m_leftTime + m_windowFirstX * m_timeSlice;
+    UvdTime windowRightTime = windowLeftTime + m_windowWidth * m_timeSlice;
+    size_t stripRowBytes = (size_t)m_windowWidth * 4;
+
+    for (m_stripFirstRow = firstRow; m_stripFirstRow < endRow; m_stripFirstRow += m_stripRows)
+    {
+        m_stripRowCount = std::min(m_stripRows, endRow - m_stripFirstRow);
+        memset(m_strip, 0, stripRowBytes * m_stripRowCount);
+
+        // the rows of the strip that show points, drawn by the generator
+        int pointsFirstRow = std::max(m_stripFirstRow, EXPORT_AXIS_HEIGHT) - EXPORT_AXIS_HEIGHT;
+        int pointsEndRow = std::min(m_stripFirstRow + m_stripRowCount, EXPORT_AXIS_HEIGHT + m_pointsHeight) - EXPORT_AXIS_HEIGHT;
+        if (pointsFirstRow < pointsEndRow)
+        {
+            unsigned char *bitmap = m_strip + (pointsFirstRow + EXPORT_AXIS_HEIGHT - m_stripFirstRow) * stripRowBytes;
+            m_generator->setBitmap(bitmap, m_windowWidth, m_pointsHeight);
+            m_generator->setStrip(pointsFirstRow, pointsEndRow - pointsFirstRow);
+            m_generator->update(windowLeftTime, windowRightTime, m_firstTime, m_lastTime, m_timeSlice);
+        }
+
+        if (m_stripFirstRow < EXPORT_AXIS_HEIGHT) drawAxis();
+        if (m_stripFirstRow + m_stripRowCount > m_height - EXPORT_LANES_HEIGHT) drawLanes();
+
+        for (int i = 0; i < m_stripRowCount; i++)
+        {
+            const unsigned char *pixel = m_strip + i * stripRowBytes;
+            for (int x = 0; x < m_windowWidth; x++, pixel += 4)
+            {
+#ifndef BITMAP_BGR
+                m_row[x * 3] = pixel[0];
+                m_row[x * 3 + 1] = pixel[1];
+                m_row[x * 3 + 2] = pixel[2];
+#else
+                m_row[x * 3] = pixel[2];
+                m_row[x * 3 + 1] = pixel[1];
+                m_row[x * 3 + 2] = pixel[0];
+#endif
+            }
+
+            if (spool == NULL)
+            {
+                writer->writeRow(m_row);
+                continue;
+            }
+
+            long long offset = ((long long)(m_stripFirstRow + i) * m_width + m_windowFirstX) * 3;
+            if (FileSeek(spool, offset) != 0 || fwrite(m_row, 3, m_windowWidth, spool) != (size_t)m_windowWidth) return false;
+        }
+    }
+    return true;
+}
+
+void UvdImageExporter::collectOccurrences(UvdTime windowLeftTime, UvdTime windowRightTime)
+{
+    // a window also holds the ones of its neighbours' margins, and a range
+    // loaded state cuts those at its edges: the pieces of one occurrence
+    // are stitched as UvdState::mergeStates does
+    m_state->lock();
+    std::vector<OccurrenceRecord> *occurrences = m_state->occurrences();
+    for (size_t i = 0; i < occurrences->size(); i++)
+    {
+        OccurrenceRecord record = (*occurrences)[i];
+        if (record.lastTime < windowLeftTime || record.firstTime >= windowRightTime) continue;
+
+        std::map<int, size_t>::iterator last = m_lastOccurrences.find(record.tailNumber);
+        if (last != m_lastOccurrences.end() && record.firstTime <= m_occurrences[last->second].lastTime + OCCURRENCE_GAP)
+        {
+            OccurrenceRecord &stitched = m_occurrences[last->second];
+            if (record.lastTime > stitched.lastTime) stitched.lastTime = record.lastTime;
+        }
+        else
+        {
+            m_lastOccurrences[record.tailNumber] = m_occurrences.size();
+            m_occurrences.push_back(record);
+        }
+    }
+    m_state->unlock();
+}
+
+void UvdImageExporter::assignLanes()
+{
+    // the first lane free at its start, as GraphView does, or none
+    std::sort(m_occurrences.begin(), m_occurrences.end(), compareFirstTime);
+    m_lastOccurrences.clear();
+
+    UvdTime laneLastTimes[EXPORT_LANE_COUNT];
+    for (int j = 0; j < EXPORT_LANE_COUNT; j++) laneLastTimes[j] = -1;
+
+    m_lanes.resize(m_occurrences.size());
+    for (size_t i = 0; i < m_occurrences.size(); i++)
+    {
+        int lane = -1;
+        for (int j = 0; j < EXPORT_LANE_COUNT; j++)
+        {
+            if (m_occurrences[i].firstTime > laneLastTimes[j])
+            {
+                laneLastTimes[j] = m_occurrences[i].lastTime;
+                lane = j;
+                break;
+            }
+        }
+        m_lanes[i] = lane;
+    }
+}
+
+void UvdImageExporter::drawAxis()
+{
+    UvdTime leftTime = m_leftTime + m_windowFirstX * m_timeSlice;
+    UvdTime rightTime = leftTime + m_windowWidth * m_timeSlice;
+
+    size_t intervalCount = sizeof(labelIntervals) / sizeof(labelIntervals[0]);
+    UvdTime interval = labelIntervals[intervalCount - 1];
+    for (size_t i = 0; i < intervalCount; i++)
+    {
+        if (labelIntervals[i] / m_timeSlice >= EXPORT_LABEL_SPACING)
+        {
+            interval = labelIntervals[i];
+            break;
+        }
+    }
+
+    // and the labels of the previous window that run into this one
+    leftTime = std::max(m_leftTime, leftTime - EXPORT_LABEL_SPACING * m_timeSlice);
+    UvdTime time = (leftTime / interval) * interval;
+    if (time < leftTime) time += interval;
+    for (; time < rightTime; time += interval)
+    {
+        int x = (int)((time - m_leftTime) / m_timeSlice);
+        fillRect(x, 0, 1, EXPORT_AXIS_HEIGHT, 0x7f, 0x7f, 0x7f);
+
+        char label[32];
+        timeLabel(time, label);
+        drawText(x + 3, (EXPORT_AXIS_HEIGHT - GLYPH_HEIGHT) / 2, label, 0xff, 0xff, 0xff);
+    }
+}
+
+void UvdImageExporter::timeLabel(UvdTime time, char *label)
+{
+    int day = (int)(time / UVD_DAY);
+    UvdTime timeOfDay = time - day * UVD_DAY;
+    if (timeOfDay != 0)
+    {
+        int minutes = (int)(timeOfDay / (60 * UVD_SECOND));
+        sprintf(label, "%02d:%02d", minutes / 60, minutes % 60);
+        return;
+    }
+
+    // midnights show the date, or the day number without a start date
+    int yyyy, mm, dd;
+    if (m_state->getStartDate(&yyyy, &mm, &dd))
+    {
+        UvdState::dateForDayNumber(UvdState::dayNumber(yyyy, mm, dd) + day, &yyyy, &mm, &dd);
+        sprintf(label, "%04d-%02d-%02d", yyyy, mm, dd);
+    }
+    else
+    {
+        sprintf(label, "+%d", day);
+    }
+}
+
+void UvdImageExporter::drawLanes()
+{
+    for (size_t i = 0; i < m_occurrences.size(); i++)
+    {
+        if (m_lanes[i] < 0) continue;
+
+        const OccurrenceRecord &record = m_occurrences[i];
+        int firstX = (int)floor((double)(record.firstTime - m_leftTime) / m_timeSlice);
+        int lastX = (int)ceil((double)(record.lastTime - m_leftTime) / m_timeSlice);
+        if (lastX <= firstX) lastX = firstX + 1;
+        int top = m_height - (m_lanes[i] + 1) * EXPORT_LANE_HEIGHT - 1;
+
+        // GraphView's translucent yellow over black
+        fillRect(firstX, top, lastX - firstX, EXPORT_LANE_HEIGHT, 50, 50, 0);
+        fillRect(firstX, top, lastX - firstX, 1, 178, 178, 0);
+        fillRect(firstX, top + EXPORT_LANE_HEIGHT - 1, lastX - firstX, 1, 178, 178, 0);
+        fillRect(firstX, top, 1, EXPORT_LANE_HEIGHT, 178, 178, 0);
+        fillRect(lastX - 1, top, 1, EXPORT_LANE_HEIGHT, 178, 178, 0);
+
+        char label[16];
+        sprintf(label, "%05d", record.tailNumber);
+        int textWidth = (int)strlen(label) * GLYPH_ADVANCE - 1;
+        if (textWidth + 2 < lastX - firstX)
+        {
+            drawText(firstX + (lastX - firstX - textWidth) / 2, top + (EXPORT_LANE_HEIGHT - GLYPH_HEIGHT) / 2, label, 192, 192, 192);
+        }
+    }
+
+    // the ground
+    fillRect(0, m_height - EXPORT_LANES_HEIGHT, m_width, 1, 0xff, 0, 0);
+}
+
+void UvdImageExporter::putPixel(int x, int y, unsigned char r, unsigned char g, unsigned char b)
+{
+    x -= m_windowFirstX;
+    if (x < 0 || x >= m_windowWidth) return;
+
+    y -= m_stripFirstRow;
+    if (y < 0 || y >= m_stripRowCount) return;
+
+    unsigned char *pixel = m_strip + ((size_t)y * m_windowWidth + x) * 4;
+#ifndef BITMAP_BGR
+    pixel[0] = r;
+    pixel[1] = g;
+    pixel[2] = b;
+#else
+    pixel[0] = b;
+    pixel[1] = g;
+    pixel[2] = r;
+#endif
+    pixel[3] = 0xff;
+}
+
+void UvdImageExporter::fillRect(int x, int y, int width, int height, unsigned char r, unsigned char g, unsigned char b)
+{
+    // clipped to the strip first, lanes can be much wider than it is tall
+    int firstX = std::max(x, m_windowFirstX);
+    int endX = std::min(x + width, m_windowFirstX + m_windowWidth);
+    int firstY = std::max(y, m_stripFirstRow);
+    int endY = std::min(y + height, m_stripFirstRow + m_stripRowCount);
+
+    for (int j = firstY; j < endY; j++)
+    {
+        for (int i = firstX; i < endX; i++)
+        {
+            putPixel(i, j, r, g, b);
+        }
+    }
+}
+
+void UvdImageExporter::drawText(int x, int y, const char *text, unsigned char r, unsigned char g, unsigned char b)
+{
+    if (y + GLYPH_HEIGHT <= m_stripFirstRow || y >= m_stripFirstRow + m_stripRowCount) return;
+    if (x + (int)strlen(text) * GLYPH_ADVANCE <= m_windowFirstX || x >= m_windowFirstX + m_windowWidth) return;
+
+    for (; *text != 0; text++, x += GLYPH_ADVANCE)
+    {
+        const char *glyph = strchr(glyphChars, *text);
+        if (glyph == NULL) continue;
+
+        const unsigned char *rows = glyphRows[glyph - glyphChars];
+        for (int j = 0; j < GLYPH_HEIGHT; j++)
+        {
+            for (int i = 0; i < GLYPH_WIDTH; i++)
+            {
+                if (rows[j] & (0x10 >> i)) putPixel(x + i, y + j, r, g, b);
+            }
+        }
+    }
+}
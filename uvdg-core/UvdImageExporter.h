@@ -0,0 +1,82 @@
+#ifndef __UVDIMAGEEXPORTER_H__
+#define __UVDIMAGEEXPORTER_H__
+
+#include <stdio.h>
+#include <map>
+#include <vector>
+#include "UvdState.h"
+#include "UvdBitmapGenerator.h"
+#include "PngWriter.h"
+
+#define EXPORT_STRIP_BYTES (64 * 1024 * 1024)
+#define EXPORT_WINDOW_DURATION (12 * UVD_HOUR)
+#define EXPORT_AXIS_HEIGHT 12
+#define EXPORT_LANES_HEIGHT 76
+#define EXPORT_LANE_HEIGHT 15
+#define EXPORT_LANE_COUNT 5
+#define EXPORT_LABEL_SPACING 80
+
+// Renders a time range of a state to a PNG of any width, offscreen: the
+// time axis, the points as UvdBitmapGenerator draws them and the
+// occurrence lanes under them, as GraphView shows them. The image is
+// rendered in windows of EXPORT_WINDOW_DURATION, each pulled through
+// UvdState::ensureRange so a range loaded archive only holds the window
+// and its margins, and each drawn in strips of rows, a pass over the
+// points of their altitude band, within EXPORT_STRIP_BYTES. Windows are
+// spooled to a file next to the image and encoded row by row from it,
+// so memory doesn't grow with the width (a week at 1 s/px is 604800
+// pixels) or the archive. The lanes are assigned once, from the
+// occurrences of every window, stitched where a window's loaded range cut
+// them, and drawn in a last pass over the spool that needs no points.
+class UvdImageExporter
+{
+    UvdState *m_state;
+    UvdBitmapGenerator *m_generator;
+
+    UvdTime m_leftTime;
+    UvdTime m_timeSlice;
+    int m_width;
+    int m_height;
+    int m_pointsHeight;
+
+    UvdTime m_firstTime, m_lastTime;    // of the state's points
+
+    int m_windowFirstX;
+    int m_windowWidth;
+
+    unsigned char *m_strip;         // as UvdBitmapGenerator, 4 bytes a pixel
+    int m_stripRows;
+    int m_stripFirstRow;
+    int m_stripRowCount;
+    unsigned char *m_row;           // RGB, of the image's width
+
+    // occurrences of the exported range, and the lane of each
+    std::vector<OccurrenceRecord> m_occurrences;
+    std::map<int, size_t> m_lastOccurrences;    // by tail number, for stitching
+    std::vector<int> m_lanes;
+
+    void collectOccurrences(UvdTime windowLeftTime, UvdTime windowRightTime);
+    void assignLanes();
+    bool renderWindow(int firstRow, int endRow, FILE *spool, PngWriter *writer);
+    void drawAxis();
+    void drawLanes();
+    void putPixel(int x, int y, unsigned char r, unsigned char g, unsigned char b);
+    void fillRect(int x, int y, int width, int height, unsigned char r, unsigned char g, unsigned char b);
+    void drawText(int x, int y, const char *text, unsigned char r, unsigned char g, unsigned char b);
+    void timeLabel(UvdTime time, char *label);
+
+public:
+    UvdImageExporter(UvdState *state);
+    ~UvdImageExporter();
+
+    void setFilter(PointFilter *filter) { m_generator->setFilter(filter); }
+
+    // pointsHeight rows for the altitudes, between the axis and the lanes;
+    // false if the file can't be written
+    bool exportPng(const char *path, UvdTime leftTime, UvdTime rightTime, UvdTime timeSlice, int pointsHeight);
+
+    int width() { return m_width; }
+    int height() { return m_height; }
+};
+
+#endif
@@ -0,0 +1,124 @@
+#include "UvdOverview.h"
+#include <string.h>
+
+UvdOverview::UvdOverview()
+{
+    m_version = 0;
+    clear();
+}
+
+void UvdOverview::clear()
+{
+    m_buckets.clear();
+    m_firstBucket = 0;
+    m_width = OVERVIEW_MIN_WIDTH;
+    m_maxCount = 0;
+    m_version++;
+}
+
+int UvdOverview::bandForAltitude(int altitude)
+{
+    if (altitude < 0) return 0;
+
+    int band = altitude / OVERVIEW_BAND_ALTITUDE;
+    return band < OVERVIEW_BAND_COUNT ? band : OVERVIEW_BAND_COUNT - 1;
+}
+
+// doubles the width in place, bucket k holds what 2k and 2k + 1 held
+void UvdOverview::coarsen()
+{
+    long long firstBucket = m_firstBucket >> 1;
+    size_t count = 0;
+
+    for (size_t i = 0; i < m_buckets.size(); i++)
+    {
+        size_t target = (size_t)(((m_firstBucket + (long long)i) >> 1) - firstBucket);
+        if (target >= count)
+        {
+            m_buckets[target] = m_buckets[i];
+            count = target + 1;
+            continue;
+        }
+
+        for (int band = 0; band <= OVERVIEW_BAND_COUNT; band++)
+        {
+            unsigned int merged = m_buckets[target].counts[band] + m_buckets[i].counts[band];
+            m_buckets[target].counts[band] = merged;
+            if (merged > m_maxCount) m_maxCount = merged;
+        }
+    }
+
+    m_buckets.resize(count);
+    m_firstBucket = firstBucket;
+    m_width *= 2;
+}
+
+OverviewBucket *UvdOverview::bucketForTime(UvdTime time)
+{
+    if (time < 0) return NULL;
+
+    if (m_buckets.empty())
+    {
+        OverviewBucket empty;
+        memset(&empty, 0, sizeof(OverviewBucket));
+        m_firstBucket = time / m_width;
+        m_buckets.push_back(empty);
+        return &m_buckets[0];
+    }
+
+    // widen until the buckets from the first point to the last fit
+    while (true)
+    {
+        long long bucket = time / m_width;
+        long long firstBucket = bucket < m_firstBucket ? bucket : m_firstBucket;
+        long long lastBucket = m_firstBucket + (long long)m_buckets.size() - 1;
+        if (bucket > lastBucket) lastBucket = bucket;
+
+        if (lastBucket - firstBucket < OVERVIEW_MAX_BUCKETS) break;
+        coarsen();
+    }
+
+    OverviewBucket empty;
+    memset(&empty, 0, sizeof(OverviewBucket));
+
+    long long bucket = time / m_width;
+    if (bucket < m_firstBucket)
+    {
+        // an earlier log merged after a later one
+        m_buckets.insert(m_buckets.begin(), (size_t)(m_firstBucket - bucket), empty);
+        m_firstBucket = bucket;
+    }
+    size_t index = (size_t)(bucket - m_firstBucket);
+    if (index >= m_buckets.size()) m_buckets.resize(index + 1, empty);
+
+    return &m_buckets[index];
+}
+
+void UvdOverview::addCount(UvdTime time, int band, unsigned int count)
+{
+    OverviewBucket *bucket = bucketForTime(time);
+    if (bucket == NULL) return;
+
+    unsigned int merged = bucket->counts[band] + count;
+    bucket->counts[band] = merged;
+    if (merged > m_maxCount) m_maxCount = merged;
+    m_version++;
+}
+
+void UvdOverview::merge(UvdOverview *other)
+{
+    // widths are the minimum doubled, the finer one is widened so that
+    // every bucket of the other falls into one of these
+    while (m_width < other->m_width) coarsen();
+
+    for (size_t i = 0; i < other->m_buckets.size(); i++)
+    {
+        const OverviewBucket *source = &other->m_buckets[i];
+        UvdTime time = other->bucketTime(i);
+
+        for (int band = 0; band <= OVERVIEW_BAND_COUNT; band++)
+        {
+            if (source->counts[band] > 0) addCount(time, band, source->counts[band]);
+        }
+    }
+}
@@ -0,0 +1,60 @@
+#ifndef __UVDOVERVIEW_H__
+#define __UVDOVERVIEW_H__
+
+#include <stddef.h>
+#include <vector>
+#include "UvdTime.h"
+
+#define OVERVIEW_MAX_BUCKETS 4096
+#define OVERVIEW_MIN_WIDTH UVD_SECOND
+#define OVERVIEW_BAND_COUNT 8
+#define OVERVIEW_BAND_ALTITUDE 1500
+#define OVERVIEW_BAND_UNKNOWN OVERVIEW_BAND_COUNT     // counted without an altitude
+
+// points of a bucket by altitude band, the last slot for estimated ones
+typedef struct {
+    unsigned int counts[OVERVIEW_BAND_COUNT + 1];
+} OverviewBucket;
+
+// Coarse histogram of all the points a state has seen, for the minimap of
+// the time scroller. Buckets of one width cover the time from the first
+// point to the last; when there would be more than OVERVIEW_MAX_BUCKETS the
+// width doubles and neighbours are merged, so a point costs O(1), memory is
+// bounded and a redraw walks at most OVERVIEW_MAX_BUCKETS buckets whatever
+// the number of points. Points keep being counted when retention drops them
+// from memory, it is an overview of the session, not of what is loaded.
+class UvdOverview
+{
+    friend class UvdSnapshot;
+
+    std::vector<OverviewBucket> m_buckets;
+    long long m_firstBucket;        // time / m_width of m_buckets[0]
+    UvdTime m_width;
+    unsigned int m_maxCount;        // of one band of a bucket
+    unsigned long m_version;
+
+    void coarsen();
+    OverviewBucket *bucketForTime(UvdTime time);
+
+public:
+    UvdOverview();
+
+    // called with the state locked
+    void add(UvdTime time, int altitude) { addCount(time, bandForAltitude(altitude), 1); }
+    void addCount(UvdTime time, int band, unsigned int count);
+    void merge(UvdOverview *other);
+    void clear();
+
+    size_t bucketCount() { return m_buckets.size(); }
+    const OverviewBucket *bucket(size_t i) { return &m_buckets[i]; }
+    UvdTime bucketTime(size_t i) { return (m_firstBucket + (long long)i) * m_width; }
+    UvdTime bucketWidth() { return m_width; }
+    unsigned int maxCount() { return m_maxCount; }
+
+    // changes with every count, for caches of what was drawn
+    unsigned long version() { return m_version; }
+
+    static int bandForAltitude(int altitude);
+};
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef __UVDRECORDS_H__
+#define __UVDRECORDS_H__
+
+#include "UvdTime.h"
+
+typedef struct {
+    int hh, mm, ss, usec;
+    UvdTime time;
+    int amplitude;
+    int confidence;
+} RecvInfo;
+
+typedef struct {
+    RecvInfo ri;
+    int tailNumber;
+} K1;
+
+typedef struct {
+    RecvInfo ri;
+    int alt;
+    int fuel;
+    int tailNumber;             // of the associated K1 track, 0 = none
+} K2;
+
+typedef struct {
+    int tailNumber;
+    UvdTime firstTime;
+    UvdTime lastTime;
+} OccurrenceRecord;
+
+#endif
@@ -0,0 +1,652 @@
+#include "UvdRetention.h"
+#include "RtlUvdIndex.h"
+#include "SpanRecorder.h"
+#include "Log.h"
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef _MSC_VER
+#include <Windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+#define POINTS_MAGIC "K2PT"
+#define OCCURRENCES_MAGIC "OCCR"
+
+typedef struct {
+    char magic[4];
+    unsigned int count;
+    unsigned int recordSize;
+} RetentionBlock;
+
+typedef struct {
+    char path[1100];
+    long long size;
+    time_t modifiedTime;
+} SegmentFile;
+
+static bool pointIsBefore(const K2 &point, UvdTime time)
+{
+    return point.ri.time < time;
+}
+
+static size_t pointIndex(ChunkedVector<K2> *points, UvdTime time)
+{
+    return std::lower_bound(points->begin(), points->end(), time, pointIsBefore) - points->begin();
+}
+
+static bool occurrenceStartsBefore(const OccurrenceRecord &a, const OccurrenceRecord &b)
+{
+    return a.firstTime < b.firstTime;
+}
+
+static int segmentHour(UvdTime time)
+{
+    return (int)(time / UVD_HOUR);
+}
+
+static bool segmentIsOlder(const SegmentFile &a, const SegmentFile &b)
+{
+    return a.modifiedTime < b.modifiedTime;
+}
+
+// the segments of every session in the directory
+static void listSegments(const char *directory, std::vector<SegmentFile> *files)
+{
+    SegmentFile file;
+
+#ifdef _MSC_VER
+    char pattern[1100];
+    _snprintf(pattern, sizeof(pattern), "%s\\uvdg-*.seg", directory);
+    pattern[sizeof(pattern) - 1] = '\x00';
+
+    WIN32_FIND_DATAA findData;
+    HANDLE find = FindFirstFileA(pattern, &findData);
+    if (find == INVALID_HANDLE_VALUE) return;
+
+    do
+    {
+        if (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) continue;
+
+        _snprintf(file.path, sizeof(file.path), "%s\\%s", directory, findData.cFileName);
+        file.path[sizeof(file.path) - 1] = '\x00';
+        file.size = ((long long)findData.nFileSizeHigh << 32) | findData.nFileSizeLow;
+
+        // 100 ns intervals since 1601
+        long long writeTime = ((long long)findData.ftLastWriteTime.dwHighDateTime << 32) | findData.ftLastWriteTime.dwLowDateTime;
+        file.modifiedTime = (time_t)((writeTime - 116444736000000000LL) / 10000000);
+        files->push_back(file);
+    } while (FindNextFileA(find, &findData));
+
+    FindClose(find);
+#else
+    DIR *handle = opendir(directory);
+    if (handle == NULL) return;
+
+    struct dirent *entry;
+    while ((entry = readdir(handle)) != NULL)
+    {
+        size_t length = strlen(entry->d_name);
+        if (strncmp(entry->d_name, "uvdg-", 5) != 0 || length < 4 || strcmp(entry->d_name + length - 4, ".seg") != 0) continue;
+
+        snprintf(file.path, sizeof(file.path), "%s/%s", directory, entry->d_name);
+
+        struct stat status;
+        if (stat(file.path, &status) != 0 || !S_ISREG(status.st_mode)) continue;
+        file.size = status.st_size;
+        file.modifiedTime = status.st_mtime;
+        files->push_back(file);
+    }
+
+    closedir(handle);
+#endif
+}
+
+void UvdRetention::defaultPolicy(RetentionPolicy *policy)
+{
+    policy->fullSeconds = 6 * 3600.0;
+    policy->secondSeconds = 18 * 3600.0;
+    policy->minuteSeconds = 6 * 86400.0;
+    policy->maxPoints = 8000000;
+    policy->directory[0] = 0;
+    policy->segmentSeconds = 30 * 86400.0;
+    policy->segmentBytes = 4LL * 1024 * 1024 * 1024;
+}
+
+UvdRetention::UvdRetention(UvdState *state, RetentionPolicy *policy)
+{
+    m_state = state;
+    m_policy = *policy;
+
+    // segments of different sessions share the directory, and the state
+    // clock starts over every session
+    time_t now = time(NULL);
+    strftime(m_sessionName, sizeof(m_sessionName), "%Y%m%d-%H%M%S", localtime(&now));
+
+    m_nextCompactTime = -1;
+    m_currentTime = -1;
+    m_spilledUntil = -1;
+    m_memoryFirstTime = -1;
+    m_recallFirstTime = -1;
+    m_recallLastTime = -1;
+
+    m_spilledPoints = 0;
+    m_spilledOccurrences = 0;
+    m_droppedPoints = 0;
+
+    for (int i = 0; i < RETENTION_CELL_COUNT; i++)
+    {
+        m_summary.cells[i] = -1;
+        m_recallSummary.cells[i] = -1;
+    }
+    startSummary(&m_summary);
+    startSummary(&m_recallSummary);
+
+    if (m_policy.directory[0] == 0)
+    {
+        UvdLog("retention: no spill directory, points older than %.0f s will be dropped.\n", m_policy.fullSeconds);
+    }
+
+    m_requestFirstTime = -1;
+    m_requestLastTime = -1;
+    m_readFirstTime = -1;
+    m_readLastTime = -1;
+    m_isStopping = false;
+    MutexCreate(&m_requestLock);
+    EventCreate(&m_requestEvent);
+    ThreadCreate(&m_thread, recallThread, this);
+
+    m_state->setRetentionFunction(retentionFunction, this);
+    m_state->setRangeFunction(rangeFunction, this);
+}
+
+UvdRetention::~UvdRetention()
+{
+    m_state->setRetentionFunction(NULL, NULL);
+    m_state->setRangeFunction(NULL, NULL);
+
+    MutexLock(&m_requestLock);
+    m_isStopping = true;
+    MutexUnlock(&m_requestLock);
+
+    EventSignal(&m_requestEvent);
+    ThreadJoin(&m_thread);
+
+    EventDestroy(&m_requestEvent);
+    MutexDestroy(&m_requestLock);
+
+    UvdLog("retention: %lu points and %lu occurrences spilled, %lu points dropped.\n",
+           m_spilledPoints, m_spilledOccurrences, m_droppedPoints);
+}
+
+void UvdRetention::retentionFunction(void *context, UvdTime currentTime)
+{
+    UvdRetention *retention = (UvdRetention *)context;
+    if (currentTime < retention->m_nextCompactTime) return;
+
+    retention->m_nextCompactTime = currentTime + RETENTION_INTERVAL;
+    retention->compact(currentTime);
+}
+
+void UvdRetention::rangeFunction(void *context, UvdTime leftTime, UvdTime rightTime)
+{
+    ((UvdRetention *)context)->ensureRange(leftTime, rightTime);
+}
+
+void UvdRetention::compact(UvdTime currentTime)
+{
+    TRACE_SPAN("UvdRetention::compact");
+
+    m_state->lock();
+    m_currentTime = currentTime;
+    compactPoints();
+    compactOccurrences(m_memoryFirstTime);
+    m_state->unlock();
+}
+
+void UvdRetention::compactPoints()
+{
+    ChunkedVector<K2> *points = m_state->points();
+
+    UvdTime fullTime = m_currentTime - UvdTimeFromSeconds(m_policy.fullSeconds);
+    UvdTime secondTime = fullTime - UvdTimeFromSeconds(m_policy.secondSeconds);
+    UvdTime minuteTime = secondTime - UvdTimeFromSeconds(m_policy.minuteSeconds);
+
+    // points leave the full resolution window only once they are on disk;
+    // if the disk fails they stay as they are until the cap is reached
+    if (fullTime > m_spilledUntil)
+    {
+        if (spillPoints(pointIndex(points, m_spilledUntil), pointIndex(points, fullTime)))
+        {
+            m_spilledUntil = fullTime;
+        }
+    }
+
+    size_t endIndex = pointIndex(points, m_spilledUntil);
+    size_t writeIndex = 0;
+    UvdTime changedUntil = m_spilledUntil;
+
+    // the summaries are rewritten in place, the index follows from there
+    size_t changedIndex = endIndex > 0 ? 0 : points->size();
+
+    startSummary(&m_summary);
+    for (size_t i = 0; i < endIndex; i++)
+    {
+        K2 point = (*points)[i];
+        UvdTime time = point.ri.time;
+
+        if (time >= m_recallFirstTime && time < m_recallLastTime)
+        {
+            (*points)[writeIndex++] = point;
+        }
+        else if (time >= secondTime)
+        {
+            summarizePoint(&m_summary, points, &writeIndex, point, UVD_SECOND);
+        }
+        else if (time >= minuteTime)
+        {
+            summarizePoint(&m_summary, points, &writeIndex, point, 60 * UVD_SECOND);
+        }
+    }
+    points->erase(writeIndex, endIndex);
+
+    m_memoryFirstTime = minuteTime < m_spilledUntil ? minuteTime : m_spilledUntil;
+
+    // the cap wins over the windows: the oldest points go, to disk if
+    // they aren't there yet. A recall is a prefix of the points and has
+    // its own budget
+    size_t recallCount = m_recallLastTime >= 0 ? pointIndex(points, m_recallLastTime) : 0;
+    if (points->size() - recallCount > m_policy.maxPoints)
+    {
+        UvdTime cutTime = (*points)[points->size() - m_policy.maxPoints].ri.time;
+        size_t cutIndex = pointIndex(points, cutTime);
+
+        if (cutTime > m_spilledUntil)
+        {
+            size_t spillIndex = pointIndex(points, m_spilledUntil);
+            if (!spillPoints(spillIndex, cutIndex))
+            {
+                m_droppedPoints += cutIndex - spillIndex;
+                UvdLog("retention: memory cap reached, dropped %lu points that could not be spilled.\n",
+                       (unsigned long)(cutIndex - spillIndex));
+            }
+            m_spilledUntil = cutTime;
+        }
+
+        points->erase(recallCount, cutIndex);
+        if (recallCount < changedIndex) changedIndex = recallCount;
+        if (cutTime > changedUntil) changedUntil = cutTime;
+
+        if (cutTime > m_memoryFirstTime) m_memoryFirstTime = cutTime;
+    }
+
+    // the points after the summaries and the cut only moved
+    m_state->pointsChanged(changedIndex, UVD_TIME_MIN, changedUntil);
+}
+
+void UvdRetention::compactOccurrences(UvdTime horizonTime)
+{
+    std::vector<OccurrenceRecord> *occurrences = m_state->finalizedOccurrences();
+
+    // finalized occurrences ending before the points held in memory go to
+    // the segment of the hour they start in
+    std::vector<OccurrenceRecord> &spilled = m_spilled;
+    spilled.clear();
+    size_t writeIndex = 0;
+    for (size_t i = 0; i < occurrences->size(); i++)
+    {
+        OccurrenceRecord record = (*occurrences)[i];
+        if (record.lastTime < horizonTime)
+        {
+            spilled.push_back(record);
+        }
+        else
+        {
+            (*occurrences)[writeIndex++] = record;
+        }
+    }
+    if (spilled.size() == 0) return;
+
+    if (m_policy.directory[0] != 0)
+    {
+        std::sort(spilled.begin(), spilled.end(), occurrenceStartsBefore);
+
+        size_t runIndex = 0;
+        while (runIndex < spilled.size())
+        {
+            int hour = segmentHour(spilled[runIndex].firstTime);
+            size_t runEnd = runIndex + 1;
+            while (runEnd < spilled.size() && segmentHour(spilled[runEnd].firstTime) == hour) runEnd++;
+
+            if (appendBlock(spilled[runIndex].firstTime, OCCURRENCES_MAGIC, &spilled[runIndex], sizeof(OccurrenceRecord), runEnd - runIndex))
+            {
+                m_spilledOccurrences += runEnd - runIndex;
+            }
+            else
+            {
+                // kept in memory, they are few
+                for (size_t i = runIndex; i < runEnd; i++) (*occurrences)[writeIndex++] = spilled[i];
+            }
+            runIndex = runEnd;
+        }
+    }
+    occurrences->resize(writeIndex);
+}
+
+void UvdRetention::startSummary(RetentionSummary *summary)
+{
+    for (size_t i = 0; i < summary->touchedCells.size(); i++)
+    {
+        summary->cells[summary->touchedCells[i]] = -1;
+    }
+    summary->touchedCells.clear();
+
+    summary->bucketWidth = 0;
+    summary->bucket = -1;
+}
+
+void UvdRetention::summarizePoint(RetentionSummary *summary, ChunkedVector<K2> *points, size_t *writeIndex, K2 point, UvdTime width)
+{
+    // points are in time order, so a bucket is a run of points; one point
+    // is kept per altitude cell and confidence, the first one's time with
+    // the loudest one's values, so the summaries stay in time order
+    long long bucket = point.ri.time / width;
+    if (width != summary->bucketWidth || bucket != summary->bucket)
+    {
+        startSummary(summary);
+        summary->bucketWidth = width;
+        summary->bucket = bucket;
+    }
+
+    int cell = point.alt / RETENTION_ALTITUDE_CELL;
+    if (cell < 0) cell = 0;
+    if (cell >= RETENTION_CELL_COUNT / 2) cell = RETENTION_CELL_COUNT / 2 - 1;
+    cell = cell * 2 + (point.ri.confidence == 4);
+
+    if (summary->cells[cell] < 0)
+    {
+        summary->cells[cell] = (long)*writeIndex;
+        summary->touchedCells.push_back(cell);
+        (*points)[(*writeIndex)++] = point;
+    }
+    else
+    {
+        K2 &kept = (*points)[summary->cells[cell]];
+        if (point.ri.amplitude > kept.ri.amplitude)
+        {
+            kept.alt = point.alt;
+            kept.fuel = point.fuel;
+            kept.ri.amplitude = point.ri.amplitude;
+        }
+    }
+}
+
+bool UvdRetention::spillPoints(size_t startIndex, size_t endIndex)
+{
+    if (startIndex >= endIndex) return true;
+
+    if (m_policy.directory[0] == 0)
+    {
+        m_droppedPoints += endIndex - startIndex;
+        return true;
+    }
+
+    ChunkedVector<K2> *points = m_state->points();
+
+    size_t runIndex = startIndex;
+    while (runIndex < endIndex)
+    {
+        // a block is written from one chunk of the storage
+        size_t chunkEnd = runIndex + points->contiguousCount(runIndex);
+        if (chunkEnd > endIndex) chunkEnd = endIndex;
+
+        int hour = segmentHour((*points)[runIndex].ri.time);
+        size_t runEnd = runIndex + 1;
+        while (runEnd < chunkEnd && segmentHour((*points)[runEnd].ri.time) == hour) runEnd++;
+
+        if (!appendBlock((*points)[runIndex].ri.time, POINTS_MAGIC, &(*points)[runIndex], sizeof(K2), runEnd - runIndex))
+        {
+            // the hours before are on disk, the caller keeps the rest
+            return false;
+        }
+
+        m_spilledPoints += runEnd - runIndex;
+        runIndex = runEnd;
+    }
+
+    return true;
+}
+
+bool UvdRetention::appendBlock(UvdTime time, const char *magic, const void *records, size_t recordSize, size_t count)
+{
+    char path[1100];
+    segmentPath(segmentHour(time), path);
+
+    FILE *file = fopen(path, "ab");
+    if (file == NULL)
+    {
+        UvdLog("retention: can't open %s.\n", path);
+        return false;
+    }
+
+    RetentionBlock block;
+    memcpy(block.magic, magic, 4);
+    block.count = (unsigned int)count;
+    block.recordSize = (unsigned int)recordSize;
+
+    bool isWritten = fwrite(&block, sizeof(RetentionBlock), 1, file) == 1 &&
+                     fwrite(records, recordSize, count, file) == count;
+    if (fclose(file) != 0) isWritten = false;
+
+    if (!isWritten)
+    {
+        UvdLog("retention: can't write %s.\n", path);
+    }
+    return isWritten;
+}
+
+void UvdRetention::segmentPath(int hour, char *path)
+{
+    sprintf(path, "%s/uvdg-%s-%08d.seg", m_policy.directory, m_sessionName, hour);
+}
+
+void UvdRetention::readSegments(UvdTime firstTime, UvdTime lastTime, ChunkedVector<K2> *points, std::vector<OccurrenceRecord> *occurrences)
+{
+    int firstHour = segmentHour(firstTime);
+    int lastHour = segmentHour(lastTime);
+
+    // occurrences are filed by the hour they start in, look a few earlier
+    for (int hour = firstHour - RETENTION_OCCURRENCE_SLACK_HOURS; hour <= lastHour; hour++)
+    {
+        char path[1100];
+        segmentPath(hour, path);
+
+        FILE *file = fopen(path, "rb");
+        if (file == NULL) continue;
+
+        RetentionBlock block;
+        while (fread(&block, sizeof(RetentionBlock), 1, file) == 1)
+        {
+            if (memcmp(block.magic, POINTS_MAGIC, 4) == 0 && block.recordSize == sizeof(K2) && hour >= firstHour)
+            {
+                std::vector<K2> records(block.count);
+                if (block.count > 0 && fread(&records[0], sizeof(K2), block.count, file) != block.count) break;
+
+                for (size_t i = 0; i < records.size(); i++)
+                {
+                    if (records[i].ri.time >= firstTime && records[i].ri.time < lastTime) points->push_back(records[i]);
+                }
+            }
+            else if (memcmp(block.magic, OCCURRENCES_MAGIC, 4) == 0 && block.recordSize == sizeof(OccurrenceRecord))
+            {
+                std::vector<OccurrenceRecord> records(block.count);
+                if (block.count > 0 && fread(&records[0], sizeof(OccurrenceRecord), block.count, file) != block.count) break;
+
+                for (size_t i = 0; i < records.size(); i++)
+                {
+                    if (records[i].lastTime >= firstTime && records[i].firstTime < lastTime) occurrences->push_back(records[i]);
+                }
+            }
+            else if (FileSeek(file, FileTell(file) + (long long)block.count * block.recordSize) != 0)
+            {
+                break;
+            }
+        }
+
+        fclose(file);
+    }
+}
+
+// called on the paint path and by tile servers, so it only asks the worker
+void UvdRetention::ensureRange(UvdTime leftTime, UvdTime rightTime)
+{
+    if (m_policy.directory[0] == 0) return;
+
+    m_state->lock();
+    if (m_memoryFirstTime < 0)
+    {
+        m_state->unlock();
+        return;
+    }
+
+    if (leftTime >= m_memoryFirstTime)
+    {
+        if (m_recallLastTime >= 0)
+        {
+            // back in the range memory holds, the recall is summarized away
+            m_recallFirstTime = -1;
+            m_recallLastTime = -1;
+            m_state->recalledOccurrences()->clear();
+            compactPoints();
+        }
+        m_state->unlock();
+        return;
+    }
+
+    UvdTime lastTime = rightTime < m_memoryFirstTime ? rightTime : m_memoryFirstTime;
+    bool isRecalled = leftTime >= m_recallFirstTime && lastTime <= m_recallLastTime;
+    UvdTime memoryFirstTime = m_memoryFirstTime;
+    m_state->unlock();
+
+    if (isRecalled) return;
+
+    MutexLock(&m_requestLock);
+    bool isRequested = (leftTime >= m_requestFirstTime && lastTime <= m_requestLastTime) ||
+                       (leftTime >= m_readFirstTime && lastTime <= m_readLastTime);
+    if (!isRequested)
+    {
+        // half a view width on each side, so scrolling doesn't read every
+        // time; a newer view replaces a request not taken yet
+        UvdTime margin = (rightTime - leftTime) / 2;
+        m_requestFirstTime = leftTime - margin;
+        m_requestLastTime = lastTime + margin;
+        if (m_requestLastTime > memoryFirstTime) m_requestLastTime = memoryFirstTime;
+    }
+    MutexUnlock(&m_requestLock);
+
+    if (!isRequested) EventSignal(&m_requestEvent);
+}
+
+void UvdRetention::recallThread(void *context)
+{
+    ((UvdRetention *)context)->recallLoop();
+}
+
+void UvdRetention::recallLoop()
+{
+    if (m_policy.directory[0] != 0) pruneSegments();
+
+    while (true)
+    {
+        bool isSignaled = EventWait(&m_requestEvent, RETENTION_PRUNE_INTERVAL_MS);
+
+        MutexLock(&m_requestLock);
+        bool isStopping = m_isStopping;
+        m_readFirstTime = m_requestFirstTime;
+        m_readLastTime = m_requestLastTime;
+        m_requestFirstTime = -1;
+        m_requestLastTime = -1;
+        MutexUnlock(&m_requestLock);
+
+        if (isStopping) break;
+        if (m_policy.directory[0] == 0) continue;
+
+        if (m_readLastTime >= 0) recall(m_readFirstTime, m_readLastTime);
+        if (!isSignaled) pruneSegments();
+
+        MutexLock(&m_requestLock);
+        m_readFirstTime = -1;
+        m_readLastTime = -1;
+        MutexUnlock(&m_requestLock);
+    }
+}
+
+void UvdRetention::recall(UvdTime firstTime, UvdTime lastTime)
+{
+    TRACE_SPAN("UvdRetention::recall");
+
+    ChunkedVector<K2> recalled;
+    std::vector<OccurrenceRecord> occurrences;
+    readSegments(firstTime, lastTime, &recalled, &occurrences);
+
+    if (recalled.size() > RETENTION_RECALL_POINTS)
+    {
+        size_t writeIndex = 0;
+        startSummary(&m_recallSummary);
+        for (size_t i = 0; i < recalled.size(); i++)
+        {
+            summarizePoint(&m_recallSummary, &recalled, &writeIndex, recalled[i], 60 * UVD_SECOND);
+        }
+        recalled.resize(writeIndex);
+    }
+
+    m_state->lock();
+
+    // below the horizon memory holds only the previous recall, which is
+    // dropped by the compaction unless the new one covers it
+    ChunkedVector<K2> *points = m_state->points();
+    size_t startIndex = pointIndex(points, firstTime);
+    size_t endIndex = pointIndex(points, lastTime);
+    points->erase(startIndex, endIndex);
+    points->insert(startIndex, &recalled);
+    m_state->pointsChanged(startIndex, firstTime, lastTime);
+
+    m_recallFirstTime = firstTime;
+    m_recallLastTime = lastTime;
+    m_state->recalledOccurrences()->swap(occurrences);
+    compactPoints();
+
+    m_state->unlock();
+
+    UvdLog("retention: recalled %lu points.\n", (unsigned long)recalled.size());
+}
+
+// segments of earlier sessions are only read back by a restored snapshot,
+// which keeps spilling into them, so old ones of any session go first
+void UvdRetention::pruneSegments()
+{
+    std::vector<SegmentFile> files;
+    listSegments(m_policy.directory, &files);
+    std::sort(files.begin(), files.end(), segmentIsOlder);
+
+    long long totalBytes = 0;
+    for (size_t i = 0; i < files.size(); i++) totalBytes += files[i].size;
+
+    time_t oldestTime = time(NULL) - (time_t)m_policy.segmentSeconds;
+    size_t removedCount = 0;
+    for (size_t i = 0; i < files.size(); i++)
+    {
+        if (files[i].modifiedTime >= oldestTime && totalBytes <= m_policy.segmentBytes) break;
+        if (remove(files[i].path) != 0) continue;
+
+        totalBytes -= files[i].size;
+        removedCount++;
+    }
+
+    if (removedCount > 0) UvdLog("retention: deleted %lu old segments.\n", (unsigned long)removedCount);
+}
@@ -0,0 +1,103 @@
+#ifndef __UVDRETENTION_H__
+#define __UVDRETENTION_H__
+
+#include <vector>
+#include "Mutex.h"
+#include "Thread.h"
+#include "UvdState.h"
+
+#define RETENTION_INTERVAL (60 * UVD_SECOND)
+#define RETENTION_ALTITUDE_CELL 25
+#define RETENTION_CELL_COUNT 1024
+#define RETENTION_RECALL_POINTS 2000000
+#define RETENTION_OCCURRENCE_SLACK_HOURS 12
+#define RETENTION_PRUNE_INTERVAL_MS (10 * 60 * 1000)
+
+typedef struct {
+    double fullSeconds;         // recent points kept as received
+    double secondSeconds;       // then one point per second and altitude cell
+    double minuteSeconds;       // then one point per minute and altitude cell
+    size_t maxPoints;           // points held in memory, whatever their age
+    char directory[1024];       // spill segments, empty = don't spill
+    double segmentSeconds;      // older segments are deleted, of any session
+    long long segmentBytes;     // and the oldest beyond this total
+} RetentionPolicy;
+
+// the point kept per altitude cell of the bucket being summarized
+typedef struct {
+    long cells[RETENTION_CELL_COUNT];
+    std::vector<int> touchedCells;
+    UvdTime bucketWidth;
+    long long bucket;
+} RetentionSummary;
+
+// Bounds the memory of a long realtime session. Points older than the full
+// resolution window are spilled to hourly segment files and replaced by
+// per-second, then per-minute summaries (the point with the highest
+// amplitude of each altitude cell); older summaries and finalized
+// occurrences are dropped from memory. When the view scrolls back past the
+// full resolution window the spilled points are read back for it by a
+// worker thread, the view shows the summaries until they are in. The
+// worker also deletes segments past the policy's age and total size.
+class UvdRetention
+{
+    friend class UvdSnapshot;
+
+    UvdState *m_state;
+    RetentionPolicy m_policy;
+    char m_sessionName[32];
+
+    UvdTime m_nextCompactTime;
+    UvdTime m_currentTime;
+    // under the state lock
+    UvdTime m_spilledUntil;         // every point before it is on disk
+    UvdTime m_memoryFirstTime;      // memory holds only a recall before it
+    UvdTime m_recallFirstTime, m_recallLastTime;
+
+    // under m_requestLock, the range to recall next and the one being read
+    UvdTime m_requestFirstTime, m_requestLastTime;
+    UvdTime m_readFirstTime, m_readLastTime;
+    bool m_isStopping;
+    Mutex m_requestLock;
+    Event m_requestEvent;
+    Thread m_thread;
+
+    unsigned long m_spilledPoints;
+    unsigned long m_spilledOccurrences;
+    unsigned long m_droppedPoints;
+
+    // kept between compactions, so they run without allocating
+    RetentionSummary m_summary;
+    RetentionSummary m_recallSummary;   // of the worker
+    std::vector<OccurrenceRecord> m_spilled;
+
+    static void retentionFunction(void *context, UvdTime currentTime);
+    static void rangeFunction(void *context, UvdTime leftTime, UvdTime rightTime);
+    static void recallThread(void *context);
+
+    void compactPoints();
+    void compactOccurrences(UvdTime horizonTime);
+    void startSummary(RetentionSummary *summary);
+    void summarizePoint(RetentionSummary *summary, ChunkedVector<K2> *points, size_t *writeIndex, K2 point, UvdTime width);
+    void recallLoop();
+    void recall(UvdTime firstTime, UvdTime lastTime);
+    void pruneSegments();
+    bool spillPoints(size_t startIndex, size_t endIndex);
+    bool appendBlock(UvdTime time, const char *magic, const void *records, size_t recordSize, size_t count);
+    void segmentPath(int hour, char *path);
+    void readSegments(UvdTime firstTime, UvdTime lastTime, ChunkedVector<K2> *points, std::vector<OccurrenceRecord> *occurrences);
+
+public:
+    UvdRetention(UvdState *state, RetentionPolicy *policy);
+    ~UvdRetention();
+
+    void compact(UvdTime currentTime);
+    void ensureRange(UvdTime leftTime, UvdTime rightTime);
+
+    unsigned long spilledPoints() { return m_spilledPoints; }
+    unsigned long droppedPoints() { return m_droppedPoints; }
+
+    static void defaultPolicy(RetentionPolicy *policy);
+};
+
+#endif
@@ -0,0 +1,628 @@
+#include "UvdSnapshot.h"
+#include "MappedFile.h"
+#include "Clock.h"
+#include "SpanRecorder.h"
+#include "Log.h"
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef _MSC_VER
+#include <io.h>
+#define fsync _commit
+#define fileno _fileno
+#else
+#include <unistd.h>
+#endif
+
+#define HEAD_MAGIC "UVDGSNP4"
+#define JOURNAL_MAGIC "UVDGPTS3"
+
+typedef struct {
+    char magic[8];
+    unsigned int pointSize;         // snapshots are read back by the same build only
+    int journal;
+    unsigned long long journalPoints;
+    int occurrenceCount;
+    int pendingCount;
+    int trackCount;
+    int rowCount;
+    int overviewBucketCount;
+    int yyyy, mm, dd;
+    UvdTime realtimeStartTime;
+    UvdTime lastTime;
+    RecvStats recvStats;
+    int statisticsBaseDay;
+    UvdTime statisticsLastTime;
+    UvdTime parserLastTime;
+    int parserDay;
+    UvdTime parserBaseTime;
+    int parserLineDay;              // local date of the parser's last line, as a day number
+    int duplicateIndex;
+    char retentionSession[32];
+    UvdTime retentionSpilledUntil;
+    UvdTime retentionMemoryFirstTime;
+    long long overviewFirstBucket;
+    UvdTime overviewWidth;
+    unsigned int overviewMaxCount;
+} SnapshotHeader;
+
+typedef struct {
+    char magic[8];
+    unsigned int pointSize;
+    unsigned int reserved;
+} JournalHeader;
+
+static bool pointIsAfter(UvdTime time, const K2 &point)
+{
+    return time < point.ri.time;
+}
+
+// today's local date as a day number, and the seconds since its midnight
+static int localDayNumber(int *seconds)
+{
+    time_t now = time(NULL);
+    struct tm date = *localtime(&now);
+    if (seconds != NULL) *seconds = date.tm_hour * 3600 + date.tm_min * 60 + date.tm_sec;
+    return UvdState::dayNumber(date.tm_year + 1900, date.tm_mon + 1, date.tm_mday);
+}
+
+// the local date a line with this time of day was received on, by the same
+// rule as RtlUvdRecorder: a line more than 12 hours off the clock is from
+// the day before or after
+static int lineDayNumber(UvdTime lineTime)
+{
+    int lineSeconds = (int)(lineTime / UVD_SECOND);
+    int nowSeconds;
+    int day = localDayNumber(&nowSeconds);
+
+    if (lineSeconds - nowSeconds > 12 * 3600) return day - 1;
+    if (nowSeconds - lineSeconds > 12 * 3600) return day + 1;
+    return day;
+}
+
+static void appendBytes(std::vector<char> *bytes, const void *data, size_t size)
+{
+    bytes->insert(bytes->end(), (const char *)data, (const char *)data + size);
+}
+
+static bool syncFile(FILE *file)
+{
+    return fflush(file) == 0 && fsync(fileno(file)) == 0;
+}
+
+static bool replaceFile(const char *fromPath, const char *toPath)
+{
+#ifdef _MSC_VER
+    return MoveFileExA(fromPath, toPath, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    return rename(fromPath, toPath) == 0;
+#endif
+}
+
+UvdSnapshot::UvdSnapshot(const char *directory, UvdState *state, RtlUvdParser *parser)
+{
+    strncpy(m_directory, directory, sizeof(m_directory) - 1);
+    m_directory[sizeof(m_directory) - 1] = '\x00';
+
+    m_state = state;
+    m_parser = parser;
+    m_retention = NULL;
+
+    m_nextCaptureTime = -1;
+    m_journalLastTime = -1;
+    m_rewritesJournal = false;
+
+    m_hasPending = false;
+
+    m_journal = 0;
+    m_journalFile = NULL;
+    m_journalPoints = 0;
+    m_writtenSnapshots = 0;
+
+    m_retentionSession[0] = '\x00';
+    m_retentionSpilledUntil = -1;
+    m_retentionMemoryFirstTime = -1;
+
+    m_isStarted = false;
+    m_isStopping = false;
+
+    MutexCreate(&m_lock);
+    EventCreate(&m_wakeup);
+}
+
+UvdSnapshot::~UvdSnapshot()
+{
+    if (m_isStarted)
+    {
+        // the last lines since the previous capture
+        m_nextCaptureTime = -1;
+        capture(0);
+
+        MutexLock(&m_lock);
+        m_isStopping = true;
+        MutexUnlock(&m_lock);
+
+        EventSignal(&m_wakeup);
+        ThreadJoin(&m_thread);
+    }
+
+    if (m_journalFile != NULL) fclose(m_journalFile);
+
+    EventDestroy(&m_wakeup);
+    MutexDestroy(&m_lock);
+}
+
+void UvdSnapshot::setRetention(UvdRetention *retention)
+{
+    m_retention = retention;
+
+    if (m_retentionSession[0] != '\x00')
+    {
+        // keep spilling into the restored session's segments, so scrolling
+        // back still finds them
+        strcpy(retention->m_sessionName, m_retentionSession);
+        retention->m_spilledUntil = m_retentionSpilledUntil;
+        retention->m_memoryFirstTime = m_retentionMemoryFirstTime;
+    }
+}
+
+void UvdSnapshot::start()
+{
+    m_isStarted = true;
+    ThreadCreate(&m_thread, writerThread, this);
+}
+
+void UvdSnapshot::capture(UvdTime time)
+{
+    if (time < m_nextCaptureTime) return;
+    m_nextCaptureTime = time + SNAPSHOT_INTERVAL;
+
+    TRACE_SPAN("UvdSnapshot::capture");
+
+    SnapshotHeader header;
+    memset(&header, 0, sizeof(SnapshotHeader));
+    memcpy(header.magic, HEAD_MAGIC, 8);
+    header.pointSize = sizeof(K2);
+
+    std::vector<char> head;
+    std::vector<K2> points;
+    UvdTime journalLastTime = m_journalLastTime;
+
+    // runs on the ingest thread between lines, so the parser and the
+    // state agree; only the new points and the small tables are copied
+    m_state->lock();
+
+    ChunkedVector<K2> &statePoints = m_state->m_points;
+    size_t newIndex = std::upper_bound(statePoints.begin(), statePoints.end(), m_journalLastTime, pointIsAfter) - statePoints.begin();
+    points.reserve(statePoints.size() - newIndex);
+    for (size_t i = newIndex; i < statePoints.size(); i += statePoints.contiguousCount(i))
+    {
+        K2 *records = &statePoints[i];
+        points.insert(points.end(), records, records + statePoints.contiguousCount(i));
+    }
+    if (points.size() > 0) m_journalLastTime = points[points.size() - 1].ri.time;
+
+    if (m_journalPoints > 2 * statePoints.size() + SNAPSHOT_REWRITE_MIN_POINTS)
+    {
+        // retention has dropped most of the journal from memory
+        m_rewritesJournal = true;
+    }
+
+    header.occurrenceCount = (int)m_state->m_occurrences.size();
+    header.pendingCount = (int)m_state->m_pendingOccurrences.size();
+    header.trackCount = (int)m_state->m_associator.m_tracks.size();
+    header.rowCount = (int)m_state->m_statistics.m_rows.size();
+    header.overviewBucketCount = (int)m_state->m_overview.m_buckets.size();
+    header.yyyy = m_state->m_yyyy;
+    header.mm = m_state->m_mm;
+    header.dd = m_state->m_dd;
+    header.realtimeStartTime = m_state->m_realtimeStartTime;
+    header.lastTime = m_state->m_lastTime;
+    header.recvStats = m_state->m_recvStats;
+    header.statisticsBaseDay = m_state->m_statistics.m_baseDay;
+    header.statisticsLastTime = m_state->m_statistics.m_lastTime;
+    header.overviewFirstBucket = m_state->m_overview.m_firstBucket;
+    header.overviewWidth = m_state->m_overview.m_width;
+    header.overviewMaxCount = m_state->m_overview.m_maxCount;
+    header.parserLastTime = m_parser->m_lastTime;
+    header.parserDay = m_parser->m_day;
+    header.parserBaseTime = m_parser->m_baseTime;
+    header.parserLineDay = lineDayNumber(m_parser->m_lastTime);
+    header.duplicateIndex = m_parser->m_duplicateDetectorBufferIndex;
+
+    if (m_retention != NULL)
+    {
+        strcpy(header.retentionSession, m_retention->m_sessionName);
+        header.retentionSpilledUntil = m_retention->m_spilledUntil;
+        header.retentionMemoryFirstTime = m_retention->m_memoryFirstTime;
+    }
+    else
+    {
+        strcpy(header.retentionSession, m_retentionSession);
+        header.retentionSpilledUntil = m_retentionSpilledUntil;
+        header.retentionMemoryFirstTime = m_retentionMemoryFirstTime;
+    }
+
+    appendBytes(&head, &header, sizeof(SnapshotHeader));
+    appendBytes(&head, m_parser->m_duplicateDetectorBuffer, DUPLICATE_DETECTOR_BUFFER_SIZE * sizeof(UvdTime));
+    if (header.occurrenceCount > 0)
+    {
+        appendBytes(&head, &m_state->m_occurrences[0], header.occurrenceCount * sizeof(OccurrenceRecord));
+    }
+    if (header.pendingCount > 0)
+    {
+        appendBytes(&head, &m_state->m_pendingOccurrences[0], header.pendingCount * sizeof(OccurrenceRecord));
+    }
+    if (header.trackCount > 0)
+    {
+        appendBytes(&head, &m_state->m_associator.m_tracks[0], header.trackCount * sizeof(Track));
+    }
+    if (header.rowCount > 0)
+    {
+        appendBytes(&head, &m_state->m_statistics.m_rows[0], header.rowCount * sizeof(AircraftSummary));
+    }
+    if (header.overviewBucketCount > 0)
+    {
+        appendBytes(&head, &m_state->m_overview.m_buckets[0], header.overviewBucketCount * sizeof(OverviewBucket));
+    }
+
+    m_state->unlock();
+
+    MutexLock(&m_lock);
+    if (m_hasPending)
+    {
+        // the writer is behind: the newer head wins, points add up
+        m_pending.points.insert(m_pending.points.end(), points.begin(), points.end());
+        m_pending.rewritesJournal = m_pending.rewritesJournal || m_rewritesJournal;
+    }
+    else
+    {
+        m_pending.points.swap(points);
+        m_pending.journalLastTime = journalLastTime;
+        m_pending.rewritesJournal = m_rewritesJournal;
+        m_hasPending = true;
+    }
+    m_pending.head.swap(head);
+    MutexUnlock(&m_lock);
+
+    m_rewritesJournal = false;
+
+    EventSignal(&m_wakeup);
+}
+
+void UvdSnapshot::writerThread(void *context)
+{
+    ((UvdSnapshot *)context)->writerLoop();
+}
+
+void UvdSnapshot::writerLoop()
+{
+    while (true)
+    {
+        EventWait(&m_wakeup, -1);
+
+        MutexLock(&m_lock);
+        bool hasBatch = m_hasPending;
+        if (hasBatch)
+        {
+            m_writing.head.swap(m_pending.head);
+            m_writing.points.swap(m_pending.points);
+            m_writing.journalLastTime = m_pending.journalLastTime;
+            m_writing.rewritesJournal = m_pending.rewritesJournal;
+            m_pending.points.clear();
+            m_hasPending = false;
+        }
+        bool isStopping = m_isStopping;
+        MutexUnlock(&m_lock);
+
+        if (hasBatch) writeBatch();
+
+        if (isStopping) break;
+    }
+}
+
+void UvdSnapshot::writeBatch()
+{
+    TRACE_SPAN("UvdSnapshot::writeBatch");
+
+    int previousJournal = -1;
+    if (m_writing.rewritesJournal || m_journalFile == NULL)
+    {
+        previousJournal = m_journal;
+        if (!rewriteJournal(m_writing.journalLastTime))
+        {
+            // the next batch rewrites it again, including these points;
+            // the head keeps the old journal until then
+            if (m_journalFile != NULL) fclose(m_journalFile);
+            m_journalFile = NULL;
+            return;
+        }
+    }
+
+    size_t count = m_writing.points.size();
+    if (count > 0 && fwrite(&m_writing.points[0], sizeof(K2), count, m_journalFile) != count)
+    {
+        UvdLog("snapshot: can't append to the journal.\n");
+        fclose(m_journalFile);
+        m_journalFile = NULL;
+        return;
+    }
+    if (!syncFile(m_journalFile))
+    {
+        UvdLog("snapshot: can't sync the journal.\n");
+        fclose(m_journalFile);
+        m_journalFile = NULL;
+        return;
+    }
+    m_journalPoints += count;
+
+    if (!writeHead()) return;
+
+    if (previousJournal >= 0)
+    {
+        char path[1100];
+        journalPath(previousJournal, path);
+        remove(path);
+    }
+
+    m_writtenSnapshots++;
+}
+
+bool UvdSnapshot::rewriteJournal(UvdTime lastTime)
+{
+    TRACE_SPAN("UvdSnapshot::rewriteJournal");
+
+    int journal = m_journal + 1;
+    char path[1100];
+    journalPath(journal, path);
+
+    FILE *file = fopen(path, "wb");
+    if (file == NULL)
+    {
+        UvdLog("snapshot: can't open %s.\n", path);
+        return false;
+    }
+
+    JournalHeader header;
+    memset(&header, 0, sizeof(JournalHeader));
+    memcpy(header.magic, JOURNAL_MAGIC, 8);
+    header.pointSize = sizeof(K2);
+    bool isWritten = fwrite(&header, sizeof(JournalHeader), 1, file) == 1;
+
+    // what memory holds up to the batch, a chunk per lock so ingest goes on;
+    // compactions in between only change points the cursor has passed or
+    // not reached, and either version of them is fine to resume from
+    std::vector<K2> chunk;
+    chunk.reserve(SNAPSHOT_REWRITE_CHUNK_POINTS);
+    unsigned long long count = 0;
+    UvdTime cursorTime = -1;
+    while (isWritten)
+    {
+        m_state->lock();
+        ChunkedVector<K2> &points = m_state->m_points;
+        size_t startIndex = std::upper_bound(points.begin(), points.end(), cursorTime, pointIsAfter) - points.begin();
+        size_t endIndex = std::upper_bound(points.begin(), points.end(), lastTime, pointIsAfter) - points.begin();
+        if (endIndex > startIndex + SNAPSHOT_REWRITE_CHUNK_POINTS) endIndex = startIndex + SNAPSHOT_REWRITE_CHUNK_POINTS;
+        if (endIndex > startIndex + points.contiguousCount(startIndex)) endIndex = startIndex + points.contiguousCount(startIndex);
+        chunk.clear();
+        if (endIndex > startIndex) chunk.insert(chunk.end(), &points[startIndex], &points[startIndex] + (endIndex - startIndex));
+        m_state->unlock();
+
+        if (chunk.size() == 0) break;
+
+        isWritten = fwrite(&chunk[0], sizeof(K2), chunk.size(), file) == chunk.size();
+        count += chunk.size();
+        cursorTime = chunk[chunk.size() - 1].ri.time;
+    }
+
+    if (!isWritten || !syncFile(file))
+    {
+        UvdLog("snapshot: can't write %s.\n", path);
+        fclose(file);
+        remove(path);
+        return false;
+    }
+
+    if (m_journalFile != NULL) fclose(m_journalFile);
+    m_journalFile = file;
+    m_journal = journal;
+    m_journalPoints = count;
+
+    return true;
+}
+
+bool UvdSnapshot::writeHead()
+{
+    SnapshotHeader *header = (SnapshotHeader *)&m_writing.head[0];
+    header->journal = m_journal;
+    header->journalPoints = m_journalPoints;
+
+    char path[1100];
+    char temporaryPath[1100];
+    headPath(path, "");
+    headPath(temporaryPath, ".tmp");
+
+    FILE *file = fopen(temporaryPath, "wb");
+    if (file == NULL)
+    {
+        UvdLog("snapshot: can't open %s.\n", temporaryPath);
+        return false;
+    }
+
+    bool isWritten = fwrite(&m_writing.head[0], 1, m_writing.head.size(), file) == m_writing.head.size();
+    isWritten = syncFile(file) && isWritten;
+    fclose(file);
+
+    if (!isWritten || !replaceFile(temporaryPath, path))
+    {
+        UvdLog("snapshot: can't write %s.\n", path);
+        remove(temporaryPath);
+        return false;
+    }
+
+    return true;
+}
+
+bool UvdSnapshot::restore()
+{
+    TRACE_SPAN("UvdSnapshot::restore");
+
+    long long startTime = ClockMicroseconds();
+
+    char path[1100];
+    headPath(path, "");
+
+    MappedFile head;
+    if (!MappedFileOpen(&head, path)) return false;
+
+    SnapshotHeader header;
+    bool isValid = head.size >= (long long)sizeof(SnapshotHeader);
+    if (isValid)
+    {
+        memcpy(&header, head.data, sizeof(SnapshotHeader));
+        isValid = memcmp(header.magic, HEAD_MAGIC, 8) == 0 && header.pointSize == sizeof(K2)
+            && head.size == (long long)(sizeof(SnapshotHeader) + DUPLICATE_DETECTOR_BUFFER_SIZE * sizeof(UvdTime)
+                                        + (header.occurrenceCount + header.pendingCount) * sizeof(OccurrenceRecord)
+                                        + header.trackCount * sizeof(Track)
+                                        + header.rowCount * sizeof(AircraftSummary)
+                                        + header.overviewBucketCount * sizeof(OverviewBucket));
+    }
+
+    MappedFile journal;
+    bool isJournalOpen = false;
+    if (isValid)
+    {
+        // a torn append after the last head is ignored
+        journalPath(header.journal, path);
+        isJournalOpen = MappedFileOpen(&journal, path);
+        isValid = isJournalOpen
+            && journal.size >= (long long)(sizeof(JournalHeader) + header.journalPoints * sizeof(K2))
+            && memcmp(journal.data, JOURNAL_MAGIC, 8) == 0;
+    }
+
+    if (!isValid)
+    {
+        UvdLog("snapshot: %s is not usable.\n", path);
+        if (isJournalOpen) MappedFileClose(&journal);
+        MappedFileClose(&head);
+        return false;
+    }
+
+    const unsigned char *data = head.data + sizeof(SnapshotHeader);
+
+    m_state->lock();
+
+    const K2 *points = (const K2 *)(journal.data + sizeof(JournalHeader));
+    m_state->m_points.clear();
+    m_state->m_points.append(points, (size_t)header.journalPoints);
+    m_state->pointsChanged(0);
+
+    memcpy(m_parser->m_duplicateDetectorBuffer, data, DUPLICATE_DETECTOR_BUFFER_SIZE * sizeof(UvdTime));
+    data += DUPLICATE_DETECTOR_BUFFER_SIZE * sizeof(UvdTime);
+    m_parser->m_duplicateDetectorBufferIndex = header.duplicateIndex;
+    m_parser->m_lastTime = header.parserLastTime;
+    m_parser->m_day = header.parserDay;
+    m_parser->m_baseTime = header.parserBaseTime;
+
+    // the feed's lines carry only a time of day: when the restart is on a
+    // later date, the days in between are counted here, and the next line
+    // starts the day instead of being compared with the last one's time
+    int passedDays = localDayNumber(NULL) - header.parserLineDay;
+    if (passedDays > 0)
+    {
+        m_parser->m_day += passedDays;
+        m_parser->m_lastTime = 0;
+        UvdLog("snapshot: %d days passed since the last line.\n", passedDays);
+    }
+
+    m_state->m_occurrences.resize(header.occurrenceCount);
+    if (header.occurrenceCount > 0)
+    {
+        memcpy(&m_state->m_occurrences[0], data, header.occurrenceCount * sizeof(OccurrenceRecord));
+    }
+    data += header.occurrenceCount * sizeof(OccurrenceRecord);
+
+    // written in tail number order, as the state keeps them
+    m_state->m_pendingOccurrences.resize(header.pendingCount);
+    if (header.pendingCount > 0)
+    {
+        memcpy(&m_state->m_pendingOccurrences[0], data, header.pendingCount * sizeof(OccurrenceRecord));
+    }
+    data += header.pendingCount * sizeof(OccurrenceRecord);
+
+    std::vector<Track> &tracks = m_state->m_associator.m_tracks;
+    tracks.resize(header.trackCount);
+    if (header.trackCount > 0)
+    {
+        memcpy(&tracks[0], data, header.trackCount * sizeof(Track));
+    }
+    data += header.trackCount * sizeof(Track);
+    // expired tracks go at the next line, which finds the next expiry
+    m_state->m_associator.m_nextExpiryTime = header.lastTime;
+
+    m_state->setStartDate(header.yyyy, header.mm, header.dd);
+    m_state->m_realtimeStartTime = header.realtimeStartTime;
+    m_state->m_lastTime = header.lastTime;
+    m_state->m_recvStats = header.recvStats;
+
+    AircraftStatistics *statistics = &m_state->m_statistics;
+    statistics->clear();
+    statistics->m_rows.resize(header.rowCount);
+    if (header.rowCount > 0)
+    {
+        memcpy(&statistics->m_rows[0], data, header.rowCount * sizeof(AircraftSummary));
+    }
+    for (int i = 0; i < header.rowCount; i++)
+    {
+        statistics->m_rowIndex[statistics->m_rows[i].tailNumber] = i;
+    }
+    statistics->m_baseDay = header.statisticsBaseDay;
+    statistics->m_lastTime = header.statisticsLastTime;
+    data += header.rowCount * sizeof(AircraftSummary);
+
+    // saved rather than counted again from the journal: it costs a few
+    // thousand buckets, and it still counts the points retention dropped
+    UvdOverview *overview = &m_state->m_overview;
+    overview->clear();
+    overview->m_buckets.resize(header.overviewBucketCount);
+    if (header.overviewBucketCount > 0)
+    {
+        memcpy(&overview->m_buckets[0], data, header.overviewBucketCount * sizeof(OverviewBucket));
+    }
+    overview->m_firstBucket = header.overviewFirstBucket;
+    overview->m_width = header.overviewWidth;
+    overview->m_maxCount = header.overviewMaxCount;
+
+    size_t pointCount = m_state->m_points.size();
+    m_journalLastTime = pointCount > 0 ? m_state->m_points[pointCount - 1].ri.time : -1;
+
+    m_state->unlock();
+
+    strcpy(m_retentionSession, header.retentionSession);
+    m_retentionSpilledUntil = header.retentionSpilledUntil;
+    m_retentionMemoryFirstTime = header.retentionMemoryFirstTime;
+
+    // the restored journal stays untouched until a new one is complete
+    m_journal = header.journal;
+    m_rewritesJournal = true;
+
+    MappedFileClose(&journal);
+    MappedFileClose(&head);
+
+    UvdLog("snapshot: restored %lu points, %d occurrences, %d pending in %lld ms.\n",
+           (unsigned long)pointCount, header.occurrenceCount, header.pendingCount, (ClockMicroseconds() - startTime) / 1000);
+
+    return true;
+}
+
+void UvdSnapshot::journalPath(int journal, char *path)
+{
+    sprintf(path, "%s/uvdg-snapshot-%d.pts", m_directory, journal);
+}
+
+void UvdSnapshot::headPath(char *path, const char *suffix)
+{
+    sprintf(path, "%s/uvdg-snapshot.head%s", m_directory, suffix);
+}
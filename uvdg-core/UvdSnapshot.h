@@ -0,0 +1,90 @@
+#ifndef __UVDSNAPSHOT_H__
+#define __UVDSNAPSHOT_H__
+
+#include <vector>
+#include "UvdState.h"
+#include "RtlUvdParser.h"
+#include "UvdRetention.h"
+#include "Mutex.h"
+#include "Thread.h"
+
+#define SNAPSHOT_INTERVAL (10 * UVD_SECOND)
+#define SNAPSHOT_REWRITE_MIN_POINTS 1000000
+#define SNAPSHOT_REWRITE_CHUNK_POINTS 65536
+
+// one capture, or several merged while the writer was busy
+typedef struct {
+    std::vector<char> head;         // SnapshotHeader and the small tables
+    std::vector<K2> points;         // points newer than the journal's last
+    UvdTime journalLastTime;        // the journal's last point time before them
+    bool rewritesJournal;
+} SnapshotBatch;
+
+// Periodic snapshots of a realtime session, to resume it after a restart.
+// Points go to an append-only journal, everything else (occurrences,
+// pending occurrences, associated tracks, receive stats, statistics, the
+// parser's day and duplicate window, the retention's spill position) to a
+// small head file replaced atomically after the journal is synced, so a
+// crash at any time leaves the previous snapshot usable. The ingest thread
+// only copies the points added since the last capture and the small
+// tables, a writer thread does the disk I/O; when the journal holds much
+// more than the state (retention dropped points), it is rewritten from
+// memory a chunk per lock.
+class UvdSnapshot
+{
+    char m_directory[1024];
+
+    UvdState *m_state;
+    RtlUvdParser *m_parser;
+    UvdRetention *m_retention;
+
+    // owned by the ingest thread
+    UvdTime m_nextCaptureTime;
+    UvdTime m_journalLastTime;
+    bool m_rewritesJournal;
+
+    // filled by capture, swapped out by the writer thread
+    SnapshotBatch m_pending;
+    bool m_hasPending;
+
+    // owned by the writer thread
+    SnapshotBatch m_writing;
+    int m_journal;
+    FILE *m_journalFile;
+    volatile unsigned long long m_journalPoints;
+    unsigned long m_writtenSnapshots;
+
+    // restored until a retention picks them up
+    char m_retentionSession[32];
+    UvdTime m_retentionSpilledUntil;
+    UvdTime m_retentionMemoryFirstTime;
+
+    bool m_isStarted;
+    bool m_isStopping;
+
+    Mutex m_lock;
+    Event m_wakeup;
+    Thread m_thread;
+
+    static void writerThread(void *context);
+    void writerLoop();
+    void writeBatch();
+    bool rewriteJournal(UvdTime lastTime);
+    bool writeHead();
+    void journalPath(int journal, char *path);
+    void headPath(char *path, const char *suffix);
+
+public:
+    UvdSnapshot(const char *directory, UvdState *state, RtlUvdParser *parser);
+    ~UvdSnapshot();
+
+    bool restore();
+    void setRetention(UvdRetention *retention);
+    void start();
+
+    void capture(UvdTime time);
+
+    unsigned long writtenSnapshots() { return m_writtenSnapshots; }
+};
+
+#endif
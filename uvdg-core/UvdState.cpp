@@ -0,0 +1,600 @@
+
+#include "UvdState.h"
+#include "SpanRecorder.h"
+#include "Log.h"
+#include <algorithm>
+#include <map>
+#include <queue>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define HIDE_TAILNUMBERS true
+
+static bool pendingIsBefore(const OccurrenceRecord &record, int tailNumber)
+{
+    return record.tailNumber < tailNumber;
+}
+
+UvdState::UvdState()
+{
+    m_isRealtimeMode = false;
+    m_isShared = false;
+    m_loadProgress = -1.0;
+    m_isLoadCancelled = false;
+    m_realtimeStartTime = -1;
+    
+    m_yyyy = 0;
+
+    m_hidesTailNumbers = HIDE_TAILNUMBERS;
+    m_hasPseudonyms = false;
+
+    m_rangeFunction = NULL;
+    m_rangeContext = NULL;
+    m_retentionFunction = NULL;
+    m_retentionContext = NULL;
+    m_changeFunction = NULL;
+    m_changeContext = NULL;
+    m_alerts = NULL;
+    m_boundsFirstTime = -1;
+    m_boundsLastTime = -1;
+    m_isOverviewFixed = false;
+
+    m_pendingOccurrences.reserve(PENDING_OCCURRENCE_RESERVE);
+    
+    memset(&m_recvStats, 0, sizeof(RecvStats));
+    
+    MutexCreate(&m_lock);
+}
+
+UvdState::~UvdState()
+{
+    MutexDestroy(&m_lock);
+}
+
+void UvdState::setStartDate(int yyyy, int mm, int dd)
+{
+    m_yyyy = yyyy;
+    m_mm = mm;
+    m_dd = dd;
+
+    m_statistics.setBaseDay(dayNumber(yyyy, mm, dd));
+}
+
+void UvdState::processK1(K1 k1)
+{
+    preprocess(k1.ri.time);
+    
+    if (k1.ri.confidence == 3)
+    {
+        m_recvStats.k1Conf3Lines++;
+    }
+    else
+    {
+        m_recvStats.k1Conf4Lines++;
+    }
+    
+    m_associator.k1Seen(k1);
+
+    // transitions go to the alerts once the lock is released
+    bool isStarting = false;
+    bool hasEnded = false;
+    OccurrenceRecord ended;
+
+    lock();
+    m_statistics.lineSeen(k1.tailNumber, k1.ri.time);
+
+    std::vector<OccurrenceRecord>::iterator pending = std::lower_bound(m_pendingOccurrences.begin(), m_pendingOccurrences.end(), k1.tailNumber, pendingIsBefore);
+    if (pending == m_pendingOccurrences.end() || pending->tailNumber != k1.tailNumber)
+    {
+        OccurrenceRecord record;
+        record.tailNumber = k1.tailNumber;
+        record.firstTime = k1.ri.time;
+        record.lastTime = k1.ri.time;
+        m_pendingOccurrences.insert(pending, record);
+        isStarting = true;
+    }
+    else if (pending->lastTime + OCCURRENCE_GAP < k1.ri.time)
+    {
+        // finalize old occurrence
+        m_occurrences.push_back(*pending);
+        m_statistics.addOccurrence(pending->tailNumber, pending->firstTime, pending->lastTime);
+        ended = *pending;
+        hasEnded = true;
+
+        // and replace with new
+        pending->firstTime = k1.ri.time;
+        pending->lastTime = k1.ri.time;
+        isStarting = true;
+    }
+    else
+    {
+        pending->lastTime = k1.ri.time;
+    }
+    unlock();
+
+    if (m_alerts != NULL)
+    {
+        if (hasEnded) m_alerts->occurrenceEnded(ended, k1.ri.time);
+        if (isStarting) m_alerts->occurrenceStarted(k1.tailNumber, k1.ri.time);
+        m_alerts->k1Seen(k1);
+    }
+    
+    postprocess(k1.ri.time);
+}
+
+void UvdState::processK2(K2 k2)
+{
+    preprocess(k2.ri.time);
+    
+    if (k2.ri.confidence == 3)
+    {
+        m_recvStats.k2Conf3Lines++;
+    }
+    else
+    {
+        m_recvStats.k2Conf4Lines++;
+    }
+    
+    // K2 carries no tail number, the associator finds the aircraft
+    k2.tailNumber = m_associator.associate(k2);
+
+    lock();
+    m_points.push_back(k2);
+    m_pointIndex.add(k2);
+    if (!m_isOverviewFixed) m_overview.add(k2.ri.time, k2.alt);
+    if (m_changeFunction != NULL) m_changeFunction(m_changeContext, k2.ri.time, k2.ri.time);
+
+    if (k2.tailNumber != 0)
+    {
+        m_statistics.addPoint(k2.tailNumber, k2.alt);
+    }
+    unlock();
+
+    if (m_alerts != NULL) m_alerts->k2Seen(k2);
+    
+    postprocess(k2.ri.time);
+}
+
+void UvdState::finalizeLogFile()
+{
+    UvdLog("finalizing log file.\n");
+
+    lock();
+    
+    for (size_t i = 0; i < m_pendingOccurrences.size(); i++)
+    {
+        OccurrenceRecord record = m_pendingOccurrences[i];
+        m_occurrences.push_back(record);
+        m_statistics.addOccurrence(record.tailNumber, record.firstTime, record.lastTime);
+    }
+    
+    m_pendingOccurrences.clear();
+    m_associator.clear();
+    
+    if (m_hidesTailNumbers)
+    {
+        hideTailNumbers(&m_occurrences);
+        hideTailNumbers(&m_points);
+        pointsChanged(0);
+    }
+
+    unlock();
+}
+
+// one pseudonym per aircraft, kept by the state, so its occurrences and
+// points still match, in every part merged into it
+void UvdState::hideTailNumbers(std::vector<OccurrenceRecord> *occurrences)
+{
+    std::vector<OccurrenceRecord>::iterator iter;
+    for (iter = occurrences->begin(); iter != occurrences->end(); ++iter)
+    {
+        std::map<int, int>::iterator pseudonym = m_pseudonyms.find((*iter).tailNumber);
+        if (pseudonym == m_pseudonyms.end())
+        {
+            // drawn again while taken, or two aircraft would share tracks
+            // and statistics; RAND_MAX may be 32767, two draws cover 99999
+            int value;
+            do
+            {
+                value = 1 + (int)(((unsigned int)(rand() & 0x7fff) << 15 | (unsigned int)(rand() & 0x7fff)) % 99999);
+            }
+            while (m_tailNumbers.find(value) != m_tailNumbers.end());
+
+            pseudonym = m_pseudonyms.insert(std::make_pair((*iter).tailNumber, value)).first;
+            m_tailNumbers[value] = (*iter).tailNumber;
+        }
+        (*iter).tailNumber = pseudonym->second;
+    }
+}
+
+// points of aircrafts without occurrences lose their tail number
+void UvdState::hideTailNumbers(ChunkedVector<K2> *points)
+{
+    for (size_t i = 0; i < points->size(); i++)
+    {
+        K2 &point = (*points)[i];
+        if (point.tailNumber == 0) continue;
+
+        std::map<int, int>::iterator pseudonym = m_pseudonyms.find(point.tailNumber);
+        point.tailNumber = pseudonym != m_pseudonyms.end() ? pseudonym->second : 0;
+    }
+}
+
+// the real tail number of a merged occurrence, statistics are kept by them
+int UvdState::tailNumberOf(int tailNumber)
+{
+    if (!m_hidesTailNumbers) return tailNumber;
+
+    std::map<int, int>::iterator iter = m_tailNumbers.find(tailNumber);
+    return iter != m_tailNumbers.end() ? iter->second : tailNumber;
+}
+
+typedef struct {
+    UvdTime time;
+    size_t part;
+    size_t index;
+} MergeCursor;
+
+struct MergeCursorLater
+{
+    bool operator()(const MergeCursor &a, const MergeCursor &b) const { return a.time > b.time; }
+};
+
+static bool compareFirstTime(const OccurrenceRecord &a, const OccurrenceRecord &b)
+{
+    return a.firstTime < b.firstTime;
+}
+
+void UvdState::mergeStates(std::vector<UvdState *> *parts, bool releasesParts)
+{
+    TRACE_SPAN("mergeStates");
+
+    // parts are finalized logs parsed on this state's clock; points and
+    // occurrences are k-way merged by time, so overlapping logs (several
+    // receivers, restarts) interleave correctly
+    std::priority_queue<MergeCursor, std::vector<MergeCursor>, MergeCursorLater> heap;
+
+    // hidden before they are merged, kept parts only once
+    if (m_hidesTailNumbers)
+    {
+        for (size_t i = 0; i < parts->size(); i++)
+        {
+            if (!(*parts)[i]->m_hasPseudonyms) hideTailNumbers(&(*parts)[i]->m_occurrences);
+        }
+        for (size_t i = 0; i < parts->size(); i++)
+        {
+            if ((*parts)[i]->m_hasPseudonyms) continue;
+            hideTailNumbers(&(*parts)[i]->m_points);
+            (*parts)[i]->m_hasPseudonyms = true;
+        }
+    }
+
+    size_t pointCount = 0;
+    size_t occurrenceCount = 0;
+    UvdTime firstTime = UVD_TIME_MAX;
+    for (size_t i = 0; i < parts->size(); i++)
+    {
+        UvdState *part = (*parts)[i];
+        pointCount += part->m_points.size();
+        occurrenceCount += part->m_occurrences.size();
+        if (part->m_points.size() > 0 && part->m_points[0].ri.time < firstTime) firstTime = part->m_points[0].ri.time;
+
+        std::sort(part->m_occurrences.begin(), part->m_occurrences.end(), compareFirstTime);
+
+        m_recvStats.k1Conf3Lines += part->m_recvStats.k1Conf3Lines;
+        m_recvStats.k2Conf3Lines += part->m_recvStats.k2Conf3Lines;
+        m_recvStats.k1Conf4Lines += part->m_recvStats.k1Conf4Lines;
+        m_recvStats.k2Conf4Lines += part->m_recvStats.k2Conf4Lines;
+    }
+
+    lock();
+
+    // merged after what an earlier merge left (an archive published a day
+    // at a time): points already there that are later than the parts'
+    // first one are taken out and merged again with them
+    size_t firstMergedIndex = m_points.size();
+    while (firstMergedIndex > 0 && m_points[firstMergedIndex - 1].ri.time > firstTime) firstMergedIndex--;
+
+    ChunkedVector<K2> laterPoints;
+    laterPoints.append(&m_points, firstMergedIndex, m_points.size());
+    m_points.resize(firstMergedIndex);
+
+    std::vector<ChunkedVector<K2> *> sources;
+    for (size_t i = 0; i < parts->size(); i++)
+    {
+        sources.push_back(&(*parts)[i]->m_points);
+    }
+    sources.push_back(&laterPoints);
+
+    m_points.reserve(m_points.size() + pointCount + laterPoints.size());
+    for (size_t i = 0; i < sources.size(); i++)
+    {
+        ChunkedVector<K2> &points = *sources[i];
+        if (points.size() > 0)
+        {
+            MergeCursor cursor = { points[0].ri.time, i, 0 };
+            heap.push(cursor);
+        }
+    }
+    while (!heap.empty())
+    {
+        MergeCursor cursor = heap.top();
+        heap.pop();
+
+        // copy the whole run that precedes every other part, which for
+        // daily logs is the whole part
+        ChunkedVector<K2> &points = *sources[cursor.part];
+        size_t runEnd = cursor.index + 1;
+        if (heap.empty())
+        {
+            runEnd = points.size();
+        }
+        else
+        {
+            UvdTime nextTime = heap.top().time;
+            while (runEnd < points.size() && points[runEnd].ri.time <= nextTime) runEnd++;
+        }
+        m_points.append(&points, cursor.index, runEnd);
+
+        cursor.index = runEnd;
+        if (cursor.index < points.size())
+        {
+            cursor.time = points[cursor.index].ri.time;
+            heap.push(cursor);
+        }
+        else if (releasesParts)
+        {
+            // release parts as soon as they are consumed to keep the peak low
+            points.release();
+        }
+    }
+    pointsChanged(firstMergedIndex);
+
+    if (!m_isOverviewFixed)
+    {
+        for (size_t i = 0; i < parts->size(); i++)
+        {
+            m_overview.merge(&(*parts)[i]->m_overview);
+        }
+    }
+
+    // an occurrence is only split by a gap of more than 100 s (as in
+    // processK1), so one that continues within that gap in the next log
+    // is the same flight crossing midnight and gets stitched, to one
+    // merged before too
+    std::map<int, size_t> lastOccurrences;
+    for (size_t i = 0; i < m_occurrences.size(); i++)
+    {
+        lastOccurrences[m_occurrences[i].tailNumber] = i;
+    }
+
+    m_occurrences.reserve(m_occurrences.size() + occurrenceCount);
+    for (size_t i = 0; i < parts->size(); i++)
+    {
+        std::vector<OccurrenceRecord> &occurrences = (*parts)[i]->m_occurrences;
+        if (occurrences.size() > 0)
+        {
+            MergeCursor cursor = { occurrences[0].firstTime, i, 0 };
+            heap.push(cursor);
+        }
+    }
+    while (!heap.empty())
+    {
+        MergeCursor cursor = heap.top();
+        heap.pop();
+
+        std::vector<OccurrenceRecord> &occurrences = (*parts)[cursor.part]->m_occurrences;
+        OccurrenceRecord record = occurrences[cursor.index];
+
+        std::map<int, size_t>::iterator last = lastOccurrences.find(record.tailNumber);
+        if (last != lastOccurrences.end() && record.firstTime <= m_occurrences[last->second].lastTime + OCCURRENCE_GAP)
+        {
+            OccurrenceRecord &stitched = m_occurrences[last->second];
+            if (record.lastTime > stitched.lastTime) stitched.lastTime = record.lastTime;
+        }
+        else
+        {
+            lastOccurrences[record.tailNumber] = m_occurrences.size();
+            m_occurrences.push_back(record);
+        }
+
+        if (++cursor.index < occurrences.size())
+        {
+            cursor.time = occurrences[cursor.index].firstTime;
+            heap.push(cursor);
+        }
+    }
+
+    // statistics follow the stitched occurrences, point attribution was
+    // only possible while parsing and is added up part by part
+    m_statistics.clearOccurrences();
+    std::vector<OccurrenceRecord>::iterator iter;
+    for (iter = m_occurrences.begin(); iter != m_occurrences.end(); ++iter)
+    {
+        m_statistics.addOccurrence(tailNumberOf((*iter).tailNumber), (*iter).firstTime, (*iter).lastTime);
+    }
+    for (size_t i = 0; i < parts->size(); i++)
+    {
+        m_statistics.mergePoints((*parts)[i]->statistics());
+    }
+
+    unlock();
+}
+
+void UvdState::preprocess(UvdTime currentTime)
+{
+    if (m_isRealtimeMode)
+    {
+        if (m_realtimeStartTime < 0)
+        {
+            UvdLog("first realtime line.\n");
+            m_realtimeStartTime = currentTime;
+        }
+        
+        m_lastTime = currentTime;
+    }
+}
+
+void UvdState::postprocess(UvdTime currentTime)
+{
+    TRACE_SPAN("postprocess");
+
+    // only this thread changes the pending table, so it is scanned without
+    // the lock (and vanished tracks are alerted meanwhile); most lines
+    // finalize nothing
+    m_associator.expire(currentTime);
+
+    bool hasExpired = false;
+    for (size_t i = 0; i < m_pendingOccurrences.size(); i++)
+    {
+        const OccurrenceRecord &record = m_pendingOccurrences[i];
+        if (record.lastTime + OCCURRENCE_GAP < currentTime)
+        {
+            hasExpired = true;
+            if (m_alerts == NULL) break;
+            // blips are dropped below, they never were occurrences
+            if (record.lastTime - record.firstTime > UVD_SECOND) m_alerts->occurrenceEnded(record, currentTime);
+        }
+    }
+
+    if (hasExpired)
+    {
+        lock();
+        size_t writeIndex = 0;
+        for (size_t i = 0; i < m_pendingOccurrences.size(); i++)
+        {
+            OccurrenceRecord record = m_pendingOccurrences[i];
+            if (record.lastTime + OCCURRENCE_GAP >= currentTime)
+            {
+                m_pendingOccurrences[writeIndex++] = record;
+            }
+            else if (record.lastTime - record.firstTime > UVD_SECOND)
+            {
+                m_occurrences.push_back(record);
+                m_statistics.addOccurrence(record.tailNumber, record.firstTime, record.lastTime);
+            }
+        }
+        m_pendingOccurrences.resize(writeIndex);
+        unlock();
+    }
+
+    if (m_isRealtimeMode && m_retentionFunction != NULL)
+    {
+        m_retentionFunction(m_retentionContext, currentTime);
+    }
+}
+
+void UvdState::clearData()
+{
+    lock();
+    m_points.clear();
+    m_pointIndex.clear();
+    m_occurrences.clear();
+    m_recalledOccurrences.clear();
+    m_pendingOccurrences.clear();
+    m_associator.clear();
+    m_statistics.clear();
+    if (!m_isOverviewFixed) m_overview.clear();
+    memset(&m_recvStats, 0, sizeof(RecvStats));
+    if (m_changeFunction != NULL) m_changeFunction(m_changeContext, UVD_TIME_MIN, UVD_TIME_MAX);
+    unlock();
+}
+
+// called with the state locked by whoever rewrote the points from fromIndex on
+void UvdState::pointsChanged(size_t fromIndex)
+{
+    // anything after the last point before them may have changed
+    UvdTime firstTime = fromIndex > 0 && fromIndex <= m_points.size() ? m_points[fromIndex - 1].ri.time : UVD_TIME_MIN;
+    pointsChanged(fromIndex, firstTime, UVD_TIME_MAX);
+}
+
+// as above, by a rewriter that knows only the points between firstTime and
+// lastTime changed and the later ones just moved
+void UvdState::pointsChanged(size_t fromIndex, UvdTime firstTime, UvdTime lastTime)
+{
+    m_pointIndex.rebuild(&m_points, fromIndex);
+    if (m_changeFunction != NULL) m_changeFunction(m_changeContext, firstTime, lastTime);
+}
+
+bool UvdState::getTimeBounds(UvdTime *firstTime, UvdTime *lastTime)
+{
+    // explicit bounds of a partially loaded log, otherwise the points'
+    if (m_boundsLastTime >= 0)
+    {
+        *firstTime = m_boundsFirstTime;
+        *lastTime = m_boundsLastTime;
+        return true;
+    }
+
+    if (m_points.size() == 0) return false;
+
+    *firstTime = m_points[0].ri.time;
+    *lastTime = m_points[m_points.size() - 1].ri.time;
+    return true;
+}
+
+void UvdState::lock()
+{
+    // never switched off again, a holder must always find it on in unlock
+    if (m_isShared)
+    {
+        MutexLock(&m_lock);
+    }
+}
+
+void UvdState::unlock()
+{
+    if (m_isShared)
+    {
+        MutexUnlock(&m_lock);
+    }
+}
+
+std::vector<OccurrenceRecord> *UvdState::occurrences()
+{
+    if (!m_isRealtimeMode)
+    {
+        return &m_occurrences;
+    }
+    else
+    {
+        // occurrences read back for a view of spilled history come first
+        m_tempOccurrences = m_recalledOccurrences;
+        m_tempOccurrences.insert(m_tempOccurrences.end(), m_occurrences.begin(), m_occurrences.end());
+        
+        for (size_t i = 0; i < m_pendingOccurrences.size(); i++)
+        {
+            OccurrenceRecord record = m_pendingOccurrences[i];
+            record.lastTime = m_lastTime;
+            m_tempOccurrences.push_back(record);
+        }
+        
+        return &m_tempOccurrences;
+    }
+}
+
+int UvdState::dayNumber(int yyyy, int mm, int dd)
+{
+    // days since 1970-01-01 in the proleptic Gregorian calendar
+    int y = yyyy - (mm <= 2);
+    int era = (y >= 0 ? y : y - 399) / 400;
+    int yearOfEra = y - era * 400;
+    int dayOfYear = (153 * (mm + (mm > 2 ? -3 : 9)) + 2) / 5 + dd - 1;
+    int dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + dayOfEra - 719468;
+}
+
+void UvdState::dateForDayNumber(int day, int *yyyy, int *mm, int *dd)
+{
+    // the inverse of dayNumber
+    int z = day + 719468;
+    int era = (z >= 0 ? z : z - 146096) / 146097;
+    int dayOfEra = z - era * 146097;
+    int yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    int dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    int monthIndex = (5 * dayOfYear + 2) / 153;
+    *dd = dayOfYear - (153 * monthIndex + 2) / 5 + 1;
+    *mm = monthIndex < 10 ? monthIndex + 3 : monthIndex - 9;
+    *yyyy = yearOfEra + era * 400 + (*mm <= 2);
+}
@@ -0,0 +1,143 @@
+
+#ifndef __UVDSTATE_H__
+#define __UVDSTATE_H__
+
+#include <map>
+#include <vector>
+#include "AircraftStatistics.h"
+#include "AlertEngine.h"
+#include "ChunkedVector.h"
+#include "Mutex.h"
+#include "PointIndex.h"
+#include "TrackAssociator.h"
+#include "UvdOverview.h"
+#include "UvdRecords.h"
+#include "UvdTime.h"
+
+#define PENDING_OCCURRENCE_RESERVE 256
+#define OCCURRENCE_RESERVE 4096
+#define OCCURRENCE_GAP (100 * UVD_SECOND)     // K1 silence that ends an occurrence
+
+typedef struct {
+    unsigned long k1Conf3Lines;
+    unsigned long k2Conf3Lines;
+    unsigned long k1Conf4Lines;
+    unsigned long k2Conf4Lines;
+} RecvStats;
+
+// called before a time range is drawn, for states that hold only part of a log
+typedef void (*RangeFunction)(void *context, UvdTime leftTime, UvdTime rightTime);
+
+// called after every realtime line, for states that bound their memory
+typedef void (*RetentionFunction)(void *context, UvdTime currentTime);
+
+// called with the state locked when the points between firstTime and
+// lastTime were added or rewritten, for caches of what was drawn of them
+typedef void (*ChangeFunction)(void *context, UvdTime firstTime, UvdTime lastTime);
+
+class UvdState
+{
+    friend class UvdSnapshot;
+
+    // storage the ingest path appends to is reserved or chunked, so a
+    // line doesn't allocate once the state has warmed up
+    std::vector<OccurrenceRecord> m_pendingOccurrences;    // by tail number
+    std::vector<OccurrenceRecord> m_occurrences;
+    std::vector<OccurrenceRecord> m_tempOccurrences;
+    std::vector<OccurrenceRecord> m_recalledOccurrences;
+    ChunkedVector<K2> m_points;
+    PointIndex m_pointIndex;
+    UvdOverview m_overview;
+    bool m_isOverviewFixed;
+    TrackAssociator m_associator;
+    
+    bool m_isRealtimeMode;
+    bool m_isShared;
+    volatile double m_loadProgress;
+    volatile bool m_isLoadCancelled;
+    UvdTime m_realtimeStartTime;
+    UvdTime m_lastTime;
+    
+    int m_yyyy, m_mm, m_dd;
+    
+    RecvStats m_recvStats;
+    AircraftStatistics m_statistics;
+
+    bool m_hidesTailNumbers;
+    bool m_hasPseudonyms;               // of a part hidden when merged
+    std::map<int, int> m_pseudonyms;    // by tail number, kept across merges
+    std::map<int, int> m_tailNumbers;   // by pseudonym
+
+    RangeFunction m_rangeFunction;
+    void *m_rangeContext;
+    RetentionFunction m_retentionFunction;
+    void *m_retentionContext;
+    ChangeFunction m_changeFunction;
+    void *m_changeContext;
+    AlertEngine *m_alerts;
+    UvdTime m_boundsFirstTime, m_boundsLastTime;
+    
+    Mutex m_lock;
+
+    void preprocess(UvdTime currentTime);
+    void postprocess(UvdTime currentTime);
+    void hideTailNumbers(std::vector<OccurrenceRecord> *occurrences);
+    void hideTailNumbers(ChunkedVector<K2> *points);
+    int tailNumberOf(int tailNumber);
+
+public:
+    UvdState();
+    ~UvdState();
+    
+    void processK1(K1 k1);
+    void processK2(K2 k2);
+    void finalizeLogFile();
+    void mergeStates(std::vector<UvdState *> *parts, bool releasesParts);
+    void clearData();
+    void pointsChanged(size_t fromIndex);
+    void pointsChanged(size_t fromIndex, UvdTime firstTime, UvdTime lastTime);
+
+    void setStartDate(int yyyy, int mm, int dd);
+    void startRealtimeMode() { m_isRealtimeMode = true; m_isShared = true; m_occurrences.reserve(OCCURRENCE_RESERVE); }
+    void setHidesTailNumbers(bool flag) { m_hidesTailNumbers = flag; }
+
+    std::vector<OccurrenceRecord> *occurrences();
+    ChunkedVector<K2> *points() { return &m_points; }
+    PointIndex *pointIndex() { return &m_pointIndex; }
+    UvdOverview *overview() { return &m_overview; }
+    std::vector<OccurrenceRecord> *finalizedOccurrences() { return &m_occurrences; }
+    std::vector<OccurrenceRecord> *recalledOccurrences() { return &m_recalledOccurrences; }
+    AircraftStatistics *statistics() { return &m_statistics; }
+    bool hidesTailNumbers() { return m_hidesTailNumbers; }
+
+    void setRangeFunction(RangeFunction function, void *context) { m_rangeFunction = function; m_rangeContext = context; }
+    void ensureRange(UvdTime leftTime, UvdTime rightTime) { if (m_rangeFunction != NULL) m_rangeFunction(m_rangeContext, leftTime, rightTime); }
+    void setTimeBounds(UvdTime firstTime, UvdTime lastTime) { m_boundsFirstTime = firstTime; m_boundsLastTime = lastTime; }
+    bool getTimeBounds(UvdTime *firstTime, UvdTime *lastTime);
+    void setRetentionFunction(RetentionFunction function, void *context) { m_retentionFunction = function; m_retentionContext = context; }
+    void setChangeFunction(ChangeFunction function, void *context) { m_changeFunction = function; m_changeContext = context; }
+    // evaluated on the ingest thread, for realtime states
+    void setAlertEngine(AlertEngine *alerts) { m_alerts = alerts; }
+    // for states that hold only part of a log, whose loader fills the
+    // overview of all of it: points added or cleared no longer change it
+    void setOverviewFixed(bool flag) { m_isOverviewFixed = flag; }
+
+    // filled by a loader thread while the view is already drawing it
+    void startLoading() { m_isShared = true; m_isLoadCancelled = false; m_loadProgress = 0.0; }
+    void setLoadProgress(double progress) { m_loadProgress = progress; }
+    void finishLoading() { m_loadProgress = -1.0; }
+    void cancelLoading() { m_isLoadCancelled = true; }
+    bool isLoading() { return m_loadProgress >= 0.0; }
+    bool isLoadCancelled() { return m_isLoadCancelled; }
+    double loadProgress() { return m_loadProgress; }
+    bool isRealtimeStarted() { return m_isRealtimeMode && m_realtimeStartTime >= 0; }
+    bool getStartDate(int *yyyy, int *mm, int *dd) { *yyyy = m_yyyy; *mm = m_mm; *dd = m_dd; return m_yyyy != 0; }
+    
+    void lock();
+    void unlock();
+
+    static int dayNumber(int yyyy, int mm, int dd);
+    static void dateForDayNumber(int day, int *yyyy, int *mm, int *dd);
+};
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef __UVDTIME_H__
+#define __UVDTIME_H__
+
+#include <math.h>
+
+// Time on the state clock: microseconds since midnight of the start date.
+// Integer, so equal times compare equal and points fall into pixel columns
+// by exact integer arithmetic, however long the span.
+typedef long long UvdTime;
+
+#define UVD_SECOND 1000000LL
+#define UVD_HOUR (3600 * UVD_SECOND)
+#define UVD_DAY (86400 * UVD_SECOND)
+
+// open ends of time ranges
+#define UVD_TIME_MIN (-0x7fffffffffffffffLL - 1)
+#define UVD_TIME_MAX 0x7fffffffffffffffLL
+
+inline double UvdTimeSeconds(UvdTime time) { return time / 1000000.0; }
+inline UvdTime UvdTimeFromSeconds(double seconds) { return (UvdTime)floor(seconds * 1000000.0 + 0.5); }
+
+#endif
@@ -0,0 +1,439 @@
+// Synthetic rtl-uvd feed: listens on a TCP port and emits K1/K2 lines in the
+// format RtlUvdParser::processLine expects, for load testing UVDG. With
+// --shm it is instead the reference producer of a RecordRing, writing the
+// same records into shared memory. A client sending the RtlUvdWire hello
+// gets binary frames instead of lines.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+#include "Socket.h"
+#include "Clock.h"
+#include "RecordRing.h"
+#include "RtlUvdWire.h"
+#include "Thread.h"
+
+#define SEND_BUFFER_SIZE (64 * 1024)
+#define RING_BATCH_RECORDS 1024
+#define HELLO_BUFFER_SIZE 256
+#define TICK_MS 1
+#define MAX_GENERATED_ALTITUDE 9990
+
+typedef struct {
+    int port;
+    int aircraftCount;
+    double lineRate;
+    double duplicateRatio;
+    double confidence4Ratio;
+    double k1Ratio;
+    long long startTime;    // time of day in us, -1 for the local clock
+    double timeScale;       // simulated seconds per real second
+    unsigned long lineLimit;
+    unsigned int seed;
+    const char *ringName;   // NULL to serve TCP
+    bool isTextOnly;        // ignores the binary hello, as rtl-uvd itself
+} FeedOptions;
+
+typedef struct {
+    int tailNumber;
+    double alt;
+    double climbRate;
+    int fuel;
+    int amplitude;
+    double expiryTime;
+} Aircraft;
+
+typedef struct {
+    std::vector<Aircraft> aircrafts;
+    long long simulationStart;
+    long long lastLineTime;
+    double lastSimulationTime;
+    unsigned long lineCount;
+    unsigned long duplicateCount;
+    RingRecord previous;
+} Feed;
+
+static double randomUnit()
+{
+    return rand() / (RAND_MAX + 1.0);
+}
+
+static void spawnAircraft(Aircraft *aircraft, double time)
+{
+    aircraft->tailNumber = 10000 + rand() % 90000;
+    aircraft->alt = 300 + randomUnit() * (MAX_GENERATED_ALTITUDE - 300);
+    aircraft->climbRate = (randomUnit() - 0.5) * 20.0;
+    aircraft->fuel = (rand() % 5 == 0) ? 0 : 10 + rand() % 90;
+    aircraft->amplitude = 0x30 + rand() % 0xc0;
+    aircraft->expiryTime = time + 600 + randomUnit() * 3000;
+}
+
+static void advanceAircraft(Aircraft *aircraft, double deltaTime)
+{
+    aircraft->alt += aircraft->climbRate * deltaTime;
+    if (aircraft->alt < 100 || aircraft->alt > MAX_GENERATED_ALTITUDE)
+    {
+        aircraft->climbRate = -aircraft->climbRate;
+        aircraft->alt = aircraft->alt < 100 ? 100 : MAX_GENERATED_ALTITUDE;
+    }
+
+    if (randomUnit() < 0.001)
+    {
+        aircraft->climbRate = (randomUnit() - 0.5) * 20.0;
+    }
+}
+
+static long long localTimeOfDay()
+{
+    // wait for the second to tick over, so the result is exact to the clock
+    time_t start = time(NULL);
+    time_t now;
+    while ((now = time(NULL)) == start) ThreadSleep(1);
+
+    struct tm date = *localtime(&now);
+    return (date.tm_hour * 3600LL + date.tm_min * 60 + date.tm_sec) * 1000000;
+}
+
+static void startFeed(Feed *feed, FeedOptions *options)
+{
+    feed->aircrafts.resize(options->aircraftCount);
+    feed->simulationStart = options->startTime >= 0 ? options->startTime : localTimeOfDay();
+    for (int i = 0; i < options->aircraftCount; i++)
+    {
+        spawnAircraft(&feed->aircrafts[i], 0.0);
+    }
+
+    feed->lastLineTime = -1;
+    feed->lastSimulationTime = 0.0;
+    feed->lineCount = 0;
+    feed->duplicateCount = 0;
+}
+
+// false for a repeat of the previous record
+static bool nextRecord(Feed *feed, FeedOptions *options, RingRecord *record)
+{
+    if (feed->lineCount > 0 && randomUnit() < options->duplicateRatio)
+    {
+        *record = feed->previous;
+        feed->duplicateCount++;
+        feed->lineCount++;
+        return false;
+    }
+
+    // spread the lines of this tick over the tick, strictly increasing,
+    // as identical timestamps are dropped by the duplicate detector
+    double lineElapsed = (double)feed->lineCount / options->lineRate;
+    double simulationTime = lineElapsed * options->timeScale;
+    long long lineTime = feed->simulationStart + (long long)(simulationTime * 1000000.0);
+    if (lineTime <= feed->lastLineTime) lineTime = feed->lastLineTime + 1;
+    feed->lastLineTime = lineTime;
+
+    Aircraft *aircraft = &feed->aircrafts[rand() % options->aircraftCount];
+    if (simulationTime > aircraft->expiryTime)
+    {
+        spawnAircraft(aircraft, simulationTime);
+    }
+    advanceAircraft(aircraft, (simulationTime - feed->lastSimulationTime) * options->aircraftCount);
+    feed->lastSimulationTime = simulationTime;
+
+    bool isK1 = randomUnit() < options->k1Ratio;
+    bool isConfidence4 = randomUnit() < options->confidence4Ratio;
+
+    record->type = isK1 ? RING_RECORD_K1 : RING_RECORD_K2;
+    record->confidence = isConfidence4 ? 4 : 3;
+    record->timeOfDay = lineTime % (86400LL * 1000000);
+    record->amplitude = aircraft->amplitude + rand() % 8;
+    record->value = isK1 ? aircraft->tailNumber : (int)aircraft->alt;
+    record->fuel = isK1 ? 0 : aircraft->fuel;
+    record->reserved = 0;
+
+    feed->previous = *record;
+    feed->lineCount++;
+    return true;
+}
+
+static int formatLine(char *line, const RingRecord *record)
+{
+    // K1 14:57:41.207.405 [ 1776] {087} **** :01234
+    // K2 14:57:41.212.757 [ 5352] {088} **** FL  770m [F025]+  F:40%
+
+    int seconds = (int)(record->timeOfDay / 1000000);
+    int usec = (int)(record->timeOfDay % 1000000);
+    const char *confidence = record->confidence == 4 ? "****" : "***.";
+    bool isK1 = record->type == RING_RECORD_K1;
+
+    int length = sprintf(line, "K%c %02d:%02d:%02d.%03d.%03d [%5d] {%03X} %s ",
+                         isK1 ? '1' : '2',
+                         seconds / 3600, (seconds / 60) % 60, seconds % 60, usec / 1000, usec % 1000,
+                         rand() % 10000, record->amplitude, confidence);
+
+    if (isK1)
+    {
+        length += sprintf(line + length, ":%05d\n", record->value);
+    }
+    else
+    {
+        length += sprintf(line + length, "FL %4dm [F%03d]+  F:%d%%\n", record->value, rand() % 100, record->fuel);
+    }
+
+    return length;
+}
+
+// true once the client has sent the hello, answered then
+static bool receiveHello(Socket client, char *hello, int *helloLength, bool *isConnected)
+{
+    if (!SocketIsReadable(client, 0)) return false;
+
+    int received = SocketRecv(client, hello + *helloLength, HELLO_BUFFER_SIZE - 1 - *helloLength);
+    if (received <= 0)
+    {
+        *isConnected = false;
+        return false;
+    }
+    *helloLength += received;
+    hello[*helloLength] = '\x00';
+
+    char *lineEnd = strchr(hello, '\n');
+    if (lineEnd == NULL)
+    {
+        if (*helloLength == HELLO_BUFFER_SIZE - 1) *helloLength = 0;
+        return false;
+    }
+
+    *lineEnd = '\x00';
+    bool isHello = RtlUvdWire::isHello(hello);
+    *helloLength = 0;
+    if (!isHello) return false;
+
+    // the last text line, frames follow it
+    char answer[64];
+    int length = sprintf(answer, "%s\n", WIRE_HELLO);
+    if (SocketSend(client, answer, length) < 0) *isConnected = false;
+    return true;
+}
+
+// to client as text lines or wire frames, or into ring as records
+static bool runFeed(Socket client, RecordRing *ring, FeedOptions *options)
+{
+    Feed feed;
+    startFeed(&feed, options);
+    long long startLocal = ClockMicroseconds();
+
+    char *buffer = (char *)malloc(SEND_BUFFER_SIZE + 256);
+    char previousLine[256];
+    previousLine[0] = '\x00';
+
+    RtlUvdWire wire;
+    bool isBinary = false;
+    char hello[HELLO_BUFFER_SIZE];
+    int helloLength = 0;
+
+    long long reportLocal = startLocal;
+    unsigned long reportLines = 0;
+
+    bool isConnected = true;
+    while (isConnected && (options->lineLimit == 0 || feed.lineCount < options->lineLimit))
+    {
+        long long nowLocal = ClockMicroseconds();
+        double elapsed = (nowLocal - startLocal) / 1000000.0;
+        unsigned long dueLines = (unsigned long)(elapsed * options->lineRate);
+        if (options->lineLimit > 0 && dueLines > options->lineLimit) dueLines = options->lineLimit;
+
+        if (ring == NULL && !isBinary && !options->isTextOnly)
+        {
+            isBinary = receiveHello(client, hello, &helloLength, &isConnected);
+            if (isBinary) printf("client switched to binary frames.\n");
+        }
+
+        int length = 0;
+        int batchRecords = 0;
+        while (feed.lineCount < dueLines && length < SEND_BUFFER_SIZE && batchRecords < RING_BATCH_RECORDS)
+        {
+            RingRecord record;
+            bool isNew = nextRecord(&feed, options, &record);
+
+            if (ring != NULL)
+            {
+                // a full ring drops the record, as a decoder would
+                ring->write(&record);
+                batchRecords++;
+            }
+            else if (isBinary)
+            {
+                // a repeat has the same time, a zero delta
+                length += wire.encode(&record, (unsigned char *)buffer + length);
+            }
+            else if (!isNew)
+            {
+                length += sprintf(buffer + length, "%s", previousLine);
+            }
+            else
+            {
+                int lineLength = formatLine(buffer + length, &record);
+                memcpy(previousLine, buffer + length, lineLength + 1);
+                length += lineLength;
+            }
+        }
+
+        if (ring != NULL)
+        {
+            ring->publish();
+        }
+        else if (isConnected && length > 0 && SocketSend(client, buffer, length) < 0)
+        {
+            isConnected = false;
+        }
+
+        if (nowLocal >= reportLocal + 1000000)
+        {
+            printf("%lu lines sent, %.0f lines/s.\n", feed.lineCount, (feed.lineCount - reportLines) * 1000000.0 / (nowLocal - reportLocal));
+            reportLocal = nowLocal;
+            reportLines = feed.lineCount;
+        }
+
+        if (feed.lineCount >= dueLines)
+        {
+            ThreadSleep(TICK_MS);
+        }
+    }
+
+    if (ring != NULL)
+    {
+        ring->finish();
+        printf("ring done: %lu records, %lu duplicates, %llu dropped by a full ring.\n",
+               feed.lineCount, feed.duplicateCount, ring->droppedCount());
+    }
+    else
+    {
+        if (isConnected)
+        {
+            // not a K line, so processLine ignores it; tells the benchmark what to expect
+            char trailer[128];
+            sprintf(trailer, "# feedgen: %lu lines, %lu duplicates", feed.lineCount, feed.duplicateCount);
+
+            int length = isBinary ? wire.encodeComment(trailer, (unsigned char *)buffer) : sprintf(buffer, "%s\n", trailer);
+            SocketSend(client, buffer, length);
+        }
+
+        printf("client done: %lu lines, %lu duplicates.\n", feed.lineCount, feed.duplicateCount);
+    }
+
+    free(buffer);
+    return isConnected;
+}
+
+static void printUsage()
+{
+    printf("usage: uvdg-feedgen [options]\n");
+    printf("  --port N          listen port (31003)\n");
+    printf("  --aircraft N      simultaneously active aircraft (40)\n");
+    printf("  --rate N          lines per second (1000)\n");
+    printf("  --duplicates R    ratio of repeated lines, 0..1 (0.05)\n");
+    printf("  --conf4 R         ratio of confidence 4 lines, 0..1 (0.7)\n");
+    printf("  --k1 R            ratio of K1 lines, 0..1 (0.3)\n");
+    printf("  --start HH:MM:SS  simulated start time (local clock), use 23:59:00 for a midnight crossing\n");
+    printf("  --time-scale R    simulated seconds per real second (1)\n");
+    printf("  --lines N         stop after N lines per client (0 = never)\n");
+    printf("  --seed N          random seed\n");
+    printf("  --text-only       ignore the binary hello of clients, as rtl-uvd does\n");
+    printf("  --shm NAME        write records into the shared-memory ring NAME instead of serving TCP\n");
+}
+
+int main(int argc, char **argv)
+{
+    FeedOptions options;
+    options.port = 31003;
+    options.aircraftCount = 40;
+    options.lineRate = 1000.0;
+    options.duplicateRatio = 0.05;
+    options.confidence4Ratio = 0.7;
+    options.k1Ratio = 0.3;
+    options.startTime = -1;
+    options.timeScale = 1.0;
+    options.lineLimit = 0;
+    options.seed = (unsigned int)time(NULL);
+    options.ringName = NULL;
+    options.isTextOnly = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        const char *value = (i + 1 < argc) ? argv[i + 1] : NULL;
+
+        if (strcmp(arg, "--text-only") == 0)
+        {
+            options.isTextOnly = true;
+            continue;
+        }
+
+        if (strcmp(arg, "--help") == 0 || value == NULL)
+        {
+            printUsage();
+            return strcmp(arg, "--help") == 0 ? 0 : 1;
+        }
+
+        i++;
+
+        if (strcmp(arg, "--port") == 0) options.port = atoi(value);
+        else if (strcmp(arg, "--aircraft") == 0) options.aircraftCount = atoi(value);
+        else if (strcmp(arg, "--rate") == 0) options.lineRate = atof(value);
+        else if (strcmp(arg, "--duplicates") == 0) options.duplicateRatio = atof(value);
+        else if (strcmp(arg, "--conf4") == 0) options.confidence4Ratio = atof(value);
+        else if (strcmp(arg, "--k1") == 0) options.k1Ratio = atof(value);
+        else if (strcmp(arg, "--time-scale") == 0) options.timeScale = atof(value);
+        else if (strcmp(arg, "--lines") == 0) options.lineLimit = strtoul(value, NULL, 10);
+        else if (strcmp(arg, "--seed") == 0) options.seed = (unsigned int)atoi(value);
+        else if (strcmp(arg, "--shm") == 0) options.ringName = value;
+        else if (strcmp(arg, "--start") == 0)
+        {
+            int hh = 0, mm = 0, ss = 0;
+            sscanf(value, "%d:%d:%d", &hh, &mm, &ss);
+            options.startTime = (hh * 3600LL + mm * 60 + ss) * 1000000;
+        }
+        else
+        {
+            printUsage();
+            return 1;
+        }
+    }
+
+    if (options.aircraftCount < 1) options.aircraftCount = 1;
+    if (options.lineRate < 1.0) options.lineRate = 1.0;
+
+    srand(options.seed);
+
+    if (options.ringName != NULL)
+    {
+        RecordRing ring;
+        if (!ring.create(options.ringName, RECORD_RING_CAPACITY))
+        {
+            printf("can't create the ring %s.\n", options.ringName);
+            return 1;
+        }
+
+        printf("feeding %.0f records/s from %d aircraft into the ring %s.\n", options.lineRate, options.aircraftCount, options.ringName);
+        runFeed(SOCKET_INVALID, &ring, &options);
+        return 0;
+    }
+
+    if (!SocketStartup()) return 1;
+
+    Socket listener = SocketListen(options.port);
+    if (listener == SOCKET_INVALID) return 1;
+
+    printf("feeding %.0f lines/s from %d aircraft on port %d.\n", options.lineRate, options.aircraftCount, options.port);
+
+    while (true)
+    {
+        Socket client = SocketAccept(listener);
+        if (client == SOCKET_INVALID) continue;
+
+        printf("client connected.\n");
+        runFeed(client, NULL, &options);
+        SocketClose(client);
+    }
+
+    return 0;
+}
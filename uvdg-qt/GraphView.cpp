@@ -4,41 +4,58 @@
 #include <QtCore/QtCore>
 #include <QtGui/QtGui>
 
+#include "SpanRecorder.h"
+
 #define OCCURRENCE_LANE_HEIGHT 15
 #define OCCURRENCE_LANES_HEIGHT 76
 #define OCCURRENCE_FIRST_LANE_OFFSET 1
 #define TIME_SCROLLER_HEIGHT 20
+#define LAYER_DATA 1
+#define LAYER_LANES 2
+#define LAYER_SCROLLER 4
+#define LAYER_HUD 8             // ground, times, realtime line, status and latency boxes
+#define LAYER_ALL 15
+#define OVERVIEW_MIN_VALUE 48       // of the least dense column that has points
 #define NOTIFICATION_BOX_WIDTH 200
 #define NOTIFICATION_BOX_HEIGHT 20
-#define STATUS_BOX_WIDTH 400
+#define STATUS_BOX_WIDTH 600
 #define STATUS_BOX_HEIGHT 20
+#define LATENCY_BOX_WIDTH 640
+#define LATENCY_BOX_HEIGHT 20
+#define HOVER_BOX_WIDTH 260
+#define HOVER_BOX_LINE_HEIGHT 15
+#define LATENCY_DUMP_PATH "uvdg-latency.txt"
+#define SPAN_DUMP_PATH "uvdg-trace.json"
+#define STATISTICS_TOP_COUNT 50
 #define NORM_REALTIME_MARKER_OFFSET 0.9
+#define FILTER_AMPLITUDE_STEP 10
+#define FILTER_ALTITUDE_BAND 500
+#define FILTER_FUEL_BAND_COUNT 5
+
+// F cycles through these, fuel 0 means no fuel reported
+static const int fuelBandMin[FILTER_FUEL_BAND_COUNT] = { INT_MIN, 0, 1, 34, 67 };
+static const int fuelBandMax[FILTER_FUEL_BAND_COUNT] = { INT_MAX, 0, 33, 66, 100 };
 
 GraphView::GraphView(UvdState *state)
 {
     m_state = state;
 
     m_bitmapGenerator = new UvdBitmapGenerator(state);
+    m_bitmapGenerator->setIndexesPoints(true);
     m_image = NULL;
-
-    m_state->lock();
-    std::vector<K2> *points = m_state->points();
-    if (points->size() > 0)
-    {
-        K2 firstPoint = points->at(0);
-        m_firstTime = firstPoint.ri.time;
-        K2 lastPoint = points->at(points->size() - 1);
-        m_lastTime = lastPoint.ri.time;
-    }
-    else
-    {
-        m_firstTime = -1.0;
-        m_lastTime = 0.0;
-    }
-    m_state->unlock();
+    m_lanesImage = NULL;
+    m_scrollerImage = NULL;
+    m_frameImage = NULL;
+    m_invalidLayers = LAYER_ALL;
+    m_overviewImage = NULL;
+    m_overviewVersion = 0;
+    m_overviewFirstTime = -1;
+    m_overviewLastTime = -1;
+
+    refreshTimeBounds();
     
-    m_timeOffset = 0.0;
-    m_timeSlice = 1.0;
+    m_timeOffset = 0;
+    m_timeSlice = UVD_SECOND;
     m_isLineCrossEnabled = false;
 
     m_downPoint = QPoint(-1, -1);
@@ -46,7 +63,7 @@ GraphView::GraphView(UvdState *state)
 
     m_isNotificationShown = false;
 
-    m_realtimeMarkerTime = -1.0;
+    m_realtimeMarkerTime = -1;
     m_isLockedOnRealtimeMarker = false;
 
     m_isBeepingEnabled = true;
@@ -54,7 +71,14 @@ GraphView::GraphView(UvdState *state)
     m_shouldPlayBeep = false;
     m_lastBeepTimeLocal = 0;
 
+    m_fuelBand = 0;
+    m_hoveredTailNumber = 0;
+
     m_isShowingStatusBox = true;
+    m_isShowingLatency = false;
+    m_isLoading = false;
+
+    m_tracer = NULL;
 
     m_connectionStatus = QString("LOG ONLY");
 
@@ -71,52 +95,72 @@ GraphView::~GraphView()
 {
     delete m_bitmapGenerator;
     if (m_image != NULL) delete m_image;
+    if (m_lanesImage != NULL) delete m_lanesImage;
+    if (m_scrollerImage != NULL) delete m_scrollerImage;
+    if (m_frameImage != NULL) delete m_frameImage;
+    if (m_overviewImage != NULL) delete m_overviewImage;
     delete m_beep;
 }
 
 void GraphView::paintEvent(QPaintEvent *event)
 {
+    TRACE_SPAN("GraphView::paintEvent");
+
+    // a mouse move only draws the overlays over the frame composed before
+    if (m_invalidLayers != 0) composeFrame();
+
     QPainter painter(this);
+    painter.drawImage(0, 0, *m_frameImage);
+    drawOverlays(&painter);
 
-    //
+    if (m_tracer != NULL) m_tracer->paintFinished();
+}
 
-    m_bitmapGenerator->lock();
-    painter.drawImage(QRect(0, 0, m_image->width(), m_image->height()), *m_image);
-    m_bitmapGenerator->unlock();
+void GraphView::invalidateLayers(int layers)
+{
+    m_invalidLayers |= layers;
+    update();
+}
 
-    //
+void GraphView::composeFrame()
+{
+    TRACE_SPAN("GraphView::composeFrame");
 
-    double leftTime = screenLeftTime();
-    double rightTime = screenRightTime();
+    UvdTime leftTime = screenLeftTime();
+    UvdTime rightTime = screenRightTime();
 
-    //
+    m_state->lock();
+    if (m_state->overview()->version() != m_overviewVersion) m_invalidLayers |= LAYER_SCROLLER;
+    if (m_invalidLayers & LAYER_LANES) drawLanes(leftTime, rightTime);
+    if (m_invalidLayers & LAYER_SCROLLER) drawScroller(leftTime, rightTime);
+    m_state->unlock();
 
-    painter.fillRect(QRect(0, height() - OCCURRENCE_LANES_HEIGHT, width(), OCCURRENCE_LANES_HEIGHT), QColor(0, 0, 0));
+    QPainter painter(m_frameImage);
 
-    // rate calculator
+    m_bitmapGenerator->lock();
+    painter.drawImage(0, 0, *m_image);
+    m_bitmapGenerator->unlock();
 
-    if (m_downPoint.x() >= 0 && !m_isDraggingKnob)
-    {
-        painter.setPen(QColor(255, 255, 0, 255));
-        painter.drawLine(m_downPoint, m_hoverPoint);
-        
-        int deltaX = m_hoverPoint.x() - m_downPoint.x();
-        float deltaTime = deltaX * m_timeSlice;
-        
-        int deltaY = m_downPoint.y() - m_hoverPoint.y();
-        float deltaAlt = (deltaY / (float)m_image->height()) * MAX_ALTITUDE;
-        
-        QString rateString;
-        rateString.sprintf("%.1f m/s", deltaAlt / deltaTime);
-        painter.drawText(QPoint(m_hoverPoint.x() + 4, m_hoverPoint.y() - 4), rateString);
-    }
+    painter.drawImage(0, height() - OCCURRENCE_LANES_HEIGHT, *m_lanesImage);
+    painter.drawImage(0, 0, *m_scrollerImage);
+    drawHud(&painter, leftTime, rightTime);
 
-    // occurrence lanes
-    
-    double pendingLastTimes[10];
-    for (int i = 0; i < 10; i++) pendingLastTimes[i] = 0.0;
+    m_invalidLayers = 0;
+}
 
-    m_state->lock();
+// called with the state locked
+void GraphView::drawLanes(UvdTime leftTime, UvdTime rightTime)
+{
+    TRACE_SPAN("GraphView::drawLanes");
+
+    QPainter painter(m_lanesImage);
+    painter.fillRect(QRect(0, 0, m_lanesImage->width(), m_lanesImage->height()), QColor(0, 0, 0));
+
+    int lanesTop = height() - OCCURRENCE_LANES_HEIGHT;
+    m_laneRects.clear();
+
+    UvdTime pendingLastTimes[10];
+    for (int i = 0; i < 10; i++) pendingLastTimes[i] = 0;
 
     std::vector<OccurrenceRecord> *occurrences = m_state->occurrences();
     std::vector<OccurrenceRecord>::iterator iter;
@@ -128,8 +172,8 @@ void GraphView::paintEvent(QPaintEvent *event)
             || (record.firstTime > leftTime && record.firstTime < rightTime)
             || (record.firstTime < leftTime && record.lastTime > rightTime))
         {
-            float firstX = (record.firstTime - leftTime) / m_timeSlice;
-            float lastX = (record.lastTime - leftTime) / m_timeSlice;
+            float firstX = xForTime(record.firstTime);
+            float lastX = xForTime(record.lastTime);
 
             int n;
             for (int i = 0; i < 10; i++)
@@ -142,9 +186,13 @@ void GraphView::paintEvent(QPaintEvent *event)
                 }
             }
             
-            painter.setPen(QColor(255, 255, 0));
-
             QRect rect(firstX, height() - ((n + 1) * OCCURRENCE_LANE_HEIGHT) - OCCURRENCE_FIRST_LANE_OFFSET, ceil(lastX) - firstX, OCCURRENCE_LANE_HEIGHT);
+
+            // kept in widget coordinates for the hover overlay
+            LaneRect laneRect = { rect, firstX, lastX, record.tailNumber };
+            m_laneRects.push_back(laneRect);
+
+            rect = rect.translated(0, -lanesTop);
             painter.fillRect(rect, QColor(255, 255, 0, 50));
 
             QString tailNumberString;
@@ -157,42 +205,31 @@ void GraphView::paintEvent(QPaintEvent *event)
             painter.drawText(textRect, 0, tailNumberString, &trueTextRect);
             bool textFitsRect = trueTextRect.width() < rect.width();
 
-            QColor textColor;
-            if (rect.contains(m_hoverPoint))
-            {
-                QRect stripeRect = QRect(firstX, 0, lastX - firstX, height());
-                painter.fillRect(stripeRect, QColor(255, 255, 0, 25));
-
-                painter.setPen(QColor(255, 255, 0, 255));
-                painter.drawLine(firstX, 0, firstX, height());
-                painter.drawLine(lastX, 0, lastX, height());
-                
-                if (!textFitsRect)
-                {
-                    textRect.setWidth(trueTextRect.width());
-                }
-
-                textColor = QColor(255, 255, 255, 255);
-            } else {
-                painter.setPen(QColor(255, 255, 0, 178));
-                textColor = QColor(192, 192, 192, 255);
-            }
-
+            painter.setPen(QColor(255, 255, 0, 178));
             painter.drawRect(rect);
 
-            painter.setPen(textColor);
+            painter.setPen(QColor(192, 192, 192, 255));
             painter.drawText(textRect, textFitsRect ? Qt::AlignCenter : Qt::AlignLeft, tailNumberString);
         }
     }
+}
+
+// called with the state locked
+void GraphView::drawScroller(UvdTime leftTime, UvdTime rightTime)
+{
+    QPainter painter(m_scrollerImage);
+    m_scrollerImage->fill(Qt::transparent);
+
+    updateOverviewImage();
+    painter.drawImage(0, 1, *m_overviewImage);
 
-    // scroller
     painter.setPen(QColor(255, 255, 255, 255));
     painter.drawRect(QRect(0, 0, width(), TIME_SCROLLER_HEIGHT));
 
     if (m_state->points()->size() > 1)
     {
-        float normalizedLeftTime = (leftTime - m_firstTime) / (m_lastTime - m_firstTime);
-        float normalizedRightTime = (rightTime - m_firstTime) / (m_lastTime - m_firstTime);
+        float normalizedLeftTime = (leftTime - m_firstTime) / (float)(m_lastTime - m_firstTime);
+        float normalizedRightTime = (rightTime - m_firstTime) / (float)(m_lastTime - m_firstTime);
         int knobLeftX = normalizedLeftTime * width();
         int knobRightX = normalizedRightTime * width();
 
@@ -200,76 +237,223 @@ void GraphView::paintEvent(QPaintEvent *event)
         painter.drawRect(m_knobRect);
         painter.fillRect(m_knobRect, QColor(255, 255, 255, 96));
     }
+}
 
-    m_state->unlock();
-
+void GraphView::drawHud(QPainter *painter, UvdTime leftTime, UvdTime rightTime)
+{
     // ground
 
-    painter.setPen(QColor(255, 0, 0));
-    painter.drawLine(0, height() - OCCURRENCE_LANES_HEIGHT, width(), height() - OCCURRENCE_LANES_HEIGHT);
+    painter->setPen(QColor(255, 0, 0));
+    painter->drawLine(0, height() - OCCURRENCE_LANES_HEIGHT, width(), height() - OCCURRENCE_LANES_HEIGHT);
+
+    // times
+
+    painter->setPen(QColor(255, 255, 255, 255));
+    painter->drawText(QRect(0, TIME_SCROLLER_HEIGHT + 4, 200, 20), Qt::AlignLeft, timeString(leftTime));
+    painter->drawText(QRect(width() - 200, TIME_SCROLLER_HEIGHT + 4, 200, 20), Qt::AlignRight, timeString(rightTime));
+
+    // realtime line
+
+    if (m_realtimeMarkerTime > 0)
+    {
+        float x = xForTime(m_realtimeMarkerTime);
+        painter->drawLine(x, 0, x, height());
+    }
+
+    // status box
+
+    if (m_isShowingStatusBox)
+    {
+        painter->setPen(QColor(255, 255, 255, 255));
+        QRect statusBoxRect((width() - STATUS_BOX_WIDTH) / 2, TIME_SCROLLER_HEIGHT, STATUS_BOX_WIDTH, STATUS_BOX_HEIGHT);
+        painter->drawRect(statusBoxRect);       
+
+        QString statusString;
+        statusString.sprintf("%s | %s | %s | %s | %s | BOLD %d | %s",
+                            m_state->isRealtimeStarted() ? "RT" : "LOG",
+                            m_connectionStatus.toUtf8().data(),
+                            m_isLockedOnRealtimeMarker ? "LOCK" : "NO LOCK",
+                            m_isBeepingEnabled ? "BEEP" : "NO BEEP",
+                            m_bitmapGenerator->isConfidence4Only() ? "C4" : "C3+C4",
+                            m_bitmapGenerator->boldThreshold(),
+                            filterString().toUtf8().data());
+
+        painter->drawText(statusBoxRect, Qt::AlignCenter | Qt::AlignVCenter, statusString);
+    }
+
+    // latency box
+
+    if (m_isShowingLatency && m_tracer != NULL)
+    {
+        painter->setPen(QColor(255, 255, 255, 255));
+        QRect latencyBoxRect((width() - LATENCY_BOX_WIDTH) / 2, TIME_SCROLLER_HEIGHT + STATUS_BOX_HEIGHT, LATENCY_BOX_WIDTH, LATENCY_BOX_HEIGHT);
+        painter->drawRect(latencyBoxRect);
+
+        QString latencyString("p50/p99 ms since recv:");
+        for (int i = 0; i < TraceStageCount; i++)
+        {
+            LatencyHistogram *histogram = m_tracer->histogram((TraceStage)i);
+
+            QString stageString;
+            stageString.sprintf(" | %s %.1f/%.1f", LatencyTracer::stageName((TraceStage)i),
+                                histogram->percentile(50.0) / 1000.0, histogram->percentile(99.0) / 1000.0);
+            latencyString += stageString;
+        }
+
+        painter->drawText(latencyBoxRect, Qt::AlignCenter | Qt::AlignVCenter, latencyString);
+    }
+}
+
+void GraphView::drawOverlays(QPainter *painter)
+{
+    // rate calculator
+
+    if (m_downPoint.x() >= 0 && !m_isDraggingKnob)
+    {
+        painter->setPen(QColor(255, 255, 0, 255));
+        painter->drawLine(m_downPoint, m_hoverPoint);
+        
+        int deltaX = m_hoverPoint.x() - m_downPoint.x();
+        float deltaTime = UvdTimeSeconds(deltaX * m_timeSlice);
+        
+        int deltaY = m_downPoint.y() - m_hoverPoint.y();
+        float deltaAlt = (deltaY / (float)m_image->height()) * MAX_ALTITUDE;
+        
+        QString rateString;
+        rateString.sprintf("%.1f m/s", deltaAlt / deltaTime);
+        painter->drawText(QPoint(m_hoverPoint.x() + 4, m_hoverPoint.y() - 4), rateString);
+    }
+
+    // hovered occurrence, the last lane drawn under the mouse
+
+    m_hoveredTailNumber = 0;
+
+    for (size_t i = m_laneRects.size(); i > 0; i--)
+    {
+        LaneRect *laneRect = &m_laneRects[i - 1];
+        if (!laneRect->rect.contains(m_hoverPoint)) continue;
+
+        m_hoveredTailNumber = laneRect->tailNumber;
+
+        QRect rect = laneRect->rect;
+        QRect stripeRect = QRect(laneRect->firstX, 0, laneRect->lastX - laneRect->firstX, height());
+        painter->fillRect(stripeRect, QColor(255, 255, 0, 25));
+
+        painter->setPen(QColor(255, 255, 0, 255));
+        painter->drawLine(laneRect->firstX, 0, laneRect->firstX, height());
+        painter->drawLine(laneRect->lastX, 0, laneRect->lastX, height());
+
+        // over the dimmer label of the lanes layer
+        painter->fillRect(rect, QColor(0, 0, 0));
+        painter->fillRect(rect, QColor(255, 255, 0, 50));
+        painter->drawRect(rect);
+
+        QString tailNumberString;
+        tailNumberString.sprintf("%05d", m_hoveredTailNumber);
+
+        QRect textRect = rect.adjusted(1, 1, -1, -1);
+
+        QRect trueTextRect;
+        painter->setPen(QColor(0, 0, 0, 0));
+        painter->drawText(textRect, 0, tailNumberString, &trueTextRect);
+        bool textFitsRect = trueTextRect.width() < rect.width();
+        if (!textFitsRect)
+        {
+            textRect.setWidth(trueTextRect.width());
+        }
+
+        painter->setPen(QColor(255, 255, 255, 255));
+        painter->drawText(textRect, textFitsRect ? Qt::AlignCenter : Qt::AlignLeft, tailNumberString);
+        break;
+    }
 
     // line cross
 
     if (m_isLineCrossEnabled && m_hoverPoint.y() < height()- OCCURRENCE_LANES_HEIGHT && !m_isDraggingKnob)
     {
-        painter.setPen(QColor(127, 127, 127, 178));
-        painter.drawLine(m_hoverPoint.x(), 0, m_hoverPoint.x(), height());
-        painter.drawLine(0, m_hoverPoint.y(), width(), m_hoverPoint.y());
+        painter->setPen(QColor(127, 127, 127, 178));
+        painter->drawLine(m_hoverPoint.x(), 0, m_hoverPoint.x(), height());
+        painter->drawLine(0, m_hoverPoint.y(), width(), m_hoverPoint.y());
     }
 
     // hover alt/time
 
-    painter.setPen(QColor(255, 255, 255, 255));
+    painter->setPen(QColor(255, 255, 255, 255));
 
-    double hoverTime = timeForX(m_hoverPoint.x());
+    UvdTime hoverTime = timeForX(m_hoverPoint.x());
     int hoverAlt = altForY(m_hoverPoint.y());
     QString altTimeString = QString("alt %1 time %2").arg(hoverAlt).arg(timeString(hoverTime));
-    painter.drawText(QRect(0, 0, width(), 20), Qt::AlignCenter, altTimeString);
+    painter->drawText(QRect(0, 0, width(), 20), Qt::AlignCenter, altTimeString);
 
-    // times
+    // the reply under the mouse, from the point grid of the last update
 
-    painter.drawText(QRect(0, TIME_SCROLLER_HEIGHT + 4, 200, 20), Qt::AlignLeft, timeString(leftTime));
-    painter.drawText(QRect(width() - 200, TIME_SCROLLER_HEIGHT + 4, 200, 20), Qt::AlignRight, timeString(rightTime));
+    if (m_hoverPoint.y() > TIME_SCROLLER_HEIGHT && m_hoverPoint.y() < height() - OCCURRENCE_LANES_HEIGHT && !m_isDraggingKnob)
+    {
+        drawHoverPoint(painter);
+    }
 
     // notification
 
     if (m_isNotificationShown)
     {
-        painter.setPen(QColor(127, 127, 255, 255));
+        painter->setPen(QColor(127, 127, 255, 255));
         QRect notificationRect((width() - NOTIFICATION_BOX_WIDTH) / 2, (height() - NOTIFICATION_BOX_HEIGHT) / 2, NOTIFICATION_BOX_WIDTH, NOTIFICATION_BOX_HEIGHT);
-        painter.drawRect(notificationRect);
-        painter.fillRect(notificationRect, QColor(127, 127, 255, 127));
+        painter->drawRect(notificationRect);
+        painter->fillRect(notificationRect, QColor(127, 127, 255, 127));
 
-        painter.setPen(QColor(255, 255, 255, 255));
-        painter.drawText(notificationRect, Qt::AlignCenter | Qt::AlignVCenter, m_notificationText);
+        painter->setPen(QColor(255, 255, 255, 255));
+        painter->drawText(notificationRect, Qt::AlignCenter | Qt::AlignVCenter, m_notificationText);
     }
+}
 
-    // realtime line
+void GraphView::drawHoverPoint(QPainter *painter)
+{
+    K2 point;
+    int pointX, pointY;
+    ColumnStats stats;
 
-    if (m_realtimeMarkerTime > 0.0)
-    {
-        float x = xForTime(m_realtimeMarkerTime);
-        painter.drawLine(x, 0, x, height());
-    }
+    m_bitmapGenerator->lock();
+    bool hasPoint = m_bitmapGenerator->nearestPoint(m_hoverPoint.x(), m_hoverPoint.y(), &point, &pointX, &pointY);
+    bool hasStats = m_bitmapGenerator->getColumnStats(hasPoint ? pointX : m_hoverPoint.x(), &stats);
+    m_bitmapGenerator->unlock();
 
-    // status box
+    if (!hasPoint && !hasStats) return;
 
-    if (m_isShowingStatusBox)
+    QStringList lines;
+    QString line;
+    if (hasPoint)
     {
-        painter.setPen(QColor(255, 255, 255, 255));
-        QRect statusBoxRect((width() - STATUS_BOX_WIDTH) / 2, TIME_SCROLLER_HEIGHT, STATUS_BOX_WIDTH, STATUS_BOX_HEIGHT);
-        painter.drawRect(statusBoxRect);       
+        painter->setPen(QColor(255, 255, 255, 255));
+        painter->drawRect(QRect(pointX - 3, pointY - 3, 6, 6));
+
+        line.sprintf(".%06d", (int)(point.ri.time % UVD_SECOND));
+        lines << "time " + timeString(point.ri.time) + line;
+        if (point.fuel == 0) line.sprintf("alt %d m, no fuel", point.alt);
+        else line.sprintf("alt %d m, fuel %d%%", point.alt, point.fuel);
+        lines << line;
+        line.sprintf("amplitude %d, confidence %d", point.ri.amplitude, point.ri.confidence);
+        lines << line;
+    }
+    if (hasStats)
+    {
+        line.sprintf("column: %d point(s), %d-%d m", stats.count, stats.minAltitude, stats.maxAltitude);
+        lines << line;
+    }
 
-        QString statusString;
-        statusString.sprintf("%s | %s | %s | %s | %s | BOLD %d",
-                            m_state->isRealtimeStarted() ? "RT" : "LOG",
-                            m_connectionStatus.toUtf8().data(),
-                            m_isLockedOnRealtimeMarker ? "LOCK" : "NO LOCK",
-                            m_isBeepingEnabled ? "BEEP" : "NO BEEP",
-                            m_bitmapGenerator->isConfidence4Only() ? "C4" : "C3+C4",
-                            m_bitmapGenerator->boldThreshold());
+    // beside the mouse, on the side with room
+    QRect boxRect(m_hoverPoint.x() + 12, m_hoverPoint.y() + 12, HOVER_BOX_WIDTH, lines.size() * HOVER_BOX_LINE_HEIGHT + 4);
+    if (boxRect.right() >= width()) boxRect.moveLeft(m_hoverPoint.x() - 12 - HOVER_BOX_WIDTH);
+    if (boxRect.bottom() >= height() - OCCURRENCE_LANES_HEIGHT) boxRect.moveBottom(m_hoverPoint.y() - 12);
+
+    painter->fillRect(boxRect, QColor(0, 0, 0, 192));
+    painter->setPen(QColor(127, 127, 255, 255));
+    painter->drawRect(boxRect);
 
-        painter.drawText(statusBoxRect, Qt::AlignCenter | Qt::AlignVCenter, statusString);
+    painter->setPen(QColor(255, 255, 255, 255));
+    for (int i = 0; i < lines.size(); i++)
+    {
+        QRect lineRect(boxRect.x() + 4, boxRect.y() + 2 + i * HOVER_BOX_LINE_HEIGHT, HOVER_BOX_WIDTH - 8, HOVER_BOX_LINE_HEIGHT);
+        painter->drawText(lineRect, Qt::AlignLeft | Qt::AlignVCenter, lines[i]);
     }
 }
 
@@ -281,6 +465,18 @@ void GraphView::resizeEvent(QResizeEvent *event)
     m_bitmapGenerator->setBitmap(m_image->bits(), m_image->width(), m_image->height());
     m_bitmapGenerator->unlock();
 
+    if (m_lanesImage != NULL) delete m_lanesImage;
+    m_lanesImage = new QImage(width(), OCCURRENCE_LANES_HEIGHT, QImage::Format_RGB32);
+    // one row more for the bottom of the outline, transparent over the data
+    if (m_scrollerImage != NULL) delete m_scrollerImage;
+    m_scrollerImage = new QImage(width(), TIME_SCROLLER_HEIGHT + 1, QImage::Format_ARGB32_Premultiplied);
+    if (m_frameImage != NULL) delete m_frameImage;
+    m_frameImage = new QImage(width(), height(), QImage::Format_RGB32);
+    if (m_overviewImage != NULL) delete m_overviewImage;
+    m_overviewImage = new QImage(width(), TIME_SCROLLER_HEIGHT - 2, QImage::Format_RGB32);
+    m_overviewFirstTime = -1;
+    m_overviewLastTime = -1;
+
     if (m_isLockedOnRealtimeMarker)
     {
         scrollToRealtimeMarker();
@@ -296,7 +492,7 @@ void GraphView::mouseMoveEvent(QMouseEvent *event)
     if (m_isDraggingKnob)
     {
         double normalizedTimeOffset = (m_hoverPoint.x() - m_knobDragOffset) / (double)width();
-        double timeOffset = (m_lastTime - m_firstTime) * normalizedTimeOffset;
+        UvdTime timeOffset = (UvdTime)((m_lastTime - m_firstTime) * normalizedTimeOffset);
         setTimeOffset(timeOffset);
         updateBitmap();
     }
@@ -327,7 +523,7 @@ void GraphView::mouseReleaseEvent(QMouseEvent *event)
 void GraphView::wheelEvent(QWheelEvent *event)
 {
     int delta = event->delta();
-    double timeOffset = m_timeOffset - delta * 0.05 * m_timeSlice * modifierMultiplier();
+    UvdTime timeOffset = m_timeOffset - (UvdTime)(delta * 0.05 * m_timeSlice * modifierMultiplier());
     setTimeOffset(timeOffset);
     
     updateBitmap();
@@ -344,8 +540,8 @@ void GraphView::keyReleaseEvent(QKeyEvent *event)
     }
     else if (key == Qt::Key_Up)
     {
-        m_timeSlice += 1.0;
-        if (m_timeSlice > 10.0) m_timeSlice = 10.0;
+        m_timeSlice += UVD_SECOND;
+        if (m_timeSlice > 10 * UVD_SECOND) m_timeSlice = 10 * UVD_SECOND;
         
         if (m_isLockedOnRealtimeMarker)
         {
@@ -356,8 +552,8 @@ void GraphView::keyReleaseEvent(QKeyEvent *event)
     }
     else if (key == Qt::Key_Down)
     {
-        m_timeSlice -= 1.0;
-        if (m_timeSlice < 1.0) m_timeSlice = 1.0;
+        m_timeSlice -= UVD_SECOND;
+        if (m_timeSlice < UVD_SECOND) m_timeSlice = UVD_SECOND;
         
         if (m_isLockedOnRealtimeMarker)
         {
@@ -368,14 +564,14 @@ void GraphView::keyReleaseEvent(QKeyEvent *event)
     }
     else if (key == Qt::Key_Left)
     {
-        double timeOffset = m_timeOffset - (10.0 * m_timeSlice * modifierMultiplier());
+        UvdTime timeOffset = m_timeOffset - (UvdTime)(10.0 * m_timeSlice * modifierMultiplier());
         setTimeOffset(timeOffset);
         
         updateBitmap();
     }
     else if (key == Qt::Key_Right)
     {
-        double timeOffset = m_timeOffset + (10.0 * m_timeSlice * modifierMultiplier());
+        UvdTime timeOffset = m_timeOffset + (UvdTime)(10.0 * m_timeSlice * modifierMultiplier());
         setTimeOffset(timeOffset);
         
         updateBitmap();
@@ -415,6 +611,105 @@ void GraphView::keyReleaseEvent(QKeyEvent *event)
 
         updateBitmap();
     }
+    else if (key == Qt::Key_W || key == Qt::Key_E)
+    {
+        PointFilter filter;
+        m_bitmapGenerator->getFilter(&filter);
+
+        int minAmplitude = filter.minAmplitude < 0 ? 0 : filter.minAmplitude;
+        minAmplitude += key == Qt::Key_W ? FILTER_AMPLITUDE_STEP : -FILTER_AMPLITUDE_STEP;
+        if (minAmplitude > 250) minAmplitude = 250;
+
+        QString text;
+        if (minAmplitude <= 0)
+        {
+            filter.minAmplitude = INT_MIN;
+            text = "Amplitude filter: OFF.";
+        }
+        else
+        {
+            filter.minAmplitude = minAmplitude;
+            text.sprintf("Minimum amplitude set to %d.", minAmplitude);
+        }
+        setFilter(&filter, text);
+    }
+    else if (key == Qt::Key_G)
+    {
+        PointFilter filter;
+        m_bitmapGenerator->getFilter(&filter);
+
+        QString text;
+        if (filter.minAltitude != INT_MIN || filter.maxAltitude != INT_MAX)
+        {
+            filter.minAltitude = INT_MIN;
+            filter.maxAltitude = INT_MAX;
+            text = "Altitude filter: OFF.";
+        }
+        else
+        {
+            // the band around the altitude under the mouse
+            int alt = altForY(m_hoverPoint.y());
+            filter.minAltitude = alt - FILTER_ALTITUDE_BAND;
+            filter.maxAltitude = alt + FILTER_ALTITUDE_BAND;
+            text.sprintf("Altitude filter: %d-%d m.", filter.minAltitude, filter.maxAltitude);
+        }
+        setFilter(&filter, text);
+    }
+    else if (key == Qt::Key_F)
+    {
+        PointFilter filter;
+        m_bitmapGenerator->getFilter(&filter);
+
+        m_fuelBand = (m_fuelBand + 1) % FILTER_FUEL_BAND_COUNT;
+        filter.minFuel = fuelBandMin[m_fuelBand];
+        filter.maxFuel = fuelBandMax[m_fuelBand];
+
+        QString text;
+        if (m_fuelBand == 0) text = "Fuel filter: OFF.";
+        else if (filter.maxFuel == 0) text = "Fuel filter: no fuel reported.";
+        else text.sprintf("Fuel filter: %d-%d %%.", filter.minFuel, filter.maxFuel);
+        setFilter(&filter, text);
+    }
+    else if (key == Qt::Key_K)
+    {
+        // the occurrence under the mouse: its track highlighted, then
+        // alone, then everything again
+        PointFilter filter;
+        m_bitmapGenerator->getFilter(&filter);
+        int highlightTailNumber = m_bitmapGenerator->highlightTailNumber();
+
+        QString text;
+        if (m_hoveredTailNumber != 0 && m_hoveredTailNumber != highlightTailNumber && m_hoveredTailNumber != filter.tailNumber)
+        {
+            filter.tailNumber = 0;
+            m_bitmapGenerator->setHighlightTailNumber(m_hoveredTailNumber);
+            text.sprintf("Track %05d highlighted.", m_hoveredTailNumber);
+        }
+        else if (highlightTailNumber != 0)
+        {
+            filter.tailNumber = highlightTailNumber;
+            m_bitmapGenerator->setHighlightTailNumber(0);
+            text.sprintf("Only track %05d.", highlightTailNumber);
+        }
+        else if (filter.tailNumber != 0)
+        {
+            filter.tailNumber = 0;
+            text = "All tracks.";
+        }
+        else
+        {
+            text = "Hover an occurrence to pick its track.";
+        }
+        setFilter(&filter, text);
+    }
+    else if (key == Qt::Key_X)
+    {
+        PointFilter filter;
+        PointIndex::defaultFilter(&filter);
+        m_fuelBand = 0;
+        m_bitmapGenerator->setHighlightTailNumber(0);
+        setFilter(&filter, "All filters cleared.");
+    }
     else if (key == Qt::Key_L)
     {
         if (!m_isLockedOnRealtimeMarker && m_state->isRealtimeStarted())
@@ -435,10 +730,10 @@ void GraphView::keyReleaseEvent(QKeyEvent *event)
         if (!m_isBeepingEnabled) m_shouldPlayBeep = false;
 
         QString text;
-        text.sprintf("Beep on new points: %s.", m_isBeepingEnabled ? "ON" : "OFF");
+        text.sprintf("Beep on alerts: %s.", m_isBeepingEnabled ? "ON" : "OFF");
         showNotification(text);
 
-        update();
+        invalidateLayers(LAYER_HUD);
     }
     else if (key == Qt::Key_R)
     {
@@ -452,8 +747,45 @@ void GraphView::keyReleaseEvent(QKeyEvent *event)
     {
         m_isShowingStatusBox = !m_isShowingStatusBox;
         
+        invalidateLayers(LAYER_HUD);
+    }
+    else if (key == Qt::Key_T)
+    {
+        m_isShowingLatency = !m_isShowingLatency;
+
+        invalidateLayers(LAYER_HUD);
+    }
+    else if (key == Qt::Key_Y)
+    {
+        if (m_tracer != NULL)
+        {
+            bool isDumped = m_tracer->dump(LATENCY_DUMP_PATH);
+            showNotification(isDumped ? "Latency dumped to " LATENCY_DUMP_PATH "." : "Can't write " LATENCY_DUMP_PATH ".");
+
+            update();
+        }
+    }
+    else if (key == Qt::Key_P)
+    {
+        SpanRecorder::setEnabled(!SpanRecorder::isEnabled);
+
+        QString text;
+        text.sprintf("Span recording: %s.", SpanRecorder::isEnabled ? "ON" : "OFF");
+        showNotification(text);
+
+        update();
+    }
+    else if (key == Qt::Key_J)
+    {
+        bool isDumped = SpanRecorder::dump(SPAN_DUMP_PATH);
+        showNotification(isDumped ? "Spans dumped to " SPAN_DUMP_PATH "." : "Can't write " SPAN_DUMP_PATH ".");
+
         update();
     }
+    else if (key == Qt::Key_S)
+    {
+        showStatistics();
+    }
     else if (key == Qt::Key_F1)
     {
         QString text;
@@ -462,10 +794,20 @@ void GraphView::keyReleaseEvent(QKeyEvent *event)
         text += "Space : toggle line cross\n";
         text += "Q/A : change bold threshold\n";
         text += "C : toggle 4 points only confidence\n";
+        text += "W/E : raise/lower minimum amplitude\n";
+        text += "G : altitude band around the mouse on/off\n";
+        text += "F : cycle fuel band\n";
+        text += "K : highlight/isolate the track of the occurrence under the mouse\n";
+        text += "X : clear filters\n";
         text += "L : lock on realtime marker\n";
-        text += "B : toggle beep on new points\n";
+        text += "B : toggle beep on alerts (the alertRules setting, \"beep k2\" = any new point)\n";
         text += "R/D : resconnect/disconnect\n";
         text += "I : toggle status box\n";
+        text += "T : toggle latency stats\n";
+        text += "Y : dump latency stats to " LATENCY_DUMP_PATH "\n";
+        text += "P : toggle span recording\n";
+        text += "J : dump recorded spans to " SPAN_DUMP_PATH " (chrome://tracing)\n";
+        text += "S : aircraft statistics\n";
         text += "\n";
         text += "When changing time offset: Shift increases scroll speed, Alt decreases.";
 
@@ -477,6 +819,44 @@ void GraphView::keyReleaseEvent(QKeyEvent *event)
     }
 }
 
+void GraphView::setFilter(PointFilter *filter, QString text)
+{
+    m_bitmapGenerator->setFilter(filter);
+
+    showNotification(text);
+
+    updateBitmap();
+}
+
+QString GraphView::filterString()
+{
+    PointFilter filter;
+    m_bitmapGenerator->getFilter(&filter);
+
+    QString text;
+    if (filter.minAmplitude != INT_MIN)
+    {
+        text += QString().sprintf("AMP>=%d ", filter.minAmplitude);
+    }
+    if (filter.minAltitude != INT_MIN || filter.maxAltitude != INT_MAX)
+    {
+        text += QString().sprintf("ALT %d-%d ", filter.minAltitude, filter.maxAltitude);
+    }
+    if (filter.minFuel != INT_MIN || filter.maxFuel != INT_MAX)
+    {
+        text += QString().sprintf("FUEL %d-%d ", filter.minFuel, filter.maxFuel);
+    }
+    if (filter.tailNumber != 0)
+    {
+        text += QString().sprintf("ONLY %05d ", filter.tailNumber);
+    }
+    if (m_bitmapGenerator->highlightTailNumber() != 0)
+    {
+        text += QString().sprintf("TRACK %05d ", m_bitmapGenerator->highlightTailNumber());
+    }
+    return text.isEmpty() ? QString("NO FILTER") : text.trimmed();
+}
+
 void GraphView::showNotification(QString text)
 {
     m_isNotificationShown = true;
@@ -484,6 +864,50 @@ void GraphView::showNotification(QString text)
     m_notificationText = text;
 }
 
+void GraphView::showStatistics()
+{
+    std::vector<AircraftSummary> top;
+    std::vector<AircraftSummary> today;
+
+    m_state->lock();
+    AircraftStatistics *statistics = m_state->statistics();
+    size_t aircraftCount = statistics->aircraftCount();
+    statistics->topByAirtime(STATISTICS_TOP_COUNT, &top);
+    UvdTime dayStartTime = statistics->lastTime() / UVD_DAY * UVD_DAY;
+    statistics->seenSince(dayStartTime, &today);
+    m_state->unlock();
+
+    bool hidesTailNumbers = m_state->hidesTailNumbers();
+
+    QString text;
+    QString line;
+    line.sprintf("Unique aircrafts: %lu, seen today: %lu.\n\n", (unsigned long)aircraftCount, (unsigned long)today.size());
+    text += line;
+
+    text += "Top by airtime:\n";
+    std::vector<AircraftSummary>::iterator iter;
+    for (iter = top.begin(); iter != top.end(); ++iter)
+    {
+        AircraftSummary summary = *iter;
+
+        QString tailNumber;
+        if (hidesTailNumbers) tailNumber = "*****";
+        else tailNumber.sprintf("%05d", summary.tailNumber);
+
+        line.sprintf(": %.0f mins (max %.0f) in %lu occurrences over %d day(s), last seen ",
+                     summary.totalDuration / 60.0, summary.maxDuration / 60.0, summary.occurrences, summary.days);
+        text += tailNumber + line + timeString(summary.lastSeen);
+        if (summary.points > 0)
+        {
+            line.sprintf(", %d-%dm", summary.minAltitude, summary.maxAltitude);
+            text += line;
+        }
+        text += "\n";
+    }
+
+    QMessageBox::information(this, "UVDG aircraft statistics", text);
+}
+
 void GraphView::timerFired()
 {
     if (m_notificationTimeLeft >= 0.0f)
@@ -496,12 +920,34 @@ void GraphView::timerFired()
         update();
     }
 
+    // a background load publishes points as it goes: follow the bounds and
+    // redraw on every tick until it is done
+    if (m_state->isLoading() || m_isLoading)
+    {
+        m_isLoading = m_state->isLoading();
+
+        if (m_isLoading)
+        {
+            QString status;
+            status.sprintf("LOADING %.0f%%", m_state->loadProgress() * 100.0);
+            setConnectionStatus(status);
+        }
+        else if (m_connectionStatus.startsWith("LOADING"))
+        {
+            // unless the feed has been connected meanwhile
+            setConnectionStatus("LOG ONLY");
+        }
+
+        refreshTimeBounds();
+        updateBitmap();
+    }
+
     qint64 timeLocal = QDateTime::currentMSecsSinceEpoch();
     if (m_state->isRealtimeStarted() && timeLocal > m_realtimeTickTimeLocal)
     {
         m_realtimeTickTimeLocal = timeLocal + 1000;
 
-        m_realtimeMarkerTime = m_lastTime + ((timeLocal - m_lastTimeLocal) / 1000.0);
+        m_realtimeMarkerTime = m_lastTime + (timeLocal - m_lastTimeLocal) * 1000;
         
         if (m_isLockedOnRealtimeMarker)
         {
@@ -519,22 +965,110 @@ void GraphView::timerFired()
     }
 }
 
+void GraphView::refreshTimeBounds()
+{
+    m_state->lock();
+    if (!m_state->getTimeBounds(&m_firstTime, &m_lastTime))
+    {
+        m_firstTime = -1;
+        m_lastTime = 0;
+    }
+    m_state->unlock();
+}
+
+// called with the state locked; the buckets of the overview are summed
+// into columns, so a redraw costs the scroller width plus the bounded
+// number of buckets, not the points
+void GraphView::updateOverviewImage()
+{
+    UvdOverview *overview = m_state->overview();
+    if (overview->version() == m_overviewVersion && m_firstTime == m_overviewFirstTime && m_lastTime == m_overviewLastTime) return;
+
+    m_overviewVersion = overview->version();
+    m_overviewFirstTime = m_firstTime;
+    m_overviewLastTime = m_lastTime;
+
+    int imageWidth = m_overviewImage->width();
+    int imageHeight = m_overviewImage->height();
+    unsigned int *pixels = (unsigned int *)m_overviewImage->bits();
+    m_overviewImage->fill(0xff000000);
+    if (m_lastTime <= m_firstTime || imageWidth <= 0) return;
+
+    // a column per band, then one of the points without an altitude
+    const int slotCount = OVERVIEW_BAND_COUNT + 1;
+    m_overviewColumns.assign((size_t)imageWidth * slotCount, 0);
+
+    unsigned int maxCount = 0;
+    double pixelsPerTime = imageWidth / (double)(m_lastTime - m_firstTime);
+    for (size_t i = 0; i < overview->bucketCount(); i++)
+    {
+        UvdTime middleTime = overview->bucketTime(i) + overview->bucketWidth() / 2;
+        int x = (int)((middleTime - m_firstTime) * pixelsPerTime);
+        if (x < 0 || x >= imageWidth) continue;
+
+        const OverviewBucket *bucket = overview->bucket(i);
+        unsigned int *column = &m_overviewColumns[(size_t)x * slotCount];
+        for (int band = 0; band < slotCount; band++)
+        {
+            column[band] += bucket->counts[band];
+            if (column[band] > maxCount) maxCount = column[band];
+        }
+    }
+    if (maxCount == 0) return;
+
+    // brightness by log density, hue by altitude band, high ones on top
+    double logMax = log(1.0 + maxCount);
+    for (int x = 0; x < imageWidth; x++)
+    {
+        unsigned int *column = &m_overviewColumns[(size_t)x * slotCount];
+
+        if (column[OVERVIEW_BAND_UNKNOWN] > 0)
+        {
+            int value = OVERVIEW_MIN_VALUE + (int)((255 - OVERVIEW_MIN_VALUE) * log(1.0 + column[OVERVIEW_BAND_UNKNOWN]) / logMax);
+            for (int y = 0; y < imageHeight; y++)
+            {
+                pixels[x + y * imageWidth] = 0xff000000 | (value << 16) | (value << 8) | value;
+            }
+        }
+
+        for (int band = 0; band < OVERVIEW_BAND_COUNT; band++)
+        {
+            if (column[band] == 0) continue;
+
+            int value = OVERVIEW_MIN_VALUE + (int)((255 - OVERVIEW_MIN_VALUE) * log(1.0 + column[band]) / logMax);
+            QColor color = QColor::fromHsv(120 + band * 120 / (OVERVIEW_BAND_COUNT - 1), 255, value);
+            unsigned int pixel = 0xff000000 | (color.red() << 16) | (color.green() << 8) | color.blue();
+
+            int bottomY = imageHeight - band * imageHeight / OVERVIEW_BAND_COUNT;
+            int topY = imageHeight - (band + 1) * imageHeight / OVERVIEW_BAND_COUNT;
+            for (int y = topY; y < bottomY; y++)
+            {
+                pixels[x + y * imageWidth] = pixel;
+            }
+        }
+    }
+}
+
 void GraphView::updateBitmap()
 {
+    m_state->ensureRange(screenLeftTime(), screenRightTime());
+
     m_bitmapGenerator->lock();
     m_bitmapGenerator->update(screenLeftTime(), screenRightTime(), m_firstTime, m_lastTime, m_timeSlice);
     m_bitmapGenerator->unlock();
 
+    if (m_tracer != NULL) m_tracer->bitmapGenerated();
+
     m_lastUpdateTimeLocal = QDateTime::currentMSecsSinceEpoch();
 
-    update();
+    invalidateLayers(LAYER_ALL);
 }
 
-QString GraphView::timeString(double time)
+QString GraphView::timeString(UvdTime time)
 {
-    if (time < 0.0) time = 0.0;
+    if (time < 0) time = 0;
 
-    int t = (int)time;
+    int t = (int)(time / UVD_SECOND);
     int dd = t / 86400;
     t %= 86400;
     int hh = t / 3600;
@@ -561,17 +1095,17 @@ QString GraphView::timeString(double time)
     return result;
 }
 
-double GraphView::screenLeftTime()
+UvdTime GraphView::screenLeftTime()
 {
     return m_firstTime + m_timeOffset;
 }
 
-double GraphView::screenRightTime()
+UvdTime GraphView::screenRightTime()
 {
     return screenLeftTime() + m_image->width() * m_timeSlice;
 }
 
-double GraphView::timeForX(int x)
+UvdTime GraphView::timeForX(int x)
 {
     return (x * m_timeSlice) + screenLeftTime();
 }
@@ -582,16 +1116,16 @@ int GraphView::altForY(int y)
     return alt >= 0 ? alt : 0;
 }
 
-float GraphView::xForTime(double time)
+float GraphView::xForTime(UvdTime time)
 {
-    return (time - screenLeftTime()) / m_timeSlice;
+    return (time - screenLeftTime()) / (float)m_timeSlice;
 }
 
-void GraphView::setTimeOffset(double timeOffset)
+void GraphView::setTimeOffset(UvdTime timeOffset)
 {
     // do not allow negative time
     
-    if (m_firstTime + timeOffset < 0.0)
+    if (m_firstTime + timeOffset < 0)
     {
         m_timeOffset = -m_firstTime;
     }
@@ -626,7 +1160,7 @@ float GraphView::modifierMultiplier()
 
 void GraphView::scrollToRealtimeMarker()
 {
-    m_timeOffset = m_realtimeMarkerTime - m_firstTime - (m_image->width() * NORM_REALTIME_MARKER_OFFSET) * m_timeSlice;
+    m_timeOffset = m_realtimeMarkerTime - m_firstTime - (UvdTime)(m_image->width() * NORM_REALTIME_MARKER_OFFSET) * m_timeSlice;
 }
 
 void GraphView::startRealtimeMode()
@@ -634,7 +1168,7 @@ void GraphView::startRealtimeMode()
     m_isStartingRealtimeMode = true;
 }
 
-void GraphView::uvdStateChanged(double time)
+void GraphView::uvdStateChanged(UvdTime time)
 {
     if (m_isStartingRealtimeMode)
     {
@@ -642,7 +1176,7 @@ void GraphView::uvdStateChanged(double time)
         m_isLockedOnRealtimeMarker = true;
     }
 
-    if (m_firstTime < 0.0)
+    if (m_firstTime < 0)
     {
         m_firstTime = time;
     }
@@ -652,11 +1186,6 @@ void GraphView::uvdStateChanged(double time)
     m_lastTimeLocal = QDateTime::currentMSecsSinceEpoch();
     m_realtimeTickTimeLocal = m_lastTimeLocal + 1000;
     
-    if (m_isBeepingEnabled)
-    {
-        m_shouldPlayBeep = true;
-    }
-    
     if (m_isLockedOnRealtimeMarker)
     {
         scrollToRealtimeMarker();
@@ -671,10 +1200,25 @@ void GraphView::uvdStateChanged(double time)
     }
 }
 
+void GraphView::alertMatched(const AlertMatch *match)
+{
+    if ((match->actions & ALERT_ACTION_BEEP) && m_isBeepingEnabled)
+    {
+        m_shouldPlayBeep = true;
+    }
+
+    if (match->actions & ALERT_ACTION_NOTIFY)
+    {
+        QString text;
+        text.sprintf("%s: %05d", match->text, match->fields[AlertFieldTail]);
+        showNotification(text);
+    }
+}
+
 void GraphView::setConnectionStatus(QString status)
 {
     m_connectionStatus = status;
-    update();
+    invalidateLayers(LAYER_HUD);
 }
 
 void GraphView::tcpConnecting()
@@ -697,3 +1241,26 @@ void GraphView::tcpDisconnected()
     setConnectionStatus("CONN OFF");
     showNotification("Disconnected.");
 }
+
+void GraphView::replayProgress(double speed, double linesPerSecond)
+{
+    QString status;
+    if (speed > 0.0)
+    {
+        status.sprintf("REPLAY %.0fx %.0f L/S", speed, linesPerSecond);
+    }
+    else
+    {
+        status.sprintf("REPLAY MAX %.0f L/S", linesPerSecond);
+    }
+    setConnectionStatus(status);
+}
+
+void GraphView::replayFinished(unsigned long lines, double seconds)
+{
+    setConnectionStatus("REPLAY DONE");
+
+    QString text;
+    text.sprintf("Replayed %lu lines in %.1f s.", lines, seconds);
+    showNotification(text);
+}
@@ -3,11 +3,20 @@
 #define __GRAPHVIEW_H__
 
 #include <QImage>
+#include <QPainter>
 #include <QTimer>
 #include <QSound>
 #include <QWidget>
 #include "UvdState.h"
 #include "UvdBitmapGenerator.h"
+#include "LatencyTracer.h"
+
+// an occurrence drawn in the lanes layer, for the hover overlay
+typedef struct {
+    QRect rect;
+    float firstX, lastX;
+    int tailNumber;
+} LaneRect;
 
 class GraphView : public QWidget
 {
@@ -18,10 +27,25 @@ class GraphView : public QWidget
     UvdBitmapGenerator *m_bitmapGenerator;
     QImage *m_image;
 
-    double m_firstTime;
-    double m_lastTime;
-    double m_timeOffset;
-    double m_timeSlice;
+    // the view is composed of cached layers, each redrawn when invalidated,
+    // into a frame the overlays (cursor, rate calculator, hover readout,
+    // notification) are drawn over on every paint
+    QImage *m_lanesImage;
+    QImage *m_scrollerImage;
+    QImage *m_frameImage;
+    int m_invalidLayers;
+    std::vector<LaneRect> m_laneRects;
+
+    // minimap of the scroller, redrawn when the overview or the bounds change
+    QImage *m_overviewImage;
+    unsigned long m_overviewVersion;
+    UvdTime m_overviewFirstTime, m_overviewLastTime;
+    std::vector<unsigned int> m_overviewColumns;
+
+    UvdTime m_firstTime;
+    UvdTime m_lastTime;
+    UvdTime m_timeOffset;
+    UvdTime m_timeSlice;            // per pixel column
     bool m_isLineCrossEnabled;
 
     QPoint m_downPoint;
@@ -36,7 +60,7 @@ class GraphView : public QWidget
     QString m_notificationText;
 
     bool m_isStartingRealtimeMode;
-    double m_realtimeMarkerTime;
+    UvdTime m_realtimeMarkerTime;
     bool m_isLockedOnRealtimeMarker;
 
     qint64 m_lastTimeLocal;
@@ -48,38 +72,62 @@ class GraphView : public QWidget
     bool m_shouldPlayBeep;
     qint64 m_lastBeepTimeLocal;
     
+    int m_fuelBand;
+    int m_hoveredTailNumber;        // of the occurrence under the mouse
+    
     bool m_isShowingStatusBox;
+    bool m_isShowingLatency;
+    bool m_isLoading;
+
+    LatencyTracer *m_tracer;
     
     QString m_connectionStatus;
 
     QTimer *m_timer;
 
     void showNotification(QString text);
+    void showStatistics();
 
     void putPixel(int x, int y, int r, int g, int b);
     void updateBitmap();
-
-    QString timeString(double time);
-    double screenLeftTime();
-    double screenRightTime();
-    double timeForX(int x);
+    void invalidateLayers(int layers);
+    void composeFrame();
+    void drawLanes(UvdTime leftTime, UvdTime rightTime);
+    void drawScroller(UvdTime leftTime, UvdTime rightTime);
+    void drawHud(QPainter *painter, UvdTime leftTime, UvdTime rightTime);
+    void drawOverlays(QPainter *painter);
+    void drawHoverPoint(QPainter *painter);
+    void updateOverviewImage();
+    void setFilter(PointFilter *filter, QString text);
+    QString filterString();
+
+    QString timeString(UvdTime time);
+    UvdTime screenLeftTime();
+    UvdTime screenRightTime();
+    UvdTime timeForX(int x);
     int altForY(int y);
-    float xForTime(double time);
-    void setTimeOffset(double timeOffset);
+    float xForTime(UvdTime time);
+    void setTimeOffset(UvdTime timeOffset);
     float modifierMultiplier();
     void scrollToRealtimeMarker();
+    void refreshTimeBounds();
     void setConnectionStatus(QString status);
 
 public:
     GraphView(UvdState *state);
     ~GraphView();
 
+    void setLatencyTracer(LatencyTracer *tracer) { m_tracer = tracer; }
+
     void startRealtimeMode();
-    void uvdStateChanged(double time);
+    void uvdStateChanged(UvdTime time);
+    void alertMatched(const AlertMatch *match);
     void tcpConnecting();
     void tcpConnected();
     void tcpReconnecting(int secondsToReconnect);
     void tcpDisconnected();
+    void replayProgress(double speed, double linesPerSecond);
+    void replayFinished(unsigned long lines, double seconds);
 
 protected:
     virtual void paintEvent(QPaintEvent *event);
@@ -1,5 +1,13 @@
 
 #include "MainWindow.h"
+#include "SpanRecorder.h"
+#include "Thread.h"
+
+#define REPLAY_TIMER_INTERVAL_MS 10
+#define REPLAY_TICK_BUDGET_MS 50
+#define LOAD_TIMER_INTERVAL_MS 100
+#define RING_TIMER_INTERVAL_MS 10
+#define RING_READ_RECORDS 1024
 
 MainWindow::MainWindow() : QMainWindow(NULL)
 {
@@ -8,6 +16,34 @@ MainWindow::MainWindow() : QMainWindow(NULL)
     if (!m_settings->contains("logFilePath")) m_settings->setValue("logFilePath", "");
     if (!m_settings->contains("serverHost")) m_settings->setValue("serverHost", "127.0.0.1");
     if (!m_settings->contains("serverPort")) m_settings->setValue("serverPort", "31003");
+    if (!m_settings->contains("ringEnabled")) m_settings->setValue("ringEnabled", false);
+    if (!m_settings->contains("ringName")) m_settings->setValue("ringName", "rtl-uvd");
+    if (!m_settings->contains("spanRecordingEnabled")) m_settings->setValue("spanRecordingEnabled", false);
+    if (!m_settings->contains("archiveEnabled")) m_settings->setValue("archiveEnabled", false);
+    if (!m_settings->contains("archiveFrom")) m_settings->setValue("archiveFrom", "");
+    if (!m_settings->contains("archiveTo")) m_settings->setValue("archiveTo", "");
+    if (!m_settings->contains("lazyLoadingEnabled")) m_settings->setValue("lazyLoadingEnabled", false);
+    if (!m_settings->contains("replaySpeed")) m_settings->setValue("replaySpeed", "1");
+    if (!m_settings->contains("recordEnabled")) m_settings->setValue("recordEnabled", false);
+    if (!m_settings->contains("recordDirectory")) m_settings->setValue("recordDirectory", "");
+    if (!m_settings->contains("recordSyncPolicy")) m_settings->setValue("recordSyncPolicy", (int)RecorderSyncInterval);
+    if (!m_settings->contains("recordSyncInterval")) m_settings->setValue("recordSyncInterval", 10);
+    if (!m_settings->contains("retentionEnabled")) m_settings->setValue("retentionEnabled", true);
+    if (!m_settings->contains("retentionFullHours")) m_settings->setValue("retentionFullHours", 6);
+    if (!m_settings->contains("retentionSecondHours")) m_settings->setValue("retentionSecondHours", 18);
+    if (!m_settings->contains("retentionMinuteDays")) m_settings->setValue("retentionMinuteDays", 6);
+    if (!m_settings->contains("retentionMemoryMB")) m_settings->setValue("retentionMemoryMB", 512);
+    // segments used to go to the temp directory, which is never cleaned up
+    QString segmentDirectory = QDesktopServices::storageLocation(QDesktopServices::DataLocation) + "/segments";
+    if (!m_settings->contains("retentionDirectory") || m_settings->value("retentionDirectory").toString() == QDir::tempPath())
+    {
+        m_settings->setValue("retentionDirectory", segmentDirectory);
+    }
+    if (!m_settings->contains("retentionSegmentDays")) m_settings->setValue("retentionSegmentDays", 30);
+    if (!m_settings->contains("retentionSegmentMB")) m_settings->setValue("retentionSegmentMB", 4096);
+    if (!m_settings->contains("snapshotEnabled")) m_settings->setValue("snapshotEnabled", true);
+    if (!m_settings->contains("alertRules")) m_settings->setValue("alertRules", QStringList("beep k2"));
+    if (!m_settings->contains("snapshotDirectory")) m_settings->setValue("snapshotDirectory", QDesktopServices::storageLocation(QDesktopServices::DataLocation));
 
     setWindowTitle("UVDG");
 
@@ -31,6 +67,36 @@ MainWindow::MainWindow() : QMainWindow(NULL)
     m_logFilePathLabel = new QLabel(logFilePath, this);
     layout->addWidget(m_logFilePathLabel);
 
+    m_archiveSwitch = new QCheckBox("Load all daily logs in its directory", this);
+    m_archiveSwitch->setChecked(m_settings->value("archiveEnabled").toBool());
+    layout->addWidget(m_archiveSwitch);
+
+    QLabel *archiveRangeLabel = new QLabel("From/to date (YYYY-MM-DD, empty = any):", this);
+    layout->addWidget(archiveRangeLabel);
+
+    m_archiveFromField = new QLineEdit(this);
+    m_archiveFromField->setText(m_settings->value("archiveFrom").toString());
+    layout->addWidget(m_archiveFromField);
+
+    m_archiveToField = new QLineEdit(this);
+    m_archiveToField->setText(m_settings->value("archiveTo").toString());
+    layout->addWidget(m_archiveToField);
+
+    m_lazySwitch = new QCheckBox("Keep only the viewed range in memory (indexes the logs)", this);
+    m_lazySwitch->setChecked(m_settings->value("lazyLoadingEnabled").toBool());
+    layout->addWidget(m_lazySwitch);
+
+    m_replaySwitch = new QCheckBox("Replay log file through realtime pipeline", this);
+    m_replaySwitch->setChecked(false);
+    layout->addWidget(m_replaySwitch);
+
+    QLabel *replaySpeedLabel = new QLabel("Replay speed (1-1000x, 0 = as fast as possible):", this);
+    layout->addWidget(replaySpeedLabel);
+
+    m_replaySpeedField = new QLineEdit(this);
+    m_replaySpeedField->setText(m_settings->value("replaySpeed").toString());
+    layout->addWidget(m_replaySpeedField);
+
     m_useServerSwitch = new QCheckBox("Connect to RTL-UVD", this);
     m_useServerSwitch->setChecked(true);
     connect(m_useServerSwitch, SIGNAL(stateChanged(int)), this, SLOT(useServerSwitchAction(int)));
@@ -50,6 +116,22 @@ MainWindow::MainWindow() : QMainWindow(NULL)
     m_portField->setText(m_settings->value("serverPort").toString());
     layout->addWidget(m_portField);
 
+    m_ringSwitch = new QCheckBox("Read the shared-memory ring of a decoder on this host instead:", this);
+    m_ringSwitch->setChecked(m_settings->value("ringEnabled").toBool());
+    layout->addWidget(m_ringSwitch);
+
+    m_ringNameField = new QLineEdit(this);
+    m_ringNameField->setText(m_settings->value("ringName").toString());
+    layout->addWidget(m_ringNameField);
+
+    m_recordSwitch = new QCheckBox("Record raw stream to directory", this);
+    m_recordSwitch->setChecked(m_settings->value("recordEnabled").toBool());
+    layout->addWidget(m_recordSwitch);
+
+    m_recordDirectoryField = new QLineEdit(this);
+    m_recordDirectoryField->setText(m_settings->value("recordDirectory").toString());
+    layout->addWidget(m_recordDirectoryField);
+
     m_goButton = new QPushButton("GO", this);
     connect(m_goButton, SIGNAL(clicked()), this, SLOT(goAction()));
     layout->addWidget(m_goButton);
@@ -58,14 +140,46 @@ MainWindow::MainWindow() : QMainWindow(NULL)
     m_secondsToReconnect = 1;
     m_reconnectTimer = NULL;
 
-    m_buffer = (char *)malloc(256);
+    m_socket = NULL;
+    m_feedReader = new RtlUvdFeedReader();
+
+    m_ring = NULL;
+    m_ringRecords = NULL;
+    m_ringTimer = NULL;
+
+    m_recorder = NULL;
+    m_rangeLoader = NULL;
+    m_retention = NULL;
+    m_snapshot = NULL;
+    m_alerts = NULL;
+    m_loader = NULL;
+    m_loadTimer = NULL;
+
+    m_tracer = new LatencyTracer();
+
+    SpanRecorder::setEnabled(m_settings->value("spanRecordingEnabled").toBool());
+
+    m_replay = NULL;
+    m_replayTimer = NULL;
+
+    updateControlsState(m_useLogSwitch->isChecked(), m_useServerSwitch->isChecked());
 }
 
 MainWindow::~MainWindow()
 {
     delete m_settings;
 
-    free(m_buffer);
+    delete m_feedReader;
+
+    // takes a last snapshot, which reads the retention
+    if (m_snapshot != NULL) delete m_snapshot;
+    if (m_recorder != NULL) delete m_recorder;
+    if (m_rangeLoader != NULL) delete m_rangeLoader;
+    if (m_retention != NULL) delete m_retention;
+    if (m_alerts != NULL) delete m_alerts;
+    if (m_loader != NULL) delete m_loader;
+    if (m_replay != NULL) delete m_replay;
+    delete m_tracer;
 
     if (m_socket != NULL)
     {
@@ -73,6 +187,7 @@ MainWindow::~MainWindow()
         m_socket->abort();
         delete m_socket;
     }
+    ringClose();
 
     stopReconnectTimer();
 }
@@ -113,49 +228,268 @@ void MainWindow::goAction()
     m_state = new UvdState();
     m_parser = new RtlUvdParser(m_state);
 
-    if (m_useLogSwitch->isChecked())
+    if (m_useLogSwitch->isChecked() && (m_archiveSwitch->isChecked() || isLazyLoading()))
+    {
+        loadArchive();
+    }
+    else if (m_useLogSwitch->isChecked())
     {
-        QString logFileName = m_logFilePathLabel->text().section('/', -1);
         int yyyy, mm, dd;
-        int gotTokens = sscanf(logFileName.toUtf8().data(), "rtl-uvd-log-%04d-%02d-%02d", &yyyy, &mm, &dd);
-        if (gotTokens == 3)
+        if (RtlUvdParser::dateFromLogFileName(m_logFilePathLabel->text().toUtf8().data(), &yyyy, &mm, &dd))
         {
             m_state->setStartDate(yyyy, mm, dd);
         }
 
-        m_parser->parseLogFile(m_logFilePathLabel->text().toUtf8().data());
+        if (m_replaySwitch->isChecked())
+        {
+            double speed = m_replaySpeedField->text().toDouble();
+            if (speed < 0.0) speed = 0.0;
+            if (speed > 1000.0) speed = 1000.0;
+            if (speed > 0.0 && speed < 1.0) speed = 1.0;
+
+            m_replay = new RtlUvdReplay(m_logFilePathLabel->text().toUtf8().data(), speed);
+
+            m_settings->setValue("replaySpeed", m_replaySpeedField->text());
+        }
+        else
+        {
+            m_loader = new RtlUvdLoader(m_state, m_parser, m_logFilePathLabel->text().toUtf8().data());
+        }
+    }
+    else if (m_useServerSwitch->isChecked() && m_settings->value("snapshotEnabled").toBool())
+    {
+        // a feed-only session resumes where the previous one stopped
+        QString directory = m_settings->value("snapshotDirectory").toString();
+        QDir().mkpath(directory);
+
+        m_snapshot = new UvdSnapshot(directory.toUtf8().data(), m_state, m_parser);
+        m_snapshot->restore();
     }
 
     m_graphView = new GraphView(m_state);
+    m_graphView->setLatencyTracer(m_tracer);
     m_graphView->show();
 
-    if (m_useServerSwitch->isChecked())
+    if (m_loader != NULL)
+    {
+        // the view follows the load, the feed is connected once it is done
+        m_loader->start();
+
+        m_loadTimer = new QTimer(this);
+        connect(m_loadTimer, SIGNAL(timeout()), this, SLOT(loadTimerFired()));
+        m_loadTimer->start(LOAD_TIMER_INTERVAL_MS);
+    }
+    else if (m_replay != NULL)
     {
+        // replay goes through the same realtime path as the socket does,
+        // so the feed is not connected meanwhile
+
+        m_parser->setLatencyTracer(m_tracer);
         m_state->startRealtimeMode();
         m_graphView->startRealtimeMode();
+        m_graphView->replayProgress(m_replay->speed(), 0.0);
+        startRetention();
+        startAlerts();
 
-        connect(m_graphView, SIGNAL(reconnectRequested()), this, SLOT(requestReconnect()));
-        connect(m_graphView, SIGNAL(disconnectRequested()), this, SLOT(requestDisconnect()));
-
-        tcpConnect();
+        m_replayStartTimeLocal = QDateTime::currentMSecsSinceEpoch();
+        m_replayReportTimeLocal = m_replayStartTimeLocal;
+        m_replayReportLines = 0;
 
-        m_settings->setValue("serverHost", m_hostField->text());
-        m_settings->setValue("serverPort", m_portField->text());
+        m_replayTimer = new QTimer(this);
+        connect(m_replayTimer, SIGNAL(timeout()), this, SLOT(replayTimerFired()));
+        m_replayTimer->start(REPLAY_TIMER_INTERVAL_MS);
+    }
+    else if (m_useServerSwitch->isChecked())
+    {
+        startServer();
     }
 
     hide();
 }
 
+void MainWindow::loadTimerFired()
+{
+    if (!m_loader->isFinished()) return;
+
+    m_loadTimer->stop();
+
+    delete m_loader;
+    m_loader = NULL;
+
+    if (m_useServerSwitch->isChecked())
+    {
+        startServer();
+    }
+}
+
+void MainWindow::startServer()
+{
+    // not before, a log loaded by m_parser on the loader thread isn't traced
+    m_parser->setLatencyTracer(m_tracer);
+    m_state->startRealtimeMode();
+    m_graphView->startRealtimeMode();
+    startRetention();
+    startAlerts();
+
+    connect(m_graphView, SIGNAL(reconnectRequested()), this, SLOT(requestReconnect()));
+    connect(m_graphView, SIGNAL(disconnectRequested()), this, SLOT(requestDisconnect()));
+
+    if (m_recordSwitch->isChecked() && m_recordDirectoryField->text().size() > 0)
+    {
+        RecorderSyncPolicy syncPolicy = (RecorderSyncPolicy)m_settings->value("recordSyncPolicy").toInt();
+        int syncInterval = m_settings->value("recordSyncInterval").toInt();
+        m_recorder = new RtlUvdRecorder(m_recordDirectoryField->text().toUtf8().data(), syncPolicy, syncInterval);
+    }
+
+    if (m_snapshot != NULL)
+    {
+        if (m_retention != NULL) m_snapshot->setRetention(m_retention);
+        m_snapshot->start();
+    }
+
+    feedConnect();
+
+    m_settings->setValue("serverHost", m_hostField->text());
+    m_settings->setValue("serverPort", m_portField->text());
+    m_settings->setValue("ringEnabled", m_ringSwitch->isChecked());
+    m_settings->setValue("ringName", m_ringNameField->text());
+    m_settings->setValue("recordEnabled", m_recordSwitch->isChecked());
+    m_settings->setValue("recordDirectory", m_recordDirectoryField->text());
+}
+
+void MainWindow::startRetention()
+{
+    // a lazily loaded archive already bounds what it holds
+    if (!m_settings->value("retentionEnabled").toBool() || m_rangeLoader != NULL) return;
+
+    RetentionPolicy policy;
+    UvdRetention::defaultPolicy(&policy);
+    policy.fullSeconds = m_settings->value("retentionFullHours").toDouble() * 3600.0;
+    policy.secondSeconds = m_settings->value("retentionSecondHours").toDouble() * 3600.0;
+    policy.minuteSeconds = m_settings->value("retentionMinuteDays").toDouble() * 86400.0;
+    policy.maxPoints = (size_t)(m_settings->value("retentionMemoryMB").toDouble() * 1048576.0 / sizeof(K2));
+
+    policy.segmentSeconds = m_settings->value("retentionSegmentDays").toDouble() * 86400.0;
+    policy.segmentBytes = (long long)(m_settings->value("retentionSegmentMB").toDouble() * 1048576.0);
+
+    QString directoryPath = m_settings->value("retentionDirectory").toString();
+    if (directoryPath.size() > 0) QDir().mkpath(directoryPath);
+
+    QByteArray directory = directoryPath.toUtf8();
+    strncpy(policy.directory, directory.data(), sizeof(policy.directory) - 1);
+    policy.directory[sizeof(policy.directory) - 1] = 0;
+
+    m_retention = new UvdRetention(m_state, &policy);
+}
+
+void MainWindow::startAlerts()
+{
+    // rules that don't parse are logged and skipped
+    m_alerts = new AlertEngine();
+    QStringList rules = m_settings->value("alertRules").toStringList();
+    for (int i = 0; i < rules.size(); i++)
+    {
+        m_alerts->addRule(rules[i].toUtf8().data());
+    }
+
+    m_alerts->setAlertFunction(alertFunction, this);
+    m_state->setAlertEngine(m_alerts);
+}
+
+void MainWindow::alertFunction(void *context, const AlertMatch *match)
+{
+    MainWindow *window = (MainWindow *)context;
+    window->m_graphView->alertMatched(match);
+}
+
 void MainWindow::updateControlsState(bool isLogEnabled, bool isServerEnabled)
 {
     m_chooseLogFileButton->setEnabled(isLogEnabled);
+    m_archiveSwitch->setEnabled(isLogEnabled);
+    m_archiveFromField->setEnabled(isLogEnabled);
+    m_archiveToField->setEnabled(isLogEnabled);
+    m_lazySwitch->setEnabled(isLogEnabled && !isServerEnabled);
+    m_replaySwitch->setEnabled(isLogEnabled);
+    m_replaySpeedField->setEnabled(isLogEnabled);
     
     m_hostField->setEnabled(isServerEnabled);
     m_portField->setEnabled(isServerEnabled);
+    m_ringSwitch->setEnabled(isServerEnabled);
+    m_ringNameField->setEnabled(isServerEnabled);
+    m_recordSwitch->setEnabled(isServerEnabled);
+    m_recordDirectoryField->setEnabled(isServerEnabled);
     
     m_goButton->setEnabled(isLogEnabled || isServerEnabled);
 }
 
+int MainWindow::archiveDay(QLineEdit *field)
+{
+    QDate date = QDate::fromString(field->text().trimmed(), "yyyy-MM-dd");
+    if (!date.isValid()) return ARCHIVE_DAY_ANY;
+
+    return UvdState::dayNumber(date.year(), date.month(), date.day());
+}
+
+// not with the feed: a chunk swap clears the state, the feed's points with
+// it, and the time bounds stay the archive's
+bool MainWindow::isLazyLoading()
+{
+    return m_lazySwitch->isChecked() && !m_useServerSwitch->isChecked();
+}
+
+void MainWindow::loadArchive()
+{
+    // replay works on a single file, archives are loaded directly
+    QString directory = QFileInfo(m_logFilePathLabel->text()).absolutePath();
+
+    RtlUvdArchive *archive = new RtlUvdArchive(m_state);
+    if (m_archiveSwitch->isChecked())
+    {
+        archive->addDirectory(directory.toUtf8().data(), archiveDay(m_archiveFromField), archiveDay(m_archiveToField));
+    }
+    else if (!archive->addFile(m_logFilePathLabel->text().toUtf8().data()))
+    {
+        // ranges need the day from a daily log name, load other files whole
+        m_loader = new RtlUvdLoader(m_state, m_parser, m_logFilePathLabel->text().toUtf8().data());
+    }
+
+    if (m_loader == NULL && archive->fileCount() > 0)
+    {
+        // the archive puts its first day at 0 on the state clock and every
+        // later one a day further; a feed connected after it is today's, so
+        // its points go after the archive's, not onto its first day
+        archive->sortFiles();
+        QDate today = QDate::currentDate();
+        int days = UvdState::dayNumber(today.year(), today.month(), today.day()) - archive->file(0)->day;
+        if (days > 0) m_parser->setBaseTime(days * UVD_DAY);
+    }
+
+    if (m_loader != NULL)
+    {
+        delete archive;
+    }
+    else if (isLazyLoading())
+    {
+        // the view pulls its range through UvdState::ensureRange
+        m_rangeLoader = new RtlUvdRangeLoader(m_state, archive);
+        if (!m_rangeLoader->open())
+        {
+            delete m_rangeLoader;
+            m_rangeLoader = NULL;
+        }
+        delete archive;
+    }
+    else
+    {
+        m_loader = new RtlUvdLoader(m_state, archive, ThreadProcessorCount());
+    }
+
+    m_settings->setValue("archiveEnabled", m_archiveSwitch->isChecked());
+    m_settings->setValue("lazyLoadingEnabled", m_lazySwitch->isChecked());
+    m_settings->setValue("archiveFrom", m_archiveFromField->text());
+    m_settings->setValue("archiveTo", m_archiveToField->text());
+}
+
 void MainWindow::stopReconnectTimer()
 {
     if (m_reconnectTimer != NULL)
@@ -170,23 +504,74 @@ void MainWindow::tcpConnected()
     m_reconnectDelay = 1;
 
     stopReconnectTimer();
+
+    // binary frames if the feed takes the hello, its lines otherwise
+    m_socket->write(WIRE_HELLO "\n", strlen(WIRE_HELLO "\n"));
     
     m_graphView->tcpConnected();
 }
 
 void MainWindow::tcpHaveBytes()
 {
-    while (m_socket->canReadLine())
+    TRACE_SPAN("processLine batch");
+
+    m_tracer->beginBatch();
+
+    while (m_socket->bytesAvailable() > 0)
+    {
+        int space;
+        char *buffer = m_feedReader->space(&space);
+        qint64 received = m_socket->read(buffer, space);
+        if (received <= 0) break;
+        m_feedReader->append((int)received);
+
+        char *line;
+        const RingRecord *record;
+        FeedItem item;
+        while ((item = m_feedReader->next(&line, &record)) != FeedItemNone)
+        {
+            m_tracer->lineReached(TraceStageRead);
+            if (item == FeedItemRecord) ingestRecord(record);
+            else ingestLine(line);
+        }
+    }
+}
+
+void MainWindow::ingestLine(char *line)
+{
+    UvdTime lineTime = m_parser->processLine(line);
+    if (lineTime > 0)
+    {
+        if (m_recorder != NULL) m_recorder->appendLine(line);
+        lineIngested(lineTime);
+    }
+}
+
+void MainWindow::ingestRecord(const RingRecord *record)
+{
+    UvdTime lineTime = m_parser->processRecord(record);
+    if (lineTime > 0)
     {
-        m_socket->readLine(m_buffer, 256);
-        double lineTime = m_parser->processLine(m_buffer);
-        if (lineTime > 0.0)
+        if (m_recorder != NULL)
         {
-            m_graphView->uvdStateChanged(lineTime);
+            // the daily logs stay text
+            char line[256];
+            RtlUvdParser::formatRecord(record, line);
+            m_recorder->appendLine(line);
         }
+        lineIngested(lineTime);
     }
 }
 
+void MainWindow::lineIngested(UvdTime lineTime)
+{
+    if (m_snapshot != NULL) m_snapshot->capture(lineTime);
+
+    m_tracer->batchAccepted();
+
+    m_graphView->uvdStateChanged(lineTime);
+}
+
 void MainWindow::tcpDisconnected()
 {
     tcpReconnect();
@@ -197,6 +582,12 @@ void MainWindow::tcpError(QAbstractSocket::SocketError error)
     tcpReconnect();
 }
 
+void MainWindow::feedConnect()
+{
+    if (m_ringSwitch->isChecked()) ringConnect();
+    else tcpConnect();
+}
+
 void MainWindow::tcpConnect()
 {
     if (m_reconnectDelay < 30)
@@ -208,6 +599,7 @@ void MainWindow::tcpConnect()
 
     m_graphView->tcpConnecting();
 
+    m_feedReader->reset();
     m_socket = new QTcpSocket(this);
     connect(m_socket, SIGNAL(connected()), this, SLOT(tcpConnected()));
     connect(m_socket, SIGNAL(readyRead()), this, SLOT(tcpHaveBytes()));
@@ -229,6 +621,7 @@ void MainWindow::tcpReconnect()
         m_socket->deleteLater();
         m_socket = NULL;
     }
+    ringClose();
 
     stopReconnectTimer();
 
@@ -242,7 +635,7 @@ void MainWindow::reconnectTimerFired()
     m_secondsToReconnect -= 1;
     if (m_secondsToReconnect == 0)
     {
-        tcpConnect();
+        feedConnect();
     }
     else
     {
@@ -253,7 +646,7 @@ void MainWindow::reconnectTimerFired()
 void MainWindow::requestReconnect()
 {
     m_reconnectDelay = 0;
-    tcpConnect();
+    feedConnect();
 }
 
 void MainWindow::requestDisconnect()
@@ -266,6 +659,134 @@ void MainWindow::requestDisconnect()
         m_socket->deleteLater();
         m_socket = NULL;
     }
+    ringClose();
 
     m_graphView->tcpDisconnected();
 }
+
+// The ring is drained on this thread, as the socket is read: the snapshot,
+// the alerts and the view all run on the thread that ingests. It can't
+// sleep on the ring's futex, so a timer takes what arrived in batches;
+// records still cost no syscall and no text parsing. A ring that isn't
+// there yet, or that its producer closed, is retried like a dropped
+// connection.
+void MainWindow::ringConnect()
+{
+    if (m_reconnectDelay < 30)
+    {
+        m_reconnectDelay += 1;
+    }
+
+    stopReconnectTimer();
+
+    m_graphView->tcpConnecting();
+
+    m_ring = new RecordRing();
+    if (!m_ring->open(m_ringNameField->text().toUtf8().data()))
+    {
+        delete m_ring;
+        m_ring = NULL;
+        tcpReconnect();
+        return;
+    }
+
+    m_reconnectDelay = 1;
+    m_graphView->tcpConnected();
+
+    m_ringRecords = (RingRecord *)malloc(RING_READ_RECORDS * sizeof(RingRecord));
+    m_ringTimer = new QTimer(this);
+    connect(m_ringTimer, SIGNAL(timeout()), this, SLOT(ringTimerFired()));
+    m_ringTimer->start(RING_TIMER_INTERVAL_MS);
+}
+
+void MainWindow::ringClose()
+{
+    if (m_ringTimer != NULL)
+    {
+        delete m_ringTimer;
+        m_ringTimer = NULL;
+    }
+    if (m_ring != NULL)
+    {
+        delete m_ring;
+        m_ring = NULL;
+    }
+    if (m_ringRecords != NULL)
+    {
+        free(m_ringRecords);
+        m_ringRecords = NULL;
+    }
+}
+
+void MainWindow::ringTimerFired()
+{
+    TRACE_SPAN("processRecord batch");
+
+    // a decoder far ahead still leaves the event loop time to render
+    qint64 deadlineLocal = QDateTime::currentMSecsSinceEpoch() + REPLAY_TICK_BUDGET_MS;
+
+    m_tracer->beginBatch();
+
+    // the producer publishes its last records before it closes the ring
+    bool isClosed = m_ring->isClosed();
+
+    int count;
+    while ((count = m_ring->read(m_ringRecords, RING_READ_RECORDS)) > 0)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            m_tracer->lineReached(TraceStageRead);
+            ingestRecord(&m_ringRecords[i]);
+        }
+
+        if (QDateTime::currentMSecsSinceEpoch() > deadlineLocal) return;
+    }
+
+    if (isClosed) tcpReconnect();
+}
+
+void MainWindow::replayTimerFired()
+{
+    qint64 timeLocal = QDateTime::currentMSecsSinceEpoch();
+    double elapsedTime = (timeLocal - m_replayStartTimeLocal) / 1000.0;
+
+    // feed everything that is due, but give the event loop a chance to
+    // render when running as fast as possible
+
+    qint64 deadlineLocal = timeLocal + REPLAY_TICK_BUDGET_MS;
+    int lines = 0;
+    char *line;
+
+    m_tracer->beginBatch();
+
+    TRACE_SPAN("processLine batch");
+
+    while ((line = m_replay->nextDueLine(elapsedTime)) != NULL)
+    {
+        m_tracer->lineReached(TraceStageRead);
+        ingestLine(line);
+
+        lines++;
+        if ((lines & 255) == 0 && QDateTime::currentMSecsSinceEpoch() > deadlineLocal) break;
+    }
+
+    timeLocal = QDateTime::currentMSecsSinceEpoch();
+
+    if (m_replay->isFinished())
+    {
+        m_replayTimer->stop();
+
+        double seconds = (timeLocal - m_replayStartTimeLocal) / 1000.0;
+        m_graphView->replayFinished(m_replay->linesRead(), seconds);
+        printf("replay finished: %lu lines in %.1lf s.\n", m_replay->linesRead(), seconds);
+    }
+    else if (timeLocal >= m_replayReportTimeLocal + 1000)
+    {
+        unsigned long linesRead = m_replay->linesRead();
+        double linesPerSecond = (linesRead - m_replayReportLines) * 1000.0 / (timeLocal - m_replayReportTimeLocal);
+        m_graphView->replayProgress(m_replay->speed(), linesPerSecond);
+
+        m_replayReportTimeLocal = timeLocal;
+        m_replayReportLines = linesRead;
+    }
+}
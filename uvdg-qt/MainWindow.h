@@ -5,7 +5,18 @@
 #include <QtGui/QtGui>
 #include <QtNetwork/QtNetwork>
 #include "RtlUvdParser.h"
+#include "RtlUvdFeedReader.h"
+#include "RecordRing.h"
+#include "RtlUvdArchive.h"
+#include "RtlUvdRangeLoader.h"
+#include "RtlUvdLoader.h"
+#include "UvdRetention.h"
+#include "AlertEngine.h"
+#include "UvdSnapshot.h"
 #include "UvdState.h"
+#include "RtlUvdRecorder.h"
+#include "RtlUvdReplay.h"
+#include "LatencyTracer.h"
 #include "GraphView.h"
 
 class MainWindow : public QMainWindow
@@ -20,10 +31,21 @@ class MainWindow : public QMainWindow
     QCheckBox *m_useLogSwitch;
     QPushButton *m_chooseLogFileButton;
     QLabel *m_logFilePathLabel;
+    QCheckBox *m_archiveSwitch;
+    QLineEdit *m_archiveFromField;
+    QLineEdit *m_archiveToField;
+    QCheckBox *m_lazySwitch;
+    QCheckBox *m_replaySwitch;
+    QLineEdit *m_replaySpeedField;
 
     QCheckBox *m_useServerSwitch;
     QLineEdit *m_hostField;
     QLineEdit *m_portField;
+    QCheckBox *m_ringSwitch;
+    QLineEdit *m_ringNameField;
+
+    QCheckBox *m_recordSwitch;
+    QLineEdit *m_recordDirectoryField;
 
     QPushButton *m_goButton;
 
@@ -34,12 +56,45 @@ class MainWindow : public QMainWindow
     int m_secondsToReconnect;
     QTimer *m_reconnectTimer;
 
-    char *m_buffer;
+    RtlUvdFeedReader *m_feedReader;
+
+    RecordRing *m_ring;
+    RingRecord *m_ringRecords;
+    QTimer *m_ringTimer;
+
+    RtlUvdRecorder *m_recorder;
+    RtlUvdRangeLoader *m_rangeLoader;
+    UvdRetention *m_retention;
+    UvdSnapshot *m_snapshot;
+    AlertEngine *m_alerts;
+    RtlUvdLoader *m_loader;
+    QTimer *m_loadTimer;
+
+    LatencyTracer *m_tracer;
+
+    RtlUvdReplay *m_replay;
+    QTimer *m_replayTimer;
+    qint64 m_replayStartTimeLocal;
+    qint64 m_replayReportTimeLocal;
+    unsigned long m_replayReportLines;
 
     void updateControlsState(bool isLogEnabled, bool isServerEnabled);
     void stopReconnectTimer();
+    void feedConnect();
     void tcpConnect();
     void tcpReconnect();
+    void ringConnect();
+    void ringClose();
+    void ingestLine(char *line);
+    void ingestRecord(const RingRecord *record);
+    void lineIngested(UvdTime lineTime);
+    void loadArchive();
+    void startServer();
+    void startRetention();
+    void startAlerts();
+    static void alertFunction(void *context, const AlertMatch *match);
+    int archiveDay(QLineEdit *field);
+    bool isLazyLoading();
 
 public:
     MainWindow();
@@ -57,10 +112,15 @@ protected slots:
     void tcpError(QAbstractSocket::SocketError);
 
     void reconnectTimerFired();
+    void ringTimerFired();
 
 public slots:
     void requestReconnect();
     void requestDisconnect();
+
+protected slots:
+    void replayTimerFired();
+    void loadTimerFired();
 };
 
 #endif
\ No newline at end of file
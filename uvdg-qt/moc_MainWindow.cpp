@@ -22,7 +22,7 @@ static const uint qt_meta_data_MainWindow[] = {
        6,       // revision
        0,       // classname
        0,    0, // classinfo
-      11,   14, // methods
+      13,   14, // methods
        0,    0, // properties
        0,    0, // enums/sets
        0,    0, // constructors
@@ -41,6 +41,8 @@ static const uint qt_meta_data_MainWindow[] = {
      189,   11,   11,   11, 0x09,
      211,   11,   11,   11, 0x0a,
      230,   11,   11,   11, 0x0a,
+     250,   11,   11,   11, 0x09,
+     269,   11,   11,   11, 0x09,
 
        0        // eod
 };
@@ -53,7 +55,8 @@ static const char qt_meta_stringdata_MainWindow[] = {
     "tcpDisconnected()\0"
     "tcpError(QAbstractSocket::SocketError)\0"
     "reconnectTimerFired()\0requestReconnect()\0"
-    "requestDisconnect()\0"
+    "requestDisconnect()\0replayTimerFired()\0"
+    "loadTimerFired()\0"
 };
 
 void MainWindow::qt_static_metacall(QObject *_o, QMetaObject::Call _c, int _id, void **_a)
@@ -73,6 +76,8 @@ void MainWindow::qt_static_metacall(QObject *_o, QMetaObject::Call _c, int _id,
         case 8: _t->reconnectTimerFired(); break;
         case 9: _t->requestReconnect(); break;
         case 10: _t->requestDisconnect(); break;
+        case 11: _t->replayTimerFired(); break;
+        case 12: _t->loadTimerFired(); break;
         default: ;
         }
     }
@@ -110,9 +115,9 @@ int MainWindow::qt_metacall(QMetaObject::Call _c, int _id, void **_a)
     if (_id < 0)
         return _id;
     if (_c == QMetaObject::InvokeMetaMethod) {
-        if (_id < 11)
+        if (_id < 13)
             qt_static_metacall(this, _c, _id, _a);
-        _id -= 11;
+        _id -= 13;
     }
     return _id;
 }
@@ -0,0 +1,268 @@
+// Timeline tile server: keeps a realtime UvdState fed from an rtl-uvd
+// compatible feed or a decoder's RecordRing (or one merged from daily logs)
+// and serves it over HTTP as PNG tiles and JSON occurrences, so browsers can
+// watch the timeline without the Qt app.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "Socket.h"
+#include "Clock.h"
+#include "Log.h"
+#include "RtlUvdArchive.h"
+#include "RtlUvdFeedReader.h"
+#include "RtlUvdParser.h"
+#include "RecordRing.h"
+#include "Thread.h"
+#include "TileCache.h"
+#include "TileServer.h"
+#include "UvdRetention.h"
+#include "UvdState.h"
+
+#define REPORT_INTERVAL (10 * 1000000LL)
+#define RING_READ_RECORDS 1024
+
+static void printReport(TileServer *server, TileCache *cache, UvdState *state)
+{
+    unsigned long tileCount, hits, misses;
+    cache->getCounts(&tileCount, &hits, &misses);
+
+    state->lock();
+    unsigned long pointCount = (unsigned long)state->points()->size();
+    state->unlock();
+
+    printf("%lu points, %lu requests, %lu tile hits, %lu renderings, %lu tiles cached.\n",
+           pointCount, server->requestCount(), hits, misses, tileCount);
+    fflush(stdout);
+}
+
+static bool ingestFeed(UvdState *state, const char *host, int port, long long stopLocal, TileServer *server, TileCache *cache)
+{
+    Socket socket = SocketConnect(host, port);
+    if (socket == SOCKET_INVALID)
+    {
+        printf("can't connect to %s:%d.\n", host, port);
+        return false;
+    }
+
+    // binary frames if the feed takes the hello, its lines otherwise
+    SocketSend(socket, WIRE_HELLO "\n", (int)strlen(WIRE_HELLO "\n"));
+
+    RtlUvdParser *parser = new RtlUvdParser(state);
+    RtlUvdFeedReader *reader = new RtlUvdFeedReader();
+    long long reportLocal = ClockMicroseconds();
+
+    while (stopLocal < 0 || ClockMicroseconds() < stopLocal)
+    {
+        int space;
+        char *buffer = reader->space(&space);
+        int received = SocketRecv(socket, buffer, space);
+        if (received <= 0) break;
+        reader->append(received);
+
+        char *line;
+        const RingRecord *record;
+        FeedItem item;
+        while ((item = reader->next(&line, &record)) != FeedItemNone)
+        {
+            if (item == FeedItemRecord) parser->processRecord(record);
+            else if (line[0] != '#') parser->processLine(line);
+        }
+
+        if (ClockMicroseconds() >= reportLocal + REPORT_INTERVAL)
+        {
+            printReport(server, cache, state);
+            reportLocal = ClockMicroseconds();
+        }
+    }
+
+    printf("feed from %s:%d closed.\n", host, port);
+
+    SocketClose(socket);
+    delete reader;
+    delete parser;
+    return true;
+}
+
+static bool ingestRing(UvdState *state, const char *name, long long stopLocal, TileServer *server, TileCache *cache)
+{
+    RecordRing ring;
+    if (!ring.open(name))
+    {
+        printf("no ring %s.\n", name);
+        return false;
+    }
+
+    RtlUvdParser *parser = new RtlUvdParser(state);
+    RingRecord *records = (RingRecord *)malloc(RING_READ_RECORDS * sizeof(RingRecord));
+    long long reportLocal = ClockMicroseconds();
+
+    while (stopLocal < 0 || ClockMicroseconds() < stopLocal)
+    {
+        int count = ring.read(records, RING_READ_RECORDS);
+        if (count == 0)
+        {
+            if (ring.isClosed() && (count = ring.read(records, RING_READ_RECORDS)) == 0) break;
+            if (count == 0) ring.wait(100);
+        }
+
+        for (int i = 0; i < count; i++)
+        {
+            parser->processRecord(&records[i]);
+        }
+
+        if (ClockMicroseconds() >= reportLocal + REPORT_INTERVAL)
+        {
+            printReport(server, cache, state);
+            reportLocal = ClockMicroseconds();
+        }
+    }
+
+    printf("ring %s closed, %llu records dropped by it.\n", name, ring.droppedCount());
+
+    free(records);
+    delete parser;
+    return true;
+}
+
+static bool loadLogs(UvdState *state, std::vector<const char *> *paths)
+{
+    RtlUvdArchive *archive = new RtlUvdArchive(state);
+    for (size_t i = 0; i < paths->size(); i++)
+    {
+        if (archive->addFile((*paths)[i])) continue;
+        if (archive->addDirectory((*paths)[i], ARCHIVE_DAY_ANY, ARCHIVE_DAY_ANY) > 0) continue;
+
+        printf("%s: no daily logs.\n", (*paths)[i]);
+    }
+
+    bool isLoaded = archive->load(ThreadProcessorCount());
+    if (isLoaded)
+    {
+        printf("%lu file(s) merged: %lu points, %lu occurrences.\n", (unsigned long)archive->fileCount(),
+               (unsigned long)state->points()->size(), (unsigned long)state->occurrences()->size());
+    }
+    else
+    {
+        printf("nothing loaded.\n");
+    }
+
+    delete archive;
+    return isLoaded;
+}
+
+static void printUsage()
+{
+    printf("usage: uvdg-tiles [--listen N] [--threads N] [--tile-height N] [--cache MB] [--seconds N]\n");
+    printf("                  [--host H] [--port N] [--shm NAME] [--spill DIR] [--hide-tail-numbers] [--verbose] [LOG...]\n");
+    printf("  --listen N        HTTP port (8080)\n");
+    printf("  --threads N       connections served at once (%d)\n", TILE_SERVER_THREADS);
+    printf("  --tile-height N   tile rows for the altitudes (256)\n");
+    printf("  --cache MB        rendered tiles kept (%d)\n", TILE_CACHE_BYTES / (1024 * 1024));
+    printf("  --seconds N       stop after N seconds (0 = never)\n");
+    printf("  --host, --port    rtl-uvd feed to follow (127.0.0.1:31003)\n");
+    printf("  --shm NAME        follow the shared-memory ring NAME of a local decoder instead\n");
+    printf("  --spill DIR       retention spill directory of the feed, as in the app\n");
+    printf("  --hide-tail-numbers   mask tail numbers of merged logs\n");
+    printf("  LOG...            serve daily logs (or directories of them) instead of a feed\n");
+}
+
+int main(int argc, char **argv)
+{
+    int listenPort = 8080;
+    int threadCount = TILE_SERVER_THREADS;
+    int tileHeight = 256;
+    int cacheMegabytes = TILE_CACHE_BYTES / (1024 * 1024);
+    int seconds = 0;
+    const char *host = "127.0.0.1";
+    int port = 31003;
+    const char *ringName = NULL;
+    const char *spillDirectory = NULL;
+    bool hidesTailNumbers = false;
+    bool isVerbose = false;
+    std::vector<const char *> paths;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--listen") == 0 && i + 1 < argc) listenPort = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) threadCount = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--tile-height") == 0 && i + 1 < argc) tileHeight = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--cache") == 0 && i + 1 < argc) cacheMegabytes = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) seconds = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--host") == 0 && i + 1 < argc) host = argv[++i];
+        else if (strcmp(argv[i], "--port") == 0 && i + 1 < argc) port = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--shm") == 0 && i + 1 < argc) ringName = argv[++i];
+        else if (strcmp(argv[i], "--spill") == 0 && i + 1 < argc) spillDirectory = argv[++i];
+        else if (strcmp(argv[i], "--hide-tail-numbers") == 0) hidesTailNumbers = true;
+        else if (strcmp(argv[i], "--verbose") == 0) isVerbose = true;
+        else if (strncmp(argv[i], "--", 2) == 0)
+        {
+            printUsage();
+            return 1;
+        }
+        else paths.push_back(argv[i]);
+    }
+
+    if (threadCount < 1) threadCount = 1;
+    if (tileHeight < 2) tileHeight = 2;
+
+    UvdLogSetEnabled(isVerbose);
+
+    UvdState *state = new UvdState();
+    state->setHidesTailNumbers(hidesTailNumbers);
+    UvdRetention *retention = NULL;
+
+    if (paths.size() > 0)
+    {
+        if (!loadLogs(state, &paths)) return 2;
+    }
+    else
+    {
+        // a long running feed is bounded as in the app
+        state->startRealtimeMode();
+        RetentionPolicy policy;
+        UvdRetention::defaultPolicy(&policy);
+        if (spillDirectory != NULL) sprintf(policy.directory, "%.1000s", spillDirectory);
+        retention = new UvdRetention(state, &policy);
+    }
+
+    TileCache *cache = new TileCache(state, (size_t)cacheMegabytes * 1024 * 1024);
+    TileServer *server = new TileServer(state, cache, tileHeight);
+    if (!server->start(listenPort, threadCount)) return 1;
+
+    printf("serving http://127.0.0.1:%d/\n", listenPort);
+    fflush(stdout);
+
+    long long startLocal = ClockMicroseconds();
+    long long stopLocal = seconds > 0 ? startLocal + seconds * 1000000LL : -1;
+
+    if (paths.size() == 0)
+    {
+        bool isFed = ringName != NULL ? ingestRing(state, ringName, stopLocal, server, cache)
+                                      : ingestFeed(state, host, port, stopLocal, server, cache);
+        if (!isFed) stopLocal = ClockMicroseconds();
+    }
+
+    // what was loaded, or the feed left, stays served
+    long long reportLocal = ClockMicroseconds();
+    while (stopLocal < 0 || ClockMicroseconds() < stopLocal)
+    {
+        ThreadSleep(100);
+        if (ClockMicroseconds() >= reportLocal + REPORT_INTERVAL)
+        {
+            printReport(server, cache, state);
+            reportLocal = ClockMicroseconds();
+        }
+    }
+
+    printReport(server, cache, state);
+
+    server->stop();
+    delete server;
+    delete cache;
+    delete retention;
+    delete state;
+
+    return 0;
+}